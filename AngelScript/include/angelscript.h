@@ -615,6 +615,10 @@ public:
 	virtual int         SetDefaultNamespace(const char *nameSpace) = 0;
 	virtual const char *GetDefaultNamespace() const = 0;
 
+	// Configuration snapshots
+	virtual int         BeginConfigSnapshot(asIBinaryStream *in, asQWORD fingerprint) = 0;
+	virtual int         EndConfigSnapshot(asIBinaryStream *out, asUINT *parsedDeclarations = 0) = 0;
+
 	// Script modules
 	virtual asIScriptModule *GetModule(const char *module, asEGMFlags flag = asGM_ONLY_IF_EXISTS) = 0;
 	virtual int              DiscardModule(const char *module) = 0;
@@ -713,6 +717,7 @@ public:
 	virtual const char *GetGlobalVarDeclaration(asUINT index, bool includeNamespace = false) const = 0;
 	virtual int         GetGlobalVar(asUINT index, const char **name, const char **nameSpace = 0, int *typeId = 0, bool *isConst = 0) const = 0;
 	virtual void       *GetAddressOfGlobalVar(asUINT index) = 0;
+	virtual void       *GetAddressOfGlobalVarStorage(asUINT index) = 0;
 	virtual int         RemoveGlobalVar(asUINT index) = 0;
 
 	// Type identification
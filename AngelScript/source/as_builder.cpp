@@ -46,6 +46,7 @@
 #include "as_texts.h"
 #include "as_scriptobject.h"
 #include "as_debug.h"
+#include "as_configsnapshot.h"
 
 BEGIN_AS_NAMESPACE
 
@@ -53,12 +54,10 @@ BEGIN_AS_NAMESPACE
 
 // asCSymbolTable template specializations for sGlobalVariableDescription entries
 template<>
-void asCSymbolTable<sGlobalVariableDescription>::GetKey(const sGlobalVariableDescription *entry, asCString &key) const
+void asCSymbolTable<sGlobalVariableDescription>::GetKey(const sGlobalVariableDescription *entry, asSNameSpaceNamePair &key) const
 {
-	// TODO: optimize: The key should be a struct, composed of namespace pointer and the name string
-	asSNameSpace *ns = entry->property->nameSpace;
-	asCString name = entry->property->name;
-	key = ns->name + "::" + name;
+	asASSERT( m_names );
+	key = asSNameSpaceNamePair(entry->property->nameSpace, m_names->Intern(entry->property->name));
 }
 
 // Comparator for exact variable search
@@ -85,6 +84,10 @@ asCBuilder::asCBuilder(asCScriptEngine *engine, asCModule *module)
 {
 	this->engine = engine;
 	this->module = module;
+
+#ifndef AS_NO_COMPILER
+	globVariables.SetInternTable(&engine->internedNames);
+#endif
 }
 
 asCBuilder::~asCBuilder()
@@ -732,15 +735,24 @@ void asCBuilder::CompileFunctions()
 // Called from module and engine
 int asCBuilder::ParseDataType(const char *datatype, asCDataType *result, asSNameSpace *implicitNamespace, bool isReturnType)
 {
+	// While the engine has a configuration snapshot open the type may be restored instead of parsed
+	asCConfigSnapshot *snapshot = engine->configSnapshot;
+	int r;
+	if( snapshot && snapshot->RestoreDataType(datatype, implicitNamespace, isReturnType, result, &r) )
+		return r;
+
 	Reset();
 
 	asCScriptCode source;
 	source.SetCode("", datatype, true);
 
 	asCParser parser(this);
-	int r = parser.ParseDataType(&source, isReturnType);
+	r = parser.ParseDataType(&source, isReturnType);
 	if( r < 0 )
+	{
+		if( snapshot ) snapshot->StoreDataType(datatype, implicitNamespace, isReturnType, asINVALID_TYPE, 0);
 		return asINVALID_TYPE;
+	}
 
 	// Get data type and property name
 	asCScriptNode *dataType = parser.GetScriptNode()->firstChild;
@@ -750,7 +762,12 @@ int asCBuilder::ParseDataType(const char *datatype, asCDataType *result, asSName
 		*result = ModifyDataTypeFromNode(*result, dataType->next, &source, 0, 0);
 
 	if( numErrors > 0 )
+	{
+		if( snapshot ) snapshot->StoreDataType(datatype, implicitNamespace, isReturnType, asINVALID_TYPE, 0);
 		return asINVALID_TYPE;
+	}
+
+	if( snapshot ) snapshot->StoreDataType(datatype, implicitNamespace, isReturnType, asSUCCESS, result);
 
 	return asSUCCESS;
 }
@@ -796,43 +813,70 @@ int asCBuilder::VerifyProperty(asCDataType *dt, const char *decl, asCString &nam
 			return asINVALID_OBJECT;
 	}
 
-	// Check property declaration and type
+	// Check property declaration and type. While the engine has a configuration
+	// snapshot open they may be restored instead of parsed, but the name is
+	// checked for conflicts either way
+	asCObjectType *objType = dt ? dt->GetObjectType() : 0;
 	asCScriptCode source;
-	source.SetCode(TXT_PROPERTY, decl, true);
-
 	asCParser parser(this);
-	int r = parser.ParsePropertyDeclaration(&source);
-	if( r < 0 )
-		return asINVALID_DECLARATION;
+	asCScriptNode *nameNode = 0;
+	asCConfigSnapshot *snapshot = engine->configSnapshot;
+	int r;
+	if( snapshot && snapshot->RestoreProperty(decl, objType, ns, name, type, &r) )
+	{
+		if( r < 0 )
+			return r;
+	}
+	else
+	{
+		source.SetCode(TXT_PROPERTY, decl, true);
 
-	// Get data type and property name
-	asCScriptNode *dataType = parser.GetScriptNode()->firstChild;
+		r = parser.ParsePropertyDeclaration(&source);
+		if( r < 0 )
+		{
+			if( snapshot ) snapshot->StoreProperty(decl, objType, ns, asINVALID_DECLARATION, 0, 0);
+			return asINVALID_DECLARATION;
+		}
 
-	asCScriptNode *nameNode = dataType->next;
+		// Get data type and property name
+		asCScriptNode *dataType = parser.GetScriptNode()->firstChild;
 
-	// If an object property is registered, then use the
-	// object's namespace, otherwise use the specified namespace
-	type = CreateDataTypeFromNode(dataType, &source, dt ? dt->GetObjectType()->nameSpace : ns);
-	name.Assign(&decl[nameNode->tokenPos], nameNode->tokenLength);
+		nameNode = dataType->next;
 
-	// Validate that the type really can be a registered property
-	// We cannot use CanBeInstanciated, as it is allowed to register
-	// properties of type that cannot otherwise be instanciated
-	if( type.GetFuncDef() && !type.IsObjectHandle() )
-	{
-		// Function definitions must always be handles
-		return asINVALID_DECLARATION;
+		// If an object property is registered, then use the
+		// object's namespace, otherwise use the specified namespace
+		type = CreateDataTypeFromNode(dataType, &source, dt ? dt->GetObjectType()->nameSpace : ns);
+		name.Assign(&decl[nameNode->tokenPos], nameNode->tokenLength);
+
+		// Validate that the type really can be a registered property
+		// We cannot use CanBeInstanciated, as it is allowed to register
+		// properties of type that cannot otherwise be instanciated
+		if( type.GetFuncDef() && !type.IsObjectHandle() )
+		{
+			// Function definitions must always be handles
+			if( snapshot ) snapshot->StoreProperty(decl, objType, ns, asINVALID_DECLARATION, 0, 0);
+			return asINVALID_DECLARATION;
+		}
+
+		// A type with errors isn't stored, so it is parsed and reported again next time
+		if( snapshot )
+		{
+			if( numErrors > 0 )
+				snapshot->StoreProperty(decl, objType, ns, asSUCCESS, 0, 0);
+			else
+				snapshot->StoreProperty(decl, objType, ns, asSUCCESS, &name, &type);
+		}
 	}
 
 	// Verify property name
 	if( dt )
 	{
-		if( CheckNameConflictMember(dt->GetObjectType(), name.AddressOf(), nameNode, &source, true) < 0 )
+		if( CheckNameConflictMember(dt->GetObjectType(), name.AddressOf(), nameNode, nameNode ? &source : 0, true) < 0 )
 			return asNAME_TAKEN;
 	}
 	else
 	{
-		if( CheckNameConflict(name.AddressOf(), nameNode, &source, ns) < 0 )
+		if( CheckNameConflict(name.AddressOf(), nameNode, nameNode ? &source : 0, ns) < 0 )
 			return asNAME_TAKEN;
 	}
 
@@ -915,6 +959,24 @@ int asCBuilder::ParseFunctionDeclaration(asCObjectType *objType, const char *dec
 {
 	asASSERT( objType || ns );
 
+	// While the engine has a configuration snapshot open the
+	// declarations of registered functions may be restored instead of parsed
+	asCConfigSnapshot *snapshot = isSystemFunction ? engine->configSnapshot : 0;
+	if( snapshot == 0 )
+		return ParseFunctionDeclarationText(objType, decl, func, isSystemFunction, paramAutoHandles, returnAutoHandle, ns);
+
+	int r;
+	if( snapshot->RestoreFunction(decl, objType, ns, func, paramAutoHandles, returnAutoHandle, &r) )
+		return r;
+
+	r = ParseFunctionDeclarationText(objType, decl, func, isSystemFunction, paramAutoHandles, returnAutoHandle, ns);
+	snapshot->StoreFunction(decl, objType, ns, r, func, paramAutoHandles, returnAutoHandle);
+
+	return r;
+}
+
+int asCBuilder::ParseFunctionDeclarationText(asCObjectType *objType, const char *decl, asCScriptFunction *func, bool isSystemFunction, asCArray<bool> *paramAutoHandles, bool *returnAutoHandle, asSNameSpace *ns)
+{
 	// TODO: Can't we use GetParsedFunctionDetails to do most of what is done in this function?
 
 	Reset();
@@ -1662,6 +1724,7 @@ void asCBuilder::CompileGlobalVariables()
 	asCScriptFunction *initFunc = 0;
 
 	asCSymbolTable<asCGlobalProperty> initOrder;
+	initOrder.SetInternTable(&engine->internedNames);
 
 	// We first try to compile all the primitive global variables, and only after that
 	// compile the non-primitive global variables. This permits the constructors
@@ -3981,15 +4044,13 @@ void asCBuilder::GetFunctionDescriptions(const char *name, asCArray<int> &funcs,
 			funcs.PushLast(module->bindInformations[n]->importedFunctionSignature->id);
 	}
 
-	// TODO: optimize: Linear search. The registered global functions should be stored in a symbol table too
-	for( n = 0; n < engine->registeredGlobalFuncs.GetLength(); n++ )
+	const asCArray<asCScriptFunction *> &registeredFuncs = engine->GetRegisteredGlobalFuncs(ns, name);
+	for( n = 0; n < registeredFuncs.GetLength(); n++ )
 	{
-		asCScriptFunction *f = engine->registeredGlobalFuncs[n];
+		asCScriptFunction *f = registeredFuncs[n];
 		if( f &&
 			f->funcType == asFUNC_SYSTEM &&
-			f->objectType == 0 &&
-			f->nameSpace == ns &&
-			f->name == name )
+			f->objectType == 0 )
 		{
 			// Verify if the module has access to the function
 			if( module->accessMask & f->accessMask )
@@ -81,7 +81,7 @@ struct sGlobalVariableDescription
 
 // asCSymbolTable template specializations for sGlobalVariableDescription entries
 template<>
-void asCSymbolTable<sGlobalVariableDescription>::GetKey(const sGlobalVariableDescription *entry, asCString &key) const;
+void asCSymbolTable<sGlobalVariableDescription>::GetKey(const sGlobalVariableDescription *entry, asSNameSpaceNamePair &key) const;
 
 struct sPropertyInitializer
 {
@@ -157,6 +157,8 @@ protected:
 
 	void               Reset();
 
+	int                ParseFunctionDeclarationText(asCObjectType *type, const char *decl, asCScriptFunction *func, bool isSystemFunction, asCArray<bool> *paramAutoHandles, bool *returnAutoHandle, asSNameSpace *ns);
+
 	void               WriteInfo(const asCString &scriptname, const asCString &msg, int r, int c, bool preMessage);
 	void               WriteInfo(const asCString &msg, asCScriptCode *file, asCScriptNode *node);
 	void               WriteError(const asCString &scriptname, const asCString &msg, int r, int c);
@@ -107,6 +107,11 @@
 // if the new order of the member initialization caused null pointer exceptions in older
 // scripts (e.g. if a base class accessed members of a derived class through a virtual method).
 
+// AS_NO_SIMD
+// Turns off the SSE2 scanning of white space and identifiers in the tokenizer. The
+// scanner is used automatically when the target supports SSE2, otherwise the tokenizer
+// scans one character at a time.
+
 
 //
 // Library usage
@@ -153,6 +158,10 @@
 // AS_NO_MEMORY_H
 // Some compilers don't come with the memory.h header file.
 
+// AS_CAN_USE_CPP11
+// This flag is automatically defined when the compiler supports C++11 rvalue
+// references. The library then uses move operations to avoid copying strings.
+
 
 
 //
@@ -1019,6 +1028,22 @@
 #endif
 
 
+// Detect targets where the tokenizer can scan with SSE2
+#if !defined(AS_NO_SIMD) && !defined(AS_USE_SSE2)
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define AS_USE_SSE2 1
+	#endif
+#endif
+
+
+// Detect compilers that support move semantics
+#if !defined(AS_CAN_USE_CPP11)
+	#if (defined(_MSC_VER) && _MSC_VER >= 1600) || (defined(__cplusplus) && __cplusplus >= 201103L)
+		#define AS_CAN_USE_CPP11 1
+	#endif
+#endif
+
+
 // The assert macro
 #if defined(ANDROID)
 	#if defined(AS_DEBUG)
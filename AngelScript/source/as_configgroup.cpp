@@ -119,6 +119,8 @@ void asCConfigGroup::RemoveConfiguration(asCScriptEngine *engine, bool notUsed)
 	// Remove global functions
 	for( n = 0; n < scriptFunctions.GetLength(); n++ )
 	{
+		// Remove it from the index before releasing it, as the name is needed to find it
+		engine->RemoveFromGlobalFuncIndex(scriptFunctions[n]);
 		scriptFunctions[n]->Release();
 		engine->registeredGlobalFuncs.RemoveValue(scriptFunctions[n]);
 		if( engine->stringFactory == scriptFunctions[n] )
@@ -156,6 +158,7 @@ void asCConfigGroup::RemoveConfiguration(asCScriptEngine *engine, bool notUsed)
 #endif
 
 				engine->objectTypes.RemoveIndex(idx);
+				engine->RemoveFromObjectTypeIndex(t);
 
 				if( t->flags & asOBJ_TYPEDEF )
 					engine->registeredTypeDefs.RemoveValue(t);
@@ -0,0 +1,653 @@
+/*
+   AngelCode Scripting Library
+   Copyright (c) 2003-2012 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   The original version of this library can be located at:
+   http://www.angelcode.com/angelscript/
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+
+//
+// as_configsnapshot.cpp
+//
+// Records what the declarations given to the Register* methods parsed to,
+// so that a later launch registering the same interface can restore the
+// results instead of parsing every declaration again
+//
+
+#include <string.h> // memcpy(), memcmp(), strlen()
+
+#include "as_config.h"
+#include "as_configsnapshot.h"
+#include "as_scriptengine.h"
+#include "as_scriptfunction.h"
+#include "as_objecttype.h"
+
+BEGIN_AS_NAMESPACE
+
+// Snapshots start with "ASCS", then the library version, pointer size and
+// application fingerprint they were recorded with
+static const asDWORD SNAPSHOT_MAGIC = 0x53435341;
+
+asCConfigSnapshot::asCConfigSnapshot(asCScriptEngine *engine, asQWORD fingerprint)
+{
+	this->engine      = engine;
+	this->fingerprint = fingerprint;
+
+	readPos     = 0;
+	readError   = false;
+	parsedCount = 0;
+}
+
+int asCConfigSnapshot::Load(asIBinaryStream *in)
+{
+	asDWORD magic, version, ptrSize, size;
+	asQWORD savedFingerprint;
+	in->Read(&magic, sizeof(magic));
+	in->Read(&version, sizeof(version));
+	in->Read(&ptrSize, sizeof(ptrSize));
+	in->Read(&savedFingerprint, sizeof(savedFingerprint));
+	in->Read(&size, sizeof(size));
+
+	// A snapshot from another build of the library or of the application is ignored,
+	// and the configuration is parsed and recorded from scratch
+	if( magic != SNAPSHOT_MAGIC ||
+		version != ANGELSCRIPT_VERSION ||
+		ptrSize != AS_PTR_SIZE ||
+		savedFingerprint != fingerprint )
+		return asINVALID_ARG;
+
+	input.Allocate(size, false);
+	if( input.GetCapacity() < size )
+		return asOUT_OF_MEMORY;
+	input.SetLength(size);
+	in->Read(input.AddressOf(), size);
+
+	readPos   = 0;
+	readError = false;
+
+	return asSUCCESS;
+}
+
+void asCConfigSnapshot::Save(asIBinaryStream *out)
+{
+	asDWORD magic   = SNAPSHOT_MAGIC;
+	asDWORD version = ANGELSCRIPT_VERSION;
+	asDWORD ptrSize = AS_PTR_SIZE;
+	asDWORD size    = (asDWORD)output.GetLength();
+	out->Write(&magic, sizeof(magic));
+	out->Write(&version, sizeof(version));
+	out->Write(&ptrSize, sizeof(ptrSize));
+	out->Write(&fingerprint, sizeof(fingerprint));
+	out->Write(&size, sizeof(size));
+	if( size )
+		out->Write(output.AddressOf(), size);
+}
+
+asUINT asCConfigSnapshot::GetParsedCount() const
+{
+	return parsedCount;
+}
+
+bool asCConfigSnapshot::RestoreDataType(const char *decl, asSNameSpace *ns, bool isReturnType, asCDataType *result, int *r)
+{
+	BuildKey(asENTRY_DATATYPE, decl, 0, ns, isReturnType);
+
+	asUINT entryStart, payloadEnd;
+	if( !BeginRestore(&entryStart, &payloadEnd, r) )
+		return false;
+	if( *r < 0 )
+		return true;
+
+	asCDataType dt;
+	if( !ReadDataType(&dt) || !EndRestore(entryStart, payloadEnd) )
+		return false;
+
+	*result = dt;
+	return true;
+}
+
+void asCConfigSnapshot::StoreDataType(const char *decl, asSNameSpace *ns, bool isReturnType, int r, const asCDataType *result)
+{
+	BuildKey(asENTRY_DATATYPE, decl, 0, ns, isReturnType);
+	asUINT payloadStart = BeginStore();
+	bool isStored = r >= 0 && WriteDataType(output, *result);
+	EndStore(payloadStart, r, isStored);
+}
+
+bool asCConfigSnapshot::RestoreFunction(const char *decl, asCObjectType *objType, asSNameSpace *ns, asCScriptFunction *func, asCArray<bool> *paramAutoHandles, bool *returnAutoHandle, int *r)
+{
+	BuildKey(asENTRY_FUNCTION, decl, objType, ns, false);
+
+	asUINT entryStart, payloadEnd;
+	if( !BeginRestore(&entryStart, &payloadEnd, r) )
+		return false;
+	if( *r < 0 )
+		return true;
+
+	// Read everything before touching the function, so a bad entry leaves it as it was
+	asSNameSpace *funcNameSpace = ReadNameSpace();
+	asUINT nameLength;
+	const char *name = ReadString(&nameLength);
+	asCDataType returnType;
+	if( !ReadDataType(&returnType) )
+		return false;
+	asBYTE flags;
+	ReadData(&flags, 1);
+	asUINT paramCount = ReadUInt();
+	if( readError || paramCount > payloadEnd - readPos )
+	{
+		EndReplay();
+		return false;
+	}
+
+	asCArray<asCDataType>      parameterTypes(paramCount);
+	asCArray<asETypeModifiers> inOutFlags(paramCount);
+	asCArray<bool>             autoHandles(paramCount);
+	asCArray<const char *>     defaultArgs(paramCount);
+	for( asUINT n = 0; n < paramCount; n++ )
+	{
+		asCDataType type;
+		if( !ReadDataType(&type) )
+			return false;
+		parameterTypes.PushLast(type);
+		inOutFlags.PushLast((asETypeModifiers)ReadUInt());
+
+		asBYTE paramFlags;
+		ReadData(&paramFlags, 1);
+		autoHandles.PushLast((paramFlags & 1) ? true : false);
+
+		asUINT argLength;
+		defaultArgs.PushLast((paramFlags & 2) ? ReadString(&argLength) : 0);
+	}
+
+	if( funcNameSpace == 0 || !EndRestore(entryStart, payloadEnd) )
+	{
+		EndReplay();
+		return false;
+	}
+
+	func->nameSpace = funcNameSpace;
+	func->name.Assign(name, nameLength);
+	func->returnType = returnType;
+	func->isReadOnly = (flags & 2) ? true : false;
+	if( returnAutoHandle ) *returnAutoHandle = (flags & 1) ? true : false;
+
+	func->parameterTypes = parameterTypes;
+	func->inOutFlags     = inOutFlags;
+	func->defaultArgs.Allocate(paramCount, false);
+	for( asUINT n = 0; n < paramCount; n++ )
+	{
+		asCString *defaultArgStr = 0;
+		if( defaultArgs[n] )
+		{
+			defaultArgStr = asNEW(asCString)(defaultArgs[n]);
+		}
+		func->defaultArgs.PushLast(defaultArgStr);
+	}
+	if( paramAutoHandles ) *paramAutoHandles = autoHandles;
+
+	return true;
+}
+
+void asCConfigSnapshot::StoreFunction(const char *decl, asCObjectType *objType, asSNameSpace *ns, int r, const asCScriptFunction *func, const asCArray<bool> *paramAutoHandles, const bool *returnAutoHandle)
+{
+	BuildKey(asENTRY_FUNCTION, decl, objType, ns, false);
+	asUINT payloadStart = BeginStore();
+	bool isStored = false;
+	if( r >= 0 && func->nameSpace )
+	{
+		WriteNameSpace(output, func->nameSpace);
+		WriteString(output, func->name.AddressOf(), (asUINT)func->name.GetLength());
+		isStored = WriteDataType(output, func->returnType);
+
+		asBYTE flags = ((returnAutoHandle && *returnAutoHandle) ? 1 : 0) | (func->isReadOnly ? 2 : 0);
+		WriteData(output, &flags, 1);
+
+		asUINT paramCount = (asUINT)func->parameterTypes.GetLength();
+		WriteUInt(output, paramCount);
+		for( asUINT n = 0; isStored && n < paramCount; n++ )
+		{
+			isStored = WriteDataType(output, func->parameterTypes[n]);
+			WriteUInt(output, func->inOutFlags[n]);
+
+			const asCString *defaultArg = func->defaultArgs[n];
+			asBYTE paramFlags = ((paramAutoHandles && (*paramAutoHandles)[n]) ? 1 : 0) | (defaultArg ? 2 : 0);
+			WriteData(output, &paramFlags, 1);
+			if( defaultArg )
+				WriteString(output, defaultArg->AddressOf(), (asUINT)defaultArg->GetLength());
+		}
+	}
+	EndStore(payloadStart, r, isStored);
+}
+
+bool asCConfigSnapshot::RestoreProperty(const char *decl, asCObjectType *objType, asSNameSpace *ns, asCString &name, asCDataType &type, int *r)
+{
+	BuildKey(asENTRY_PROPERTY, decl, objType, ns, false);
+
+	asUINT entryStart, payloadEnd;
+	if( !BeginRestore(&entryStart, &payloadEnd, r) )
+		return false;
+	if( *r < 0 )
+		return true;
+
+	asUINT nameLength;
+	const char *propName = ReadString(&nameLength);
+	asCDataType dt;
+	if( !ReadDataType(&dt) || !EndRestore(entryStart, payloadEnd) )
+		return false;
+
+	name.Assign(propName, nameLength);
+	type = dt;
+	return true;
+}
+
+void asCConfigSnapshot::StoreProperty(const char *decl, asCObjectType *objType, asSNameSpace *ns, int r, const asCString *name, const asCDataType *type)
+{
+	BuildKey(asENTRY_PROPERTY, decl, objType, ns, false);
+	asUINT payloadStart = BeginStore();
+	bool isStored = false;
+	if( r >= 0 && name && type )
+	{
+		WriteString(output, name->AddressOf(), (asUINT)name->GetLength());
+		isStored = WriteDataType(output, *type);
+	}
+	EndStore(payloadStart, r, isStored);
+}
+
+void asCConfigSnapshot::BuildKey(asBYTE entryType, const char *decl, asCObjectType *objType, asSNameSpace *ns, bool isReturnType)
+{
+	key.SetLength(0);
+	asBYTE b[2] = { entryType, (asBYTE)(isReturnType ? 1 : 0) };
+	WriteData(key, b, 2);
+	WriteNameSpace(key, ns);
+
+	// A type that can't be stored still gets a key of its name, so the declaration
+	// is recognized on the next launch and parsed without ending the replay
+	WriteObjectType(key, objType);
+	WriteString(key, decl, (asUINT)strlen(decl));
+}
+
+bool asCConfigSnapshot::BeginRestore(asUINT *entryStart, asUINT *payloadEnd, int *r)
+{
+	if( readPos >= input.GetLength() )
+		return false;
+
+	// Entries are a key length, the key, a byte telling what the entry
+	// holds, and the length of the result followed by the result itself
+	*entryStart = readPos;
+	asUINT keyLength = ReadUInt();
+	if( readError ||
+		keyLength != key.GetLength() ||
+		keyLength > input.GetLength() - readPos ||
+		memcmp(input.AddressOf() + readPos, key.AddressOf(), keyLength) != 0 )
+	{
+		EndReplay();
+		return false;
+	}
+	readPos += keyLength;
+
+	asBYTE result;
+	ReadData(&result, 1);
+	asUINT payloadLength = ReadUInt();
+	if( readError || payloadLength > input.GetLength() - readPos )
+	{
+		EndReplay();
+		return false;
+	}
+	*payloadEnd = readPos + payloadLength;
+
+	// Declarations that failed to parse are common, as registering a type first
+	// checks that its name doesn't parse as a type. They are parsed again only
+	// when the application listens for the messages the parser would write
+	if( result == asRESULT_FAILED && !engine->msgCallback )
+	{
+		*r = (int)ReadUInt();
+		return EndRestore(*entryStart, *payloadEnd);
+	}
+
+	// Otherwise a declaration without a stored result is parsed
+	// again, and the replay continues with the next entry
+	if( result != asRESULT_STORED )
+	{
+		readPos = *payloadEnd;
+		return false;
+	}
+
+	*r = 0;
+	return true;
+}
+
+bool asCConfigSnapshot::EndRestore(asUINT entryStart, asUINT payloadEnd)
+{
+	if( readError || readPos != payloadEnd )
+	{
+		EndReplay();
+		return false;
+	}
+
+	// The restored entry is still current, so it is recorded unchanged
+	WriteData(output, input.AddressOf() + entryStart, payloadEnd - entryStart);
+	return true;
+}
+
+void asCConfigSnapshot::EndReplay()
+{
+	readPos = (asUINT)input.GetLength();
+}
+
+asUINT asCConfigSnapshot::BeginStore()
+{
+	WriteUInt(output, (asUINT)key.GetLength());
+	WriteData(output, key.AddressOf(), (asUINT)key.GetLength());
+	asBYTE result = asRESULT_NOT_STORED;
+	WriteData(output, &result, 1);
+	WriteUInt(output, 0);
+
+	return (asUINT)output.GetLength();
+}
+
+void asCConfigSnapshot::EndStore(asUINT payloadStart, int r, bool isStored)
+{
+	asBYTE result = asRESULT_STORED;
+	if( r < 0 )
+	{
+		output.SetLength(payloadStart);
+		WriteUInt(output, (asUINT)r);
+		result = asRESULT_FAILED;
+	}
+	else if( !isStored )
+	{
+		output.SetLength(payloadStart);
+		result = asRESULT_NOT_STORED;
+	}
+
+	asUINT payloadLength = (asUINT)output.GetLength() - payloadStart;
+	output[payloadStart - sizeof(asUINT) - 1] = result;
+	memcpy(output.AddressOf() + payloadStart - sizeof(asUINT), &payloadLength, sizeof(asUINT));
+
+	parsedCount++;
+}
+
+void asCConfigSnapshot::WriteData(asCArray<asBYTE> &buf, const void *data, asUINT size)
+{
+	size_t pos = buf.GetLength();
+	if( pos + size > buf.GetCapacity() )
+		buf.Allocate(2 * (pos + size), true);
+	buf.SetLength(pos + size);
+	memcpy(buf.AddressOf() + pos, data, size);
+}
+
+void asCConfigSnapshot::WriteUInt(asCArray<asBYTE> &buf, asUINT value)
+{
+	WriteData(buf, &value, sizeof(value));
+}
+
+void asCConfigSnapshot::WriteString(asCArray<asBYTE> &buf, const char *str, asUINT length)
+{
+	// The terminator is stored too, so restored names can be used in place
+	WriteUInt(buf, length);
+	WriteData(buf, str, length);
+	asBYTE terminator = 0;
+	WriteData(buf, &terminator, 1);
+}
+
+void asCConfigSnapshot::WriteNameSpace(asCArray<asBYTE> &buf, asSNameSpace *ns)
+{
+	asBYTE hasNameSpace = ns ? 1 : 0;
+	WriteData(buf, &hasNameSpace, 1);
+	if( ns )
+		WriteString(buf, ns->name.AddressOf(), (asUINT)ns->name.GetLength());
+}
+
+bool asCConfigSnapshot::WriteObjectType(asCArray<asBYTE> &buf, asCObjectType *ot)
+{
+	// Types are written the same way asCWriter writes them to saved bytecode
+	char ch;
+	if( ot == 0 )
+	{
+		ch = '\0';
+		WriteData(buf, &ch, 1);
+		return true;
+	}
+
+	if( ot->flags & asOBJ_TEMPLATE_SUBTYPE )
+	{
+		ch = 's';
+		WriteData(buf, &ch, 1);
+		WriteString(buf, ot->name.AddressOf(), (asUINT)ot->name.GetLength());
+		return true;
+	}
+
+	if( !(ot->flags & asOBJ_TYPEDEF) && ot->nameSpace )
+	{
+		asCObjectType *named = engine->GetObjectType(ot->name.AddressOf(), ot->nameSpace);
+		if( ot->templateSubType.GetTokenType() != ttUnrecognizedToken )
+		{
+			// Templates, their instances and specializations are found from the template and the subtype
+			if( named && (named->flags & asOBJ_TEMPLATE) )
+			{
+				ch = 'a';
+				WriteData(buf, &ch, 1);
+				WriteString(buf, ot->name.AddressOf(), (asUINT)ot->name.GetLength());
+				WriteNameSpace(buf, ot->nameSpace);
+				return WriteDataType(buf, ot->templateSubType);
+			}
+		}
+		else if( named == ot )
+		{
+			ch = 'o';
+			WriteData(buf, &ch, 1);
+			WriteString(buf, ot->name.AddressOf(), (asUINT)ot->name.GetLength());
+			WriteNameSpace(buf, ot->nameSpace);
+			return true;
+		}
+	}
+
+	// Types the engine can't look up by name, e.g. the built-in ones, aren't stored
+	ch = 'x';
+	WriteData(buf, &ch, 1);
+	WriteString(buf, ot->name.AddressOf(), (asUINT)ot->name.GetLength());
+	return false;
+}
+
+bool asCConfigSnapshot::WriteDataType(asCArray<asBYTE> &buf, const asCDataType &dt)
+{
+	asUINT tokenType = dt.GetTokenType();
+	WriteUInt(buf, tokenType);
+
+	asBYTE flags = (dt.IsObjectHandle()  ? 1 : 0) |
+	               (dt.IsHandleToConst() ? 2 : 0) |
+	               (dt.IsReference()     ? 4 : 0) |
+	               (dt.IsReadOnly()      ? 8 : 0);
+	WriteData(buf, &flags, 1);
+
+	if( tokenType != ttIdentifier )
+		return true;
+
+	asCScriptFunction *funcDef = dt.GetFuncDef();
+	if( funcDef )
+	{
+		// Function definitions are found by name among the registered ones
+		char ch = 'f';
+		WriteData(buf, &ch, 1);
+		WriteString(buf, funcDef->name.AddressOf(), (asUINT)funcDef->name.GetLength());
+		WriteNameSpace(buf, funcDef->nameSpace);
+		return engine->registeredFuncDefs.IndexOf(funcDef) >= 0;
+	}
+
+	return WriteObjectType(buf, dt.GetObjectType());
+}
+
+void asCConfigSnapshot::ReadData(void *data, asUINT size)
+{
+	if( readError || size > input.GetLength() - readPos )
+	{
+		readError = true;
+		memset(data, 0, size);
+		return;
+	}
+
+	memcpy(data, input.AddressOf() + readPos, size);
+	readPos += size;
+}
+
+asUINT asCConfigSnapshot::ReadUInt()
+{
+	asUINT value;
+	ReadData(&value, sizeof(value));
+	return value;
+}
+
+const char *asCConfigSnapshot::ReadString(asUINT *length)
+{
+	*length = ReadUInt();
+	if( readError || *length >= input.GetLength() - readPos )
+	{
+		readError = true;
+		*length = 0;
+		return "";
+	}
+
+	const char *str = (const char*)input.AddressOf() + readPos;
+	readPos += *length + 1;
+	return str;
+}
+
+asSNameSpace *asCConfigSnapshot::ReadNameSpace()
+{
+	asBYTE hasNameSpace;
+	ReadData(&hasNameSpace, 1);
+	if( !hasNameSpace )
+		return 0;
+
+	asUINT length;
+	const char *name = ReadString(&length);
+	if( readError )
+		return 0;
+
+	asSNameSpace *ns = engine->FindNameSpace(name);
+	if( ns == 0 )
+		readError = true;
+	return ns;
+}
+
+asCObjectType *asCConfigSnapshot::ReadObjectType()
+{
+	char ch;
+	ReadData(&ch, 1);
+	if( readError || ch == '\0' )
+		return 0;
+
+	asUINT length;
+	const char *name = ReadString(&length);
+	if( ch == 's' )
+	{
+		for( asUINT n = 0; n < engine->templateSubTypes.GetLength(); n++ )
+			if( engine->templateSubTypes[n] && engine->templateSubTypes[n]->name == name )
+				return engine->templateSubTypes[n];
+	}
+	else if( ch == 'o' || ch == 'a' )
+	{
+		asSNameSpace *ns = ReadNameSpace();
+		asCObjectType *ot = readError ? 0 : engine->GetObjectType(name, ns);
+		if( ot && ch == 'a' )
+		{
+			asCDataType subType;
+			if( !(ot->flags & asOBJ_TEMPLATE) || !ReadDataType(&subType) )
+				return 0;
+
+			// The template itself is written with its own subtype
+			if( ot->templateSubType.GetObjectType() != subType.GetObjectType() )
+				ot = engine->GetTemplateInstanceType(ot, subType);
+		}
+		if( ot )
+			return ot;
+	}
+
+	readError = true;
+	return 0;
+}
+
+bool asCConfigSnapshot::ReadDataType(asCDataType *dt)
+{
+	eTokenType tokenType = (eTokenType)ReadUInt();
+	asBYTE flags;
+	ReadData(&flags, 1);
+
+	if( tokenType == ttIdentifier )
+	{
+		if( input.GetLength() > readPos && input[readPos] == 'f' )
+		{
+			readPos++;
+			asUINT length;
+			const char *name = ReadString(&length);
+			asSNameSpace *ns = ReadNameSpace();
+
+			asCScriptFunction *funcDef = 0;
+			for( asUINT n = 0; !readError && n < engine->registeredFuncDefs.GetLength(); n++ )
+			{
+				if( engine->registeredFuncDefs[n]->name == name &&
+					engine->registeredFuncDefs[n]->nameSpace == ns )
+				{
+					funcDef = engine->registeredFuncDefs[n];
+					break;
+				}
+			}
+			if( funcDef == 0 )
+				readError = true;
+			else
+				*dt = asCDataType::CreateFuncDef(funcDef);
+		}
+		else
+		{
+			asCObjectType *ot = ReadObjectType();
+			if( ot )
+				*dt = asCDataType::CreateObject(ot, false);
+		}
+	}
+	else
+		*dt = asCDataType::CreatePrimitive(tokenType, false);
+
+	if( readError )
+	{
+		EndReplay();
+		return false;
+	}
+
+	// Set the flags in the same order as asCReader::ReadDataType
+	if( flags & 1 )
+	{
+		dt->MakeReadOnly((flags & 2) ? true : false);
+		dt->MakeHandle(true, true);
+	}
+	dt->MakeReadOnly((flags & 8) ? true : false);
+	dt->MakeReference((flags & 4) ? true : false);
+
+	return true;
+}
+
+END_AS_NAMESPACE
+
@@ -0,0 +1,142 @@
+/*
+   AngelCode Scripting Library
+   Copyright (c) 2003-2012 Andreas Jonsson
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any
+   damages arising from the use of this software.
+
+   Permission is granted to anyone to use this software for any
+   purpose, including commercial applications, and to alter it and
+   redistribute it freely, subject to the following restrictions:
+
+   1. The origin of this software must not be misrepresented; you
+      must not claim that you wrote the original software. If you use
+      this software in a product, an acknowledgment in the product
+      documentation would be appreciated but is not required.
+
+   2. Altered source versions must be plainly marked as such, and
+      must not be misrepresented as being the original software.
+
+   3. This notice may not be removed or altered from any source
+      distribution.
+
+   The original version of this library can be located at:
+   http://www.angelcode.com/angelscript/
+
+   Andreas Jonsson
+   andreas@angelcode.com
+*/
+
+
+//
+// as_configsnapshot.h
+//
+// Records what the declarations given to the Register* methods parsed to,
+// so that a later launch registering the same interface can restore the
+// results instead of parsing every declaration again
+//
+
+
+
+#ifndef AS_CONFIGSNAPSHOT_H
+#define AS_CONFIGSNAPSHOT_H
+
+#include "as_config.h"
+#include "as_string.h"
+#include "as_array.h"
+#include "as_datatype.h"
+
+BEGIN_AS_NAMESPACE
+
+class asCScriptEngine;
+class asCObjectType;
+class asCScriptFunction;
+struct asSNameSpace;
+
+// A snapshot is a sequence of entries, one for each declaration parsed while
+// the snapshot is open, in the order the application registered them. Each
+// entry holds a key made of the declaration and the context it was parsed in,
+// followed by the result. Types are stored by name so the entries stay valid
+// although the engine hands out new pointers on every launch.
+//
+// On restore the entries are replayed in order. The first declaration that
+// doesn't match the next entry ends the replay, and everything after it is
+// parsed as usual. Whatever was restored or parsed is recorded again, so the
+// snapshot saved at the end always describes the latest configuration.
+class asCConfigSnapshot
+{
+public:
+	asCConfigSnapshot(asCScriptEngine *engine, asQWORD fingerprint);
+
+	int    Load(asIBinaryStream *in);
+	void   Save(asIBinaryStream *out);
+	asUINT GetParsedCount() const;
+
+	// Each Restore method gives back the recorded outcome if the next entry is for the
+	// same declaration in the same context, with r set to what the parse returned.
+	// If it returns false the caller parses the declaration and hands the outcome
+	// to the matching Store method, with null results when the declaration didn't parse
+	bool RestoreDataType(const char *decl, asSNameSpace *ns, bool isReturnType, asCDataType *result, int *r);
+	void StoreDataType(const char *decl, asSNameSpace *ns, bool isReturnType, int r, const asCDataType *result);
+
+	bool RestoreFunction(const char *decl, asCObjectType *objType, asSNameSpace *ns, asCScriptFunction *func, asCArray<bool> *paramAutoHandles, bool *returnAutoHandle, int *r);
+	void StoreFunction(const char *decl, asCObjectType *objType, asSNameSpace *ns, int r, const asCScriptFunction *func, const asCArray<bool> *paramAutoHandles, const bool *returnAutoHandle);
+
+	bool RestoreProperty(const char *decl, asCObjectType *objType, asSNameSpace *ns, asCString &name, asCDataType &type, int *r);
+	void StoreProperty(const char *decl, asCObjectType *objType, asSNameSpace *ns, int r, const asCString *name, const asCDataType *type);
+
+protected:
+	enum eEntryType
+	{
+		asENTRY_DATATYPE = 1,
+		asENTRY_FUNCTION = 2,
+		asENTRY_PROPERTY = 3
+	};
+
+	// What the entry holds after the key
+	enum eEntryResult
+	{
+		asRESULT_NOT_STORED = 0,
+		asRESULT_STORED     = 1,
+		asRESULT_FAILED     = 2
+	};
+
+	asCScriptEngine *engine;
+	asQWORD          fingerprint;
+
+	// Entries loaded from the previous snapshot and the position of the next one to replay
+	asCArray<asBYTE> input;
+	asUINT           readPos;
+	bool             readError;
+
+	// Entries recorded in this session, and the key of the declaration being looked up
+	asCArray<asBYTE> output;
+	asCArray<asBYTE> key;
+	asUINT           parsedCount;
+
+	void   BuildKey(asBYTE entryType, const char *decl, asCObjectType *objType, asSNameSpace *ns, bool isReturnType);
+	bool   BeginRestore(asUINT *entryStart, asUINT *payloadEnd, int *r);
+	bool   EndRestore(asUINT entryStart, asUINT payloadEnd);
+	void   EndReplay();
+	asUINT BeginStore();
+	void   EndStore(asUINT payloadStart, int r, bool isStored);
+
+	static void WriteData(asCArray<asBYTE> &buf, const void *data, asUINT size);
+	static void WriteUInt(asCArray<asBYTE> &buf, asUINT value);
+	static void WriteString(asCArray<asBYTE> &buf, const char *str, asUINT length);
+	static void WriteNameSpace(asCArray<asBYTE> &buf, asSNameSpace *ns);
+	bool        WriteObjectType(asCArray<asBYTE> &buf, asCObjectType *ot);
+	bool        WriteDataType(asCArray<asBYTE> &buf, const asCDataType &dt);
+
+	void           ReadData(void *data, asUINT size);
+	asUINT         ReadUInt();
+	const char    *ReadString(asUINT *length);
+	asSNameSpace  *ReadNameSpace();
+	asCObjectType *ReadObjectType();
+	bool           ReadDataType(asCDataType *dt);
+};
+
+END_AS_NAMESPACE
+
+#endif
@@ -58,6 +58,9 @@ asCModule::asCModule(const char *name, asCScriptEngine *engine)
 	accessMask = 1;
 
 	defaultNamespace = engine->nameSpaces[0];
+
+	globalFunctions.SetInternTable(&engine->internedNames);
+	scriptGlobals.SetInternTable(&engine->internedNames);
 }
 
 // internal
@@ -718,6 +721,18 @@ void *asCModule::GetAddressOfGlobalVar(asUINT index)
 	return (void*)(prop->GetAddressOfValue());
 }
 
+// interface
+void *asCModule::GetAddressOfGlobalVarStorage(asUINT index)
+{
+	asCGlobalProperty *prop = scriptGlobals.Get(index);
+	if( !prop )
+		return 0;
+
+	// Unlike GetAddressOfGlobalVar this doesn't dereference object variables, so the
+	// caller gets the location the bytecode reads the pointer to the object from
+	return (void*)(prop->GetAddressOfValue());
+}
+
 // interface
 const char *asCModule::GetGlobalVarDeclaration(asUINT index, bool includeNamespace) const
 {
@@ -136,6 +136,7 @@ public:
 	virtual const char *GetGlobalVarDeclaration(asUINT index, bool includeNamespace) const;
 	virtual int         GetGlobalVar(asUINT index, const char **name, const char **nameSpace, int *typeId, bool *isConst) const;
 	virtual void       *GetAddressOfGlobalVar(asUINT index);
+	virtual void       *GetAddressOfGlobalVarStorage(asUINT index);
 	virtual int         RemoveGlobalVar(asUINT index);
 
 	// Type identification
@@ -52,6 +52,7 @@
 #include "as_compiler.h"
 #include "as_bytecode.h"
 #include "as_debug.h"
+#include "as_configsnapshot.h"
 
 BEGIN_AS_NAMESPACE
 
@@ -415,6 +416,8 @@ asCScriptEngine::asCScriptEngine()
 {
 	asCThreadManager::Prepare(0);
 
+	registeredGlobalProps.SetInternTable(&internedNames);
+
 	// Engine properties
 	{
 		ep.allowUnsafeReferences        = false;
@@ -464,6 +467,7 @@ asCScriptEngine::asCScriptEngine()
 	typeIdSeqNbr      = 0;
 	currentGroup      = &defaultGroup;
 	defaultAccessMask = 1;
+	configSnapshot    = 0;
 
 	msgCallback = 0;
     jitCompiler = 0;
@@ -511,6 +515,10 @@ asCScriptEngine::~asCScriptEngine()
 	asASSERT(refCount.get() == 0);
 	asUINT n;
 
+	// A snapshot left open is discarded without saving it
+	if( configSnapshot )
+		asDELETE(configSnapshot,asCConfigSnapshot);
+
 	// The modules must be deleted first, as they may use
 	// object types from the config groups
 	for( n = (asUINT)scriptModules.GetLength(); n-- > 0; )
@@ -641,6 +649,7 @@ asCScriptEngine::~asCScriptEngine()
 		}
 	}
 	templateTypes.SetLength(0);
+	templateTypeIndex.EraseAll();
 
 	for( n = 0; n < objectTypes.GetLength(); n++ )
 	{
@@ -652,6 +661,7 @@ asCScriptEngine::~asCScriptEngine()
 		}
 	}
 	objectTypes.SetLength(0);
+	objectTypeIndex.EraseAll();
 	for( n = 0; n < templateSubTypes.GetLength(); n++ )
 	{
 		if( templateSubTypes[n] )
@@ -668,6 +678,7 @@ asCScriptEngine::~asCScriptEngine()
 			registeredGlobalFuncs[n]->Release();
 	}
 	registeredGlobalFuncs.SetLength(0);
+	registeredGlobalFuncIndex.EraseAll();
 
 	scriptTypeBehaviours.ReleaseAllFunctions();
 	functionBehaviours.ReleaseAllFunctions();
@@ -1317,6 +1328,7 @@ int asCScriptEngine::RegisterInterface(const char *name)
 
 	objectTypes.PushLast(st);
 	registeredObjTypes.PushLast(st);
+	AddToObjectTypeIndex(st);
 
 	currentGroup->objTypes.PushLast(st);
 
@@ -1491,13 +1503,10 @@ int asCScriptEngine::RegisterObjectType(const char *name, int byteSize, asDWORD
 			return ConfigError(r, "RegisterObjectType", name, 0);
 
 		// Verify that the template name hasn't been registered as a type already
+		if( GetObjectType(typeName.AddressOf(), defaultNamespace) )
+			// This is not an irrepairable error, as it may just be that the same type is registered twice
+			return asALREADY_REGISTERED;
 		asUINT n;
-		for( n = 0; n < objectTypes.GetLength(); n++ )
-		{
-			if( objectTypes[n] && objectTypes[n]->name == typeName && objectTypes[n]->nameSpace == defaultNamespace )
-				// This is not an irrepairable error, as it may just be that the same type is registered twice
-				return asALREADY_REGISTERED;
-		}
 
 		asCObjectType *type = asNEW(asCObjectType)(this);
 		if( type == 0 )
@@ -1511,6 +1520,7 @@ int asCScriptEngine::RegisterObjectType(const char *name, int byteSize, asDWORD
 
 		// Store it in the object types
 		objectTypes.PushLast(type);
+		AddToObjectTypeIndex(type);
 
 		// Define a template subtype
 		asCObjectType *subtype = 0;
@@ -1547,16 +1557,11 @@ int asCScriptEngine::RegisterObjectType(const char *name, int byteSize, asDWORD
 		typeName = name;
 
 		// Verify if the name has been registered as a type already
-		asUINT n;
-		for( n = 0; n < objectTypes.GetLength(); n++ )
-		{
-			if( objectTypes[n] &&
-				objectTypes[n]->name == typeName &&
-				objectTypes[n]->nameSpace == defaultNamespace )
-				// This is not an irrepairable error, as it may just be that the same type is registered twice
-				return asALREADY_REGISTERED;
-		}
+		if( GetObjectType(typeName.AddressOf(), defaultNamespace) )
+			// This is not an irrepairable error, as it may just be that the same type is registered twice
+			return asALREADY_REGISTERED;
 
+		asUINT n;
 		for( n = 0; n < templateTypes.GetLength(); n++ )
 		{
 			if( templateTypes[n] &&
@@ -1607,6 +1612,7 @@ int asCScriptEngine::RegisterObjectType(const char *name, int byteSize, asDWORD
 
 			objectTypes.PushLast(type);
 			registeredObjTypes.PushLast(type);
+			AddToObjectTypeIndex(type);
 
 			currentGroup->objTypes.PushLast(type);
 		}
@@ -1651,6 +1657,7 @@ int asCScriptEngine::RegisterObjectType(const char *name, int byteSize, asDWORD
 			type->accessMask = defaultAccessMask;
 
 			templateTypes.PushLast(type);
+			AddTemplateTypeToIndex(type);
 
 			currentGroup->objTypes.PushLast(type);
 
@@ -2522,12 +2529,11 @@ int asCScriptEngine::RegisterGlobalFunction(const char *declaration, const asSFu
 
 	// Make sure the function is not identical to a previously registered function
 	asUINT n;
-	for( n = 0; n < registeredGlobalFuncs.GetLength(); n++ )
+	const asCArray<asCScriptFunction *> &overloads = GetRegisteredGlobalFuncs(func->nameSpace, func->name);
+	for( n = 0; n < overloads.GetLength(); n++ )
 	{
-		asCScriptFunction *f = registeredGlobalFuncs[n];
-		if( f->name == func->name &&
-			f->nameSpace == func->nameSpace &&
-			f->IsSignatureExceptNameAndReturnTypeEqual(func) )
+		asCScriptFunction *f = overloads[n];
+		if( f->IsSignatureExceptNameAndReturnTypeEqual(func) )
 		{
 			func->funcType = asFUNC_DUMMY;
 			asDELETE(func,asCScriptFunction);
@@ -2541,6 +2547,7 @@ int asCScriptEngine::RegisterGlobalFunction(const char *declaration, const asSFu
 	currentGroup->scriptFunctions.PushLast(func);
 	func->accessMask = defaultAccessMask;
 	registeredGlobalFuncs.PushLast(func);
+	AddToGlobalFuncIndex(func);
 
 	// If parameter type from other groups are used, add references
 	if( func->returnType.GetObjectType() )
@@ -2636,16 +2643,81 @@ asIScriptFunction *asCScriptEngine::GetGlobalFunctionByDecl(const char *decl) co
 
 asCObjectType *asCScriptEngine::GetObjectType(const char *type, asSNameSpace *ns)
 {
-	// TODO: optimize: Improve linear search
-	for( asUINT n = 0; n < objectTypes.GetLength(); n++ )
-		if( objectTypes[n] &&
-			objectTypes[n]->name == type &&
-			objectTypes[n]->nameSpace == ns ) // TODO: template: Should we check the subtype in case of template instances?
-			return objectTypes[n];
+	// TODO: template: Should we check the subtype in case of template instances?
+	// A name that was never interned can't be the name of a type
+	const asCString *name = internedNames.Find(type, strlen(type));
+	if( name == 0 )
+		return 0;
+
+	asSMapNode<asSNameSpaceNamePair, asCObjectType*> *cursor;
+	if( objectTypeIndex.MoveTo(&cursor, asSNameSpaceNamePair(ns, name)) )
+		return objectTypeIndex.GetValue(cursor);
 
 	return 0;
 }
 
+// internal
+void asCScriptEngine::AddToObjectTypeIndex(asCObjectType *type)
+{
+	// The registration functions doesn't allow two types with the same name in the same namespace
+	asASSERT( GetObjectType(type->name.AddressOf(), type->nameSpace) == 0 );
+	objectTypeIndex.Insert(asSNameSpaceNamePair(type->nameSpace, internedNames.Intern(type->name)), type);
+}
+
+// internal
+void asCScriptEngine::RemoveFromObjectTypeIndex(asCObjectType *type)
+{
+	asSMapNode<asSNameSpaceNamePair, asCObjectType*> *cursor;
+	if( objectTypeIndex.MoveTo(&cursor, asSNameSpaceNamePair(type->nameSpace, internedNames.Intern(type->name))) &&
+		objectTypeIndex.GetValue(cursor) == type )
+		objectTypeIndex.Erase(cursor);
+}
+
+// internal
+void asCScriptEngine::AddToGlobalFuncIndex(asCScriptFunction *func)
+{
+	asSNameSpaceNamePair key(func->nameSpace, internedNames.Intern(func->name));
+
+	asSMapNode<asSNameSpaceNamePair, asCArray<asCScriptFunction*> > *cursor;
+	if( registeredGlobalFuncIndex.MoveTo(&cursor, key) )
+		registeredGlobalFuncIndex.GetValue(cursor).PushLast(func);
+	else
+	{
+		asCArray<asCScriptFunction*> arr(1);
+		arr.PushLast(func);
+		registeredGlobalFuncIndex.Insert(key, arr);
+	}
+}
+
+// internal
+void asCScriptEngine::RemoveFromGlobalFuncIndex(asCScriptFunction *func)
+{
+	asSMapNode<asSNameSpaceNamePair, asCArray<asCScriptFunction*> > *cursor;
+	if( registeredGlobalFuncIndex.MoveTo(&cursor, asSNameSpaceNamePair(func->nameSpace, internedNames.Intern(func->name))) )
+	{
+		asCArray<asCScriptFunction*> &arr = registeredGlobalFuncIndex.GetValue(cursor);
+		arr.RemoveValue(func);
+		if( arr.GetLength() == 0 )
+			registeredGlobalFuncIndex.Erase(cursor);
+	}
+}
+
+// internal
+const asCArray<asCScriptFunction *> &asCScriptEngine::GetRegisteredGlobalFuncs(asSNameSpace *ns, const asCString &name) const
+{
+	static asCArray<asCScriptFunction *> dummy;
+
+	const asCString *interned = internedNames.Find(name);
+	if( interned == 0 )
+		return dummy;
+
+	asSMapNode<asSNameSpaceNamePair, asCArray<asCScriptFunction*> > *cursor;
+	if( registeredGlobalFuncIndex.MoveTo(&cursor, asSNameSpaceNamePair(ns, interned)) )
+		return registeredGlobalFuncIndex.GetValue(cursor);
+
+	return dummy;
+}
+
 
 
 
@@ -2962,6 +3034,8 @@ void asCScriptEngine::RemoveTemplateInstanceType(asCObjectType *t)
 	}
 	t->beh.operators.SetLength(0);
 
+	RemoveTemplateTypeFromIndex(t);
+
 	// Start searching from the end of the list, as most of
 	// the time it will be the last two types
 	for( n = (int)templateTypes.GetLength()-1; n >= 0; n-- )
@@ -3013,19 +3087,94 @@ void asCScriptEngine::OrphanTemplateInstances(asCObjectType *subType)
 	}
 }
 
+asSTemplateInstanceKey::asSTemplateInstanceKey()
+{
+	hash = 0;
+}
+
+asSTemplateInstanceKey::asSTemplateInstanceKey(const asCString &in_name, const asCDataType &in_subType)
+{
+	name    = in_name;
+	subType = in_subType;
+
+	// FNV-1a over the name, then mix in the parts of the subtype that identify it
+	hash = 2166136261u;
+	const char *str = name.AddressOf();
+	for( size_t n = 0; n < name.GetLength(); n++ )
+		hash = (hash ^ (asBYTE)str[n]) * 16777619u;
+
+	hash = (hash ^ (asUINT)subType.GetTokenType()) * 16777619u;
+	hash = (hash ^ (asUINT)(asPWORD)subType.GetObjectType()) * 16777619u;
+	hash = (hash ^ (asUINT)(asPWORD)subType.GetFuncDef()) * 16777619u;
+	hash = (hash ^ (subType.IsObjectHandle() ? 1u : 0u)) * 16777619u;
+}
+
+bool asSTemplateInstanceKey::operator==(const asSTemplateInstanceKey &other) const
+{
+	return !(*this < other) && !(other < *this);
+}
+
+bool asSTemplateInstanceKey::operator<(const asSTemplateInstanceKey &other) const
+{
+	if( hash != other.hash )
+		return hash < other.hash;
+
+	// Compare the same properties as asCDataType::operator== so the
+	// index considers two subtypes equal only when the linear search would
+	if( subType.GetTokenType() != other.subType.GetTokenType() )
+		return subType.GetTokenType() < other.subType.GetTokenType();
+	if( subType.GetObjectType() != other.subType.GetObjectType() )
+		return subType.GetObjectType() < other.subType.GetObjectType();
+	if( subType.GetFuncDef() != other.subType.GetFuncDef() )
+		return subType.GetFuncDef() < other.subType.GetFuncDef();
+	if( subType.IsObjectHandle() != other.subType.IsObjectHandle() )
+		return other.subType.IsObjectHandle();
+	if( subType.IsReadOnly() != other.subType.IsReadOnly() )
+		return other.subType.IsReadOnly();
+	if( subType.IsHandleToConst() != other.subType.IsHandleToConst() )
+		return other.subType.IsHandleToConst();
+	if( subType.IsReference() != other.subType.IsReference() )
+		return other.subType.IsReference();
+
+	return name.Compare(other.name) < 0;
+}
+
+// internal
+void asCScriptEngine::AddTemplateTypeToIndex(asCObjectType *t)
+{
+	asSTemplateInstanceKey key(t->name, t->templateSubType);
+
+	// A template specialization replaces the template instance with the same subtype
+	asSMapNode<asSTemplateInstanceKey, asCObjectType*> *cursor;
+	if( templateTypeIndex.MoveTo(&cursor, key) )
+		templateTypeIndex.GetValue(cursor) = t;
+	else
+		templateTypeIndex.Insert(key, t);
+}
+
+// internal
+void asCScriptEngine::RemoveTemplateTypeFromIndex(asCObjectType *t)
+{
+	asSTemplateInstanceKey key(t->name, t->templateSubType);
+
+	// Only remove the entry if it still refers to this type, as it
+	// may already have been replaced by a template specialization
+	asSMapNode<asSTemplateInstanceKey, asCObjectType*> *cursor;
+	if( templateTypeIndex.MoveTo(&cursor, key) && templateTypeIndex.GetValue(cursor) == t )
+		templateTypeIndex.Erase(cursor);
+}
+
 // internal
 asCObjectType *asCScriptEngine::GetTemplateInstanceType(asCObjectType *templateType, asCDataType &subType)
 {
 	asUINT n;
 
 	// Is there any template instance type or template specialization already with this subtype?
-	for( n = 0; n < templateTypes.GetLength(); n++ )
-	{
-		if( templateTypes[n] &&
-			templateTypes[n]->name == templateType->name &&
-			templateTypes[n]->templateSubType == subType )
-			return templateTypes[n];
-	}
+	// The factory stubs and specialized functions are owned by the template instance, so by reusing
+	// it here they are also shared by all modules that refer to the same template instance
+	asSMapNode<asSTemplateInstanceKey, asCObjectType*> *cursor;
+	if( templateTypeIndex.MoveTo(&cursor, asSTemplateInstanceKey(templateType->name, subType)) )
+		return templateTypeIndex.GetValue(cursor);
 
 	// No previous template instance exists
 
@@ -3176,6 +3325,7 @@ asCObjectType *asCScriptEngine::GetTemplateInstanceType(asCObjectType *templateT
 	if( ot->templateSubType.GetObjectType() ) ot->templateSubType.GetObjectType()->AddRef();
 
 	templateTypes.PushLast(ot);
+	AddTemplateTypeToIndex(ot);
 
 	// We need to store the object type somewhere for clean-up later
 	// TODO: Why do we need both templateTypes and templateInstanceTypes? It is possible to differ between template instance and template specialization by checking for the asOBJ_TEMPLATE flag
@@ -4255,6 +4405,43 @@ int asCScriptEngine::EndConfigGroup()
 	return 0;
 }
 
+// interface
+int asCScriptEngine::BeginConfigSnapshot(asIBinaryStream *in, asQWORD fingerprint)
+{
+	// Snapshots can't be nested
+	if( configSnapshot )
+		return asERROR;
+
+	configSnapshot = asNEW(asCConfigSnapshot)(this, fingerprint);
+	if( configSnapshot == 0 )
+		return asOUT_OF_MEMORY;
+
+	// Without a matching snapshot to restore, the declarations are
+	// parsed as usual and recorded for EndConfigSnapshot to save
+	if( in )
+		configSnapshot->Load(in);
+
+	return 0;
+}
+
+// interface
+int asCScriptEngine::EndConfigSnapshot(asIBinaryStream *out, asUINT *parsedDeclarations)
+{
+	if( configSnapshot == 0 )
+		return asERROR;
+
+	// The application only needs to save the snapshot again when something had to be parsed
+	if( parsedDeclarations )
+		*parsedDeclarations = configSnapshot->GetParsedCount();
+	if( out )
+		configSnapshot->Save(out);
+
+	asDELETE(configSnapshot,asCConfigSnapshot);
+	configSnapshot = 0;
+
+	return 0;
+}
+
 // interface
 int asCScriptEngine::RemoveConfigGroup(const char *groupName)
 {
@@ -4565,6 +4752,7 @@ int asCScriptEngine::RegisterTypedef(const char *type, const char *decl)
 
 	objectTypes.PushLast(object);
 	registeredTypeDefs.PushLast(object);
+	AddToObjectTypeIndex(object);
 
 	currentGroup->objTypes.PushLast(object);
 
@@ -4650,6 +4838,7 @@ int asCScriptEngine::RegisterEnum(const char *name)
 
 	objectTypes.PushLast(st);
 	registeredEnums.PushLast(st);
+	AddToObjectTypeIndex(st);
 
 	currentGroup->objTypes.PushLast(st);
 
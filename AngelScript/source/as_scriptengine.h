@@ -58,6 +58,7 @@ BEGIN_AS_NAMESPACE
 
 class asCBuilder;
 class asCContext;
+class asCConfigSnapshot;
 
 // TODO: import: Remove this when import is removed
 struct sBindInfo;
@@ -68,6 +69,22 @@ struct sBindInfo;
 
 // TODO: Should allow enumerating modules, in case they have not been named.
 
+// Key used to find template instances and specializations by template name and subtype
+// without having to do a linear search through all the template types. The hash is
+// compared first so that most comparisons in the map never have to look at the name
+struct asSTemplateInstanceKey
+{
+	asSTemplateInstanceKey();
+	asSTemplateInstanceKey(const asCString &name, const asCDataType &subType);
+
+	bool operator==(const asSTemplateInstanceKey &other) const;
+	bool operator<(const asSTemplateInstanceKey &other) const;
+
+	asUINT      hash;
+	asCString   name;
+	asCDataType subType;
+};
+
 
 class asCScriptEngine : public asIScriptEngine
 {
@@ -155,6 +172,10 @@ public:
 	virtual int         SetDefaultNamespace(const char *nameSpace);
 	virtual const char *GetDefaultNamespace() const;
 
+	// Configuration snapshots
+	virtual int         BeginConfigSnapshot(asIBinaryStream *in, asQWORD fingerprint);
+	virtual int         EndConfigSnapshot(asIBinaryStream *out, asUINT *parsedDeclarations);
+
 	// Script modules
 	virtual asIScriptModule *GetModule(const char *module, asEGMFlags flag);
 	virtual int              DiscardModule(const char *module);
@@ -299,6 +320,15 @@ public:
 	asCScriptFunction *GenerateTemplateFactoryStub(asCObjectType *templateType, asCObjectType *templateInstanceType, int origFactoryId);
 	bool               GenerateNewTemplateFunction(asCObjectType *templateType, asCObjectType *templateInstanceType, asCDataType &subType, asCScriptFunction *templateFunc, asCScriptFunction **newFunc);
 	void               OrphanTemplateInstances(asCObjectType *subType);
+	void               AddTemplateTypeToIndex(asCObjectType *templateType);
+	void               RemoveTemplateTypeFromIndex(asCObjectType *templateType);
+
+	// Indexes of the registered interface by namespace and name
+	void AddToObjectTypeIndex(asCObjectType *type);
+	void RemoveFromObjectTypeIndex(asCObjectType *type);
+	void AddToGlobalFuncIndex(asCScriptFunction *func);
+	void RemoveFromGlobalFuncIndex(asCScriptFunction *func);
+	const asCArray<asCScriptFunction *> &GetRegisteredGlobalFuncs(asSNameSpace *ns, const asCString &name) const;
 
 	// String constants
 	// TODO: Must free unused string constants, thus the ref count for each must be tracked
@@ -335,6 +365,11 @@ public:
 	asCSymbolTable<asCGlobalProperty>  registeredGlobalProps;
 	asCArray<asCScriptFunction *>      registeredGlobalFuncs;
 	asCArray<asCScriptFunction *>      registeredFuncDefs;
+	// Every symbol name used as a key in the symbol tables and indexes, so they can be compared by pointer
+	asCStringInternTable                                          internedNames;
+	// These indexes avoid linear searches when registering and looking up the application interface
+	asCMap<asSNameSpaceNamePair, asCObjectType *>                 objectTypeIndex;
+	asCMap<asSNameSpaceNamePair, asCArray<asCScriptFunction *> >  registeredGlobalFuncIndex;
 	asCScriptFunction                 *stringFactory;
 	bool configFailed;
 
@@ -344,6 +379,8 @@ public:
 
 	// Store information about template types
 	asCArray<asCObjectType *>      templateTypes;
+	// Index of the template instances and specializations in templateTypes by name and subtype
+	asCMap<asSTemplateInstanceKey, asCObjectType *> templateTypeIndex;
 
 	// Stores all global properties, both those registered by application, and those declared by scripts.
 	// The id of a global property is the index in this array.
@@ -398,6 +435,9 @@ public:
 	asDWORD                    defaultAccessMask;
 	asSNameSpace              *defaultNamespace;
 
+	// Declarations recorded or restored between BeginConfigSnapshot and EndConfigSnapshot
+	asCConfigSnapshot         *configSnapshot;
+
 	// Message callback
 	bool                        msgCallback;
 	asSSystemFunctionInterface  msgCallbackFunc;
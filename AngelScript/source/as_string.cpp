@@ -56,6 +56,17 @@ asCString::asCString(const asCString &str)
 	Assign(str.AddressOf(), str.length);
 }
 
+#ifdef AS_CAN_USE_CPP11
+// Move constructor
+asCString::asCString(asCString &&str)
+{
+	length = 0;
+	local[0] = 0;
+
+	*this = static_cast<asCString&&>(str);
+}
+#endif
+
 asCString::asCString(const char *str, size_t len)
 {
 	length = 0;
@@ -183,6 +194,30 @@ asCString &asCString::operator =(const asCString &str)
 	return *this;
 }
 
+#ifdef AS_CAN_USE_CPP11
+asCString &asCString::operator =(asCString &&str)
+{
+	if( this == &str )
+		return *this;
+
+	if( length > 11 && dynamic )
+		asDELETEARRAY(dynamic);
+
+	// Take over the dynamic buffer instead of copying it. Short strings are
+	// stored in the local buffer and must be copied anyway
+	if( str.length > 11 )
+		dynamic = str.dynamic;
+	else
+		memcpy(local, str.local, str.length + 1);
+	length = str.length;
+
+	str.length = 0;
+	str.local[0] = 0;
+
+	return *this;
+}
+#endif
+
 asCString &asCString::operator =(char ch)
 {
 	Assign(&ch, 1);
@@ -347,12 +382,16 @@ bool operator !=(const asCString &a, const char *b)
 
 bool operator ==(const asCString &a, const asCString &b)
 {
-	return a.Compare(b) == 0;
+	// Strings with different lengths can never be equal so there is no need to compare the content
+	if( a.GetLength() != b.GetLength() )
+		return false;
+
+	return memcmp(a.AddressOf(), b.AddressOf(), a.GetLength()) == 0;
 }
 
 bool operator !=(const asCString &a, const asCString &b)
 {
-	return a.Compare(b) != 0;
+	return !(a == b);
 }
 
 bool operator ==(const char *a, const asCString &b)
@@ -38,8 +38,6 @@
 #include <stdio.h>
 #include <string.h>
 
-// TODO: optimize: On compilers with C++11 support the string class should take advantage of the move operator &&
-
 class asCString
 {
 public:
@@ -47,6 +45,9 @@ public:
 	~asCString();
 
 	asCString(const asCString &);
+#ifdef AS_CAN_USE_CPP11
+	asCString(asCString &&);
+#endif
 	asCString(const char *);
 	asCString(const char *, size_t length);
 	explicit asCString(char);
@@ -62,6 +63,9 @@ public:
 
 	void Assign(const char *str, size_t length);
 	asCString &operator =(const asCString &);
+#ifdef AS_CAN_USE_CPP11
+	asCString &operator =(asCString &&);
+#endif
 	asCString &operator =(const char *);
 	asCString &operator =(char);
 
@@ -46,6 +46,9 @@
 #include "as_string.h"
 #include "as_map.h"
 #include "as_datatype.h"
+#include "as_criticalsection.h"
+
+#include <functional> // std::less
 
 
 BEGIN_AS_NAMESPACE
@@ -63,6 +66,183 @@ struct asSNameSpace
 
 
 
+// Engine wide table holding a single copy of each symbol name. Two interned names
+// are equal exactly when their pointers are, so the symbol tables can compare names
+// without looking at the characters. The names stay valid until the table is destroyed.
+// Names are never released before that, not even when the last symbol using them is
+// removed, so the table grows with every distinct name the engine has ever seen. An
+// application that keeps building modules with new symbol names should recreate the
+// engine from time to time.
+class asCStringInternTable
+{
+public:
+	asCStringInternTable() : slots(0), capacity(0), count(0) {}
+
+	~asCStringInternTable()
+	{
+		for( asUINT n = 0; n < capacity; n++ )
+			if( slots[n].str )
+				asDELETE(slots[n].str, asCString);
+		if( slots )
+			asDELETEARRAY(slots);
+	}
+
+	// Returns the interned copy of the name, adding it the first time it is seen
+	const asCString *Intern(const char *str, size_t length)
+	{
+		asUINT hash = Hash(str, length);
+
+		ACQUIREEXCLUSIVE(lock);
+
+		asUINT slot = FindSlot(str, length, hash);
+		if( slot == asUINT(-1) || slots[slot].str == 0 )
+		{
+			// Keep the table at most half full so the probe sequences stay short
+			if( (count + 1) * 2 > capacity )
+			{
+				Grow();
+				slot = FindSlot(str, length, hash);
+			}
+
+			slots[slot].str  = asNEW(asCString)(str, length);
+			slots[slot].hash = hash;
+			count++;
+		}
+		const asCString *interned = slots[slot].str;
+
+		RELEASEEXCLUSIVE(lock);
+
+		return interned;
+	}
+
+	const asCString *Intern(const asCString &str)
+	{
+		return Intern(str.AddressOf(), str.GetLength());
+	}
+
+	// Returns the interned copy of the name, or null if it has never been interned.
+	// A name that was never interned can't be the name of any symbol
+	const asCString *Find(const char *str, size_t length) const
+	{
+		asUINT hash = Hash(str, length);
+
+		ACQUIRESHARED(const_cast<asCStringInternTable*>(this)->lock);
+
+		asUINT slot = FindSlot(str, length, hash);
+		const asCString *interned = slot == asUINT(-1) ? 0 : slots[slot].str;
+
+		RELEASESHARED(const_cast<asCStringInternTable*>(this)->lock);
+
+		return interned;
+	}
+
+	const asCString *Find(const asCString &str) const
+	{
+		return Find(str.AddressOf(), str.GetLength());
+	}
+
+	asUINT GetCount() const
+	{
+		return count;
+	}
+
+private:
+	// Don't allow copying
+	asCStringInternTable(const asCStringInternTable &);
+	asCStringInternTable &operator=(const asCStringInternTable &);
+
+	struct sSlot
+	{
+		asCString *str;
+		asUINT     hash;
+	};
+
+	static asUINT Hash(const char *str, size_t length)
+	{
+		asUINT hash = 2166136261u;
+		for( size_t n = 0; n < length; n++ )
+			hash = (hash ^ asBYTE(str[n])) * 16777619u;
+		return hash;
+	}
+
+	// Returns the slot holding the name, or the empty slot where it would go
+	asUINT FindSlot(const char *str, size_t length, asUINT hash) const
+	{
+		if( capacity == 0 )
+			return asUINT(-1);
+
+		for( asUINT slot = hash & (capacity - 1); ; slot = (slot + 1) & (capacity - 1) )
+		{
+			const sSlot &s = slots[slot];
+			if( s.str == 0 )
+				return slot;
+			if( s.hash == hash && s.str->GetLength() == length && memcmp(s.str->AddressOf(), str, length) == 0 )
+				return slot;
+		}
+	}
+
+	void Grow()
+	{
+		asUINT newCapacity = capacity ? capacity * 2 : 256;
+		sSlot *newSlots = asNEWARRAY(sSlot, newCapacity);
+		memset(newSlots, 0, sizeof(sSlot) * newCapacity);
+
+		for( asUINT n = 0; n < capacity; n++ )
+		{
+			if( slots[n].str == 0 )
+				continue;
+
+			asUINT slot = slots[n].hash & (newCapacity - 1);
+			while( newSlots[slot].str )
+				slot = (slot + 1) & (newCapacity - 1);
+			newSlots[slot] = slots[n];
+		}
+
+		if( slots )
+			asDELETEARRAY(slots);
+		slots    = newSlots;
+		capacity = newCapacity;
+	}
+
+	sSlot  *slots;
+	asUINT  capacity;
+	asUINT  count;
+	DECLAREREADWRITELOCK(lock)
+};
+
+
+
+
+// Key used in the symbol table. The namespaces are shared by all entities in the
+// engine and the names are interned in the engine's asCStringInternTable, so both
+// are compared by pointer. This also avoids building a new string with the 
+// qualified name on each lookup.
+struct asSNameSpaceNamePair
+{
+	asSNameSpaceNamePair() : ns(0), name(0) {}
+	asSNameSpaceNamePair(const asSNameSpace *_ns, const asCString *_name) : ns(_ns), name(_name) {}
+
+	bool operator==(const asSNameSpaceNamePair &other) const
+	{
+		return ns == other.ns && name == other.name;
+	}
+
+	bool operator<(const asSNameSpaceNamePair &other) const
+	{
+		// The pointers are into unrelated objects, which only std::less orders portably
+		if( name != other.name )
+			return std::less<const asCString*>()(name, other.name);
+
+		return std::less<const asSNameSpace*>()(ns, other.ns);
+	}
+
+	const asSNameSpace *ns;
+	const asCString    *name;
+};
+
+
+
+
 // Interface to avoid nested templates which is not well supported by older compilers, e.g. MSVC6
 struct asIFilter
 {
@@ -115,6 +295,10 @@ public:
 
 	asCSymbolTable(unsigned int initialCapacity = 0);
 
+	// The table keys its symbols on names interned in the engine's table, which
+	// must be set before the first symbol is added
+	void SetInternTable(asCStringInternTable *names) { m_names = names; }
+
 	int      GetFirstIndex(const asSNameSpace *ns, const asCString &name, const asIFilter &comparator) const;
 	int      GetFirstIndex(const asSNameSpace *ns, const asCString &name) const;
 	int      GetLastIndex() const;
@@ -151,13 +335,14 @@ private:
     friend class asCSymbolTableIterator<T, T>;
     friend class asCSymbolTableIterator<T, const T>;
 
-	void GetKey(const T *entry, asCString &key) const;
-	void BuildKey(const asSNameSpace *ns, const asCString &name, asCString &key) const;
+	void GetKey(const T *entry, asSNameSpaceNamePair &key) const;
+	bool GetLookupKey(const asSNameSpace *ns, const asCString &name, asSNameSpaceNamePair &key) const;
 	bool CheckIdx(unsigned idx) const;
 
-	asCMap<asCString, asCArray<unsigned int> > m_map;
+	asCMap<asSNameSpaceNamePair, asCArray<unsigned int> > m_map;
 	asCArray<T*>                               m_entries;
 	unsigned int                               m_size;
+	asCStringInternTable                      *m_names;
 };
 
 
@@ -172,6 +357,10 @@ void asCSymbolTable<T>::SwapWith(asCSymbolTable<T> &other)
 	unsigned int tmp = m_size;
 	m_size = other.m_size;
 	other.m_size = tmp;
+
+	asCStringInternTable *names = m_names;
+	m_names = other.m_names;
+	other.m_names = names;
 }
 
 
@@ -182,7 +371,27 @@ void asCSymbolTable<T>::SwapWith(asCSymbolTable<T> &other)
 template<class T>
 asCSymbolTable<T>::asCSymbolTable(unsigned initialCapacity) : m_entries(initialCapacity)
 {
-	m_size = 0;
+	m_size  = 0;
+	m_names = 0;
+}
+
+
+
+// Builds the key for looking up a name. Returns false if the name
+// has never been interned, in which case no symbol can have it
+template<class T>
+bool asCSymbolTable<T>::GetLookupKey(const asSNameSpace *ns, const asCString &name, asSNameSpaceNamePair &key) const
+{
+	asASSERT( m_names );
+	if( m_names == 0 || m_size == 0 )
+		return false;
+
+	const asCString *interned = m_names->Find(name);
+	if( interned == 0 )
+		return false;
+
+	key = asSNameSpaceNamePair(ns, interned);
+	return true;
 }
 
 
@@ -193,11 +402,10 @@ int asCSymbolTable<T>::GetFirstIndex(
         const asCString &name,
         const asIFilter &filter) const
 {
-	asCString key;
-	BuildKey(ns, name, key);
+	asSNameSpaceNamePair key;
 
-	asSMapNode<asCString, asCArray<unsigned int> > *cursor;
-	if( m_map.MoveTo(&cursor, key) )
+	asSMapNode<asSNameSpaceNamePair, asCArray<unsigned int> > *cursor;
+	if( GetLookupKey(ns, name, key) && m_map.MoveTo(&cursor, key) )
 	{
 		const asCArray<unsigned int> &arr = m_map.GetValue(cursor);
 		for( unsigned int n = 0; n < arr.GetLength(); n++ )
@@ -216,11 +424,10 @@ int asCSymbolTable<T>::GetFirstIndex(
 template<class T>
 const asCArray<unsigned int> &asCSymbolTable<T>::GetIndexes(const asSNameSpace *ns, const asCString &name) const
 {
-	asCString key;
-	BuildKey(ns, name, key);
+	asSNameSpaceNamePair key;
 
-	asSMapNode<asCString, asCArray<unsigned int> > *cursor;
-	if( m_map.MoveTo(&cursor, key) )
+	asSMapNode<asSNameSpaceNamePair, asCArray<unsigned int> > *cursor;
+	if( GetLookupKey(ns, name, key) && m_map.MoveTo(&cursor, key) )
 		return m_map.GetValue(cursor);
 
 	static asCArray<unsigned int> dummy;
@@ -244,11 +451,10 @@ T* asCSymbolTable<T>::GetFirst(const asSNameSpace *ns, const asCString &name, co
 template<class T>
 int asCSymbolTable<T>::GetFirstIndex(const asSNameSpace *ns, const asCString &name) const
 {
-    asCString key;
-    BuildKey(ns, name, key);
+    asSNameSpaceNamePair key;
 
-	asSMapNode<asCString, asCArray<unsigned int> > *cursor;
-	if( m_map.MoveTo(&cursor, key) )
+	asSMapNode<asSNameSpaceNamePair, asCArray<unsigned int> > *cursor;
+	if( GetLookupKey(ns, name, key) && m_map.MoveTo(&cursor, key) )
         return m_map.GetValue(cursor)[0];
 
     return -1;
@@ -375,10 +581,10 @@ bool asCSymbolTable<T>::Erase(unsigned idx)
 		m_entries[idx] = 0;
 	m_size--;
 
-    asCString key;
+    asSNameSpaceNamePair key;
     GetKey(entry, key);
 
-	asSMapNode<asCString, asCArray<unsigned int> > *cursor;
+	asSMapNode<asSNameSpaceNamePair, asCArray<unsigned int> > *cursor;
 	if( m_map.MoveTo(&cursor, key) )
 	{
 		asCArray<unsigned int> &arr = m_map.GetValue(cursor);
@@ -399,10 +605,10 @@ template<class T>
 int asCSymbolTable<T>::Put(T *entry)
 {
 	unsigned int idx = (unsigned int)(m_entries.GetLength());
-	asCString key;
+	asSNameSpaceNamePair key;
 	GetKey(entry, key);
 
-	asSMapNode<asCString, asCArray<unsigned int> > *cursor;
+	asSMapNode<asSNameSpaceNamePair, asCArray<unsigned int> > *cursor;
 	if( m_map.MoveTo(&cursor, key) )
 		m_map.GetValue(cursor).PushLast(idx);
 	else
@@ -419,25 +625,12 @@ int asCSymbolTable<T>::Put(T *entry)
 
 
 
-template<class T>
-void asCSymbolTable<T>::BuildKey(const asSNameSpace *ns, const asCString &name, asCString &key) const
-{
-	// TODO: optimize: The key shouldn't be just an asCString. It should keep the
-	//                 namespace as a pointer, so it can be compared as pointer.
-	//                 Which should be compared first, the namespace or the name? There is likely
-	//                 going to be many symbols with the same namespace, so it is probably best to
-	//                 compare the name first
-    key = ns->name + "::" + name;
-}
-
-
-
-
 // Return key for specified symbol (namespace and name are used to generate the key)
 template<class T>
-void asCSymbolTable<T>::GetKey(const T *entry, asCString &key) const
+void asCSymbolTable<T>::GetKey(const T *entry, asSNameSpaceNamePair &key) const
 {
-	BuildKey(entry->nameSpace, entry->name, key);
+	asASSERT( m_names );
+	key = asSNameSpaceNamePair(entry->nameSpace, m_names->Intern(entry->name));
 }
 
 
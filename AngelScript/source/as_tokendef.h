@@ -286,6 +286,14 @@ sTokenWord const tokenWords[] =
 
 const unsigned int numTokenWords = sizeof(tokenWords)/sizeof(sTokenWord);
 
+// The tokenizer finds keywords through a perfect hash of the token words. The seed below
+// gives a collision free table of tokenWordHashSize entries for the words above. If the 
+// list of words is changed the tokenizer will search for a new seed when it is created, 
+// but the constant should then be updated so that the search isn't needed.
+const unsigned int tokenWordHashSize = 512;
+const unsigned int tokenWordHashSeed = 511;
+const unsigned int maxTokenWordLength = 9;
+
 const char * const whiteSpace = " \t\r\n";
 
 // Some keywords that are not considered tokens by the parser
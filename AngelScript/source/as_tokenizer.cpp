@@ -45,27 +45,178 @@
 #endif
 #include <string.h> // strcmp()
 
+#ifdef AS_USE_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
 BEGIN_AS_NAMESPACE
 
+// The keyword hash is FNV-1a over the characters, so the hash of every
+// prefix of the source can be computed in a single pass over it
+static inline asUINT KeywordHashStep(asUINT hash, char c)
+{
+	return (hash ^ asBYTE(c)) * 16777619u;
+}
+
+static inline asUINT KeywordHashSlot(asUINT hash)
+{
+	return (hash ^ (hash >> 15)) & (tokenWordHashSize - 1);
+}
+
+#ifdef AS_USE_SSE2
+// Returns the index of the lowest set bit of a non-zero mask
+static inline asUINT LowestSetBit(asUINT mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return asUINT(index);
+#else
+	return asUINT(__builtin_ctz(mask));
+#endif
+}
+
+// Returns a bit mask with the bits set for the characters that are white space
+static inline asUINT WhiteSpaceMask(__m128i c)
+{
+	__m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')),  _mm_cmpeq_epi8(c, _mm_set1_epi8('\t'))),
+	                          _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(c, _mm_set1_epi8('\n'))));
+	return asUINT(_mm_movemask_epi8(ws));
+}
+
+// Returns a bit mask with the bits set for the characters that can be part of an identifier.
+// Setting bit 5 turns upper case letters into lower case so one range test covers both. The
+// bytes are compared as signed values, so characters above 127 fall outside every range
+static inline asUINT IdentifierMask(__m128i c)
+{
+	__m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+	__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a'-1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('z'+1)));
+	__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0'-1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9'+1)));
+	__m128i under = _mm_cmpeq_epi8(c, _mm_set1_epi8('_'));
+	return asUINT(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under)));
+}
+#endif
+
 asCTokenizer::asCTokenizer()
 {
 	engine = 0;
 
-	// Initialize the keyword map
+	// Initialize the character classes
+	memset(charClass, 0, sizeof(charClass));
+	for( const char *ws = whiteSpace; *ws; ws++ )
+		charClass[asBYTE(*ws)] |= CC_WHITESPACE;
+	for( int c = 0; c < 256; c++ )
+	{
+		if( (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') )
+			charClass[c] |= CC_ALPHA | CC_IDENT_START | CC_IDENT;
+		else if( c == '_' )
+			charClass[c] |= CC_IDENT_START | CC_IDENT;
+		else if( c >= '0' && c <= '9' )
+			charClass[c] |= CC_IDENT;
+	}
+
+#ifdef AS_USE_SSE2
+	// The SSE2 scanner tests for the white space characters directly
+	asASSERT( strcmp(whiteSpace, " \t\r\n") == 0 );
+#endif
+
+	// Initialize the keyword table
 	for( asUINT n = 0; n < numTokenWords; n++ )
 	{
-		if( (tokenWords[n].word[0] >= 'a' && tokenWords[n].word[0] <= 'z') ||
-			(tokenWords[n].word[0] >= 'A' && tokenWords[n].word[0] <= 'Z') )
-			alphaKeywordMap.Insert(asCStringPointer(tokenWords[n].word, strlen(tokenWords[n].word)), tokenWords[n].tokenType);
-		else
-			nonAlphaKeywordMap.Insert(asCStringPointer(tokenWords[n].word, strlen(tokenWords[n].word)), tokenWords[n].tokenType);
+		asASSERT( strlen(tokenWords[n].word) <= maxTokenWordLength );
+		keywordLength[n] = asBYTE(strlen(tokenWords[n].word));
+	}
+
+	keywordSeed = tokenWordHashSeed;
+	if( !BuildKeywordTable(keywordSeed) )
+	{
+		// The list of token words has changed without updating the seed.
+		// Search for a new seed that gives a collision free table
+		asASSERT( false );
+		for( keywordSeed = 1; !BuildKeywordTable(keywordSeed); keywordSeed++ ) {}
 	}
 }
 
+bool asCTokenizer::BuildKeywordTable(asUINT seed)
+{
+	asASSERT( numTokenWords < 0xFF );
+
+	memset(keywordTable, 0xFF, sizeof(keywordTable));
+	for( asUINT n = 0; n < numTokenWords; n++ )
+	{
+		asUINT hash = seed;
+		for( asUINT c = 0; c < keywordLength[n]; c++ )
+			hash = KeywordHashStep(hash, tokenWords[n].word[c]);
+
+		asUINT slot = KeywordHashSlot(hash);
+		if( keywordTable[slot] != 0xFF )
+			return false;
+		keywordTable[slot] = asBYTE(n);
+	}
+
+	return true;
+}
+
+eTokenType asCTokenizer::FindKeyword(const asUINT *prefixHash, size_t length, const char *source) const
+{
+	asBYTE idx = keywordTable[KeywordHashSlot(prefixHash[length-1])];
+	if( idx == 0xFF || keywordLength[idx] != length )
+		return ttUnrecognizedToken;
+
+	// The hash is perfect for the token words, but the source may still be a different word with the same hash
+	if( memcmp(tokenWords[idx].word, source, length) != 0 )
+		return ttUnrecognizedToken;
+
+	return tokenWords[idx].tokenType;
+}
+
 asCTokenizer::~asCTokenizer()
 {
 }
 
+size_t asCTokenizer::ScanWhiteSpace(const char *source, size_t sourceLength) const
+{
+	size_t n = 0;
+
+#ifdef AS_USE_SSE2
+	// Test 16 characters at a time for as long as that doesn't read past the end of the source
+	for( ; n + 16 <= sourceLength; n += 16 )
+	{
+		asUINT mask = ~WhiteSpaceMask(_mm_loadu_si128((const __m128i*)(source + n))) & 0xFFFF;
+		if( mask )
+			return n + LowestSetBit(mask);
+	}
+#endif
+
+	while( n < sourceLength && (charClass[asBYTE(source[n])] & CC_WHITESPACE) )
+		n++;
+
+	return n;
+}
+
+size_t asCTokenizer::ScanIdentifier(const char *source, size_t sourceLength) const
+{
+	size_t n = 0;
+
+#ifdef AS_USE_SSE2
+	// Test 16 characters at a time for as long as that doesn't read past the end of the source
+	for( ; n + 16 <= sourceLength; n += 16 )
+	{
+		asUINT mask = ~IdentifierMask(_mm_loadu_si128((const __m128i*)(source + n))) & 0xFFFF;
+		if( mask )
+			return n + LowestSetBit(mask);
+	}
+#endif
+
+	while( n < sourceLength && (charClass[asBYTE(source[n])] & CC_IDENT) )
+		n++;
+
+	return n;
+}
+
 // static
 const char *asCTokenizer::GetDefinition(int tokenType)
 {
@@ -136,21 +287,7 @@ bool asCTokenizer::IsWhiteSpace(const char *source, size_t sourceLength, size_t
 	}
 
 	// Group all other white space characters into one
-	size_t n;
-	int numWsChars = (int)strlen(whiteSpace);
-	for( n = 0; n < sourceLength; n++ )
-	{
-		bool isWhiteSpace = false;
-		for( int w = 0; w < numWsChars; w++ )
-		{
-			if( source[n] == whiteSpace[w] )
-			{
-				isWhiteSpace = true;
-				break;
-			}
-		}
-		if( !isWhiteSpace )	break;
-	}
+	size_t n = ScanWhiteSpace(source, sourceLength);
 
 	if( n > 0 )
 	{
@@ -175,12 +312,8 @@ bool asCTokenizer::IsComment(const char *source, size_t sourceLength, size_t &to
 		// One-line comment
 
 		// Find the length
-		size_t n;
-		for( n = 2; n < sourceLength; n++ )
-		{
-			if( source[n] == '\n' )
-				break;
-		}
+		const char *end = (const char*)memchr(source + 2, '\n', sourceLength - 2);
+		size_t n = end ? size_t(end - source) : sourceLength;
 
 		tokenType   = ttOnelineComment;
 		tokenLength = n+1;
@@ -192,11 +325,19 @@ bool asCTokenizer::IsComment(const char *source, size_t sourceLength, size_t &to
 	{
 		// Multi-line comment
 
-		// Find the length
-		size_t n;
-		for( n = 2; n < sourceLength-1; )
+		// Find the length by jumping from one '*' to the next
+		size_t n = 2;
+		while( n < sourceLength-1 )
 		{
-			if( source[n++] == '*' && source[n] == '/' )
+			const char *star = (const char*)memchr(source + n, '*', sourceLength - 1 - n);
+			if( star == 0 )
+			{
+				n = sourceLength-1;
+				break;
+			}
+
+			n = size_t(star - source) + 1;
+			if( source[n] == '/' )
 				break;
 		}
 
@@ -344,27 +485,26 @@ bool asCTokenizer::IsConstant(const char *source, size_t sourceLength, size_t &t
 bool asCTokenizer::IsIdentifier(const char *source, size_t sourceLength, size_t &tokenLength, eTokenType &tokenType) const
 {
 	// Starting with letter or underscore
-	if( (source[0] >= 'a' && source[0] <= 'z') ||
-		(source[0] >= 'A' && source[0] <= 'Z') ||
-		source[0] == '_' )
+	if( charClass[asBYTE(source[0])] & CC_IDENT_START )
 	{
 		tokenType   = ttIdentifier;
-		tokenLength = 1;
+		tokenLength = ScanIdentifier(source, sourceLength);
 
-		for( size_t n = 1; n < sourceLength; n++ )
+		// Make sure the identifier isn't a reserved keyword. Only 
+		// identifiers short enough to be a keyword need to be hashed
+		if( tokenLength <= maxTokenWordLength )
 		{
-			if( (source[n] >= 'a' && source[n] <= 'z') ||
-				(source[n] >= 'A' && source[n] <= 'Z') ||
-				(source[n] >= '0' && source[n] <= '9') ||
-				source[n] == '_' )
-				tokenLength++;
-			else
-				break;
-		}
+			asUINT hash[maxTokenWordLength];
+			asUINT h = keywordSeed;
+			for( size_t n = 0; n < tokenLength; n++ )
+			{
+				h = KeywordHashStep(h, source[n]);
+				hash[n] = h;
+			}
 
-		// Make sure the identifier isn't a reserved keyword
-		if( alphaKeywordMap.MoveTo(0, asCStringPointer(source, tokenLength)) )
-			return false;
+			if( FindKeyword(hash, tokenLength, source) != ttUnrecognizedToken )
+				return false;
+		}
 
 		return true;
 	}
@@ -374,18 +514,6 @@ bool asCTokenizer::IsIdentifier(const char *source, size_t sourceLength, size_t
 
 bool asCTokenizer::IsKeyWord(const char *source, size_t sourceLength, size_t &tokenLength, eTokenType &tokenType) const
 {
-	// TODO: optimize: This can probably be optimized further with a specialized algorithm
-	//                 As most keywords are shorter, then we should start from the shortest
-	//                 to the longest. Only for some of the keywords is it necessary to look
-	//                 for a longer part, e.g. ! and !is.
-	//
-	//                 We can use a map that separates the tokens based on the first character.
-	//                 The highest number of possible tokens would then be 11 for the letter 'i'.
-
-	// Choose the best map
-	const asCMap<asCStringPointer,eTokenType> *map;
-	int maxLength;
-
 	// Optimization for large array init-lists
 	// This makes a significant improvement when parsing
 	// very long initialization lists, yet doesn't cause
@@ -397,37 +525,29 @@ bool asCTokenizer::IsKeyWord(const char *source, size_t sourceLength, size_t &to
 		return true;
 	}
 
-	if( (source[0] >= 'a' && source[0] <= 'z') ||
-		(source[0] >= 'A' && source[0] <= 'Z') )
-	{
-		map = &alphaKeywordMap;
-		// 'interface' is the longest alpha keyword
-		maxLength = sourceLength > 9 ? 9 : int(sourceLength);
-	}
-	else
+	// Compute the hash for each prefix of the source that could be a keyword
+	size_t maxLength = sourceLength > maxTokenWordLength ? maxTokenWordLength : sourceLength;
+	asUINT hash[maxTokenWordLength];
+	asUINT h = keywordSeed;
+	for( size_t n = 0; n < maxLength; n++ )
 	{
-		map = &nonAlphaKeywordMap;
-		// '>>>=' is the longest non-alpha keyword
-		maxLength = sourceLength > 4 ? 4 : int(sourceLength);
+		h = KeywordHashStep(h, source[n]);
+		hash[n] = h;
 	}
 
 	// Find the longest keyword that matches the start of the source string
 	while( maxLength > 0 )
 	{
-		asSMapNode<asCStringPointer, eTokenType> *cursor;
-		if( map->MoveTo(&cursor, asCStringPointer(source, maxLength)) )
+		eTokenType tt = FindKeyword(hash, maxLength, source);
+		if( tt != ttUnrecognizedToken )
 		{
 			// Tokens that end with a character that can be part of an 
 			// identifier require an extra verification to guarantee that 
 			// we don't split an identifier token, e.g. the "!is" token 
 			// and the tokens "!" and "isTrue" in the "!isTrue" expression.
-			if( maxLength < int(sourceLength) &&
-				((source[maxLength-1] >= 'a' && source[maxLength-1] <= 'z') ||
-				 (source[maxLength-1] >= 'A' && source[maxLength-1] <= 'Z')) &&
-				((source[maxLength] >= 'a' && source[maxLength] <= 'z') ||
-				 (source[maxLength] >= 'A' && source[maxLength] <= 'Z') ||
-				 (source[maxLength] >= '0' && source[maxLength] <= '9') ||
-				 (source[maxLength] == '_')) )
+			if( maxLength < sourceLength &&
+				(charClass[asBYTE(source[maxLength-1])] & CC_ALPHA) &&
+				(charClass[asBYTE(source[maxLength])] & CC_IDENT) )
 			{
 				// The token doesn't really match, even though 
 				// the start of the source matches the token
@@ -435,7 +555,7 @@ bool asCTokenizer::IsKeyWord(const char *source, size_t sourceLength, size_t &to
 				continue;
 			}
 
-			tokenType   = cursor->value;
+			tokenType   = tt;
 			tokenLength = maxLength;
 			return true;
 		}
@@ -42,7 +42,6 @@
 
 #include "as_config.h"
 #include "as_tokendef.h"
-#include "as_map.h"
 #include "as_string.h"
 
 BEGIN_AS_NAMESPACE
@@ -67,10 +66,28 @@ protected:
 	bool IsKeyWord(const char *source, size_t sourceLength, size_t &tokenLength, eTokenType &tokenType) const;
 	bool IsIdentifier(const char *source, size_t sourceLength, size_t &tokenLength, eTokenType &tokenType) const;
 
+	size_t     ScanWhiteSpace(const char *source, size_t sourceLength) const;
+	size_t     ScanIdentifier(const char *source, size_t sourceLength) const;
+	bool       BuildKeywordTable(asUINT seed);
+	eTokenType FindKeyword(const asUINT *prefixHash, size_t length, const char *source) const;
+
 	const asCScriptEngine *engine;
 
-	asCMap<asCStringPointer, eTokenType> alphaKeywordMap;
-	asCMap<asCStringPointer, eTokenType> nonAlphaKeywordMap;
+	// Character classes used to scan white space and identifiers without comparing each character.
+	// With SSE2 they are only used for the last few characters of the source
+	enum
+	{
+		CC_WHITESPACE   = 1,
+		CC_IDENT_START  = 2,
+		CC_IDENT        = 4,
+		CC_ALPHA        = 8
+	};
+	asBYTE charClass[256];
+
+	// Perfect hash table with the index in tokenWords for each keyword, or 0xFF if unused
+	asUINT keywordSeed;
+	asBYTE keywordTable[tokenWordHashSize];
+	asBYTE keywordLength[numTokenWords];
 };
 
 END_AS_NAMESPACE
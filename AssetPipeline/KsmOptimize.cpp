@@ -0,0 +1,205 @@
+//////////////////////////////////////////////////////////////////////////
+// KsmOptimize.cpp
+// Command line pass over a KSM file converted by KsmCreator: reorders
+// every mesh with MeshOptimizer, reports the vertex cache miss ratio
+// (ACMR) and transformed vertices per vertex (ATVR) of each mesh before
+// and after, optionally builds levels of detail with MeshSimplifier and
+// reports their size and error, and writes the result as a v2 KSM file
+// if given a path. Only needs the headless engine sources, see
+// Tests/Makefile
+//
+//   KsmOptimize input.ksm [output.ksm] [--cache N] [--no-overdraw]
+//               [--lods N] [--lod-error E]
+//
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "../Engine/KsmReader.h"
+#include "../Engine/KsmWriter.h"
+#include "../Engine/MeshOptimizer.h"
+#include "../Engine/MeshSimplifier.h"
+#include <chrono>
+
+using namespace Engine;
+
+namespace
+{
+	// The sizes of the engine's VertexPositionNormalTexture and VertexPositionNormalTextureBoneWeight
+	const KsmVertexStrides EngineVertexStrides = { 32, 64 };
+
+	bool readFile(
+		_In_ const char* path,
+		_Out_ std::vector<byte>& data)
+	{
+		data.clear();
+		FILE* in = fopen(path, "rb");
+		if (in == nullptr)
+		{
+			return false;
+		}
+
+		byte buffer[65536];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0)
+		{
+			data.insert(data.end(), buffer, buffer + read);
+		}
+
+		bool failed = ferror(in) != 0;
+		fclose(in);
+		return !failed;
+	}
+
+	bool writeFile(
+		_In_ const char* path,
+		_In_ const std::vector<byte>& data)
+	{
+		FILE* out = fopen(path, "wb");
+		if (out == nullptr)
+		{
+			return false;
+		}
+
+		bool written = fwrite(data.data(), 1, data.size(), out) == data.size();
+		return (fclose(out) == 0) && written;
+	}
+
+	int usage()
+	{
+		printf("usage: KsmOptimize input.ksm [output.ksm] [--cache N] [--no-overdraw] [--lods N] [--lod-error E]\n");
+		return 2;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const char* inputPath = nullptr;
+	const char* outputPath = nullptr;
+	MeshOptimizationSettings settings;
+
+	// No levels of detail unless asked for
+	LodChainSettings lodSettings;
+	lodSettings.MaxLevels = 0;
+
+	for (int a = 1; a < argc; ++a)
+	{
+		if (strcmp(argv[a], "--cache") == 0 && a + 1 < argc)
+		{
+			settings.CacheSize = static_cast<UINT>(atoi(argv[++a]));
+		}
+		else if (strcmp(argv[a], "--no-overdraw") == 0)
+		{
+			settings.OptimizeOverdraw = false;
+		}
+		else if (strcmp(argv[a], "--lods") == 0 && a + 1 < argc)
+		{
+			lodSettings.MaxLevels = static_cast<UINT>(atoi(argv[++a]));
+		}
+		else if (strcmp(argv[a], "--lod-error") == 0 && a + 1 < argc)
+		{
+			lodSettings.MaxError = static_cast<float>(atof(argv[++a]));
+		}
+		else if (argv[a][0] == '-')
+		{
+			return usage();
+		}
+		else if (inputPath == nullptr)
+		{
+			inputPath = argv[a];
+		}
+		else if (outputPath == nullptr)
+		{
+			outputPath = argv[a];
+		}
+		else
+		{
+			return usage();
+		}
+	}
+
+	if (inputPath == nullptr || settings.CacheSize == 0 || lodSettings.MaxError <= 0.0f)
+	{
+		return usage();
+	}
+
+	std::vector<byte> input;
+	KsmModelView model;
+	if (!readFile(inputPath, input) || !KsmReader::Read(input.data(), input.size(), EngineVertexStrides, model))
+	{
+		printf("KsmOptimize: can't read %s as a KSM file\n", inputPath);
+		return 1;
+	}
+
+	// Levels of detail index the vertices the optimizer renumbers, so they're generated after it
+	for (const KsmMeshView& mesh : model.Meshes)
+	{
+		if (!mesh.Lods.empty())
+		{
+			printf("KsmOptimize: %s already has levels of detail, optimize it before generating them\n", inputPath);
+			return 1;
+		}
+	}
+
+	std::vector<OptimizedMesh> optimized;
+	auto start = std::chrono::steady_clock::now();
+	MeshOptimizer::OptimizeModel(model, settings, optimized);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	double transformedBefore = 0.0;
+	double transformedAfter = 0.0;
+	UINT triangles = 0;
+	for (size_t m = 0; m < optimized.size(); ++m)
+	{
+		const MeshOptimizationStats& stats = optimized[m].Stats;
+		UINT meshTriangles = model.Meshes[m].IndexCount / 3;
+		printf("mesh %zu: %u triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u unused vertices dropped, overdraw order %s\n",
+			m, meshTriangles, stats.AcmrBefore, stats.AcmrAfter, stats.AtvrBefore, stats.AtvrAfter, stats.UnusedVertices,
+			!settings.OptimizeOverdraw ? "off" : stats.OverdrawOrderKept ? "kept" : "dropped");
+
+		transformedBefore += static_cast<double>(stats.AcmrBefore) * meshTriangles;
+		transformedAfter += static_cast<double>(stats.AcmrAfter) * meshTriangles;
+		triangles += meshTriangles;
+	}
+
+	if (triangles > 0)
+	{
+		printf("%zu meshes, %u triangles, %u entry cache: ACMR %.3f -> %.3f in %.1f ms\n", optimized.size(), triangles,
+			settings.CacheSize, transformedBefore / triangles, transformedAfter / triangles, ms);
+	}
+
+	// Built after the vertices are renumbered, since the levels index them
+	std::vector<MeshLodChain> lods;
+	if (lodSettings.MaxLevels > 0)
+	{
+		start = std::chrono::steady_clock::now();
+		MeshSimplifier::GenerateLods(model, lodSettings, lods);
+		ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		UINT levels = 0;
+		for (size_t m = 0; m < model.Meshes.size(); ++m)
+		{
+			const KsmMeshView& mesh = model.Meshes[m];
+			for (size_t l = 0; l < mesh.Lods.size(); ++l)
+			{
+				printf("mesh %zu level %zu: %u triangles (%.1f%%), error %.4f\n", m, l + 1, mesh.Lods[l].IndexCount / 3,
+					100.0 * mesh.Lods[l].IndexCount / mesh.IndexCount, mesh.Lods[l].Error);
+			}
+			levels += static_cast<UINT>(mesh.Lods.size());
+		}
+		printf("%u levels of detail built in %.1f ms\n", levels, ms);
+	}
+
+	if (outputPath != nullptr)
+	{
+		std::vector<byte> output;
+		KsmWriter::Write(model, output);
+		if (!writeFile(outputPath, output))
+		{
+			printf("KsmOptimize: can't write %s\n", outputPath);
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,166 @@
+#include "pch.h"
+#include "scriptmoduleinstance.h"
+#include <assert.h>
+#include <string.h>
+#include <map>
+
+BEGIN_AS_NAMESPACE
+
+// The instance currently active for each module. Scripts are only executed
+// from one thread, so the map doesn't need to be protected.
+static std::map<asIScriptModule*, CScriptModuleInstance*> &ActiveInstances()
+{
+	static std::map<asIScriptModule*, CScriptModuleInstance*> instances;
+	return instances;
+}
+
+CScriptModuleInstance::CScriptModuleInstance(asIScriptModule *module)
+{
+	assert( module );
+
+	m_module = module;
+	m_active = false;
+}
+
+CScriptModuleInstance::~CScriptModuleInstance()
+{
+	// The module gets its own values back before this instance's are released
+	Deactivate();
+	ReleaseValues();
+}
+
+int CScriptModuleInstance::Activate(asIScriptContext *ctx)
+{
+	if( m_active )
+		return asSUCCESS;
+
+	if( GetActiveInstance(m_module) )
+		return asCONTEXT_ACTIVE;
+
+	if( m_values.empty() )
+	{
+		// This instance hasn't stored any values yet, so it holds on to the
+		// module's own values and starts out with freshly initialized ones,
+		// which are used in place. The module gets its values back when this
+		// instance deactivates.
+		TakeModuleValues();
+
+		int r = m_module->ResetGlobalVars(ctx);
+		if( r < 0 )
+		{
+			// Give the module its values back and drop what was initialized
+			SwapValues();
+			ReleaseValues();
+			return r;
+		}
+	}
+	else
+	{
+		// The module must not have been rebuilt since the values were saved
+		if( m_values.size() != m_module->GetGlobalVarCount() )
+			return asERROR;
+
+		SwapValues();
+	}
+
+	m_active = true;
+	ActiveInstances()[m_module] = this;
+	return asSUCCESS;
+}
+
+void CScriptModuleInstance::Deactivate()
+{
+	if( !m_active )
+		return;
+
+	assert( m_values.size() == m_module->GetGlobalVarCount() );
+	SwapValues();
+
+	m_active = false;
+	ActiveInstances().erase(m_module);
+}
+
+bool CScriptModuleInstance::IsActive() const
+{
+	return m_active;
+}
+
+asIScriptModule *CScriptModuleInstance::GetModule() const
+{
+	return m_module;
+}
+
+CScriptModuleInstance *CScriptModuleInstance::GetActiveInstance(asIScriptModule *module)
+{
+	std::map<asIScriptModule*, CScriptModuleInstance*>::const_iterator it = ActiveInstances().find(module);
+	return (it != ActiveInstances().end()) ? it->second : 0;
+}
+
+void CScriptModuleInstance::TakeModuleValues()
+{
+	asIScriptEngine *engine = m_module->GetEngine();
+	asUINT count = m_module->GetGlobalVarCount();
+
+	SGlobalValue empty;
+	memset(&empty, 0, sizeof(empty));
+	m_values.resize(count, empty);
+
+	for( asUINT n = 0; n < count; n++ )
+	{
+		SGlobalValue &value = m_values[n];
+		m_module->GetGlobalVar(n, 0, 0, &value.typeId);
+		void *storage = m_module->GetAddressOfGlobalVarStorage(n);
+
+		if( value.typeId & asTYPEID_MASK_OBJECT )
+		{
+			// The object now belongs to this instance until it is handed back.
+			// Clearing the pointer keeps the module from releasing it when the
+			// globals are reinitialized.
+			value.size = sizeof(void*);
+			memcpy(value.storage, storage, sizeof(void*));
+			memset(storage, 0, sizeof(void*));
+		}
+		else
+		{
+			value.size = engine->GetSizeOfPrimitiveType(value.typeId);
+			assert( value.size <= sizeof(value.storage) );
+			memcpy(value.storage, storage, value.size);
+		}
+	}
+}
+
+void CScriptModuleInstance::SwapValues()
+{
+	for( asUINT n = 0; n < m_values.size(); n++ )
+	{
+		SGlobalValue &value = m_values[n];
+		void *storage = m_module->GetAddressOfGlobalVarStorage(n);
+
+		asBYTE current[sizeof(value.storage)];
+		memcpy(current, storage, value.size);
+		memcpy(storage, value.storage, value.size);
+		memcpy(value.storage, current, value.size);
+	}
+}
+
+void CScriptModuleInstance::ReleaseValues()
+{
+	if( m_values.empty() )
+		return;
+
+	asIScriptEngine *engine = m_module->GetEngine();
+	for( asUINT n = 0; n < m_values.size(); n++ )
+	{
+		if( m_values[n].typeId & asTYPEID_MASK_OBJECT )
+		{
+			void *ref;
+			memcpy(&ref, m_values[n].storage, sizeof(void*));
+			if( ref )
+				engine->ReleaseScriptObject(ref, m_values[n].typeId);
+		}
+	}
+
+	m_values.clear();
+}
+
+END_AS_NAMESPACE
@@ -0,0 +1,79 @@
+#ifndef SCRIPTMODULEINSTANCE_H
+#define SCRIPTMODULEINSTANCE_H
+
+#include "pch.h"
+
+#ifndef ANGELSCRIPT_H
+// Avoid having to inform include path if header is already include before
+#include <angelscript.h>
+#endif
+
+#include <vector>
+
+
+BEGIN_AS_NAMESPACE
+
+// CScriptModuleInstance lets many script instances share a single compiled
+// module. The bytecode, types and constants are owned by the module and are
+// shared by all instances, while each instance keeps its own copy of the
+// module's global variables.
+//
+// The VM reads global variables through the module's storage, which for
+// objects and handles holds a pointer. Activating an instance swaps its
+// values into that storage and deactivating swaps them back out, so objects
+// are never copied. Only one instance of a given module may be active at
+// any one time, and the module must not be rebuilt or discarded while one is.
+//
+// An instance doesn't allocate anything until it is first activated. At that
+// point it takes the module's current values out of the storage, keeping them
+// to hand back on deactivation, and the globals are initialized afresh for the
+// instance by running their declarations. Every instance therefore gets its own
+// objects, including those a handle is initialized with, and the module's own
+// values are left as they were, so the module can also be used directly between
+// activations.
+class CScriptModuleInstance
+{
+public:
+	CScriptModuleInstance(asIScriptModule *module);
+	~CScriptModuleInstance();
+
+	// Make this instance's global variables the module's current ones. The
+	// optional context is used to run the initializers on first activation.
+	// Returns asCONTEXT_ACTIVE if another instance of the module is active.
+	int Activate(asIScriptContext *ctx = 0);
+
+	// Hand the module's storage back and keep the current values in this instance
+	void Deactivate();
+
+	bool IsActive() const;
+	asIScriptModule *GetModule() const;
+
+	// The instance currently active for the module, if any
+	static CScriptModuleInstance *GetActiveInstance(asIScriptModule *module);
+
+protected:
+	// Prevent copying, the saved values are owned by the instance
+	CScriptModuleInstance(const CScriptModuleInstance &);
+	CScriptModuleInstance &operator=(const CScriptModuleInstance &);
+
+	void TakeModuleValues();
+	void SwapValues();
+	void ReleaseValues();
+
+	// While the instance is inactive this holds its own values. While it is
+	// active it holds the module's, which are swapped back on deactivation.
+	struct SGlobalValue
+	{
+		int    typeId;
+		asUINT size;               // bytes swapped with the module's storage
+		asBYTE storage[8];         // primitive value, or pointer to object or handle
+	};
+
+	asIScriptModule           *m_module;
+	std::vector<SGlobalValue>  m_values;
+	bool                       m_active;
+};
+
+END_AS_NAMESPACE
+
+#endif
@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////////
+// AnimationStage.cpp
+// Poses every visible animated instance for the frame in parallel
+// before anything is drawn, once per distinct model, clip and sample
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "AnimationStage.h"
+
+using namespace DirectX;
+using namespace Engine;
+
+namespace
+{
+	// Poses evaluated per task. Small enough that a crowd playing many clips still spreads over every core,
+	// large enough that taking tasks costs little next to posing
+	const UINT EvaluationsPerTask = 4;
+}
+
+AnimationStage::AnimationStage(
+	_In_ JobSystem& jobs,
+	_In_ PoseCache& poses)
+	: _jobs(jobs), _poses(poses), _channelTransforms(jobs.GetThreadCount())
+{
+}
+
+UINT AnimationStage::Add(_In_ const AnimationRequest& request)
+{
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(request.Model != nullptr);
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(request.Clip != nullptr ? request.Cursor != nullptr : static_cast<bool>(request.Sample));
+
+	_requests.push_back(request);
+	return static_cast<UINT>(_requests.size() - 1);
+}
+
+void AnimationStage::Run()
+{
+	//
+	// Group the requests on this thread, the cache isn't thread safe. The first request of a group the cache
+	// doesn't have a pose for yet evaluates it, the rest just share it
+	_results.resize(_requests.size());
+
+	for (size_t i = 0; i < _requests.size(); ++i)
+	{
+		const AnimationRequest& request = _requests[i];
+
+		Evaluation evaluation;
+		bool missed;
+		evaluation.Request = &request;
+		evaluation.Pose = &_poses.Reserve(request.Model, request.ClipIndex, request.Time, evaluation.SampleTime, missed);
+
+		if (missed)
+		{
+			_evaluations.push_back(evaluation);
+		}
+		_results[i] = evaluation.Pose;
+	}
+
+	_jobs.ParallelFor(static_cast<UINT>(_evaluations.size()), EvaluationsPerTask,
+		[this](UINT thread, UINT begin, UINT end)
+		{
+			for (UINT i = begin; i < end; ++i)
+			{
+				evaluate(thread, _evaluations[i]);
+			}
+		});
+
+	_evaluations.clear();
+	_requests.clear();
+}
+
+void AnimationStage::evaluate(
+	_In_ UINT thread,
+	_In_ const Evaluation& evaluation)
+{
+	const AnimationRequest& request = *evaluation.Request;
+	std::vector<XMFLOAT4X4>& channelTransforms = _channelTransforms[thread];
+
+	if (request.Clip != nullptr)
+	{
+		request.Clip->Sample(evaluation.SampleTime, *request.Cursor, channelTransforms);
+	}
+	else
+	{
+		request.Sample(evaluation.SampleTime, channelTransforms);
+	}
+
+	request.Model->EvaluatePose(channelTransforms, *evaluation.Pose);
+}
@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////////
+// AnimationStage.h
+// Poses every visible animated instance for the frame before anything is
+// drawn. The scene adds a request per instance while culling. Run then
+// groups the requests through a PoseCache so instances of a model that
+// play the same clip within the same sample share one pose, samples the
+// clips and evaluates the poses and bone palettes of the groups across
+// all cores with the JobSystem, and drawing (CredibleModelData::Draw
+// with a pose) is left with just uploading the results.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CompressedClip.h"
+#include "CredibleModelPose.h"
+#include "JobSystem.h"
+#include "PoseCache.h"
+#include <functional>
+#include <vector>
+
+namespace Engine
+{
+	//
+	// The pose one instance needs this frame. Everything pointed to has to stay valid until Run returns and
+	// no two requests may share a Cursor
+	//
+	struct AnimationRequest
+	{
+		//
+		// Fills channelTransforms with the local transform of every animation channel at the given time
+		//
+		typedef std::function<void(float time, std::vector<DirectX::XMFLOAT4X4>& channelTransforms)> Sampler;
+
+		AnimationRequest() :
+			Model(nullptr), ClipIndex(0), Clip(nullptr), Cursor(nullptr), Time(0.0f)
+		{}
+
+		const PoseEvaluator* Model;
+
+		// Tells the model's clips apart in the cache, see CredibleModelData::FindAnimation
+		UINT ClipIndex;
+
+		// The clip to sample with the instance's cursor. If null, Sample is used instead. Only one request
+		// of each group is sampled, so the cursors of the others are left where they were
+		const CompressedClip* Clip;
+		CompressedClipCursor* Cursor;
+
+		// Samples clips that aren't compressed. Called from the job system's threads
+		Sampler Sample;
+
+		float Time;
+	};
+
+	class AnimationStage
+	{
+	public:
+
+		AnimationStage(
+			_In_ JobSystem& jobs,
+			_In_ PoseCache& poses);
+
+		//
+		// Queues an instance to be posed by the next Run. Returns the index to get its pose with after the Run
+		//
+		UINT Add(_In_ const AnimationRequest& request);
+
+		//
+		// FullName:  Engine::AnimationStage::Run
+		// Looks every queued request up in the pose cache on the calling thread, evaluates the poses it
+		// didn't have yet in parallel and returns once all of them are done, leaving the queue empty for the
+		// next frame. Call once per frame between culling and drawing, and the cache's EndFrame after drawing
+		//
+		void Run();
+
+		//
+		// Returns the pose of a request of the last Run, possibly shared with other requests. It stays valid
+		// until the next Run or the cache's next EndFrame, whichever comes first
+		//
+		const CredibleModelPose& GetPose(_In_ UINT request) const
+		{
+			return *_results[request];
+		}
+
+		size_t GetRequestCount() const
+		{
+			return _requests.size();
+		}
+
+	private:
+
+		// Make class not copyable
+		AnimationStage(const AnimationStage&);
+		AnimationStage& operator=(const AnimationStage&);
+
+		//
+		// A pose the cache didn't have, evaluated for the first request that asked for it
+		//
+		struct Evaluation
+		{
+			const AnimationRequest* Request;
+			float SampleTime;
+			CredibleModelPose* Pose;
+		};
+
+		void evaluate(
+			_In_ UINT thread,
+			_In_ const Evaluation& evaluation);
+
+	private:
+
+		JobSystem& _jobs;
+
+		PoseCache& _poses;
+
+		std::vector<AnimationRequest> _requests;
+
+		// The poses Run is evaluating, kept between frames only to reuse the array
+		std::vector<Evaluation> _evaluations;
+
+		// The pose of every request of the last Run
+		std::vector<const CredibleModelPose*> _results;
+
+		// Sampled channel transforms, one array per job system thread so they're reused without locking
+		std::vector<std::vector<DirectX::XMFLOAT4X4>> _channelTransforms;
+	};
+}
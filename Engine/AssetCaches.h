@@ -0,0 +1,35 @@
+//////////////////////////////////////////////////////////////////////////
+// AssetCaches.h
+// The residency caches the AssetManager keeps its textures and models in,
+// and the handles it hands out to keep them resident. Separate from
+// AssetManager.h so model data can hold texture handles without pulling
+// in the whole manager
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ResidencyCache.h"
+#include "AssetTypeEnum.h"
+
+namespace Engine
+{
+	class CredibleModelData;
+
+	// Hashes InstanceType keys; not every standard library we build with hashes enums
+	struct InstanceTypeHash
+	{
+		size_t operator()(_In_ InstanceType instanceType) const
+		{
+			return std::hash<int>()(static_cast<int>(instanceType));
+		}
+	};
+
+	// Textures keyed by file name
+	typedef ResidencyCache<std::wstring, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> TextureCache;
+	typedef TextureCache::Handle TextureHandle;
+
+	// Models keyed by the InstanceType that loads them, see AssetManager::GetModelInstanceType
+	typedef ResidencyCache<InstanceType, std::unique_ptr<CredibleModelData>, InstanceTypeHash> ModelCache;
+	typedef ModelCache::Handle ModelHandle;
+}
@@ -2,8 +2,11 @@
 // AssetManager.cpp
 // A singleton object that manages all Meshes and their textures. It loads
 // them all into memory and then instances them so there is ever only 1 
-// copy of the textures in memory at a time. It also handles preloading
-// a given list of models/materials (useful for level loading)
+// copy of the textures in memory at a time. Textures and models are kept
+// in budgeted residency caches so ones nothing references anymore are
+// evicted, least recently used first, once a category is over budget.
+// It also handles preloading a given list of models/materials (useful
+// for level loading)
 // (c) 2012 Overclocked Games LLC
 //////////////////////////////////////////////////////////////////////////
 
@@ -21,17 +24,125 @@
 #include "AnimatedObjectInstance.h"
 #include "DoodadInstance.h"
 #include "TinyUtilities.h"
+#include "MappedFile.h"
+#include <set>
 
 using namespace Engine;
 
 AssetManager* AssetManager::_instance = nullptr;
 
+// Residency budgets used until SetResidencyBudgets is called
+static const size_t DefaultTextureBudget = 512 * 1024 * 1024;
+static const size_t DefaultModelBudget = 128 * 1024 * 1024;
+
+//
+// Returns the number of bits per texel of the given format. Block compressed formats return their
+// average over a 4x4 block
+//
+static size_t formatBitsPerPixel(_In_ DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_A8_UNORM:
+		return 8;
+
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_B5G6R5_UNORM:
+		return 16;
+
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R32G32_FLOAT:
+		return 64;
+
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		return 128;
+
+	default:
+		return 32;
+	}
+}
+
+//
+// Estimates the video memory used by the texture behind the given view, including its mip chain
+//
+static size_t estimateTextureBytes(_In_ ID3D11ShaderResourceView* view)
+{
+	if (view == nullptr)
+	{
+		return 0;
+	}
+
+	Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+	view->GetResource(&resource);
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	if (FAILED(resource.As(&texture)))
+	{
+		return 0;
+	}
+
+	D3D11_TEXTURE2D_DESC desc;
+	texture->GetDesc(&desc);
+
+	size_t bitsPerPixel = formatBitsPerPixel(desc.Format);
+	bool blockCompressed = (desc.Format >= DXGI_FORMAT_BC1_TYPELESS && desc.Format <= DXGI_FORMAT_BC5_SNORM) ||
+		(desc.Format >= DXGI_FORMAT_BC6H_TYPELESS && desc.Format <= DXGI_FORMAT_BC7_UNORM_SRGB);
+
+	size_t bytes = 0;
+	size_t width = desc.Width;
+	size_t height = desc.Height;
+
+	for (UINT mip = 0; mip < desc.MipLevels; ++mip)
+	{
+		// Block compressed mips are stored as whole 4x4 blocks
+		size_t storedWidth = blockCompressed ? ((width + 3) & ~3) : width;
+		size_t storedHeight = blockCompressed ? ((height + 3) & ~3) : height;
+		bytes += storedWidth * storedHeight * bitsPerPixel / 8;
+
+		width = std::max<size_t>(width / 2, 1);
+		height = std::max<size_t>(height / 2, 1);
+	}
+
+	return bytes * desc.ArraySize;
+}
+
 AssetManager::AssetManager(void)
-	: _d3dDevice(nullptr), _dc(nullptr), _camera(nullptr), _loadedTerrain(nullptr), _perObjectCB(nullptr)
+	: _d3dDevice(nullptr), _dc(nullptr), _textureCache(DefaultTextureBudget), _modelCache(DefaultModelBudget),
+	_camera(nullptr), _loadedTerrain(nullptr), _perObjectCB(nullptr)
 {}
 
 AssetManager::~AssetManager(void)
 {
+	// Stop the loader threads before anything they could be using goes away
+	_loaderPool.reset();
+
 	if (_d3dDevice) 
 	{
 		_d3dDevice->Release();
@@ -49,10 +160,9 @@ AssetManager::~AssetManager(void)
 		delete _loadedTerrain;
 	}
 
-	_loadedModels.clear();
-
-	// ComPtr will release when destructor is called
-	_loadedTextures.clear();
+	// Models go first, they hold handles to their textures. ComPtr will release when the textures are evicted
+	_modelCache.Clear();
+	_textureCache.Clear();
 }
 
 AssetManager* AssetManager::Instance()
@@ -84,76 +194,31 @@ void AssetManager::Initialize(
 
 	_camera = camera;
 
+	// Leave a core for the render thread
+	UINT loaderThreads = std::max(std::thread::hardware_concurrency(), 2U) - 1;
+	_loaderPool = std::make_unique<ThreadPool>(loaderThreads);
+	_modelStreamer = std::make_unique<AssetStreamer<ModelHandle>>(*_loaderPool);
+	_textureStreamer = std::make_unique<AssetStreamer<TextureHandle>>(*_loaderPool);
+
 	//_groundTextureArray = GetTextureArray(groundTextures);
 	_waterTexture = this->GetTexture(L"Assets\\Textures\\Terrain\\water.dds");
 
 	//
-	// Load model metadata
+	// Load model metadata and instance to model mappings, from the compiled table if it is up to date
+	// with the XML
 	//
-	std::wstring xmlPath(_assetRootDirectory);
-	xmlPath.append(L"Engine\\Assets\\MetaData\\ModelMetaData.xml");
-	PathString narrowXmlString(xmlPath.c_str());
-
-	tinyxml2::XMLDocument modelMetaDataXml;
+	std::wstring metaDataDirectory(_assetRootDirectory);
+	metaDataDirectory.append(L"Engine\\Assets\\MetaData\\");
 
-	int result = 0;
-	if ((result = modelMetaDataXml.LoadFile(narrowXmlString.ToCStr())) != tinyxml2::XML_NO_ERROR)
+	AssetMetadata metadata;
+	if (!AssetMetadataTable::Load(metaDataDirectory, metadata))
 	{
-		MUKASHIDEBUG_CRITICALERROR(L"Failed to load Engine\\Assets\\MetaData\\ModelMetaData.xml! Error reported by tinyxml2: %d", result);
+		MUKASHIDEBUG_CRITICALERROR(L"Failed to load the asset metadata in: %s", metaDataDirectory.c_str());
 	}
 
-	tinyxml2::XMLElement* modelIterator = modelMetaDataXml.FirstChildElement("models")->FirstChildElement("model");
-
-	do 
-	{
-		InstanceType modelName = TinyUtilities::GetInstanceTypeAttribute("filename", modelIterator);		
-
-		for (auto it = ItemSlot::ITEM_SLOT_BEGIN + 1; it != ItemSlot::ITEM_SLOT_END; it++)
-		{
-			ItemSlot slot = static_cast<ItemSlot>(it);
-			_defaultTextures[modelName][slot] = L"";
-		}
-
-		tinyxml2::XMLElement* textureMapIterator = modelIterator->FirstChildElement("texturemappings")->FirstChildElement("texturemap");
-
-		do
-		{
-			ItemSlot itemSlot = InstanceSaveTypes::StringToItemSlot(TinyUtilities::GetStringAttribute("slot", textureMapIterator));
-			_defaultTextures[modelName][itemSlot] = TinyUtilities::GetStringAttribute("texture", textureMapIterator);
-
-			textureMapIterator = textureMapIterator->NextSiblingElement();
-		} while (textureMapIterator);
-
-
-		modelIterator = modelIterator->NextSiblingElement();
-	} while (modelIterator);
-
-	//
-	// Load Instance to model mappings
-	// 
-	xmlPath = _assetRootDirectory;
-	xmlPath.append(L"Engine\\Assets\\MetaData\\InstanceToModelMapping.xml");
-	narrowXmlString = xmlPath.c_str();
-
-	tinyxml2::XMLDocument instanceMappingXml;
-
-	result = 0;
-	if ((result = instanceMappingXml.LoadFile(narrowXmlString.ToCStr())) != tinyxml2::XML_NO_ERROR)
-	{
-		MUKASHIDEBUG_CRITICALERROR(L"Failed to load Engine\\Assets\\MetaData\\InstanceToModelMapping.xml! Error reported by tinyxml2: %d", result);
-	}
-
-	tinyxml2::XMLElement* instanceIterator = instanceMappingXml.FirstChildElement("instances")->FirstChildElement("instance");
-
-	do
-	{
-		InstanceType fromInstance = TinyUtilities::GetInstanceTypeAttribute("enum", instanceIterator);
-		InstanceType toModelInstance = TinyUtilities::GetInstanceTypeAttribute("mappedto", instanceIterator);
-
-		_instanceToModelInstance[fromInstance] = toModelInstance;
-
-		instanceIterator = instanceIterator->NextSiblingElement();
-	} while (instanceIterator);
+	_defaultTextures = std::move(metadata.DefaultTextures);
+	_instanceToModelInstance = std::move(metadata.InstanceToModelInstance);
+	_pinnedModels.assign(InstanceType::INSTANCE_TYPE_END, nullptr);
 }
 
 //
@@ -274,134 +339,196 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetManager::GetTextureArray(_
 //
 ID3D11ShaderResourceView* AssetManager::GetTexture(_In_ std::wstring assetRelativePath)
 {
-	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ret = nullptr;
+	TextureHandle texture = AcquireTexture(assetRelativePath);
+	if (!texture.IsValid())
+	{
+		return nullptr;
+	}
+
+	// The caller keeps a raw pointer, so the texture can't be evicted anymore
+	_textureCache.Pin(texture);
+	return texture.Get().Get();
+}
 
+TextureHandle AssetManager::AcquireTexture(_In_ std::wstring assetRelativePath)
+{
 	// Check if we've initialized
 	if (_d3dDevice == nullptr)
 	{
 		MUKASHIDEBUG_CRITICALERROR(L"Must call AssetManager::Initialize() first!");
-		return nullptr;
+		return TextureHandle();
 	}
 
 	// Attempt to find this texture in the pool of assets already loaded into memory
 	// Texture keys are the filenames 
 	PathString tmp(assetRelativePath.c_str());
 	std::wstring key(tmp.GetFileNameOnly());
-	
 
-	auto it = _loadedTextures.find(key);
-	if (it != _loadedTextures.end())
+	TextureHandle texture = _textureCache.Find(key);
+	if (texture.IsValid())
 	{
-		ret = it->second;
+		return texture;
 	}
-	else
-	{
-		// attempt to load it instead
-		byte* memBlock = nullptr;
-		std::ifstream::pos_type size;
 
-		std::wstring filePath(_assetRootDirectory);
-		filePath.append(assetRelativePath);
-		PathString tempPathString(filePath.c_str());
+	// attempt to load it instead
+	std::wstring filePath(_assetRootDirectory);
+	filePath.append(assetRelativePath);
 
-		std::wstring ext(tempPathString.GetExtension());
-		if (ext == L".dds" || ext == L".DDS")
-		{
-			std::ifstream file(filePath, std::ios::in | std::ios::binary | std::ios::ate);
+	MappedFile file;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ret = createTexture(filePath, file);
 
-			if (file.is_open())
-			{
-				size = file.tellg();
-				memBlock = new byte[(unsigned int)size];
-				file.seekg(0, std::ios::beg);
-				file.read((char*)memBlock, size);
-				file.close();
-			}
-			else
-			{
-				MUKASHIDEBUG_CRITICALERROR(L"Failed to load texture at: %s", filePath.c_str());
-			}
+	size_t bytes = estimateTextureBytes(ret.Get());
+	return _textureCache.Insert(key, ret, bytes);
+}
 
-			HRESULT hr = CreateDDSTextureFromMemory(_d3dDevice, memBlock, (size_t)size, nullptr, &ret);
-			MUKASHIDEBUG_CRITICALERROR_ONTRUE(FAILED(hr));
+void AssetManager::SetResidencyBudgets(
+	_In_ size_t textureBytes,
+	_In_ size_t modelBytes)
+{
+	// Models first, evicting them can release textures
+	_modelCache.SetBudget(modelBytes);
+	_textureCache.SetBudget(textureBytes);
+}
 
-			if (FAILED(hr))
-			{
-				MUKASHIDEBUG_CRITICALERROR(L"Call to CreateDDSTextureFromMemory failed for texture at: %s", filePath.c_str());
-			}
-		}
-		else
-		{
-			HRESULT hr = CreateWICTextureFromFile(_d3dDevice, _dc, filePath.c_str(), nullptr, &ret);			
-			MUKASHIDEBUG_CRITICALERROR_ONTRUE(FAILED(hr));
+void AssetManager::DumpAssets()
+{
+	std::fill(_pinnedModels.begin(), _pinnedModels.end(), nullptr);
 
-			if (FAILED(hr))
-			{
-				MUKASHIDEBUG_CRITICALERROR(L"Call to CreateWICTextureFromFile failed for texture at: %s", filePath.c_str());
-			}
+	_modelCache.Clear();
+	_textureCache.Clear();
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> AssetManager::createTexture(
+	_In_ const std::wstring& filePath,
+	_Inout_ MappedFile& file)
+{
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> ret = nullptr;
+
+	PathString tempPathString(filePath.c_str());
+	std::wstring ext(tempPathString.GetExtension());
+	if (ext == L".dds" || ext == L".DDS")
+	{
+		// The DDS loader copies what it needs so the file only has to stay mapped for the call
+		if (!file.IsOpen() && !file.Open(filePath))
+		{
+			MUKASHIDEBUG_CRITICALERROR(L"Failed to load texture at: %s", filePath.c_str());
 		}
 
-		_loadedTextures[key] = ret;
+		HRESULT hr = CreateDDSTextureFromMemory(_d3dDevice, file.GetData(), file.GetSize(), nullptr, &ret);
+		MUKASHIDEBUG_CRITICALERROR_ONTRUE(FAILED(hr));
+
+		if (FAILED(hr))
+		{
+			MUKASHIDEBUG_CRITICALERROR(L"Call to CreateDDSTextureFromMemory failed for texture at: %s", filePath.c_str());
+		}
+	}
+	else
+	{
+		HRESULT hr = CreateWICTextureFromFile(_d3dDevice, _dc, filePath.c_str(), nullptr, &ret);			
+		MUKASHIDEBUG_CRITICALERROR_ONTRUE(FAILED(hr));
 
-		if (memBlock != nullptr)
+		if (FAILED(hr))
 		{
-			delete[] memBlock;
-			memBlock = nullptr;
+			MUKASHIDEBUG_CRITICALERROR(L"Call to CreateWICTextureFromFile failed for texture at: %s", filePath.c_str());
 		}
 	}
 
-	return ret.Get();
+	return ret;
 }
 
+std::shared_future<TextureHandle> AssetManager::GetTextureAsync(_In_ std::wstring assetRelativePath)
+{
+	PathString tmp(assetRelativePath.c_str());
+	std::wstring key(tmp.GetFileNameOnly());
+
+	TextureHandle texture = _textureCache.Find(key);
+	if (texture.IsValid())
+	{
+		std::promise<TextureHandle> loaded;
+		loaded.set_value(texture);
+		return loaded.get_future().share();
+	}
+
+	std::wstring filePath(_assetRootDirectory);
+	filePath.append(assetRelativePath);
+
+	return _textureStreamer->Request(key, [this, key, filePath]() -> AssetStreamer<TextureHandle>::UploadStep
+	{
+		// Runs on a loader thread, so only the file and the captured copies may be touched here. WIC
+		// textures are decoded by the device call so all we can do for them is read them ahead
+		auto file = std::make_shared<MappedFile>();
+		if (!file->Open(filePath))
+		{
+			return nullptr;
+		}
+		file->Prefetch();
+
+		return [this, key, filePath, file]() -> TextureHandle
+		{
+			// A synchronous GetTexture may have loaded it in the meantime
+			TextureHandle loaded = _textureCache.Find(key, false);
+			if (loaded.IsValid())
+			{
+				return loaded;
+			}
+
+			Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> texture = createTexture(filePath, *file);
+			size_t bytes = estimateTextureBytes(texture.Get());
+			return _textureCache.Insert(key, texture, bytes);
+		};
+	});
+}
 
 CredibleModelData* AssetManager::LoadKsmModel(_In_ InstanceType instanceType)
 {
-	CredibleModelData* model = nullptr;
+	// Already handed out for this type, it is finished and pinned
+	if (static_cast<size_t>(instanceType) < _pinnedModels.size() && _pinnedModels[instanceType])
+	{
+		return _pinnedModels[instanceType];
+	}
 
+	ModelHandle model = AcquireKsmModel(instanceType);
+	if (!model.IsValid())
+	{
+		return nullptr;
+	}
+
+	// The caller keeps a raw pointer, so the model can't be evicted anymore
+	_modelCache.Pin(model);
+
+	if (static_cast<size_t>(instanceType) < _pinnedModels.size())
+	{
+		_pinnedModels[instanceType] = model.Get().get();
+	}
+
+	return model.Get().get();
+}
+
+ModelHandle AssetManager::AcquireKsmModel(_In_ InstanceType instanceType)
+{
 	//
 	// Convert the instance type to the correct model (not all InstanceTypes have their own model, there is a relationship
 	// of potentially many InstanceTypes to any KSM model saved on disk. Some InstanceTypes map directly to a model though
 	// for ease of loading, so simply identify the InstanceType that maps to the model that needs to be loaded
 	InstanceType modelInstanceType = GetModelInstanceType(instanceType);
 
-	if (_instanceToModelInstance.find(instanceType) != _instanceToModelInstance.end())
-	{
-		modelInstanceType = _instanceToModelInstance[instanceType];
-	}
-
 	// Check if the model has already been loaded
-	for (auto& modelCategory : _loadedModels)
-	{
-		if (modelCategory.first == modelInstanceType)
-		{
-			model = modelCategory.second.get();
-			break;
-		}
-	}
+	ModelHandle model = _modelCache.Find(modelInstanceType);
 
-	if (nullptr == model)
+	if (!model.IsValid())
 	{
 		// attempt to load it instead
-		std::unique_ptr<byte[]> memBlock = nullptr;
-		std::ifstream::pos_type size;
-
 		// Combine the root directory with the asset name to get the path to the asset
 		std::wstring filePath(_assetRootDirectory);
 		filePath.append(InstanceSaveTypes::InstanceTypeToModelPath(modelInstanceType));
-		std::ifstream file(filePath, std::ios::in | std::ios::binary | std::ios::ate);
 
-		if (file.is_open())
-		{
-			size = file.tellg();
-			memBlock.reset( new byte[(unsigned int)size] );
-			file.seekg(0, std::ios::beg);
-			file.read((char*)memBlock.get(), size);
-			file.close();
-		}
-		else
+		// Map the file rather than reading it so the vertex and index data go from the page cache
+		// straight into the GPU buffers. The mapping is released once the model has been created
+		MappedFile file;
+		if (!file.Open(filePath))
 		{
 			MUKASHIDEBUG_CRITICALERROR(L"Failed to load model at: %s", filePath.c_str());
-			return nullptr;
+			return ModelHandle();
 		}
 
 		bool readSubsetsAsInstances = false;
@@ -412,19 +539,168 @@ CredibleModelData* AssetManager::LoadKsmModel(_In_ InstanceType instanceType)
 			readSubsetsAsInstances = true;
 		}
 
-		_loadedModels[modelInstanceType] = std::make_unique<CredibleModelData>(memBlock.get(), _d3dDevice, readSubsetsAsInstances);
+		auto loadedModel = std::make_unique<CredibleModelData>(file.GetData(), file.GetSize(), _d3dDevice, readSubsetsAsInstances);
+		if (!loadedModel->IsLoaded())
+		{
+			MUKASHIDEBUG_CRITICALERROR(L"Failed to read model at: %s", filePath.c_str());
+			return ModelHandle();
+		}
+
+		model = insertModel(modelInstanceType, std::move(loadedModel));
+	}
+
+	finishModel(instanceType, model.Get().get());
+	return model;
+}
+
+std::shared_future<ModelHandle> AssetManager::LoadKsmModelAsync(_In_ InstanceType instanceType)
+{
+	InstanceType modelInstanceType = GetModelInstanceType(instanceType);
+
+	auto result = std::make_shared<std::promise<ModelHandle>>();
+	std::shared_future<ModelHandle> future = result->get_future().share();
+
+	// Already loaded, finish it right away just like AcquireKsmModel would
+	ModelHandle loaded = _modelCache.Find(modelInstanceType);
+	if (loaded.IsValid())
+	{
+		finishModel(instanceType, loaded.Get().get());
+		result->set_value(loaded);
+		return future;
+	}
+
+	std::wstring filePath(_assetRootDirectory);
+	filePath.append(InstanceSaveTypes::InstanceTypeToModelPath(modelInstanceType));
+
+	std::wstring assetRootDirectory(_assetRootDirectory);
+
+	bool readSubsetsAsInstances = false;
+
+	if (instanceType > InstanceType::NUETRAL_BEGIN &&
+		instanceType < InstanceType::EVIL_END)
+	{
+		readSubsetsAsInstances = true;
+	}
+
+	PendingModel pending;
+	pending.Instance = instanceType;
+	pending.Result = result;
+	pending.Model = _modelStreamer->Request(filePath,
+		[this, filePath, assetRootDirectory, modelInstanceType, readSubsetsAsInstances]() -> AssetStreamer<ModelHandle>::UploadStep
+	{
+		// Runs on a loader thread, so only the file and the captured copies may be touched here
+		auto file = std::make_shared<MappedFile>();
+		if (!file->Open(filePath))
+		{
+			return nullptr;
+		}
+		file->Prefetch();
+
+		auto ksm = std::make_shared<KsmModelView>();
+		if (!KsmReader::Read(file->GetData(), file->GetSize(), CredibleModelData::KsmEngineVertexStrides, *ksm))
+		{
+			return nullptr;
+		}
+
+		// Read the model's textures ahead as well so creating them during the upload doesn't wait on the disk
+		std::set<std::wstring> texturePaths;
+		for (const auto& mesh : ksm->Meshes)
+		{
+			if (!mesh.DiffusePath.empty()) texturePaths.insert(mesh.DiffusePath);
+			if (!mesh.NormalPath.empty()) texturePaths.insert(mesh.NormalPath);
+		}
+
+		for (const auto& texturePath : texturePaths)
+		{
+			MappedFile texture;
+			if (texture.Open(assetRootDirectory + texturePath))
+			{
+				texture.Prefetch();
+			}
+		}
+
+		return [this, file, ksm, modelInstanceType, readSubsetsAsInstances]() -> ModelHandle
+		{
+			// A synchronous LoadKsmModel may have loaded it in the meantime
+			ModelHandle loaded = _modelCache.Find(modelInstanceType, false);
+			if (loaded.IsValid())
+			{
+				return loaded;
+			}
+
+			auto model = std::make_unique<CredibleModelData>(*ksm, _d3dDevice, readSubsetsAsInstances);
+			if (!model->IsLoaded())
+			{
+				return ModelHandle();
+			}
+
+			return insertModel(modelInstanceType, std::move(model));
+		};
+	});
+
+	_pendingModels.push_back(pending);
+	return future;
+}
+
+void AssetManager::ProcessUploads(_In_ UINT maxUploads)
+{
+	// Textures go first so models uploaded after them find their textures already created
+	UINT processed = _textureStreamer->ProcessUploads(maxUploads);
+	_modelStreamer->ProcessUploads(maxUploads - processed);
+
+	for (auto it = _pendingModels.begin(); it != _pendingModels.end();)
+	{
+		if (it->Model.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		{
+			++it;
+			continue;
+		}
+
+		ModelHandle model = it->Model.get();
+		if (model.IsValid())
+		{
+			finishModel(it->Instance, model.Get().get());
+		}
+		else
+		{
+			MUKASHIDEBUG_CRITICALERROR(L"Failed to load model for instance type: %d", (int)it->Instance);
+		}
+
+		it->Result->set_value(model);
+		it = _pendingModels.erase(it);
 	}
+}
 
-	model = _loadedModels[modelInstanceType].get();
+UINT AssetManager::GetPendingLoadCount() const
+{
+	return _modelStreamer->GetPendingCount() + _textureStreamer->GetPendingCount();
+}
 
+ModelHandle AssetManager::insertModel(
+	_In_ InstanceType modelInstanceType,
+	_In_ std::unique_ptr<CredibleModelData> model)
+{
 	//
-	// Set default textures
-	for (auto it = ItemSlot::ITEM_SLOT_BEGIN + 1; it != ItemSlot::ITEM_SLOT_END; it++)
+	// Set default textures. They only depend on the model type so they are applied once here rather than
+	// every time an instance is spawned
+	if (static_cast<size_t>(modelInstanceType) < _defaultTextures.size())
 	{
-		ItemSlot slot = static_cast<ItemSlot>(it);
-		model->SetTextureMapping(slot, _defaultTextures[modelInstanceType][slot]);
+		const AssetMetadata::DefaultTextureSet& defaults = _defaultTextures[modelInstanceType];
+		for (auto it = ItemSlot::ITEM_SLOT_BEGIN + 1; it != ItemSlot::ITEM_SLOT_END; it++)
+		{
+			ItemSlot slot = static_cast<ItemSlot>(it);
+			model->SetTextureMapping(slot, defaults[slot]);
+		}
 	}
 
+	size_t bytes = model->GetResidentBytes();
+	return _modelCache.Insert(modelInstanceType, std::move(model), bytes);
+}
+
+CredibleModelData* AssetManager::finishModel(
+	_In_ InstanceType instanceType,
+	_In_ CredibleModelData* model)
+{
 	// TODO: Remove this and place it in the XML configurations somewhere
 	if (instanceType == Doodad_Hitodama || instanceType == Doodad_Fire)
 	{
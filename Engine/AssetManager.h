@@ -2,8 +2,11 @@
 // AssetManager.h
 // A singleton object that manages all Meshes and their textures. It loads
 // them all into memory and then instances them so there is ever only 1 
-// copy of the textures in memory at a time. It also handles pre-loading
-// a given list of models/materials (useful for level loading)
+// copy of the textures in memory at a time. Textures and models are kept
+// in budgeted residency caches so ones nothing references anymore are
+// evicted, least recently used first, once a category is over budget.
+// It also handles pre-loading a given list of models/materials (useful
+// for level loading)
 // (c) 2012 Overclocked Games LLC
 //////////////////////////////////////////////////////////////////////////
 
@@ -14,6 +17,9 @@
 #include "ConstantBuffer.h"
 #include "AssetTypeEnum.h"
 #include "InstanceSaveTypes.h"
+#include "AssetStreamer.h"
+#include "AssetCaches.h"
+#include "AssetMetadata.h"
 
 using namespace std;
 
@@ -24,6 +30,7 @@ namespace Engine
 	class CredibleModelData;
 	class Camera;
 	class Terrain;
+	class MappedFile;
 	struct ObjectConstBuffer;
 
 	class AssetManager
@@ -39,15 +46,51 @@ namespace Engine
 		// be loaded into memory
 		void PreloadAssets(std::wstring assetList);
 
-		// All assets loaded into memory will be deleted (not instances)
+		// All assets loaded into memory will be deleted (not instances). Assets still referenced by
+		// a handle stay resident until the handle is released
 		void DumpAssets();
 
 		//
 		// FullName:  Engine::AssetManager::LoadKsmModel
-		// Loads the KSM model associated with the given instanceType
+		// Loads the KSM model associated with the given instanceType. The model is pinned, it stays
+		// resident until DumpAssets is called. Prefer AcquireKsmModel for models that can come and go
 		//
 		CredibleModelData* LoadKsmModel(_In_ InstanceType instanceType);
 
+		//
+		// FullName:  Engine::AssetManager::AcquireKsmModel
+		// Loads the KSM model associated with the given instanceType and returns a handle that keeps it
+		// resident. Once every handle to it is released the model may be evicted. Returns an empty handle
+		// if the model could not be loaded
+		//
+		ModelHandle AcquireKsmModel(_In_ InstanceType instanceType);
+
+		//
+		// FullName:  Engine::AssetManager::LoadKsmModelAsync
+		// Starts loading the KSM model associated with the given instanceType in the background. File I/O
+		// and parsing run on the loader threads, the model itself is created by ProcessUploads. The future
+		// completes with what AcquireKsmModel would have returned
+		//
+		std::shared_future<ModelHandle> LoadKsmModelAsync(_In_ InstanceType instanceType);
+
+		//
+		// FullName:  Engine::AssetManager::GetTextureAsync
+		// Starts loading a texture in the background, see LoadKsmModelAsync
+		//
+		std::shared_future<TextureHandle> GetTextureAsync(_In_ std::wstring assetRelativePath);
+
+		//
+		// FullName:  Engine::AssetManager::ProcessUploads
+		// Creates the device resources of at most maxUploads assets that finished loading in the background
+		// and completes their futures. Call once per frame from the render thread
+		//
+		void ProcessUploads(_In_ UINT maxUploads);
+
+		//
+		// Returns the number of background loads that haven't completed yet
+		//
+		UINT GetPendingLoadCount() const;
+
 		//
 		// FullName:  Engine::AssetManager::CreateUpperTerrain
 		// Creates the upper (overworld) terrain
@@ -57,10 +100,38 @@ namespace Engine
 		Terrain* GetTerrainData() const { return _loadedTerrain; }
 
 		//
-		// Return a pointer to a shader texture resource
+		// Return a pointer to a shader texture resource. The texture is pinned, it stays resident until
+		// DumpAssets is called. Prefer AcquireTexture for textures that can come and go
 		//
 		ID3D11ShaderResourceView* GetTexture(_In_ std::wstring assetRelativePath);
 
+		//
+		// FullName:  Engine::AssetManager::AcquireTexture
+		// Loads a texture and returns a handle that keeps it resident. Once every handle to it is released
+		// the texture may be evicted
+		//
+		TextureHandle AcquireTexture(_In_ std::wstring assetRelativePath);
+
+		//
+		// FullName:  Engine::AssetManager::SetResidencyBudgets
+		// Sets how many bytes of textures and of models are kept resident. Unreferenced assets are evicted
+		// least recently used first to stay within them; referenced assets are never evicted so a category
+		// can still go over its budget
+		//
+		void SetResidencyBudgets(
+			_In_ size_t textureBytes,
+			_In_ size_t modelBytes);
+
+		//
+		// Returns the residency counters of the textures (bytes resident, hits, misses, evictions...)
+		//
+		ResidencyStats GetTextureResidency() const { return _textureCache.GetStats(); }
+
+		//
+		// Returns the residency counters of the models
+		//
+		ResidencyStats GetModelResidency() const { return _modelCache.GetStats(); }
+
 		//
 		// FullName:  Engine::AssetManager::GetItemUITexture
 		// Given a InstanceType that is an item (will return NULL if not) it'll return the loaded
@@ -73,9 +144,9 @@ namespace Engine
 		// of potentially many InstanceTypes to any KSM model saved on disk. Some InstanceTypes map directly to a model though
 		// for ease of loading, so simply identify the InstanceType that maps to the model that needs to be loaded
 		//
-		InstanceType GetModelInstanceType(_In_ InstanceType instanceType)
+		InstanceType GetModelInstanceType(_In_ InstanceType instanceType) const
 		{
-			if (_instanceToModelInstance.find(instanceType) != _instanceToModelInstance.end())
+			if (static_cast<size_t>(instanceType) < _instanceToModelInstance.size())
 			{
 				instanceType = _instanceToModelInstance[instanceType];
 			}
@@ -99,6 +170,23 @@ namespace Engine
 		// Performs cleanup (see note in CPP file on this)
 		static void cleanUp();
 
+		// Applies the state that depends on the instance type (rather than the model) to a loaded model
+		CredibleModelData* finishModel(
+			_In_ InstanceType instanceType,
+			_In_ CredibleModelData* model);
+
+		// Applies the default texture mappings of the model type to a newly created model and adds it to
+		// the model cache
+		ModelHandle insertModel(
+			_In_ InstanceType modelInstanceType,
+			_In_ std::unique_ptr<CredibleModelData> model);
+
+		// Creates the texture at the given path. DDS textures are created from file, which is opened if
+		// it isn't already
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> createTexture(
+			_In_ const std::wstring& filePath,
+			_Inout_ MappedFile& file);
+
 		// Make class not copyable
 		AssetManager(const AssetManager&);
 		AssetManager& operator=(const AssetManager&);
@@ -120,10 +208,11 @@ namespace Engine
 		ID3D11DeviceContext* _dc;
 
 		// The storage data structure for Textures
-		std::unordered_map<std::wstring, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> _loadedTextures;
+		TextureCache _textureCache;
 
-		// The storage data structure for Models
-		std::map<InstanceType, std::unique_ptr<CredibleModelData>> _loadedModels;
+		// The storage data structure for Models. Declared after the textures since models hold handles
+		// to their textures
+		ModelCache _modelCache;
 
 		Camera* _camera;
 
@@ -134,13 +223,38 @@ namespace Engine
 		// The per object constant buffer
 		ConstantBuffer<ObjectConstBuffer>* _perObjectCB;
 
-		map<InstanceType, map<ItemSlot, wstring>> _defaultTextures;
+		// The names of the default texture of every item slot, indexed by the model's InstanceType. Applied
+		// once when a model is created
+		std::vector<AssetMetadata::DefaultTextureSet> _defaultTextures;
 
 		// Maps InstanceTypes to the InstanceType that loads the model KSM data. For example, there are many InstanceTypes 
 		// that all load the same model (Ochimusha.ksm). These all need to map back to the InstanceType that loads that model
 		// (Ochimusha) when loading the model data for it. These InstanceTypes then customize the textures for that model in
-		// the CredibleObject that wraps them to make them look unique
-		map<InstanceType, InstanceType> _instanceToModelInstance;
+		// the CredibleObject that wraps them to make them look unique. Indexed by InstanceType, types that load their
+		// own model map to themselves
+		std::vector<InstanceType> _instanceToModelInstance;
+
+		// The finished models LoadKsmModel has handed out, indexed by InstanceType, so spawning a type that is
+		// already loaded is a single lookup. They are pinned in _modelCache; cleared by DumpAssets
+		std::vector<CredibleModelData*> _pinnedModels;
+
+		// A model requested through LoadKsmModelAsync whose data is streaming in. Once it is loaded the
+		// instance type state is applied and Result is completed
+		struct PendingModel
+		{
+			InstanceType Instance;
+			std::shared_future<ModelHandle> Model;
+			std::shared_ptr<std::promise<ModelHandle>> Result;
+		};
+
+		std::vector<PendingModel> _pendingModels;
+
+		// Background loading of models and textures
+		std::unique_ptr<AssetStreamer<ModelHandle>> _modelStreamer;
+		std::unique_ptr<AssetStreamer<TextureHandle>> _textureStreamer;
+
+		// The loader threads. Declared last so they are stopped before the streamers they feed go away
+		std::unique_ptr<ThreadPool> _loaderPool;
 	};
 }
 
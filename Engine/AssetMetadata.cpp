@@ -0,0 +1,387 @@
+//////////////////////////////////////////////////////////////////////////
+// AssetMetadata.cpp
+// The model metadata the AssetManager needs at startup: which model
+// every InstanceType loads and the default texture of every item slot.
+// It is authored as XML (ModelMetaData.xml, InstanceToModelMapping.xml)
+// and compiled into a compact binary table next to the XML, tagged with
+// a hash of the XML it was compiled from. Loading maps the table and
+// only falls back to parsing the XML (and recompiling the table) when
+// the XML has changed since.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "AssetMetadata.h"
+#include "MappedFile.h"
+#include "TinyUtilities.h"
+#include "../KsmCreatorLib/PathString.h"
+#include <cstdio>
+
+using namespace Engine;
+
+namespace
+{
+	const wchar_t* ModelMetaDataFile = L"ModelMetaData.xml";
+	const wchar_t* InstanceMappingFile = L"InstanceToModelMapping.xml";
+	const wchar_t* CompiledTableFile = L"AssetMetaData.ksmd";
+
+	// "KSMD" read as a little endian uint32
+	const uint32_t AssetMetadataMagic = 0x444D534B;
+
+	// Bump when the layout changes, or when InstanceType or ItemSlot values are reordered since the table
+	// stores them as numbers
+	const uint16_t AssetMetadataVersion = 1;
+
+	//
+	// The compiled table is an AssetMetadataHeader followed by a uint32 model InstanceType for every
+	// InstanceType, then TextureCount AssetMetadataTextureRecords and finally the texture names as
+	// UTF-16 code units
+	//
+	struct AssetMetadataHeader
+	{
+		uint32_t Magic;
+		uint16_t Version;
+		uint16_t HeaderSize;
+		uint64_t SourceHash;
+		uint32_t InstanceTypeCount;
+		uint32_t ItemSlotCount;
+		uint32_t TextureCount;
+		uint32_t StringsSize;
+	};
+
+	static_assert(sizeof(AssetMetadataHeader) == 32, "AssetMetadataHeader must be 32 bytes");
+
+	// A default texture; only slots that have one are stored
+	struct AssetMetadataTextureRecord
+	{
+		uint32_t Model;
+		uint32_t Slot;
+		uint32_t NameOffset;	// in code units from the start of the strings
+		uint32_t NameLength;	// in code units
+	};
+
+	static_assert(sizeof(AssetMetadataTextureRecord) == 16, "AssetMetadataTextureRecord must be 16 bytes");
+
+	template<class T>
+	void append(
+		_Inout_ std::vector<byte>& output,
+		_In_ const T& value)
+	{
+		const byte* bytes = reinterpret_cast<const byte*>(&value);
+		output.insert(output.end(), bytes, bytes + sizeof(T));
+	}
+
+	//
+	// 64 bit FNV-1a
+	//
+	uint64_t hashBytes(
+		_In_ uint64_t hash,
+		_In_ const byte* data,
+		_In_ size_t size)
+	{
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= data[i];
+			hash *= 0x100000001B3ULL;
+		}
+		return hash;
+	}
+
+	bool writeFile(
+		_In_ const std::wstring& path,
+		_In_ const std::vector<byte>& data)
+	{
+#ifdef _WIN32
+		FILE* file = nullptr;
+		if (_wfopen_s(&file, path.c_str(), L"wb") != 0)
+		{
+			file = nullptr;
+		}
+#else
+		PathString narrowPath(path.c_str());
+		FILE* file = fopen(narrowPath.ToCStr(), "wb");
+#endif
+		if (file == nullptr)
+		{
+			return false;
+		}
+
+		bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+		written = (fclose(file) == 0) && written;
+		return written;
+	}
+}
+
+bool AssetMetadataTable::Load(
+	_In_ const std::wstring& metaDataDirectory,
+	_Out_ AssetMetadata& metadata)
+{
+	uint64_t sourceHash = HashSources(metaDataDirectory);
+	std::wstring tablePath = metaDataDirectory + CompiledTableFile;
+
+	{
+		MappedFile table;
+		if (table.Open(tablePath) && Read(table.GetData(), table.GetSize(), sourceHash, metadata))
+		{
+			return true;
+		}
+	}
+
+	if (!ParseXml(metaDataDirectory, metadata))
+	{
+		return false;
+	}
+
+	// Not being able to write the table (e.g. a read only install) only costs the next launch a parse
+	std::vector<byte> compiled;
+	Compile(metadata, sourceHash, compiled);
+	writeFile(tablePath, compiled);
+
+	return true;
+}
+
+bool AssetMetadataTable::ParseXml(
+	_In_ const std::wstring& metaDataDirectory,
+	_Out_ AssetMetadata& metadata)
+{
+	// Every slot of every model starts out without a default texture, and every type that isn't listed
+	// in the mappings loads its own model
+	metadata.DefaultTextures.assign(InstanceType::INSTANCE_TYPE_END, AssetMetadata::DefaultTextureSet());
+
+	metadata.InstanceToModelInstance.resize(InstanceType::INSTANCE_TYPE_END);
+	for (size_t i = 0; i < metadata.InstanceToModelInstance.size(); ++i)
+	{
+		metadata.InstanceToModelInstance[i] = static_cast<InstanceType>(i);
+	}
+
+	//
+	// Load model metadata
+	//
+	PathString narrowXmlString((metaDataDirectory + ModelMetaDataFile).c_str());
+
+	tinyxml2::XMLDocument modelMetaDataXml;
+
+	int result = 0;
+	if ((result = modelMetaDataXml.LoadFile(narrowXmlString.ToCStr())) != tinyxml2::XML_NO_ERROR)
+	{
+		MUKASHIDEBUG_CRITICALERROR(L"Failed to load Engine\\Assets\\MetaData\\ModelMetaData.xml! Error reported by tinyxml2: %d", result);
+		return false;
+	}
+
+	tinyxml2::XMLElement* modelIterator = modelMetaDataXml.FirstChildElement("models")->FirstChildElement("model");
+
+	do
+	{
+		InstanceType modelName = TinyUtilities::GetInstanceTypeAttribute("filename", modelIterator);
+		MUKASHIDEBUG_CRITICALERROR_ONFALSE(modelName < InstanceType::INSTANCE_TYPE_END);
+
+		tinyxml2::XMLElement* textureMapIterator = modelIterator->FirstChildElement("texturemappings")->FirstChildElement("texturemap");
+
+		do
+		{
+			ItemSlot itemSlot = InstanceSaveTypes::StringToItemSlot(TinyUtilities::GetStringAttribute("slot", textureMapIterator));
+			if (modelName < InstanceType::INSTANCE_TYPE_END && itemSlot < ItemSlot::ITEM_SLOT_END)
+			{
+				metadata.DefaultTextures[modelName][itemSlot] = TinyUtilities::GetStringAttribute("texture", textureMapIterator);
+			}
+
+			textureMapIterator = textureMapIterator->NextSiblingElement();
+		} while (textureMapIterator);
+
+
+		modelIterator = modelIterator->NextSiblingElement();
+	} while (modelIterator);
+
+	//
+	// Load Instance to model mappings
+	//
+	narrowXmlString = (metaDataDirectory + InstanceMappingFile).c_str();
+
+	tinyxml2::XMLDocument instanceMappingXml;
+
+	result = 0;
+	if ((result = instanceMappingXml.LoadFile(narrowXmlString.ToCStr())) != tinyxml2::XML_NO_ERROR)
+	{
+		MUKASHIDEBUG_CRITICALERROR(L"Failed to load Engine\\Assets\\MetaData\\InstanceToModelMapping.xml! Error reported by tinyxml2: %d", result);
+		return false;
+	}
+
+	tinyxml2::XMLElement* instanceIterator = instanceMappingXml.FirstChildElement("instances")->FirstChildElement("instance");
+
+	do
+	{
+		InstanceType fromInstance = TinyUtilities::GetInstanceTypeAttribute("enum", instanceIterator);
+		InstanceType toModelInstance = TinyUtilities::GetInstanceTypeAttribute("mappedto", instanceIterator);
+		MUKASHIDEBUG_CRITICALERROR_ONFALSE(fromInstance < InstanceType::INSTANCE_TYPE_END);
+
+		if (fromInstance < InstanceType::INSTANCE_TYPE_END)
+		{
+			metadata.InstanceToModelInstance[fromInstance] = toModelInstance;
+		}
+
+		instanceIterator = instanceIterator->NextSiblingElement();
+	} while (instanceIterator);
+
+	return true;
+}
+
+void AssetMetadataTable::Compile(
+	_In_ const AssetMetadata& metadata,
+	_In_ uint64_t sourceHash,
+	_Out_ std::vector<byte>& output)
+{
+	std::vector<AssetMetadataTextureRecord> textures;
+	std::vector<uint16_t> strings;
+
+	for (size_t model = 0; model < metadata.DefaultTextures.size(); ++model)
+	{
+		for (size_t slot = 0; slot < metadata.DefaultTextures[model].size(); ++slot)
+		{
+			const std::wstring& name = metadata.DefaultTextures[model][slot];
+			if (name.empty())
+			{
+				continue;
+			}
+
+			AssetMetadataTextureRecord record;
+			record.Model = static_cast<uint32_t>(model);
+			record.Slot = static_cast<uint32_t>(slot);
+			record.NameOffset = static_cast<uint32_t>(strings.size());
+			record.NameLength = static_cast<uint32_t>(name.size());
+			textures.push_back(record);
+
+			for (wchar_t c : name)
+			{
+				strings.push_back(static_cast<uint16_t>(c));
+			}
+		}
+	}
+
+	AssetMetadataHeader header;
+	header.Magic = AssetMetadataMagic;
+	header.Version = AssetMetadataVersion;
+	header.HeaderSize = sizeof(AssetMetadataHeader);
+	header.SourceHash = sourceHash;
+	header.InstanceTypeCount = static_cast<uint32_t>(metadata.InstanceToModelInstance.size());
+	header.ItemSlotCount = ItemSlot::ITEM_SLOT_END;
+	header.TextureCount = static_cast<uint32_t>(textures.size());
+	header.StringsSize = static_cast<uint32_t>(strings.size() * sizeof(uint16_t));
+
+	output.clear();
+	output.reserve(sizeof(header) + header.InstanceTypeCount * sizeof(uint32_t) + textures.size() * sizeof(AssetMetadataTextureRecord) + header.StringsSize);
+
+	append(output, header);
+
+	for (InstanceType modelInstance : metadata.InstanceToModelInstance)
+	{
+		append(output, static_cast<uint32_t>(modelInstance));
+	}
+
+	for (const auto& record : textures)
+	{
+		append(output, record);
+	}
+
+	for (uint16_t unit : strings)
+	{
+		append(output, unit);
+	}
+}
+
+bool AssetMetadataTable::Read(
+	_In_ const byte* data,
+	_In_ size_t size,
+	_In_ uint64_t sourceHash,
+	_Out_ AssetMetadata& metadata)
+{
+	AssetMetadataHeader header;
+	if (size < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	if (header.Magic != AssetMetadataMagic ||
+		header.Version != AssetMetadataVersion ||
+		header.HeaderSize != sizeof(AssetMetadataHeader) ||
+		header.InstanceTypeCount != InstanceType::INSTANCE_TYPE_END ||
+		header.ItemSlotCount != ItemSlot::ITEM_SLOT_END ||
+		(sourceHash != 0 && header.SourceHash != sourceHash))
+	{
+		return false;
+	}
+
+	// The counts are 32 bit so the sum can't overflow 64 bits
+	uint64_t mappingsSize = (uint64_t)header.InstanceTypeCount * sizeof(uint32_t);
+	uint64_t texturesSize = (uint64_t)header.TextureCount * sizeof(AssetMetadataTextureRecord);
+	if ((uint64_t)size != sizeof(header) + mappingsSize + texturesSize + header.StringsSize)
+	{
+		return false;
+	}
+
+	const byte* mappings = data + sizeof(header);
+	const byte* textures = mappings + mappingsSize;
+	const byte* strings = textures + texturesSize;
+	size_t stringUnits = header.StringsSize / sizeof(uint16_t);
+
+	metadata.InstanceToModelInstance.resize(header.InstanceTypeCount);
+	for (uint32_t i = 0; i < header.InstanceTypeCount; ++i)
+	{
+		uint32_t modelInstance;
+		memcpy(&modelInstance, mappings + i * sizeof(uint32_t), sizeof(uint32_t));
+		if (modelInstance >= header.InstanceTypeCount)
+		{
+			return false;
+		}
+		metadata.InstanceToModelInstance[i] = static_cast<InstanceType>(modelInstance);
+	}
+
+	metadata.DefaultTextures.assign(header.InstanceTypeCount, AssetMetadata::DefaultTextureSet());
+	for (uint32_t t = 0; t < header.TextureCount; ++t)
+	{
+		AssetMetadataTextureRecord record;
+		memcpy(&record, textures + t * sizeof(record), sizeof(record));
+
+		if (record.Model >= header.InstanceTypeCount ||
+			record.Slot >= header.ItemSlotCount ||
+			record.NameOffset > stringUnits ||
+			record.NameLength > stringUnits - record.NameOffset)
+		{
+			return false;
+		}
+
+		std::wstring& name = metadata.DefaultTextures[record.Model][record.Slot];
+		name.resize(record.NameLength);
+		for (uint32_t c = 0; c < record.NameLength; ++c)
+		{
+			uint16_t unit;
+			memcpy(&unit, strings + (record.NameOffset + c) * sizeof(uint16_t), sizeof(uint16_t));
+			name[c] = static_cast<wchar_t>(unit);
+		}
+	}
+
+	return true;
+}
+
+uint64_t AssetMetadataTable::HashSources(_In_ const std::wstring& metaDataDirectory)
+{
+	const wchar_t* sources[] = { ModelMetaDataFile, InstanceMappingFile };
+
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (const wchar_t* source : sources)
+	{
+		MappedFile file;
+		if (!file.Open(metaDataDirectory + source))
+		{
+			return 0;
+		}
+
+		// Mix in the size so bytes moving from the end of one file to the start of the next changes the hash
+		uint64_t fileSize = file.GetSize();
+		hash = hashBytes(hash, reinterpret_cast<const byte*>(&fileSize), sizeof(fileSize));
+		hash = hashBytes(hash, file.GetData(), file.GetSize());
+	}
+
+	// 0 means "don't check", keep it out of the range of real hashes
+	return hash ? hash : 1;
+}
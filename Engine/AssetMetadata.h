@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////
+// AssetMetadata.h
+// The model metadata the AssetManager needs at startup: which model
+// every InstanceType loads and the default texture of every item slot.
+// It is authored as XML (ModelMetaData.xml, InstanceToModelMapping.xml)
+// and compiled into a compact binary table next to the XML, tagged with
+// a hash of the XML it was compiled from. Loading maps the table and
+// only falls back to parsing the XML (and recompiling the table) when
+// the XML has changed since.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "AssetTypeEnum.h"
+#include "InstanceSaveTypes.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Engine
+{
+	struct AssetMetadata
+	{
+		typedef std::array<std::wstring, ItemSlot::ITEM_SLOT_END> DefaultTextureSet;
+
+		// The InstanceType that loads the model of every InstanceType, indexed by InstanceType
+		std::vector<InstanceType> InstanceToModelInstance;
+
+		// The names of the default texture of every item slot, indexed by the model's InstanceType
+		std::vector<DefaultTextureSet> DefaultTextures;
+	};
+
+	class AssetMetadataTable
+	{
+	public:
+
+		//
+		// FullName:  Engine::AssetMetadataTable::Load
+		// Loads the metadata in the given directory. The compiled table is used if it was compiled from the
+		// XML that is there now (or if the XML isn't there at all), otherwise the XML is parsed and the table
+		// is recompiled for the next launch. Returns false if neither could be read
+		//
+		static bool Load(
+			_In_ const std::wstring& metaDataDirectory,
+			_Out_ AssetMetadata& metadata);
+
+		//
+		// FullName:  Engine::AssetMetadataTable::ParseXml
+		// Reads the metadata from the authoring XML in the given directory
+		//
+		static bool ParseXml(
+			_In_ const std::wstring& metaDataDirectory,
+			_Out_ AssetMetadata& metadata);
+
+		//
+		// FullName:  Engine::AssetMetadataTable::Compile
+		// Writes the metadata as a compiled table, tagged with the hash of the XML it came from
+		//
+		static void Compile(
+			_In_ const AssetMetadata& metadata,
+			_In_ uint64_t sourceHash,
+			_Out_ std::vector<byte>& output);
+
+		//
+		// FullName:  Engine::AssetMetadataTable::Read
+		// Reads a compiled table. Fails if the table is malformed, was compiled for a different set of
+		// InstanceTypes or item slots, or (unless sourceHash is 0) was compiled from different XML
+		//
+		static bool Read(
+			_In_ const byte* data,
+			_In_ size_t size,
+			_In_ uint64_t sourceHash,
+			_Out_ AssetMetadata& metadata);
+
+		//
+		// FullName:  Engine::AssetMetadataTable::HashSources
+		// Hashes the contents of the XML in the given directory. Returns 0 if any of it is missing
+		//
+		static uint64_t HashSources(_In_ const std::wstring& metaDataDirectory);
+	};
+}
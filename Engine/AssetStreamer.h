@@ -0,0 +1,188 @@
+//////////////////////////////////////////////////////////////////////////
+// AssetStreamer.h
+// Loads assets of one type in the background. Every request is split in
+// two steps: a load step (file I/O and decoding) that runs on a worker
+// of a ThreadPool, and an upload step (device resource creation) that
+// runs on the thread calling ProcessUploads, a bounded number per call
+// so a frame never stalls on a burst of finished loads. Requests for an
+// asset that is already in flight share the same future.
+//
+// The streamer knows nothing about the device; the upload step is just a
+// function, so it can be driven headless with a null upload.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ThreadPool.h"
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace Engine
+{
+	template<class T>
+	class AssetStreamer
+	{
+	public:
+
+		// Runs on the uploading thread, creates the resource and returns it
+		typedef std::function<T(void)> UploadStep;
+
+		// Runs on a worker, returns the upload step to finish the asset with. Returning an empty
+		// function means the load failed and the request completes with T(). The load step is also
+		// destroyed on the worker, so it must not capture anything that has to be released on the
+		// uploading thread
+		typedef std::function<UploadStep(void)> LoadStep;
+
+		AssetStreamer(_In_ ThreadPool& pool)
+			: _pool(pool)
+		{}
+
+		//
+		// FullName:  Engine::AssetStreamer::Request
+		// Queues the load step of the asset with the given key. If that asset is already being loaded
+		// the future of the earlier request is returned and the load step is dropped
+		//
+		std::shared_future<T> Request(
+			_In_ const std::wstring& key,
+			_In_ LoadStep load)
+		{
+			std::shared_future<T> future;
+
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+
+				auto found = _inFlight.find(key);
+				if (found != _inFlight.end())
+				{
+					return found->second->Future;
+				}
+
+				std::unique_ptr<InFlight> request(new InFlight());
+				future = request->Future = request->Result.get_future().share();
+				_inFlight[key] = std::move(request);
+			}
+
+			// The job doesn't hold on to the request. Only the thread calling ProcessUploads owns it, so the
+			// result it completes with is never released on a worker
+			_pool.Enqueue([this, key, load]()
+			{
+				UploadStep upload;
+				try
+				{
+					upload = load();
+				}
+				catch (...)
+				{
+					upload = nullptr;
+				}
+
+				std::lock_guard<std::mutex> lock(_mutex);
+				_uploads.push_back(PendingUpload(key, std::move(upload)));
+			});
+
+			return future;
+		}
+
+		//
+		// FullName:  Engine::AssetStreamer::ProcessUploads
+		// Runs the upload steps of at most maxUploads finished loads and completes their requests.
+		// Returns the number of requests completed
+		//
+		UINT ProcessUploads(_In_ UINT maxUploads)
+		{
+			UINT processed = 0;
+
+			while (processed < maxUploads)
+			{
+				PendingUpload pending;
+
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					if (_uploads.empty())
+					{
+						break;
+					}
+
+					pending = std::move(_uploads.front());
+					_uploads.pop_front();
+				}
+
+				T result = T();
+				if (pending.Upload)
+				{
+					result = pending.Upload();
+				}
+
+				// Take the request out before completing it so a failed asset can be requested again
+				{
+					std::lock_guard<std::mutex> lock(_mutex);
+					auto found = _inFlight.find(pending.Key);
+					pending.Request = std::move(found->second);
+					_inFlight.erase(found);
+				}
+
+				pending.Request->Result.set_value(result);
+				++processed;
+			}
+
+			return processed;
+		}
+
+		//
+		// Returns the number of requests that haven't completed yet
+		//
+		UINT GetPendingCount() const
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return static_cast<UINT>(_inFlight.size());
+		}
+
+	private:
+
+		// Make class not copyable
+		AssetStreamer(const AssetStreamer&);
+		AssetStreamer& operator=(const AssetStreamer&);
+
+		struct InFlight
+		{
+			std::promise<T> Result;
+			std::shared_future<T> Future;
+		};
+
+		struct PendingUpload
+		{
+			PendingUpload()
+			{}
+
+			PendingUpload(
+				_In_ const std::wstring& key,
+				_In_ UploadStep upload)
+				: Key(key), Upload(std::move(upload))
+			{}
+
+			std::wstring Key;
+
+			// Moved out of _inFlight by ProcessUploads, never set on a worker
+			std::unique_ptr<InFlight> Request;
+
+			UploadStep Upload;
+		};
+
+	private:
+
+		ThreadPool& _pool;
+
+		// Guards _inFlight and _uploads
+		mutable std::mutex _mutex;
+
+		// Requests that have been queued but not completed, by key
+		std::unordered_map<std::wstring, std::unique_ptr<InFlight>> _inFlight;
+
+		// Loads that have finished and are waiting for their upload step
+		std::deque<PendingUpload> _uploads;
+	};
+}
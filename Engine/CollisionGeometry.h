@@ -0,0 +1,57 @@
+//////////////////////////////////////////////////////////////////////////
+// CollisionGeometry.h
+// The model space triangles a model hands a CollisionShapeCache to build
+// its collision shapes from. Remembers the cache that built them so they
+// are released when the model is destroyed, and a new model that happens
+// to be allocated at the same address never gets the old one's shapes.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+namespace Engine
+{
+	class CollisionShapeCache;
+
+	//
+	// Implemented by CredibleModelData; CollisionShapeCache only goes through this, so it doesn't depend on
+	// the model's Direct3D resources
+	//
+	class CollisionGeometry
+	{
+	public:
+
+		//
+		// Fills vertices and indices with the triangles to collide with, in model space
+		//
+		virtual void GetCollisionGeometry(
+			_Out_ std::vector<DirectX::XMFLOAT3>& vertices,
+			_Out_ std::vector<UINT>& indices) const = 0;
+
+	protected:
+
+		CollisionGeometry()
+			: _collisionShapeCache(nullptr)
+		{}
+
+		//
+		// Releases the shapes built from this geometry, if any. Defined with CollisionShapeCache
+		//
+		~CollisionGeometry();
+
+	private:
+
+		// Make class not copyable, the copy would share the shapes without them knowing
+		CollisionGeometry(const CollisionGeometry&);
+		CollisionGeometry& operator=(const CollisionGeometry&);
+
+		// Keeps _collisionShapeCache up to date
+		friend class CollisionShapeCache;
+
+		// The cache holding collision shapes built from this geometry. Null if none have been built
+		mutable CollisionShapeCache* _collisionShapeCache;
+	};
+}
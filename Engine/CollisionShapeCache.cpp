@@ -0,0 +1,195 @@
+//////////////////////////////////////////////////////////////////////////
+// CollisionShapeCache.cpp
+// Shares one BVH and one simplified hull per model between all the
+// scaled collision shapes of its instances
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "CollisionShapeCache.h"
+#include "Bullet/src/BulletCollision/CollisionShapes/btShapeHull.h"
+
+using namespace DirectX;
+using namespace Engine;
+
+CollisionGeometry::~CollisionGeometry()
+{
+	if (_collisionShapeCache != nullptr)
+	{
+		_collisionShapeCache->Release(*this);
+	}
+}
+
+CollisionShapeCache::CollisionShapeCache()
+{
+}
+
+CollisionShapeCache::~CollisionShapeCache()
+{
+	Clear();
+}
+
+btScaledBvhTriangleMeshShape* CollisionShapeCache::GetTriangleMesh(
+	_In_ const CollisionGeometry& model,
+	_In_ const XMFLOAT3& scale)
+{
+	ModelShapes* shapes = findGeometry(model);
+	if (shapes == nullptr)
+	{
+		return nullptr;
+	}
+
+	auto scaled = shapes->ScaledTriangleMeshes.find(scale);
+	if (scaled != shapes->ScaledTriangleMeshes.end())
+	{
+		return scaled->second.get();
+	}
+
+	if (shapes->TriangleMesh == nullptr)
+	{
+		buildTriangleMesh(*shapes);
+	}
+
+	std::unique_ptr<btScaledBvhTriangleMeshShape> shape(
+		new btScaledBvhTriangleMeshShape(shapes->TriangleMesh.get(), btVector3(scale.x, scale.y, scale.z)));
+	btScaledBvhTriangleMeshShape* result = shape.get();
+	shapes->ScaledTriangleMeshes[scale] = std::move(shape);
+
+	return result;
+}
+
+btConvexHullShape* CollisionShapeCache::GetConvexHull(
+	_In_ const CollisionGeometry& model,
+	_In_ const XMFLOAT3& scale)
+{
+	ModelShapes* shapes = findGeometry(model);
+	if (shapes == nullptr)
+	{
+		return nullptr;
+	}
+
+	auto scaled = shapes->ScaledHulls.find(scale);
+	if (scaled != shapes->ScaledHulls.end())
+	{
+		return scaled->second.get();
+	}
+
+	if (shapes->HullPoints.size() == 0)
+	{
+		buildHull(*shapes);
+	}
+
+	//
+	// A hull only holds a few dozen points, so each scale gets its own copy rather than a wrapper around a
+	// shared one. Bullet scales hulls exactly through their local scaling
+	std::unique_ptr<btConvexHullShape> shape(
+		new btConvexHullShape(&shapes->HullPoints[0].getX(), shapes->HullPoints.size(), sizeof(btVector3)));
+	shape->setLocalScaling(btVector3(scale.x, scale.y, scale.z));
+	btConvexHullShape* result = shape.get();
+	shapes->ScaledHulls[scale] = std::move(shape);
+
+	return result;
+}
+
+void CollisionShapeCache::Release(_In_ const CollisionGeometry& model)
+{
+	auto found = _models.find(&model);
+	if (found == _models.end())
+	{
+		return;
+	}
+
+	// The scaled shapes point at the shared BVH, and that at the mesh interface, so they go first
+	ModelShapes& shapes = *found->second;
+	shapes.ScaledTriangleMeshes.clear();
+	shapes.ScaledHulls.clear();
+	shapes.TriangleMesh.reset();
+	shapes.MeshInterface.reset();
+
+	found->first->_collisionShapeCache = nullptr;
+	_models.erase(found);
+}
+
+void CollisionShapeCache::Clear()
+{
+	while (!_models.empty())
+	{
+		Release(*_models.begin()->first);
+	}
+}
+
+CollisionShapeCacheStats CollisionShapeCache::GetStats() const
+{
+	CollisionShapeCacheStats stats;
+	memset(&stats, 0, sizeof(stats));
+
+	for (const auto& model : _models)
+	{
+		const ModelShapes& shapes = *model.second;
+
+		stats.TriangleMeshes += (shapes.TriangleMesh != nullptr) ? 1 : 0;
+		stats.ScaledTriangleMeshes += static_cast<UINT>(shapes.ScaledTriangleMeshes.size());
+		stats.Hulls += (shapes.HullPoints.size() > 0) ? 1 : 0;
+		stats.ScaledHulls += static_cast<UINT>(shapes.ScaledHulls.size());
+	}
+
+	return stats;
+}
+
+CollisionShapeCache::ModelShapes* CollisionShapeCache::findGeometry(_In_ const CollisionGeometry& model)
+{
+	auto found = _models.find(&model);
+	if (found == _models.end())
+	{
+		// The model releases its shapes from the one cache that built them when it's destroyed
+		MUKASHIDEBUG_CRITICALERROR_ONFALSE(model._collisionShapeCache == nullptr);
+		model._collisionShapeCache = this;
+
+		std::unique_ptr<ModelShapes> shapes(new ModelShapes());
+		model.GetCollisionGeometry(shapes->Vertices, shapes->Indices);
+
+		found = _models.insert(std::make_pair(&model, std::move(shapes))).first;
+	}
+
+	// Models loaded without CPU geometry keep their empty entry so they aren't walked again
+	ModelShapes* shapes = found->second.get();
+	return shapes->Indices.empty() ? nullptr : shapes;
+}
+
+void CollisionShapeCache::buildTriangleMesh(_Inout_ ModelShapes& shapes)
+{
+	btIndexedMesh mesh;
+	mesh.m_vertexBase = reinterpret_cast<const unsigned char*>(&shapes.Vertices[0]);
+	mesh.m_vertexStride = sizeof(XMFLOAT3);
+	mesh.m_numVertices = static_cast<int>(shapes.Vertices.size());
+	mesh.m_triangleIndexBase = reinterpret_cast<const unsigned char*>(&shapes.Indices[0]);
+	mesh.m_triangleIndexStride = sizeof(UINT) * 3;
+	mesh.m_numTriangles = static_cast<int>(shapes.Indices.size() / 3);
+	mesh.m_indexType = PHY_INTEGER;
+	mesh.m_vertexType = PHY_FLOAT;
+
+	shapes.MeshInterface.reset(new btTriangleIndexVertexArray());
+	shapes.MeshInterface->addIndexedMesh(mesh, PHY_INTEGER);
+
+	// Quantized AABB compression keeps the tree small; the model's geometry never changes after this
+	shapes.TriangleMesh.reset(new btBvhTriangleMeshShape(shapes.MeshInterface.get(), true));
+}
+
+void CollisionShapeCache::buildHull(_Inout_ ModelShapes& shapes)
+{
+	//
+	// btShapeHull samples the support points of a convex shape in a fixed set of directions, so hulling the
+	// hull of every vertex leaves only the points that matter
+	btConvexHullShape original(&shapes.Vertices[0].x, static_cast<int>(shapes.Vertices.size()), sizeof(XMFLOAT3));
+
+	btShapeHull hull(&original);
+	hull.buildHull(original.getMargin());
+
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(hull.numVertices() > 0);
+
+	shapes.HullPoints.resize(0);
+	for (int i = 0; i < hull.numVertices(); ++i)
+	{
+		shapes.HullPoints.push_back(hull.getVertexPointer()[i]);
+	}
+}
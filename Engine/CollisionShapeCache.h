@@ -0,0 +1,141 @@
+//////////////////////////////////////////////////////////////////////////
+// CollisionShapeCache.h
+// Builds the Bullet collision shapes of a model once and shares them
+// between all its instances. The triangle mesh and its BVH are built in
+// model space the first time a model is asked for; every distinct scale
+// then gets a btScaledBvhTriangleMeshShape wrapping that one BVH, so a
+// town of identical buildings builds a single tree. Models can also be
+// given a simplified convex hull for objects that don't need exact
+// triangle collision. The cache owns every shape it hands out; they stay
+// valid until the model is released or destroyed (see CollisionGeometry;
+// a model evicted from the model cache releases its shapes) or the cache
+// is destroyed, so
+// remove the rigid bodies using them first. A model's shapes are built
+// by one cache only.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CollisionGeometry.h"
+#include <DirectXMath.h>
+#include <map>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "Bullet/src/BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
+#include "Bullet/src/BulletCollision/CollisionShapes/btScaledBvhTriangleMeshShape.h"
+#include "Bullet/src/BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h"
+#include "Bullet/src/BulletCollision/CollisionShapes/btConvexHullShape.h"
+#include "Bullet/src/LinearMath/btAlignedObjectArray.h"
+
+namespace Engine
+{
+	//
+	// How many shapes a CollisionShapeCache holds
+	//
+	struct CollisionShapeCacheStats
+	{
+		// Models with a triangle mesh BVH built
+		UINT TriangleMeshes;
+
+		// Scaled shapes sharing those BVHs
+		UINT ScaledTriangleMeshes;
+
+		// Models with a simplified hull built, and the scaled copies of those hulls
+		UINT Hulls;
+		UINT ScaledHulls;
+	};
+
+	class CollisionShapeCache
+	{
+	public:
+
+		CollisionShapeCache();
+		~CollisionShapeCache();
+
+		//
+		// FullName:  Engine::CollisionShapeCache::GetTriangleMesh
+		// Returns the model's triangles at the given scale for static collision. Shares the model's BVH with
+		// every other scale of it. Null if the model has no CPU geometry
+		//
+		btScaledBvhTriangleMeshShape* GetTriangleMesh(
+			_In_ const CollisionGeometry& model,
+			_In_ const DirectX::XMFLOAT3& scale);
+
+		//
+		// FullName:  Engine::CollisionShapeCache::GetConvexHull
+		// Returns a simplified convex hull around the model at the given scale, which is much cheaper to
+		// collide with than the triangles and can be used for moving bodies. The hull is built with
+		// btShapeHull the first time, with at most a few dozen vertices. Null if the model has no CPU geometry
+		//
+		btConvexHullShape* GetConvexHull(
+			_In_ const CollisionGeometry& model,
+			_In_ const DirectX::XMFLOAT3& scale);
+
+		//
+		// Destroys every shape of the model. Nothing may still be using them. Called when the model is
+		// destroyed, so a model never leaves shapes keyed by its address behind
+		//
+		void Release(_In_ const CollisionGeometry& model);
+
+		//
+		// Destroys every shape. Nothing may still be using them
+		//
+		void Clear();
+
+		CollisionShapeCacheStats GetStats() const;
+
+	private:
+
+		// Make class not copyable
+		CollisionShapeCache(const CollisionShapeCache&);
+		CollisionShapeCache& operator=(const CollisionShapeCache&);
+
+		//
+		// Orders scales by their exact components, so only the very same scale shares a shape
+		//
+		struct ScaleLess
+		{
+			bool operator()(
+				_In_ const DirectX::XMFLOAT3& a,
+				_In_ const DirectX::XMFLOAT3& b) const
+			{
+				if (a.x != b.x) return a.x < b.x;
+				if (a.y != b.y) return a.y < b.y;
+				return a.z < b.z;
+			}
+		};
+
+		//
+		// The shapes of one model. Bullet only points at Vertices and Indices, so they're kept here for as
+		// long as the shapes built on them
+		//
+		struct ModelShapes
+		{
+			std::vector<DirectX::XMFLOAT3> Vertices;
+			std::vector<UINT> Indices;
+
+			std::unique_ptr<btTriangleIndexVertexArray> MeshInterface;
+			std::unique_ptr<btBvhTriangleMeshShape> TriangleMesh;
+			std::map<DirectX::XMFLOAT3, std::unique_ptr<btScaledBvhTriangleMeshShape>, ScaleLess> ScaledTriangleMeshes;
+
+			// The simplified hull in model space, copied and scaled for each scale
+			btAlignedObjectArray<btVector3> HullPoints;
+			std::map<DirectX::XMFLOAT3, std::unique_ptr<btConvexHullShape>, ScaleLess> ScaledHulls;
+		};
+
+		//
+		// Returns the model's entry, collecting its geometry the first time it's asked for. Null if it has none
+		//
+		ModelShapes* findGeometry(_In_ const CollisionGeometry& model);
+
+		void buildTriangleMesh(_Inout_ ModelShapes& shapes);
+
+		void buildHull(_Inout_ ModelShapes& shapes);
+
+	private:
+
+		std::unordered_map<const CollisionGeometry*, std::unique_ptr<ModelShapes>> _models;
+	};
+}
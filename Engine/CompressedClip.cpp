@@ -0,0 +1,706 @@
+//////////////////////////////////////////////////////////////////////////
+// CompressedClip.cpp
+// Compression of animation clips for the KSM clips section and cursor
+// based sampling of them.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "CompressedClip.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace Engine;
+
+namespace
+{
+	// The three smallest components of a unit quaternion are within +-1/sqrt(2)
+	const float SmallestThreeRange = 0.70710678f;
+
+	const float QuantizedMax15 = 32767.0f;
+	const float QuantizedMax16 = 65535.0f;
+
+	// Sample indices are stored in 16 bits
+	const UINT MaxSampleCount = 65535;
+
+	//
+	// One sampled pose of a track
+	//
+	struct TrackSample
+	{
+		XMFLOAT4 Rotation;
+		XMFLOAT3 Translation;
+		XMFLOAT3 Scale;
+	};
+
+	float component(_In_ const XMFLOAT3& v, _In_ UINT axis)
+	{
+		return (&v.x)[axis];
+	}
+
+	float component(_In_ const XMFLOAT4& v, _In_ UINT axis)
+	{
+		return (&v.x)[axis];
+	}
+
+	float lerp(_In_ float a, _In_ float b, _In_ float t)
+	{
+		return a + (b - a) * t;
+	}
+
+	XMFLOAT3 lerp(_In_ const XMFLOAT3& a, _In_ const XMFLOAT3& b, _In_ float t)
+	{
+		return XMFLOAT3(lerp(a.x, b.x, t), lerp(a.y, b.y, t), lerp(a.z, b.z, t));
+	}
+
+	float dot(_In_ const XMFLOAT4& a, _In_ const XMFLOAT4& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+	}
+
+	XMFLOAT4 normalize(_In_ const XMFLOAT4& q)
+	{
+		float length = std::sqrt(dot(q, q));
+		if (length <= 0.0f)
+		{
+			return XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+		}
+
+		float inverseLength = 1.0f / length;
+		return XMFLOAT4(q.x * inverseLength, q.y * inverseLength, q.z * inverseLength, q.w * inverseLength);
+	}
+
+	//
+	// Normalized linear interpolation along the shorter arc
+	//
+	XMFLOAT4 nlerp(_In_ const XMFLOAT4& a, _In_ const XMFLOAT4& b, _In_ float t)
+	{
+		float sign = (dot(a, b) < 0.0f) ? -1.0f : 1.0f;
+		return normalize(XMFLOAT4(
+			lerp(a.x, sign * b.x, t),
+			lerp(a.y, sign * b.y, t),
+			lerp(a.z, sign * b.z, t),
+			lerp(a.w, sign * b.w, t)));
+	}
+
+	//
+	// Spherical interpolation along the shorter arc, as used to play back the uncompressed keyframes
+	//
+	XMFLOAT4 slerp(_In_ const XMFLOAT4& a, _In_ const XMFLOAT4& b, _In_ float t)
+	{
+		float cosine = dot(a, b);
+		float sign = (cosine < 0.0f) ? -1.0f : 1.0f;
+		cosine *= sign;
+
+		// Nearly identical rotations are interpolated linearly to avoid dividing by sin(0)
+		if (cosine > 0.9995f)
+		{
+			return nlerp(a, b, t);
+		}
+
+		float angle = std::acos(cosine);
+		float inverseSine = 1.0f / std::sin(angle);
+		float wa = std::sin((1.0f - t) * angle) * inverseSine;
+		float wb = sign * std::sin(t * angle) * inverseSine;
+
+		return XMFLOAT4(
+			wa * a.x + wb * b.x,
+			wa * a.y + wb * b.y,
+			wa * a.z + wb * b.z,
+			wa * a.w + wb * b.w);
+	}
+
+	uint16_t quantize(_In_ float value, _In_ float minimum, _In_ float extent, _In_ float maximum)
+	{
+		if (extent <= 0.0f)
+		{
+			return 0;
+		}
+
+		float scaled = (value - minimum) / extent * maximum + 0.5f;
+		return static_cast<uint16_t>(std::min(std::max(scaled, 0.0f), maximum));
+	}
+
+	float dequantize(_In_ uint16_t value, _In_ float minimum, _In_ float extent, _In_ float maximum)
+	{
+		return minimum + value * (extent / maximum);
+	}
+
+	//
+	// Stores the three smallest components in 15 bits each and the index of the largest in the top bits of
+	// the first two words. The largest is made positive so it can be rebuilt from the other three
+	//
+	void encodeRotation(_In_ const XMFLOAT4& rotation, _Out_ uint16_t* words)
+	{
+		XMFLOAT4 q = normalize(rotation);
+
+		UINT largest = 0;
+		for (UINT i = 1; i < 4; ++i)
+		{
+			if (std::fabs(component(q, i)) > std::fabs(component(q, largest)))
+			{
+				largest = i;
+			}
+		}
+
+		float sign = (component(q, largest) < 0.0f) ? -1.0f : 1.0f;
+
+		UINT word = 0;
+		for (UINT i = 0; i < 4; ++i)
+		{
+			if (i == largest)
+			{
+				continue;
+			}
+
+			words[word++] = quantize(sign * component(q, i), -SmallestThreeRange, 2.0f * SmallestThreeRange, QuantizedMax15);
+		}
+
+		words[0] |= static_cast<uint16_t>((largest & 1) << 15);
+		words[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+	}
+
+	XMFLOAT4 decodeRotation(_In_ const uint16_t* words)
+	{
+		UINT largest = (words[0] >> 15) | ((words[1] >> 15) << 1);
+
+		float smallest[3];
+		float sumOfSquares = 0.0f;
+		for (UINT i = 0; i < 3; ++i)
+		{
+			smallest[i] = dequantize(words[i] & 0x7FFF, -SmallestThreeRange, 2.0f * SmallestThreeRange, QuantizedMax15);
+			sumOfSquares += smallest[i] * smallest[i];
+		}
+
+		float q[4];
+		UINT word = 0;
+		for (UINT i = 0; i < 4; ++i)
+		{
+			q[i] = (i == largest) ? std::sqrt(std::max(0.0f, 1.0f - sumOfSquares)) : smallest[word++];
+		}
+
+		return XMFLOAT4(q[0], q[1], q[2], q[3]);
+	}
+
+	//
+	// Builds scale, then rotation, then translation as a row vector matrix and stores it transposed, which is
+	// how node transforms are kept
+	//
+	void composeTransform(
+		_In_ const XMFLOAT4& q,
+		_In_ const XMFLOAT3& translation,
+		_In_ const XMFLOAT3& scale,
+		_Out_ XMFLOAT4X4& transform)
+	{
+		float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+		float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+		float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+		float rows[3][3] =
+		{
+			{ 1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy) },
+			{ 2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx) },
+			{ 2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy) },
+		};
+
+		float scales[3] = { scale.x, scale.y, scale.z };
+		for (UINT row = 0; row < 3; ++row)
+		{
+			for (UINT column = 0; column < 3; ++column)
+			{
+				transform.m[column][row] = rows[row][column] * scales[row];
+			}
+			transform.m[3][row] = 0.0f;
+		}
+
+		transform.m[0][3] = translation.x;
+		transform.m[1][3] = translation.y;
+		transform.m[2][3] = translation.z;
+		transform.m[3][3] = 1.0f;
+	}
+
+	//
+	// Samples a track's keyframes at uniform times. Times before the first or after the last keyframe hold
+	// that keyframe, tracks without keyframes are the identity
+	//
+	void sampleTrack(
+		_In_ const KsmTrackView& track,
+		_In_ UINT sampleCount,
+		_In_ float sampleInterval,
+		_Out_ std::vector<TrackSample>& samples)
+	{
+		samples.resize(sampleCount);
+
+		if (track.KeyframeCount == 0)
+		{
+			for (auto& sample : samples)
+			{
+				sample.Rotation = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+				sample.Translation = XMFLOAT3(0.0f, 0.0f, 0.0f);
+				sample.Scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+			}
+			return;
+		}
+
+		UINT key = 0;
+		for (UINT i = 0; i < sampleCount; ++i)
+		{
+			float time = i * sampleInterval;
+
+			// Sample times only increase, so the keyframe pair only ever moves forward
+			while (key + 1 < track.KeyframeCount && KsmReader::ReadKeyframe(track, key + 1).TimePos <= time)
+			{
+				++key;
+			}
+
+			KsmKeyframe first = KsmReader::ReadKeyframe(track, key);
+			TrackSample& sample = samples[i];
+
+			if (key + 1 == track.KeyframeCount || time <= first.TimePos)
+			{
+				sample.Rotation = normalize(first.RotationQuat);
+				sample.Translation = first.Translation;
+				sample.Scale = first.Scale;
+				continue;
+			}
+
+			KsmKeyframe second = KsmReader::ReadKeyframe(track, key + 1);
+			float t = (time - first.TimePos) / (second.TimePos - first.TimePos);
+
+			sample.Rotation = normalize(slerp(first.RotationQuat, second.RotationQuat, t));
+			sample.Translation = lerp(first.Translation, second.Translation, t);
+			sample.Scale = lerp(first.Scale, second.Scale, t);
+		}
+
+		// Keep neighbouring rotations in the same hemisphere so the constant and key reduction tests compare
+		// like with like
+		for (UINT i = 1; i < sampleCount; ++i)
+		{
+			XMFLOAT4& q = samples[i].Rotation;
+			if (dot(samples[i - 1].Rotation, q) < 0.0f)
+			{
+				q = XMFLOAT4(-q.x, -q.y, -q.z, -q.w);
+			}
+		}
+	}
+
+	bool withinTolerance(_In_ const XMFLOAT3& a, _In_ const XMFLOAT3& b, _In_ float tolerance)
+	{
+		return std::fabs(a.x - b.x) <= tolerance && std::fabs(a.y - b.y) <= tolerance && std::fabs(a.z - b.z) <= tolerance;
+	}
+
+	bool withinTolerance(_In_ const XMFLOAT4& a, _In_ const XMFLOAT4& b, _In_ float tolerance)
+	{
+		return std::fabs(a.x - b.x) <= tolerance && std::fabs(a.y - b.y) <= tolerance &&
+			std::fabs(a.z - b.z) <= tolerance && std::fabs(a.w - b.w) <= tolerance;
+	}
+
+	//
+	// Returns bool indicating if interpolating between samples first and last reproduces every sample in
+	// between within tolerance, for the channels that aren't constant
+	//
+	bool segmentFits(
+		_In_ const std::vector<TrackSample>& samples,
+		_In_ UINT first,
+		_In_ UINT last,
+		_In_ uint32_t flags,
+		_In_ const ClipCompressionSettings& settings)
+	{
+		for (UINT i = first + 1; i < last; ++i)
+		{
+			float t = static_cast<float>(i - first) / (last - first);
+
+			if (!(flags & KSM_CLIP_CONSTANT_ROTATION) &&
+				!withinTolerance(nlerp(samples[first].Rotation, samples[last].Rotation, t), samples[i].Rotation, settings.RotationTolerance))
+			{
+				return false;
+			}
+
+			if (!(flags & KSM_CLIP_CONSTANT_TRANSLATION) &&
+				!withinTolerance(lerp(samples[first].Translation, samples[last].Translation, t), samples[i].Translation, settings.TranslationTolerance))
+			{
+				return false;
+			}
+
+			if (!(flags & KSM_CLIP_CONSTANT_SCALE) &&
+				!withinTolerance(lerp(samples[first].Scale, samples[last].Scale, t), samples[i].Scale, settings.ScaleTolerance))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	template<class T>
+	void appendArray(
+		_Inout_ std::vector<byte>& blob,
+		_In_ const std::vector<T>& values)
+	{
+		if (!values.empty())
+		{
+			const byte* bytes = reinterpret_cast<const byte*>(values.data());
+			blob.insert(blob.end(), bytes, bytes + values.size() * sizeof(T));
+		}
+	}
+
+	template<class T>
+	void readArray(
+		_Inout_ const byte*& source,
+		_In_ size_t count,
+		_Out_ std::vector<T>& values)
+	{
+		values.resize(count);
+		if (count > 0)
+		{
+			memcpy(values.data(), source, count * sizeof(T));
+		}
+		source += count * sizeof(T);
+	}
+}
+
+CompressedClip::CompressedClip()
+{
+	memset(&_header, 0, sizeof(_header));
+}
+
+void CompressedClip::Compress(
+	_In_ const KsmAnimationView& animation,
+	_In_ const ClipCompressionSettings& settings,
+	_Out_ std::vector<byte>& output)
+{
+	KsmClipHeader header = {};
+	header.Magic = KsmClipMagic;
+	header.Version = KsmClipVersion;
+	header.TrackCount = static_cast<uint32_t>(animation.Tracks.size());
+	header.Duration = std::max(animation.Duration, 0.0f);
+
+	//
+	// Pick a sample count for the requested rate, then spread the samples so the last one lands on the end
+	float ticksPerSecond = (animation.TicksPerSecond > 0.0f) ? animation.TicksPerSecond : 1.0f;
+	float samples = std::ceil(header.Duration / ticksPerSecond * settings.SamplesPerSecond);
+	header.SampleCount = static_cast<uint32_t>(std::min(std::max(samples, 0.0f), static_cast<float>(MaxSampleCount - 1))) + 1;
+	header.SampleInterval = (header.SampleCount > 1) ? header.Duration / (header.SampleCount - 1) : 0.0f;
+
+	std::vector<KsmClipTrackRecord> tracks(header.TrackCount);
+	std::vector<uint16_t> keys;
+	std::vector<uint16_t> rotations;
+	std::vector<uint16_t> translations;
+	std::vector<uint16_t> scales;
+
+	std::vector<TrackSample> trackSamples;
+	std::vector<UINT> trackKeys;
+
+	for (UINT t = 0; t < header.TrackCount; ++t)
+	{
+		sampleTrack(animation.Tracks[t], header.SampleCount, header.SampleInterval, trackSamples);
+		KsmClipTrackRecord& record = tracks[t];
+		memset(&record, 0, sizeof(record));
+
+		//
+		// Elide the channels that stay within tolerance of their first sample
+		record.Flags = KSM_CLIP_CONSTANT_ROTATION | KSM_CLIP_CONSTANT_TRANSLATION | KSM_CLIP_CONSTANT_SCALE;
+
+		XMFLOAT3 translationMin = trackSamples[0].Translation;
+		XMFLOAT3 translationMax = trackSamples[0].Translation;
+		XMFLOAT3 scaleMin = trackSamples[0].Scale;
+		XMFLOAT3 scaleMax = trackSamples[0].Scale;
+
+		for (const auto& sample : trackSamples)
+		{
+			if (!withinTolerance(sample.Rotation, trackSamples[0].Rotation, settings.RotationTolerance))
+			{
+				record.Flags &= ~KSM_CLIP_CONSTANT_ROTATION;
+			}
+			if (!withinTolerance(sample.Translation, trackSamples[0].Translation, settings.TranslationTolerance))
+			{
+				record.Flags &= ~KSM_CLIP_CONSTANT_TRANSLATION;
+			}
+			if (!withinTolerance(sample.Scale, trackSamples[0].Scale, settings.ScaleTolerance))
+			{
+				record.Flags &= ~KSM_CLIP_CONSTANT_SCALE;
+			}
+
+			translationMin = XMFLOAT3(std::min(translationMin.x, sample.Translation.x), std::min(translationMin.y, sample.Translation.y), std::min(translationMin.z, sample.Translation.z));
+			translationMax = XMFLOAT3(std::max(translationMax.x, sample.Translation.x), std::max(translationMax.y, sample.Translation.y), std::max(translationMax.z, sample.Translation.z));
+			scaleMin = XMFLOAT3(std::min(scaleMin.x, sample.Scale.x), std::min(scaleMin.y, sample.Scale.y), std::min(scaleMin.z, sample.Scale.z));
+			scaleMax = XMFLOAT3(std::max(scaleMax.x, sample.Scale.x), std::max(scaleMax.y, sample.Scale.y), std::max(scaleMax.z, sample.Scale.z));
+		}
+
+		memcpy(record.Rotation, &trackSamples[0].Rotation, sizeof(XMFLOAT4));
+
+		if (record.Flags & KSM_CLIP_CONSTANT_TRANSLATION)
+		{
+			memcpy(record.TranslationMin, &trackSamples[0].Translation, sizeof(XMFLOAT3));
+		}
+		else
+		{
+			memcpy(record.TranslationMin, &translationMin, sizeof(XMFLOAT3));
+			for (UINT axis = 0; axis < 3; ++axis)
+			{
+				record.TranslationExtent[axis] = component(translationMax, axis) - component(translationMin, axis);
+			}
+		}
+
+		if (record.Flags & KSM_CLIP_CONSTANT_SCALE)
+		{
+			memcpy(record.ScaleMin, &trackSamples[0].Scale, sizeof(XMFLOAT3));
+		}
+		else
+		{
+			memcpy(record.ScaleMin, &scaleMin, sizeof(XMFLOAT3));
+			for (UINT axis = 0; axis < 3; ++axis)
+			{
+				record.ScaleExtent[axis] = component(scaleMax, axis) - component(scaleMin, axis);
+			}
+		}
+
+		record.FirstKey = static_cast<uint32_t>(keys.size());
+		record.RotationOffset = static_cast<uint32_t>(rotations.size());
+		record.TranslationOffset = static_cast<uint32_t>(translations.size());
+		record.ScaleOffset = static_cast<uint32_t>(scales.size());
+
+		const uint32_t constant = KSM_CLIP_CONSTANT_ROTATION | KSM_CLIP_CONSTANT_TRANSLATION | KSM_CLIP_CONSTANT_SCALE;
+		if ((record.Flags & constant) == constant)
+		{
+			continue;
+		}
+
+		//
+		// Keep the fewest samples that interpolation still reproduces: from every key, reach as far forward as
+		// the samples in between allow
+		trackKeys.clear();
+		trackKeys.push_back(0);
+
+		UINT last = header.SampleCount - 1;
+		while (trackKeys.back() < last)
+		{
+			UINT first = trackKeys.back();
+			UINT end = first + 1;
+			while (end < last && segmentFits(trackSamples, first, end + 1, record.Flags, settings))
+			{
+				++end;
+			}
+			trackKeys.push_back(end);
+		}
+
+		record.KeyCount = static_cast<uint32_t>(trackKeys.size());
+
+		for (UINT key : trackKeys)
+		{
+			const TrackSample& sample = trackSamples[key];
+			keys.push_back(static_cast<uint16_t>(key));
+
+			if (!(record.Flags & KSM_CLIP_CONSTANT_ROTATION))
+			{
+				uint16_t words[3];
+				encodeRotation(sample.Rotation, words);
+				rotations.insert(rotations.end(), words, words + 3);
+			}
+
+			for (UINT axis = 0; axis < 3; ++axis)
+			{
+				if (!(record.Flags & KSM_CLIP_CONSTANT_TRANSLATION))
+				{
+					translations.push_back(quantize(component(sample.Translation, axis), record.TranslationMin[axis], record.TranslationExtent[axis], QuantizedMax16));
+				}
+				if (!(record.Flags & KSM_CLIP_CONSTANT_SCALE))
+				{
+					scales.push_back(quantize(component(sample.Scale, axis), record.ScaleMin[axis], record.ScaleExtent[axis], QuantizedMax16));
+				}
+			}
+		}
+	}
+
+	header.KeyCount = static_cast<uint32_t>(keys.size());
+	header.RotationWordCount = static_cast<uint32_t>(rotations.size());
+	header.TranslationWordCount = static_cast<uint32_t>(translations.size());
+	header.ScaleWordCount = static_cast<uint32_t>(scales.size());
+
+	output.clear();
+	const byte* headerBytes = reinterpret_cast<const byte*>(&header);
+	output.insert(output.end(), headerBytes, headerBytes + sizeof(header));
+	appendArray(output, tracks);
+	appendArray(output, keys);
+	appendArray(output, rotations);
+	appendArray(output, translations);
+	appendArray(output, scales);
+}
+
+bool CompressedClip::Read(
+	_In_ const std::wstring& name,
+	_In_ const byte* data,
+	_In_ size_t size)
+{
+	*this = CompressedClip();
+
+	KsmClipHeader header;
+	if (data == nullptr || size < sizeof(header))
+	{
+		return false;
+	}
+	memcpy(&header, data, sizeof(header));
+
+	uint64_t wordCount = (uint64_t)header.KeyCount + header.RotationWordCount + header.TranslationWordCount + header.ScaleWordCount;
+	uint64_t expectedSize = sizeof(header) + (uint64_t)header.TrackCount * sizeof(KsmClipTrackRecord) + wordCount * sizeof(uint16_t);
+
+	if (header.Magic != KsmClipMagic ||
+		header.Version != KsmClipVersion ||
+		header.SampleCount == 0 ||
+		header.SampleCount > MaxSampleCount ||
+		!(header.SampleInterval >= 0.0f) ||
+		(header.SampleCount > 1 && !(header.SampleInterval > 0.0f)) ||
+		expectedSize > size)
+	{
+		return false;
+	}
+
+	CompressedClip clip;
+	clip._name = name;
+	clip._header = header;
+
+	const byte* source = data + sizeof(header);
+	readArray(source, header.TrackCount, clip._tracks);
+	readArray(source, header.KeyCount, clip._keys);
+	readArray(source, header.RotationWordCount, clip._rotations);
+	readArray(source, header.TranslationWordCount, clip._translations);
+	readArray(source, header.ScaleWordCount, clip._scales);
+
+	//
+	// Every track's keys and values have to be inside the arrays, and its keys strictly increasing sample
+	// indices from the first sample to the last
+	for (const auto& track : clip._tracks)
+	{
+		const uint32_t constant = KSM_CLIP_CONSTANT_ROTATION | KSM_CLIP_CONSTANT_TRANSLATION | KSM_CLIP_CONSTANT_SCALE;
+		if (track.KeyCount == 0)
+		{
+			if ((track.Flags & constant) != constant)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		uint64_t valueWords = (uint64_t)track.KeyCount * 3;
+
+		if (track.FirstKey > header.KeyCount ||
+			track.KeyCount > header.KeyCount - track.FirstKey ||
+			(!(track.Flags & KSM_CLIP_CONSTANT_ROTATION) && track.RotationOffset + valueWords > header.RotationWordCount) ||
+			(!(track.Flags & KSM_CLIP_CONSTANT_TRANSLATION) && track.TranslationOffset + valueWords > header.TranslationWordCount) ||
+			(!(track.Flags & KSM_CLIP_CONSTANT_SCALE) && track.ScaleOffset + valueWords > header.ScaleWordCount))
+		{
+			return false;
+		}
+
+		const uint16_t* keys = &clip._keys[track.FirstKey];
+		if (keys[0] != 0 || keys[track.KeyCount - 1] != header.SampleCount - 1)
+		{
+			return false;
+		}
+
+		for (UINT k = 1; k < track.KeyCount; ++k)
+		{
+			if (keys[k] <= keys[k - 1])
+			{
+				return false;
+			}
+		}
+	}
+
+	*this = std::move(clip);
+	return true;
+}
+
+void CompressedClip::Sample(
+	_In_ float time,
+	_Inout_ CompressedClipCursor& cursor,
+	_Out_ std::vector<XMFLOAT4X4>& channelTransforms) const
+{
+	channelTransforms.resize(_tracks.size());
+
+	float sample = 0.0f;
+	if (_header.SampleInterval > 0.0f)
+	{
+		sample = std::min(std::max(time / _header.SampleInterval, 0.0f), static_cast<float>(_header.SampleCount - 1));
+	}
+
+	// Start over from the first keys if this is a different clip or the time went backwards
+	if (cursor.Clip != this || cursor.Keys.size() != _tracks.size() || sample < cursor.Sample)
+	{
+		cursor.Keys.assign(_tracks.size(), 0);
+	}
+	cursor.Clip = this;
+	cursor.Sample = sample;
+
+	for (size_t t = 0; t < _tracks.size(); ++t)
+	{
+		const KsmClipTrackRecord& track = _tracks[t];
+
+		//
+		// Step the cursor up to the pair of keys around the sample
+		UINT first = 0;
+		UINT second = 0;
+		float blend = 0.0f;
+
+		if (track.KeyCount > 1)
+		{
+			const uint16_t* keys = &_keys[track.FirstKey];
+			UINT& key = cursor.Keys[t];
+			key = std::min(key, track.KeyCount - 2);
+
+			while (key + 2 < track.KeyCount && keys[key + 1] <= sample)
+			{
+				++key;
+			}
+
+			first = key;
+			second = key + 1;
+			blend = std::min(std::max((sample - keys[first]) / (keys[second] - keys[first]), 0.0f), 1.0f);
+		}
+
+		XMFLOAT4 rotation;
+		if (track.Flags & KSM_CLIP_CONSTANT_ROTATION)
+		{
+			rotation = XMFLOAT4(track.Rotation[0], track.Rotation[1], track.Rotation[2], track.Rotation[3]);
+		}
+		else
+		{
+			const uint16_t* words = &_rotations[track.RotationOffset];
+			rotation = nlerp(decodeRotation(words + first * 3), decodeRotation(words + second * 3), blend);
+		}
+
+		XMFLOAT3 translation(track.TranslationMin[0], track.TranslationMin[1], track.TranslationMin[2]);
+		XMFLOAT3 scale(track.ScaleMin[0], track.ScaleMin[1], track.ScaleMin[2]);
+
+		for (UINT axis = 0; axis < 3; ++axis)
+		{
+			if (!(track.Flags & KSM_CLIP_CONSTANT_TRANSLATION))
+			{
+				const uint16_t* words = &_translations[track.TranslationOffset + axis];
+				(&translation.x)[axis] = lerp(
+					dequantize(words[first * 3], track.TranslationMin[axis], track.TranslationExtent[axis], QuantizedMax16),
+					dequantize(words[second * 3], track.TranslationMin[axis], track.TranslationExtent[axis], QuantizedMax16),
+					blend);
+			}
+
+			if (!(track.Flags & KSM_CLIP_CONSTANT_SCALE))
+			{
+				const uint16_t* words = &_scales[track.ScaleOffset + axis];
+				(&scale.x)[axis] = lerp(
+					dequantize(words[first * 3], track.ScaleMin[axis], track.ScaleExtent[axis], QuantizedMax16),
+					dequantize(words[second * 3], track.ScaleMin[axis], track.ScaleExtent[axis], QuantizedMax16),
+					blend);
+			}
+		}
+
+		composeTransform(rotation, translation, scale, channelTransforms[t]);
+	}
+}
+
+size_t CompressedClip::GetMemoryUsage() const
+{
+	return sizeof(*this) +
+		_tracks.capacity() * sizeof(KsmClipTrackRecord) +
+		(_keys.capacity() + _rotations.capacity() + _translations.capacity() + _scales.capacity()) * sizeof(uint16_t);
+}
@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////////
+// CompressedClip.h
+// Animation clips in the compressed form stored in the KSM clips
+// section. The pipeline samples every track at a uniform rate, stores
+// tracks that don't change as a single value, drops the samples linear
+// interpolation reproduces within tolerance and quantizes what is left:
+// rotations to 48 bit smallest three quaternions, translations and
+// scales to 16 bits per component. Playback keeps a cursor per instance
+// so sampling steps forward through the keys instead of searching them.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "KsmReader.h"
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+namespace Engine
+{
+	struct ClipCompressionSettings
+	{
+		ClipCompressionSettings() :
+			SamplesPerSecond(30.0f), RotationTolerance(0.0005f), TranslationTolerance(0.0005f), ScaleTolerance(0.0005f)
+		{}
+
+		// Rate the tracks are sampled at, per second of clip time (keyframe time / TicksPerSecond)
+		float SamplesPerSecond;
+
+		// Largest error allowed in any quaternion component when dropping keys or eliding constant tracks
+		float RotationTolerance;
+
+		// Largest error allowed in any translation or scale component, in model units
+		float TranslationTolerance;
+		float ScaleTolerance;
+	};
+
+	class CompressedClip;
+
+	//
+	// Where one instance is in a clip. Sampling forwards from the last sampled time only steps over the keys
+	// in between; sampling backwards (e.g. when the clip loops) or sampling another clip starts again from
+	// the first key
+	//
+	struct CompressedClipCursor
+	{
+		CompressedClipCursor() :
+			Clip(nullptr), Sample(0.0f)
+		{}
+
+		// The clip Keys were found in
+		const CompressedClip* Clip;
+
+		// The key at or before Sample in every track
+		std::vector<UINT> Keys;
+
+		// The (fractional) sample index last sampled at
+		float Sample;
+	};
+
+	class CompressedClip
+	{
+	public:
+
+		CompressedClip();
+
+		//
+		// FullName:  Engine::CompressedClip::Compress
+		// Compresses an animation read from a KSM file into the blob stored in the KSM clips section
+		//
+		static void Compress(
+			_In_ const KsmAnimationView& animation,
+			_In_ const ClipCompressionSettings& settings,
+			_Out_ std::vector<byte>& output);
+
+		//
+		// FullName:  Engine::CompressedClip::Read
+		// Loads a blob written by Compress. The data only needs to stay valid for the duration of the call.
+		// Returns false if the blob is malformed, leaving the clip empty
+		//
+		bool Read(
+			_In_ const std::wstring& name,
+			_In_ const byte* data,
+			_In_ size_t size);
+
+		//
+		// FullName:  Engine::CompressedClip::Sample
+		// Fills channelTransforms with the local transform of every channel at the given time (in the same
+		// units as the keyframe times it was compressed from, clamped to the clip) in the same layout as
+		// CredibleNode::LocalTransform
+		//
+		void Sample(
+			_In_ float time,
+			_Inout_ CompressedClipCursor& cursor,
+			_Out_ std::vector<DirectX::XMFLOAT4X4>& channelTransforms) const;
+
+		const std::wstring& GetName() const
+		{
+			return _name;
+		}
+
+		float GetDuration() const
+		{
+			return _header.Duration;
+		}
+
+		UINT GetTrackCount() const
+		{
+			return _header.TrackCount;
+		}
+
+		//
+		// Returns the number of bytes the clip uses
+		//
+		size_t GetMemoryUsage() const;
+
+	private:
+
+		std::wstring _name;
+
+		KsmClipHeader _header;
+
+		std::vector<KsmClipTrackRecord> _tracks;
+
+		// The sample index of every key of every track
+		std::vector<uint16_t> _keys;
+
+		// The quantized values of the keys of the animated channels
+		std::vector<uint16_t> _rotations;
+		std::vector<uint16_t> _translations;
+		std::vector<uint16_t> _scales;
+	};
+}
@@ -19,39 +19,140 @@
 #include "MathHelper.h"
 #include "InstancedRenderer.h"
 #include <time.h>
-#include "DataReader.h"
+#include "KsmReader.h"
 
 using namespace Engine;
 using namespace std;
 
+// The size of the vertex records in KSM files are the engine's vertex types
+const KsmVertexStrides CredibleModelData::KsmEngineVertexStrides =
+{
+	sizeof(VertexPositionNormalTexture),
+	sizeof(VertexPositionNormalTextureBoneWeight)
+};
+
+static_assert(offsetof(VertexPositionNormalTexture, position) == 0, "KsmReader::ReadPositions expects position to be the first vertex member");
+static_assert(offsetof(VertexPositionNormalTextureBoneWeight, position) == 0, "KsmReader::ReadPositions expects position to be the first vertex member");
+
 CredibleModelData::CredibleModelData(
 	_In_ byte* data,
+	_In_ size_t size,
+	_In_ ID3D11Device* device, 
+	_In_opt_ bool readSubsetAsInstanceType/* = false*/,
+	_In_opt_ bool keepCpuGeometry/* = true*/)
+	: RootNode(nullptr), _device(device), _bonePaletteSize(0), _animationTimer(0), _renderBackend(nullptr)
+{
+	KsmModelView ksm;
+	if (!KsmReader::Read(data, size, KsmEngineVertexStrides, ksm))
+	{
+		MUKASHIDEBUG_CRITICALERROR(L"KSM data is malformed or truncated, the model was not loaded");
+		return;
+	}
+
+	initializeFromKsm(ksm, readSubsetAsInstanceType, keepCpuGeometry);
+}
+
+CredibleModelData::CredibleModelData(
+	_In_ const KsmModelView& ksm,
 	_In_ ID3D11Device* device, 
-	_In_opt_ bool readSubsetAsInstanceType/* = false*/)
-	:_device(device), _animationTimer(0)
+	_In_opt_ bool readSubsetAsInstanceType/* = false*/,
+	_In_opt_ bool keepCpuGeometry/* = true*/)
+	: RootNode(nullptr), _device(device), _bonePaletteSize(0), _animationTimer(0), _renderBackend(nullptr)
 {
-	initializeFromKsm(data, readSubsetAsInstanceType);
+	initializeFromKsm(ksm, readSubsetAsInstanceType, keepCpuGeometry);
 }
 
 CredibleModelData::CredibleModelData(	
 	_In_ ID3D11Device* device,
 	_In_ GeometryGenerator::MeshData& meshData,
 	_In_ ID3D11ShaderResourceView* diffuseTexture)
-	: _device(device), _animationTimer(0)
+	: RootNode(nullptr), _device(device), _bonePaletteSize(0), _animationTimer(0), _renderBackend(nullptr)
 {
 	initializeFromMeshData(meshData, diffuseTexture, nullptr);
 }
 
 // We do not need to clean up the textures here because the Asset Manager will handle
-// that for us
+// that for us, only the references the render backend holds to them. The collision
+// shapes built from the model's geometry are released by CollisionGeometry
 CredibleModelData::~CredibleModelData(void)
-{}
+{
+	RemoveFromRenderBackend();
+}
+
+//
+// Models need at least this many nodes for Record to cull them node by node
+//
+static const size_t MinimumNodesToCull = 4;
+
+//
+// Returns the axis aligned box that encloses the given box after the (row vector) transform
+//
+static void transformBounds(
+	_In_ const BoundingBox& bounds,
+	_In_ const XMFLOAT4X4& transform,
+	_Out_ XMFLOAT3& center,
+	_Out_ XMFLOAT3& extents)
+{
+	const float* c = &bounds.Center.x;
+	const float* e = &bounds.Extents.x;
+	float* outCenter = &center.x;
+	float* outExtents = &extents.x;
+
+	for (UINT j = 0; j < 3; ++j)
+	{
+		outCenter[j] = transform.m[3][j];
+		outExtents[j] = 0.0f;
+		for (UINT i = 0; i < 3; ++i)
+		{
+			outCenter[j] += c[i] * transform.m[i][j];
+			outExtents[j] += e[i] * fabs(transform.m[i][j]);
+		}
+	}
+}
+
+//
+// Transforms a view space ray into the own space of a mesh under a node with the given (transposed) global
+// transform, i.e. by the inverse of mesh -> node -> world -> view, rather than transforming every triangle
+// out of it. Distances along the ray are the same in both spaces
+//
+static void rayToMeshSpace(
+	_In_ const XMVECTOR& rayOrigin,
+	_In_ const XMVECTOR& rayDirection,
+	_In_ const XMFLOAT4X4& worldTransform,
+	_In_ XMFLOAT4X4 nodeTransform,
+	_In_ const XMMATRIX& inverseView,
+	_Out_ XMFLOAT3& origin,
+	_Out_ XMFLOAT3& direction)
+{
+	MathHelper::Transpose(nodeTransform);
+	XMMATRIX nodeTransformMatrix = XMLoadFloat4x4(&nodeTransform);
+
+	XMMATRIX world = XMLoadFloat4x4(&worldTransform);
+	XMMATRIX meshToWorld = XMMatrixMultiply(nodeTransformMatrix, world);
+	XMVECTOR meshToWorldDeterminant = XMMatrixDeterminant(meshToWorld);
+	XMMATRIX worldToMesh = XMMatrixInverse(&meshToWorldDeterminant, meshToWorld);
+
+	XMMATRIX toMesh = XMMatrixMultiply(inverseView, worldToMesh);
+
+	XMStoreFloat3(&origin, XMVector3TransformCoord(rayOrigin, toMesh));
+	XMStoreFloat3(&direction, XMVector3TransformNormal(rayDirection, toMesh));
+}
 
 bool CredibleModelData::IntersectedBy(
 	_In_ const XMVECTOR& rayOrigin,
 	_In_ const XMVECTOR& rayDirection,
 	_In_ const XMFLOAT4X4& worldTransform,
 	_In_ const XMMATRIX& inverseView)
+{
+	return IntersectedBy(rayOrigin, rayDirection, worldTransform, inverseView, _pose);
+}
+
+bool CredibleModelData::IntersectedBy(
+	_In_ const XMVECTOR& rayOrigin,
+	_In_ const XMVECTOR& rayDirection,
+	_In_ const XMFLOAT4X4& worldTransform,
+	_In_ const XMMATRIX& inverseView,
+	_In_ const CredibleModelPose& pose) const
 {
 	for (const auto& node : Nodes)
 	{
@@ -61,7 +162,7 @@ bool CredibleModelData::IntersectedBy(
 				rayOrigin,
 				rayDirection,
 				worldTransform,
-				node->GlobalTransform,
+				pose.GlobalTransforms[node->Index],
 				inverseView);
 
 			if (result)
@@ -74,64 +175,109 @@ bool CredibleModelData::IntersectedBy(
 	return false;
 }
 
-bool CredibleMesh::IntersectedBy(
+bool CredibleModelData::IntersectNearest(
 	_In_ const XMVECTOR& rayOrigin,
 	_In_ const XMVECTOR& rayDirection,
 	_In_ const XMFLOAT4X4& worldTransform,
-	_In_ XMFLOAT4X4 nodeTransform,
-	_In_ const XMMATRIX& inverseView)
+	_In_ const XMMATRIX& inverseView,
+	_In_ float maxT,
+	_Out_ CredibleModelHit& hit) const
 {
-	MathHelper::Transpose(nodeTransform);
-	XMMATRIX nodeTransformMatrix = XMLoadFloat4x4(&nodeTransform);
-
-	// Transform the ray to local space
-	XMMATRIX world = XMLoadFloat4x4(&worldTransform);
-	XMVECTOR worldDeterminant = XMMatrixDeterminant(world);
-	XMMATRIX inverseWorld = XMMatrixInverse(&worldDeterminant, world);
+	return IntersectNearest(rayOrigin, rayDirection, worldTransform, inverseView, _pose, maxT, hit);
+}
 
-	// View space to the object's local space.
-	XMMATRIX toLocal = XMMatrixMultiply(inverseView, inverseWorld);
+bool CredibleModelData::IntersectNearest(
+	_In_ const XMVECTOR& rayOrigin,
+	_In_ const XMVECTOR& rayDirection,
+	_In_ const XMFLOAT4X4& worldTransform,
+	_In_ const XMMATRIX& inverseView,
+	_In_ const CredibleModelPose& pose,
+	_In_ float maxT,
+	_Out_ CredibleModelHit& hit) const
+{
+	struct Candidate
+	{
+		float TEnter;
+		const CredibleNode* Node;
+		const CredibleMesh* Mesh;
+		XMFLOAT3 Origin;
+		XMFLOAT3 Direction;
+	};
 
-	XMVECTOR newRayDirection = rayDirection;
-	XMVECTOR newRayOrigin = rayOrigin;
+	//
+	// Bring the ray into every node's space once and keep the meshes whose bounds it passes through
+	vector<Candidate> candidates;
 
-	newRayOrigin = XMVector3TransformCoord(newRayDirection, toLocal);
-	newRayDirection = XMVector3TransformNormal(newRayDirection, toLocal);
+	for (const auto& node : Nodes)
+	{
+		if (node->Meshes.empty())
+		{
+			continue;
+		}
 
-	// Make the ray a unit length for the intersection test
-	newRayDirection = XMVector3Normalize(newRayDirection);
+		Candidate candidate;
+		candidate.Node = node.get();
+		rayToMeshSpace(rayOrigin, rayDirection, worldTransform, pose.GlobalTransforms[node->Index], inverseView, candidate.Origin, candidate.Direction);
 
-	//////////////////////////////////////////////////////////////////////////
-	float tmin = 0.0f;
+		for (const auto& mesh : node->Meshes)
+		{
+			if (mesh->Bvh.IntersectBounds(candidate.Origin, candidate.Direction, maxT, candidate.TEnter))
+			{
+				candidate.Mesh = mesh.get();
+				candidates.push_back(candidate);
+			}
+		}
+	}
 
-	if (MeshBoundingBox.Intersects(newRayOrigin, newRayDirection, tmin))
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
 	{
-		tmin = MathHelper::Infinity;
-		for (UINT n = 0; n < Indices.size() / 3; ++n)
-		{
-			// Indices for this triangle.
-			UINT i0 = Indices[n * 3 + 0];
-			UINT i1 = Indices[n * 3 + 1];
-			UINT i2 = Indices[n * 3 + 2];
+		return a.TEnter < b.TEnter;
+	});
 
-			// Vertices for this triangle.D
-			XMVECTOR v0 = XMVectorSet(PositionalVertices[i0].x, PositionalVertices[i0].y, PositionalVertices[i0].z, 0.0f);
-			XMVECTOR v1 = XMVectorSet(PositionalVertices[i1].x, PositionalVertices[i1].y, PositionalVertices[i1].z, 0.0f);
-			XMVECTOR v2 = XMVectorSet(PositionalVertices[i2].x, PositionalVertices[i2].y, PositionalVertices[i2].z, 0.0f);
+	//
+	// Test front to back, every hit shortens the ray for the meshes after it
+	float best = maxT;
+	bool found = false;
 
-			v0 = XMVector3TransformCoord(v0, nodeTransformMatrix);
-			v1 = XMVector3TransformCoord(v1, nodeTransformMatrix);
-			v2 = XMVector3TransformCoord(v2, nodeTransformMatrix);
+	for (const auto& candidate : candidates)
+	{
+		if (candidate.TEnter > best)
+		{
+			break;
+		}
 
-			// Stop once we've found a triangle that's been hit
-			if (TriangleTests::Intersects(newRayOrigin, newRayDirection, v0, v1, v2, tmin))
-			{
-				return true;
-			}
+		MeshBvhHit meshHit;
+		if (candidate.Mesh->Bvh.IntersectNearest(candidate.Origin, candidate.Direction, best, meshHit) &&
+			(!found || meshHit.T < best))
+		{
+			best = meshHit.T;
+			found = true;
+
+			hit.T = meshHit.T;
+			hit.U = meshHit.U;
+			hit.V = meshHit.V;
+			hit.Triangle = meshHit.Triangle;
+			hit.Node = candidate.Node;
+			hit.Mesh = candidate.Mesh;
 		}
 	}
 
-	return false;
+	return found;
+}
+
+bool CredibleMesh::IntersectedBy(
+	_In_ const XMVECTOR& rayOrigin,
+	_In_ const XMVECTOR& rayDirection,
+	_In_ const XMFLOAT4X4& worldTransform,
+	_In_ XMFLOAT4X4 nodeTransform,
+	_In_ const XMMATRIX& inverseView)
+{
+	XMFLOAT3 origin;
+	XMFLOAT3 direction;
+	rayToMeshSpace(rayOrigin, rayDirection, worldTransform, nodeTransform, inverseView, origin, direction);
+
+	// Stop once we've found a triangle that's been hit
+	return Bvh.IntersectAny(origin, direction, MathHelper::Infinity);
 }
 
 std::vector<XMFLOAT3> CredibleMesh::GetAllIntersectionsBy(
@@ -139,35 +285,36 @@ std::vector<XMFLOAT3> CredibleMesh::GetAllIntersectionsBy(
 	_In_ const XMVECTOR& rayDirection,
 	_In_opt_ const XMMATRIX* translation /*= nullptr*/)
 {
-	float tmin = MathHelper::Infinity;
 	std::vector<XMFLOAT3> intersections;
 
-	for (UINT n = 0; n < Indices.size() / 3; ++n)
+	// The ray is in the space translation takes the mesh to, bring it back into the mesh's own space
+	XMVECTOR meshRayOrigin = rayOrigin;
+	XMVECTOR meshRayDirection = rayDirection;
+
+	if (translation)
 	{
-		// Indices for this triangle.
-		UINT i0 = Indices[n * 3 + 0];
-		UINT i1 = Indices[n * 3 + 1];
-		UINT i2 = Indices[n * 3 + 2];
+		XMVECTOR determinant = XMMatrixDeterminant(*translation);
+		XMMATRIX inverseTranslation = XMMatrixInverse(&determinant, *translation);
 
-		// Vertices for this triangle.D
-		XMVECTOR v0 = XMVectorSet(PositionalVertices[i0].x, PositionalVertices[i0].y, PositionalVertices[i0].z, 0.0f);
-		XMVECTOR v1 = XMVectorSet(PositionalVertices[i1].x, PositionalVertices[i1].y, PositionalVertices[i1].z, 0.0f);
-		XMVECTOR v2 = XMVectorSet(PositionalVertices[i2].x, PositionalVertices[i2].y, PositionalVertices[i2].z, 0.0f);
+		meshRayOrigin = XMVector3TransformCoord(meshRayOrigin, inverseTranslation);
+		meshRayDirection = XMVector3TransformNormal(meshRayDirection, inverseTranslation);
+	}
 
-		if (translation)
-		{
-			v0 = XMVector3TransformCoord(v0, *translation);
-			v1 = XMVector3TransformCoord(v1, *translation);
-			v2 = XMVector3TransformCoord(v2, *translation);
-		}
+	XMFLOAT3 origin;
+	XMFLOAT3 direction;
+	XMStoreFloat3(&origin, meshRayOrigin);
+	XMStoreFloat3(&direction, meshRayDirection);
 
-		// Stop once we've found a triangle that's been hit
-		if (TriangleTests::Intersects(rayOrigin, rayDirection, v0, v1, v2, tmin))
-		{
-			XMFLOAT3 intersection;
-			XMStoreFloat3(&intersection, v0);
-			intersections.push_back(intersection);
-		}
+	std::vector<MeshBvhHit> hits;
+	Bvh.IntersectAll(origin, direction, MathHelper::Infinity, hits);
+
+	for (const auto& hit : hits)
+	{
+		// The distance along the ray is the same in the mesh's space and the caller's, so the hit point can
+		// be found on the original ray
+		XMFLOAT3 intersection;
+		XMStoreFloat3(&intersection, XMVectorMultiplyAdd(XMVectorReplicate(hit.T), rayDirection, rayOrigin));
+		intersections.push_back(intersection);
 	}
 
 	return intersections;
@@ -203,7 +350,8 @@ void CredibleModelData::DrawInstancedNode(
 	_In_ ID3D11Buffer* instanceDataBuffer,
 	_In_ UINT count,
 	_In_ ConstantBuffer<ObjectConstBuffer>* cb,
-	_In_ CredibleMesh* mesh)
+	_In_ CredibleMesh* mesh,
+	_In_opt_ UINT lod /*= 0*/)
 {
 	//TODO: look into using materials loaded from models
 
@@ -223,11 +371,13 @@ void CredibleModelData::DrawInstancedNode(
 	UINT offset[2] = { 0, 0 };
 	ID3D11Buffer* vbs[2] = { mesh->VB.Get(), instanceDataBuffer };
 
+	const CredibleMeshLod* meshLod = mesh->GetLod(lod);
+
 	dc->IASetVertexBuffers(0, 2, vbs, stride, offset);
-	dc->IASetIndexBuffer(mesh->IB.Get(), mesh->IndexBufferFormat, 0);
+	dc->IASetIndexBuffer(meshLod ? meshLod->IB.Get() : mesh->IB.Get(), mesh->IndexBufferFormat, 0);
 
 	dc->DrawIndexedInstanced(
-		mesh->IndexCount,
+		meshLod ? meshLod->IndexCount : mesh->IndexCount,
 		count,
 		0,
 		0,
@@ -252,6 +402,11 @@ void CredibleModelData::initializeFromMeshData(
 	childUp.reset(child);
 	Nodes.push_back(move(rootUp));
 	Nodes.push_back(move(childUp));
+
+	RootNode->Index = 0;
+	child->Index = 1;
+	initializeSkeleton();
+	initializeLods();
 	
 	std::vector<DirectX::VertexPositionNormalTexture> staticVertices;
 	staticVertices.reserve(meshData.Vertices.size());
@@ -280,79 +435,128 @@ void CredibleModelData::Draw(
 	_In_ XMFLOAT4X4 world, 
 	_In_ const std::vector<XMFLOAT4X4>& localBoneTransforms,
 	_In_ const vector<wstring>& disabledNodes,
-	_In_ map<ItemSlot, ID3D11ShaderResourceView*>& textureOverrides)
+	_In_ map<ItemSlot, ID3D11ShaderResourceView*>& textureOverrides,
+	_In_opt_ UINT lod /*= 0*/)
 {
 	if (_hasAnimations)
 	{
-		UpdateTransforms(RootNode, localBoneTransforms);
+		UpdateTransforms(localBoneTransforms);
 	}
 
-	DrawNode(dc, cb, aCb, RootNode, world, disabledNodes, textureOverrides);
+	DrawNode(dc, cb, aCb, RootNode, world, _pose, disabledNodes, textureOverrides, lod);
 }
 
-void Engine::CredibleModelData::generateBtConvexShapeTraverse(
-	_In_ CredibleNode* node,
-	_In_ btTriangleIndexVertexArray* shape,
-	_In_ XMFLOAT4X4 scale)
+void CredibleModelData::Draw(
+	_In_ ID3D11DeviceContext* dc,
+	_In_ ConstantBuffer<ObjectConstBuffer>* cb,
+	_In_ ConstantBuffer<AnimatedConstBuffer>* aCb,
+	_In_ XMFLOAT4X4 world, 
+	_In_ const CredibleModelPose& pose,
+	_In_ const vector<wstring>& disabledNodes,
+	_In_ map<ItemSlot, ID3D11ShaderResourceView*>& textureOverrides,
+	_In_opt_ UINT lod /*= 0*/)
 {
-	XMFLOAT4X4 nodeGlobalTransform = node->GlobalTransform;
-	MathHelper::Transpose(nodeGlobalTransform);
+	DrawNode(dc, cb, aCb, RootNode, world, pose, disabledNodes, textureOverrides, lod);
+}
 
-	DirectX::XMMATRIX nodeGlobalTransformWorld = XMLoadFloat4x4(&nodeGlobalTransform);
-	XMMATRIX scaleTranslation = XMLoadFloat4x4(&scale);
-	nodeGlobalTransformWorld = XMMatrixMultiply(nodeGlobalTransformWorld, scaleTranslation);
+UINT CredibleModelData::SelectLod(
+	_In_ const LodSelection& selection,
+	_In_ const XMFLOAT4X4& world,
+	_In_ UINT currentLod) const
+{
+	UINT lodCount = GetLodCount();
+	if (lodCount <= 1)
+	{
+		return 0;
+	}
 
-	for (const auto& mesh : node->Meshes)
+	//
+	// The bounding box's radius in the world, scaled by the largest of the world transform's axis scales
+	float modelRadius = XMVectorGetX(XMVector3Length(XMLoadFloat3(&_boundingBox.Extents)));
+	float scale = 0.0f;
+	for (UINT i = 0; i < 3; ++i)
 	{
-		for (const auto& vertex : mesh->PositionalVertices)
-		{
-			XMVECTOR vertexVector = XMLoadFloat3(&vertex);
-			vertexVector = XMVector3TransformCoord(vertexVector, nodeGlobalTransformWorld);
+		scale = max(scale, XMVectorGetX(XMVector3Length(XMVectorSet(world.m[i][0], world.m[i][1], world.m[i][2], 0.0f))));
+	}
 
-			XMFLOAT3 tmp;
-			XMStoreFloat3(&tmp, vertexVector);
-			mesh->translatedVertices.push_back(tmp);
-		}
+	XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&_boundingBox.Center), XMLoadFloat4x4(&world));
+	float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(center, XMLoadFloat3(&selection.EyePosition))));
+	float radius = modelRadius * scale;
 
-		btIndexedMesh im;
-		im.m_vertexBase = (unsigned char*)&mesh->translatedVertices[0];
-		im.m_vertexStride = sizeof(XMFLOAT3);
-		im.m_numVertices = (int)mesh->translatedVertices.size();
-		im.m_triangleIndexBase = (const unsigned char*)&mesh->Indices[0];
-		im.m_triangleIndexStride = sizeof(UINT) * 3;
-		im.m_numTriangles = (int)mesh->Indices.size() / 3;
-		im.m_indexType = PHY_INTEGER;
-		im.m_vertexType = PHY_FLOAT;
+	// Up close everything is drawn at full resolution
+	if (distance <= radius || modelRadius <= 0.0f)
+	{
+		return 0;
+	}
 
-		shape->addIndexedMesh(im, PHY_INTEGER);
+	//
+	// A level's error shows up on screen as the same fraction of the projected size as it is of the model's
+	// own size, so a level is right while projectedSize * error stays within PixelError * model size
+	float projectedSize = 2.0f * radius * selection.ProjectionScale / distance;
+	float budget = selection.PixelError * 2.0f * modelRadius;
 
-		//btConvexTriangleMeshShape* t = new btConvexTriangleMeshShape();
-		//btStridingMeshInterface mi;
+	UINT lod = min(currentLod, lodCount - 1);
+	while (lod + 1 < lodCount && projectedSize * _lodErrors[lod + 1] <= budget * (1.0f - selection.Hysteresis))
+	{
+		++lod;
+	}
+	while (lod > 0 && projectedSize * _lodErrors[lod] > budget * (1.0f + selection.Hysteresis))
+	{
+		--lod;
+	}
 
-		//for (const auto& index : mesh->Indices)
-		//{
-		//	XMFLOAT3 vertexFloat = mesh->PositionalVertices[index];
-		//	XMVECTOR vertexVector = XMLoadFloat3(&vertexFloat);
-		//	vertexVector = XMVector3TransformCoord(vertexVector, nodeGlobalTransformWorld);
+	return lod;
+}
 
-		//	XMFLOAT3 tmp;
-		//	XMStoreFloat3(&tmp, vertexVector);
-		//	shape->addPoint(btVector3(tmp.x, tmp.y, tmp.z));
-		//}
-		//for (const auto& vertex : mesh->PositionalVertices)
-		//{
-		//	XMVECTOR vertexVector = XMLoadFloat3(&vertex);
-		//	vertexVector = XMVector3TransformCoord(vertexVector, nodeGlobalTransformWorld);
+void CredibleModelData::GetCollisionGeometry(
+	_Out_ vector<XMFLOAT3>& vertices,
+	_Out_ vector<UINT>& indices) const
+{
+	vertices.clear();
+	indices.clear();
 
-		//	XMFLOAT3 tmp;
-		//	XMStoreFloat3(&tmp, vertexVector);
-		//	shape->addPoint(btVector3(tmp.x, tmp.y, tmp.z));
-		//}
+	if (RootNode != nullptr)
+	{
+		collectCollisionGeometry(RootNode, vertices, indices);
+	}
+}
+
+void CredibleModelData::collectCollisionGeometry(
+	_In_ const CredibleNode* node,
+	_Inout_ vector<XMFLOAT3>& vertices,
+	_Inout_ vector<UINT>& indices) const
+{
+	XMFLOAT4X4 nodeGlobalTransform = node->GlobalTransform;
+	MathHelper::Transpose(nodeGlobalTransform);
+	XMMATRIX nodeGlobalTransformMatrix = XMLoadFloat4x4(&nodeGlobalTransform);
+
+	for (const auto& mesh : node->Meshes)
+	{
+		// Nothing to collide with if the model was loaded without CPU geometry
+		if (mesh->Indices.empty())
+		{
+			continue;
+		}
+
+		UINT baseVertex = static_cast<UINT>(vertices.size());
+		for (const auto& vertex : mesh->PositionalVertices)
+		{
+			XMVECTOR vertexVector = XMVector3TransformCoord(XMLoadFloat3(&vertex), nodeGlobalTransformMatrix);
+
+			XMFLOAT3 transformed;
+			XMStoreFloat3(&transformed, vertexVector);
+			vertices.push_back(transformed);
+		}
+
+		for (const auto& index : mesh->Indices)
+		{
+			indices.push_back(baseVertex + index);
+		}
 	}
 
 	for (unsigned int i = 0; i < node->Children.size(); ++i)
 	{
-		generateBtConvexShapeTraverse(node->Children[i], shape, scale);
+		collectCollisionGeometry(node->Children[i], vertices, indices);
 	}
 }
 
@@ -362,10 +566,12 @@ void CredibleModelData::DrawNode(
 	_In_ ConstantBuffer<AnimatedConstBuffer>* aCb,
 	CredibleNode* node, 
 	_In_ XMFLOAT4X4 worldTransform,
+	_In_ const CredibleModelPose& pose,
 	_In_ const vector<wstring>& disabledNodes,
-	_In_ map<ItemSlot, ID3D11ShaderResourceView*>& textureOverrides)
+	_In_ map<ItemSlot, ID3D11ShaderResourceView*>& textureOverrides,
+	_In_opt_ UINT lod /*= 0*/)
 {
-	XMFLOAT4X4 nodeGlobalTransform = node->GlobalTransform;
+	XMFLOAT4X4 nodeGlobalTransform = pose.GlobalTransforms[node->Index];
 	MathHelper::Transpose(nodeGlobalTransform);
 
 	DirectX::XMMATRIX nodeGlobalTransformWorld = XMLoadFloat4x4(&nodeGlobalTransform);
@@ -390,23 +596,12 @@ void CredibleModelData::DrawNode(
 			// Upload bone matrices
 			if (mesh->HasBones())
 			{
-				calculateGlobalBoneMatrices(node, mesh);
-				MUKASHIDEBUG_CRITICALERROR_ONFALSE(_globalBoneTransforms.size() == mesh->NumBones);
-
-				for (unsigned int a = 0; a < mesh->NumBones; a++)
-				{
-					XMFLOAT4X4& mat = _globalBoneTransforms[a];
-					MathHelper::Transpose(mat);
-
-					DirectX::XMFLOAT4X4 boneMatrix;
-					boneMatrix = mat;
-
-					XMMATRIX boneTransformMatrix = DirectX::XMLoadFloat4x4(&boneMatrix);
-					DirectX::XMStoreFloat4x4(
-						&aCb->Data.gBoneTransforms[a++],
-						DirectX::XMMatrixTranspose(boneTransformMatrix));
-				}
+				MUKASHIDEBUG_CRITICALERROR_ONFALSE(mesh->NumBones <= _countof(aCb->Data.gBoneTransforms));
+				UINT boneCount = min(mesh->NumBones, static_cast<UINT>(_countof(aCb->Data.gBoneTransforms)));
 
+				// The palette is evaluated once per pose rather than into the constant buffer, which every skinned
+				// draw overwrites, because one pose is drawn by every instance sharing it and outlives the frame
+				memcpy(aCb->Data.gBoneTransforms, &pose.BonePalettes[mesh->PaletteOffset], boneCount * sizeof(XMFLOAT4X4));
 				aCb->ApplyChanges(dc);
 			}
 
@@ -432,12 +627,14 @@ void CredibleModelData::DrawNode(
 				}
 			}
 
+			const CredibleMeshLod* meshLod = mesh->GetLod(lod);
+
 			UINT vOffset = 0;
 			dc->IASetVertexBuffers(0, 1, mesh->VB.GetAddressOf(), &_vertexStride, &vOffset);
-			dc->IASetIndexBuffer(mesh->IB.Get(), mesh->IndexBufferFormat, 0);
+			dc->IASetIndexBuffer(meshLod ? meshLod->IB.Get() : mesh->IB.Get(), mesh->IndexBufferFormat, 0);
 
 			dc->DrawIndexed(
-				mesh->IndexCount,
+				meshLod ? meshLod->IndexCount : mesh->IndexCount,
 				0,
 				0);
 		}
@@ -446,103 +643,327 @@ void CredibleModelData::DrawNode(
 	// render all child nodes
 	for (unsigned int i = 0; i < node->Children.size(); ++i)
 	{
-		DrawNode(dc, cb, aCb, node->Children[i], worldTransform, disabledNodes, textureOverrides);
+		DrawNode(dc, cb, aCb, node->Children[i], worldTransform, pose, disabledNodes, textureOverrides, lod);
 	}
 }
 
-void CredibleModelData::calculateGlobalBoneMatrices(
-	_In_ const CredibleNode* node,
-	_In_ const CredibleMesh* mesh)
+void CredibleModelData::AddToRenderBackend(_Inout_ RenderBackend& backend)
+{
+	RemoveFromRenderBackend();
+	_renderBackend = &backend;
+
+	for (const auto& node : Nodes)
+	{
+		for (auto& mesh : node->Meshes)
+		{
+			UINT indexSize = (mesh->IndexBufferFormat == DXGI_FORMAT_R16_UINT) ? 2 : 4;
+			mesh->RenderGeometry = backend.AddGeometry(mesh->VB.Get(), _vertexStride, mesh->IB.Get(), indexSize, mesh->MeshMaterial);
+			mesh->RenderTexture = backend.AddTexture(mesh->DiffuseTexture);
+
+			for (auto& meshLod : mesh->Lods)
+			{
+				meshLod.RenderGeometry = backend.AddGeometry(mesh->VB.Get(), _vertexStride, meshLod.IB.Get(), indexSize, mesh->MeshMaterial);
+			}
+		}
+	}
+}
+
+void CredibleModelData::RemoveFromRenderBackend()
 {
-	// resize array and initialize it with identity matrices
-	XMFLOAT4X4 identity;
-	XMStoreFloat4x4(&identity, XMMatrixIdentity());
-	_globalBoneTransforms.resize(mesh->NumBones, identity);
+	if (_renderBackend == nullptr)
+	{
+		return;
+	}
+
+	for (const auto& node : Nodes)
+	{
+		for (auto& mesh : node->Meshes)
+		{
+			_renderBackend->RemoveGeometry(mesh->RenderGeometry);
+			_renderBackend->RemoveTexture(mesh->RenderTexture);
+			mesh->RenderGeometry = 0;
+			mesh->RenderTexture = 0;
+
+			for (auto& meshLod : mesh->Lods)
+			{
+				_renderBackend->RemoveGeometry(meshLod.RenderGeometry);
+				meshLod.RenderGeometry = 0;
+			}
+		}
+	}
+
+	for (const auto& overrideTexture : _overrideTextureIds)
+	{
+		_renderBackend->RemoveTexture(overrideTexture.second);
+	}
+	_overrideTextureIds.clear();
+
+	_renderBackend = nullptr;
+}
+
+void CredibleModelData::Record(
+	_Inout_ RenderQueue& queue,
+	_Inout_ RenderBackend& backend,
+	_In_ UINT shader,
+	_In_ const XMFLOAT4X4& world,
+	_In_ const CredibleModelPose& pose,
+	_In_ const vector<wstring>& disabledNodes,
+	_In_ const map<ItemSlot, ID3D11ShaderResourceView*>& textureOverrides,
+	_In_opt_ const CullingFrustum* frustum /*= nullptr*/,
+	_In_opt_ UINT lod /*= 0*/) const
+{
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(&backend == _renderBackend);
+
+	//
+	// Turn the disabled names into node indices once instead of comparing names at every node
+	vector<bool> disabled;
+	if (!disabledNodes.empty())
+	{
+		disabled.assign(Nodes.size(), false);
+		for (const auto& name : disabledNodes)
+		{
+			auto range = _nodeIndicesByName.equal_range(name);
+			for (auto it = range.first; it != range.second; ++it)
+			{
+				disabled[it->second] = true;
+			}
+		}
+	}
+
+	XMMATRIX w = XMLoadFloat4x4(&world);
+
+	// The instance as a whole has already been culled, so only models made of several parts gain anything
+	bool cullNodes = frustum != nullptr && !_nodeBounds.empty() && Nodes.size() >= MinimumNodesToCull;
+
+	for (const auto& node : Nodes)
+	{
+		if (node->Meshes.empty() || (!disabled.empty() && disabled[node->Index]))
+		{
+			continue;
+		}
+
+		XMFLOAT4X4 nodeGlobalTransform = pose.GlobalTransforms[node->Index];
+		MathHelper::Transpose(nodeGlobalTransform);
+
+		XMFLOAT4X4 nodeWorld;
+		XMStoreFloat4x4(&nodeWorld, XMLoadFloat4x4(&nodeGlobalTransform) * w);
+
+		// Skinned meshes move away from their bounds, which are only right in the bind pose
+		bool skinned = false;
+		for (const auto& mesh : node->Meshes)
+		{
+			skinned = skinned || mesh->HasBones();
+		}
+
+		if (cullNodes && !skinned)
+		{
+			XMFLOAT3 center;
+			XMFLOAT3 extents;
+			transformBounds(_nodeBounds[node->Index], nodeWorld, center, extents);
+
+			if (!frustum->Intersects(center, extents))
+			{
+				continue;
+			}
+		}
 
-	// calculate the mesh's inverse global transform
-	XMFLOAT4X4 globalInverseMeshTransform = node->GlobalTransform;
-	MathHelper::Inverse(globalInverseMeshTransform);
+		UINT transform = queue.AddTransform(nodeWorld);
+
+		for (const auto& mesh : node->Meshes)
+		{
+			// Item slot textures replace the mesh's own when the instance overrides them
+			UINT texture = mesh->RenderTexture;
+			if (mesh->DiffuseTexture && !textureOverrides.empty())
+			{
+				auto slot = _textureMapping.find(mesh->DiffuseTexture);
+				auto textureOverride = textureOverrides.find((slot != _textureMapping.end()) ? slot->second : ItemSlot());
+				if (textureOverride != textureOverrides.end() && textureOverride->second)
+				{
+					// Added once per model rather than every frame, so the reference can be given back
+					auto added = _overrideTextureIds.find(textureOverride->second);
+					if (added == _overrideTextureIds.end())
+					{
+						added = _overrideTextureIds.emplace(textureOverride->second, backend.AddTexture(textureOverride->second)).first;
+					}
+					texture = added->second;
+				}
+			}
+
+			// Each level of detail is its own geometry, so instances at the same level still batch together
+			const CredibleMeshLod* meshLod = mesh->GetLod(lod);
+			UINT geometry = meshLod ? meshLod->RenderGeometry : mesh->RenderGeometry;
+			UINT indexCount = meshLod ? meshLod->IndexCount : mesh->IndexCount;
+
+			const XMFLOAT4X4* bonePalette = mesh->HasBones() ? &pose.BonePalettes[mesh->PaletteOffset] : nullptr;
+			queue.Add(shader, texture, geometry, indexCount, transform, bonePalette, mesh->NumBones);
+		}
+	}
+}
+
+void CredibleModelData::writeBonePalette(
+	_In_ const std::vector<XMFLOAT4X4>& globalTransforms,
+	_In_ const CredibleNode* node,
+	_In_ const CredibleMesh* mesh,
+	_Out_ XMFLOAT4X4* palette) const
+{
+	// The mesh's inverse global transform only has to be recomputed if its node moves with the animation
+	XMMATRIX inverseMeshTransform;
+	if (ModelSkeleton.IsAnimated(node->Index))
+	{
+		XMMATRIX meshTransform = XMLoadFloat4x4(&globalTransforms[node->Index]);
+		XMVECTOR determinant = XMMatrixDeterminant(meshTransform);
+		inverseMeshTransform = XMMatrixInverse(&determinant, meshTransform);
+	}
+	else
+	{
+		inverseMeshTransform = XMLoadFloat4x4(&_inverseBindGlobalTransforms[node->Index]);
+	}
 
 	// Bone matrices transform from mesh coordinates in bind pose to mesh coordinates in skinned pose
 	// Therefore the formula is offsetMatrix * currentGlobalTransform * inverseCurrentMeshTransform
-	for (size_t a = 0; a < mesh->NumBones; ++a)
+	for (UINT a = 0; a < mesh->NumBones; ++a)
 	{
-		const CredibleBone* bone = &mesh->Bones[a];
-		const XMFLOAT4X4& currentGlobalTransform = _boneNodesByName[bone->Name]->GlobalTransform;
+		const CredibleBone& bone = mesh->Bones[a];
 
-		XMMATRIX git = XMLoadFloat4x4(&globalInverseMeshTransform);
-		XMMATRIX cgt = XMLoadFloat4x4(&currentGlobalTransform);
-		XMMATRIX om = XMLoadFloat4x4(&bone->Offset);
+		XMMATRIX currentGlobalTransform = XMLoadFloat4x4(&globalTransforms[bone.NodeIndex]);
+		XMMATRIX offset = XMLoadFloat4x4(&bone.Offset);
 
-		XMMATRIX result = git * cgt * om;
-		XMStoreFloat4x4(&_globalBoneTransforms[a], result);
+		XMStoreFloat4x4(&palette[a], XMMatrixMultiply(XMMatrixMultiply(inverseMeshTransform, currentGlobalTransform), offset));
 	}
 }
 
-void CredibleModelData::UpdateTransforms(CredibleNode* node, const std::vector<XMFLOAT4X4>& transforms)
+void CredibleModelData::initializeSkeleton()
 {
-	// update node local transform
-	if (node->ChannelIndex != -1)
+	ModelSkeleton.Build(Nodes);
+
+	_nodeIndicesByName.clear();
+	for (const auto& node : Nodes)
 	{
-		node->LocalTransform = transforms[node->ChannelIndex];
+		_nodeIndicesByName.insert(std::make_pair(node->Name, node->Index));
 	}
 
-	// update global transform as well
-	CalculateGlobalTransform(node);
+	//
+	// Cache the inverse global transform of every node in the pose the model was loaded in
+	vector<XMFLOAT4X4> bindGlobalTransforms;
+	ModelSkeleton.Evaluate(vector<XMFLOAT4X4>(), bindGlobalTransforms);
 
-	// continue for all children
-	for (std::vector<CredibleNode*>::iterator it = node->Children.begin(); it != node->Children.end(); ++it)
+	_inverseBindGlobalTransforms.resize(bindGlobalTransforms.size());
+	for (size_t i = 0; i < bindGlobalTransforms.size(); ++i)
 	{
-		UpdateTransforms(*it, transforms);
+		XMMATRIX globalTransform = XMLoadFloat4x4(&bindGlobalTransforms[i]);
+		XMVECTOR determinant = XMMatrixDeterminant(globalTransform);
+		XMStoreFloat4x4(&_inverseBindGlobalTransforms[i], XMMatrixInverse(&determinant, globalTransform));
 	}
+
+	//
+	// Lay the bone palettes of the skinned meshes out back to back
+	_bonePaletteSize = 0;
+	for (const auto& node : Nodes)
+	{
+		for (auto& mesh : node->Meshes)
+		{
+			mesh->PaletteOffset = _bonePaletteSize;
+			_bonePaletteSize += mesh->NumBones;
+		}
+	}
+
+	EvaluatePose(vector<XMFLOAT4X4>(), _pose);
 }
 
-CredibleNode* CredibleModelData::readNodeTree(
-	_In_ byte* data, 
-	_In_ CredibleNode* parent, 
-	_Inout_ int& readerPosition,
-	_In_ ID3D11Device* device)
+void CredibleModelData::initializeLods()
 {
-	CredibleNode* ksmNode =  new CredibleNode(data, parent, readerPosition, device);
-
-	// Store in unique ptr to manage memory for this object
-	unique_ptr<CredibleNode> up;
-	up.reset(ksmNode);
-	Nodes.push_back(std::move(up));	
+	UINT lodCount = 1;
+	for (const auto& node : Nodes)
+	{
+		for (const auto& mesh : node->Meshes)
+		{
+			lodCount = max(lodCount, static_cast<UINT>(mesh->Lods.size()) + 1);
+		}
+	}
 
-	UINT childCount = DataReader::Read<INT>(data, readerPosition);
-	for (UINT c = 0; c < childCount; ++c)
+	//
+	// A level is only as good as its worst mesh, and never better than a finer level, so SelectLod can step
+	// through the levels in order
+	_lodErrors.assign(lodCount, 0.0f);
+	for (UINT l = 1; l < lodCount; ++l)
 	{
-		CredibleNode* child = readNodeTree(data, ksmNode, readerPosition, device);
-		ksmNode->Children.push_back(child);
+		_lodErrors[l] = _lodErrors[l - 1];
+		for (const auto& node : Nodes)
+		{
+			for (const auto& mesh : node->Meshes)
+			{
+				const CredibleMeshLod* meshLod = mesh->GetLod(l);
+				if (meshLod != nullptr)
+				{
+					_lodErrors[l] = max(_lodErrors[l], meshLod->Error);
+				}
+			}
+		}
 	}
+}
+
+void CredibleModelData::EvaluatePose(
+	_In_ const std::vector<XMFLOAT4X4>& transforms,
+	_Out_ CredibleModelPose& pose) const
+{
+	ModelSkeleton.Evaluate(transforms, pose.GlobalTransforms);
 
-	// Keep a pointer to all the meshes in the model for quick access
-	for (auto& mesh : ksmNode->Meshes)
+	pose.BonePalettes.resize(_bonePaletteSize);
+	for (const auto& node : Nodes)
 	{
-		_allMeshes.push_back(mesh.get());
+		for (const auto& mesh : node->Meshes)
+		{
+			if (mesh->HasBones())
+			{
+				writeBonePalette(pose.GlobalTransforms, node.get(), mesh.get(), &pose.BonePalettes[mesh->PaletteOffset]);
+			}
+		}
 	}
+}
 
-	return ksmNode;
+void CredibleModelData::UpdateTransforms(_In_ const std::vector<XMFLOAT4X4>& transforms)
+{
+	EvaluatePose(transforms, _pose);
 }
 
 void CredibleModelData::initializeFromKsm(
-	_In_ byte* data, 
-	_In_opt_ bool readSubsetAsInstanceType /*= false*/)
+	_In_ const KsmModelView& ksm,
+	_In_opt_ bool readSubsetAsInstanceType /*= false*/,
+	_In_opt_ bool keepCpuGeometry /*= true*/)
 {
 	UNREFERENCED_PARAMETER(readSubsetAsInstanceType);
-	int readerPos = 0;
 
 	// Read Global Data
-	_numMeshes = DataReader::Read<UINT>(data, readerPos);
-	_numMaterials = DataReader::Read<UINT>(data, readerPos);
-	_numTextures = DataReader::Read<UINT>(data, readerPos);
-	_numAnimations = DataReader::Read<UINT>(data, readerPos);
+	_numMeshes = ksm.NumMeshes;
+	_numMaterials = ksm.NumMaterials;
+	_numTextures = ksm.NumTextures;
+	_numAnimations = ksm.NumAnimations;
 
 	_hasAnimations = (_numAnimations > 0);
 
-	// Read in Node Tree
-	RootNode = readNodeTree(data, nullptr, readerPos, _device);
+	//
+	// Build the node tree. Nodes are listed parents first so every parent already exists when its
+	// children are created
+	Nodes.reserve(ksm.Nodes.size());
+	for (const auto& nodeView : ksm.Nodes)
+	{
+		CredibleNode* parent = (nodeView.Parent == KsmNone) ? nullptr : Nodes[nodeView.Parent].get();
+		Nodes.push_back(make_unique<CredibleNode>(nodeView, ksm.Meshes, parent, _device, keepCpuGeometry));
+		Nodes.back()->Index = static_cast<UINT>(Nodes.size() - 1);
+
+		if (parent)
+		{
+			parent->Children.push_back(Nodes.back().get());
+		}
+
+		// Keep a pointer to all the meshes in the model for quick access
+		for (auto& mesh : Nodes.back()->Meshes)
+		{
+			_allMeshes.push_back(mesh.get());
+		}
+	}
+
+	RootNode = Nodes.front().get();
 
 	if (_hasAnimations)
 	{
@@ -554,18 +975,17 @@ void CredibleModelData::initializeFromKsm(
 	}
 
 
-	for (unsigned int i = 0; i < _numMeshes; ++i)
+	for (size_t i = 0; i < _allMeshes.size(); ++i)
 	{
 		CredibleMesh* mesh = _allMeshes[i];
 
 		//
-		// Get all the bones that affect meshes (not all necessarily will). Storing them by name in a collection
-		// allows for quick access. These will be used when calculating the global transform (from bind pose to 
-		// skinned pose) since we'll need quick access to the node to get it's global transform
+		// Resolve the node of every bone that affects the mesh now so that building the bone matrices when
+		// drawing is only indexing, not looking nodes up by name
 		//
 		for (unsigned int n = 0; n < mesh->NumBones; ++n)
 		{
-			const CredibleBone* bone = &mesh->Bones[n];
+			CredibleBone* bone = &mesh->Bones[n];
 
 			auto found = std::find_if(Nodes.begin(), Nodes.end(), [&bone](const unique_ptr<CredibleNode>& node)->bool
 			{
@@ -573,52 +993,86 @@ void CredibleModelData::initializeFromKsm(
 			});
 			MUKASHIDEBUG_CRITICALERROR_ONFALSE(found != Nodes.end());
 
-			_boneNodesByName[bone->Name] = (*found).get();
+			bone->NodeIndex = (found != Nodes.end()) ? (*found)->Index : RootNode->Index;
+		}
+	}
+
+	initializeSkeleton();
+	initializeLods();
+
+	//
+	// Merge the bounds of each node's meshes so Record can cull the node with one test
+	_nodeBounds.assign(Nodes.size(), BoundingBox());
+	for (const auto& node : Nodes)
+	{
+		for (size_t m = 0; m < node->Meshes.size(); ++m)
+		{
+			const BoundingBox& meshBounds = node->Meshes[m]->MeshBoundingBox;
+			if (m == 0)
+			{
+				_nodeBounds[node->Index] = meshBounds;
+			}
+			else
+			{
+				BoundingBox::CreateMerged(_nodeBounds[node->Index], _nodeBounds[node->Index], meshBounds);
+			}
 		}
 	}
 
 
 	// Read in Animations
-	for (UINT a = 0; a < _numAnimations; ++a)
+	for (const auto& animationView : ksm.Animations)
 	{
 		AnimationClip animationClip;
 
-		// Read in the animation name		
-		animationClip.Name = DataReader::ReadString<wchar_t, UINT>(data, readerPos);
-		animationClip.Duration = DataReader::Read<float>(data, readerPos);
-		animationClip.TicksPerSecond = DataReader::Read<float>(data, readerPos);
+		animationClip.Name = animationView.Name;
+		animationClip.Duration = animationView.Duration;
+		animationClip.TicksPerSecond = animationView.TicksPerSecond;
+
+		animationClip.TotalFrames = animationView.TotalFrames;
 
-		UINT boneAnimationCount = DataReader::Read<UINT>(data, readerPos);
+		_animationNames.push_back(animationView.Name);
 
-		for (UINT b = 0; b < boneAnimationCount; ++b)
+		//
+		// Clips the pipeline compressed are played back from the compressed data, so their keyframes aren't kept.
+		// The file keeps the keyframes as well, so a clip that can't be read is played back from those instead
+		if (animationView.Clip != nullptr)
 		{
-			BoneAnimation boneAnimation;
+			CompressedClip compressedClip;
+			if (compressedClip.Read(animationView.Name, animationView.Clip, animationView.ClipSize))
+			{
+				CompressedClips.push_back(std::move(compressedClip));
+				ModelAnimationData.AddAnimationClip(animationClip);
+				continue;
+			}
+		}
 
-			UINT keyFrameCount = DataReader::Read<UINT>(data, readerPos);
+		animationClip.BoneAnimations.resize(animationView.Tracks.size());
+		for (size_t b = 0; b < animationView.Tracks.size(); ++b)
+		{
+			const KsmTrackView& track = animationView.Tracks[b];
+			BoneAnimation& boneAnimation = animationClip.BoneAnimations[b];
 
-			for (UINT k = 0; k < keyFrameCount; ++k)
+			boneAnimation.Keyframes.resize(track.KeyframeCount);
+			for (UINT k = 0; k < track.KeyframeCount; ++k)
 			{
-				Keyframe keyframe;
-				keyframe.Translation	= DataReader::Read<XMFLOAT3>(data, readerPos);
-				keyframe.Scale			= DataReader::Read<XMFLOAT3>(data, readerPos);
-				keyframe.RotationQuat	= DataReader::Read<XMFLOAT4>(data, readerPos);
-				keyframe.TimePos		= DataReader::Read<float>(data, readerPos);
+				KsmKeyframe keyframeView = KsmReader::ReadKeyframe(track, k);
 
-				boneAnimation.Keyframes.push_back(keyframe);
+				Keyframe& keyframe = boneAnimation.Keyframes[k];
+				keyframe.Translation	= keyframeView.Translation;
+				keyframe.Scale			= keyframeView.Scale;
+				keyframe.RotationQuat	= keyframeView.RotationQuat;
+				keyframe.TimePos		= keyframeView.TimePos;
 			}
-
-			animationClip.BoneAnimations.push_back(boneAnimation);
 		}
 
-		animationClip.TotalFrames = DataReader::Read<UINT>(data, readerPos);
-
 		ModelAnimationData.AddAnimationClip(animationClip);
 	}
 
 	//
 	// Read in bounding box data
-	_boundingBox.Center = DataReader::Read<XMFLOAT3>(data, readerPos);
-	_boundingBox.Extents = DataReader::Read<XMFLOAT3>(data, readerPos);
+	_boundingBox.Center = ksm.BoundsCenter;
+	_boundingBox.Extents = ksm.BoundsExtents;
 }
 
 void CredibleModelData::SetTextureMapping(
@@ -634,175 +1088,205 @@ void CredibleModelData::SetTextureMapping(
 	}
 }
 
+size_t CredibleModelData::GetResidentBytes() const
+{
+	size_t bytes = 0;
+
+	for (const auto& mesh : _allMeshes)
+	{
+		UINT indexSize = (mesh->IndexBufferFormat == DXGI_FORMAT_R16_UINT) ? sizeof(USHORT) : sizeof(UINT);
+
+		bytes += (size_t)mesh->VertexCount * _vertexStride;
+		bytes += (size_t)mesh->IndexCount * indexSize;
+		for (const auto& meshLod : mesh->Lods)
+		{
+			bytes += (size_t)meshLod.IndexCount * indexSize;
+		}
+		bytes += mesh->PositionalVertices.capacity() * sizeof(XMFLOAT3);
+		bytes += mesh->Indices.capacity() * sizeof(UINT);
+		bytes += mesh->Bvh.GetMemoryUsage();
+	}
+
+	for (const auto& clip : CompressedClips)
+	{
+		bytes += clip.GetMemoryUsage();
+	}
+
+	return bytes;
+}
+
+const CompressedClip* CredibleModelData::FindCompressedClip(
+	_In_ const wstring& name) const
+{
+	for (const auto& clip : CompressedClips)
+	{
+		if (clip.GetName() == name)
+		{
+			return &clip;
+		}
+	}
+
+	return nullptr;
+}
+
+UINT CredibleModelData::FindAnimation(
+	_In_ const wstring& name) const
+{
+	auto found = find(_animationNames.begin(), _animationNames.end(), name);
+	return (found != _animationNames.end()) ? static_cast<UINT>(found - _animationNames.begin()) : NoAnimation;
+}
+
 CredibleNode::CredibleNode(
-	_In_ byte* data,
+	_In_ const KsmNodeView& nodeView,
+	_In_ const vector<KsmMeshView>& meshViews,
 	_In_ CredibleNode* parent,
-	_Inout_ int& readerPosition,
-	_In_ ID3D11Device* device)
+	_In_ ID3D11Device* device,
+	_In_opt_ bool keepCpuGeometry /*= true*/)
 	: CredibleNode()
 {
-	Name = DataReader::ReadString<wchar_t, UINT>(data, readerPosition);
-	LocalTransform = DataReader::Read<XMFLOAT4X4>(data, readerPosition);
+	Name = nodeView.Name;
+	LocalTransform = nodeView.LocalTransform;
 
 	// Calculate the global transform
 	Parent = parent;
 	CredibleModelData::CalculateGlobalTransform(this);
 
-	ChannelIndex = DataReader::Read<size_t>(data, readerPosition);
+	ChannelIndex = (nodeView.ChannelIndex == KsmNone) ? (size_t)-1 : nodeView.ChannelIndex;
 
-	UINT meshCount = DataReader::Read<INT>(data, readerPosition);
-	for (UINT m = 0; m < meshCount; ++m)
+	Meshes.reserve(nodeView.MeshCount);
+	for (UINT m = 0; m < nodeView.MeshCount; ++m)
 	{
-		Meshes.push_back(make_unique<CredibleMesh>(data, readerPosition, device));
+		Meshes.push_back(make_unique<CredibleMesh>(meshViews[nodeView.FirstMesh + m], device, keepCpuGeometry));
 	}
 }
 
 CredibleMesh::CredibleMesh(
-	_In_ byte* data,
-	_Inout_ int& readerPosition,
-	_In_ ID3D11Device* device)
+	_In_ const KsmMeshView& view,
+	_In_ ID3D11Device* device,
+	_In_opt_ bool keepCpuGeometry /*= true*/)
+	: CredibleMesh()
 {
-	NumBones = DataReader::Read<UINT>(data, readerPosition);
-	FaceCount = DataReader::Read<UINT>(data, readerPosition);
-	VertexCount = DataReader::Read<UINT>(data, readerPosition);
-	IndexCount = DataReader::Read<UINT>(data, readerPosition);
-
-	MeshMaterial.Diffuse = DataReader::Read<XMFLOAT4>(data, readerPosition);
-	MeshMaterial.Ambient = DataReader::Read<XMFLOAT4>(data, readerPosition);
-	MeshMaterial.Reflect = DataReader::Read<XMFLOAT4>(data, readerPosition);
-	MeshMaterial.Specular = DataReader::Read<XMFLOAT4>(data, readerPosition);
+	NumBones = view.NumBones;
+	FaceCount = view.FaceCount;
+	VertexCount = view.VertexCount;
+	IndexCount = view.IndexCount;
 
-	MaterialOpacity = DataReader::Read<float>(data, readerPosition);
-	MaterialShininess = DataReader::Read<float>(data, readerPosition);
-	SpecularStrength = DataReader::Read<float>(data, readerPosition);
+	MeshMaterial.Diffuse = view.Diffuse;
+	MeshMaterial.Ambient = view.Ambient;
+	MeshMaterial.Reflect = view.Reflect;
+	MeshMaterial.Specular = view.Specular;
 
-	bool indicesAre16Bit = DataReader::Read<bool>(data, readerPosition);
-	//indicesAre16Bit = indicesAre16Bit;
+	MaterialOpacity = view.Opacity;
+	MaterialShininess = view.Shininess;
+	SpecularStrength = view.SpecularStrength;
 
 	D3D11_BUFFER_DESC bufferDesc;
-	D3D11_SUBRESOURCE_DATA resourceData;
+	D3D11_SUBRESOURCE_DATA resourceData = {};
 	bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;	
 	bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 	bufferDesc.CPUAccessFlags = 0;
 	bufferDesc.MiscFlags = 0;
 	bufferDesc.StructureByteStride = 0;
 
-	UINT* iPtr = DataReader::ReadArray<UINT>(data, IndexCount, readerPosition);
 	HRESULT hr;
-	if (indicesAre16Bit)
-	{
-		IndexBufferFormat = DXGI_FORMAT_R16_UINT;
-		vector<USHORT> indices;
 
-		for (UINT i = 0; i < IndexCount; ++i)
-		{
-			indices.push_back(static_cast<USHORT>(iPtr[i]));
-			Indices.push_back(iPtr[i]);
-		}
+	// Index buffers are created straight from the file data, except for v1 files which store 16 bit
+	// indices widened to 32 bits. Those need a narrowed copy
+	vector<USHORT> narrowIndices;
+	IndexBufferFormat = view.IndicesAre16Bit ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	resourceData.pSysMem = view.IndexData;
 
-		bufferDesc.ByteWidth = sizeof(USHORT) * (UINT)indices.size();
-		resourceData.pSysMem = &indices[0];
-
-		hr = device->CreateBuffer(&bufferDesc, &resourceData, &IB);
-		MUKASHIDEBUG_CRITICALERROR_ONFAILED(hr);
-	}
-	else
+	if (view.IndicesAre16Bit && view.IndexSize != sizeof(USHORT))
 	{
-		IndexBufferFormat = DXGI_FORMAT_R32_UINT;
-		vector<UINT> indices;
-
+		narrowIndices.resize(IndexCount);
 		for (UINT i = 0; i < IndexCount; ++i)
 		{
-			indices.push_back(iPtr[i]);
-			Indices.push_back(iPtr[i]);
+			narrowIndices[i] = static_cast<USHORT>(view.GetIndex(i));
 		}
 
-		bufferDesc.ByteWidth = sizeof(UINT) * (UINT)indices.size();
-		resourceData.pSysMem = &indices[0];
+		resourceData.pSysMem = narrowIndices.data();
+	}
+
+	bufferDesc.ByteWidth = (UINT)(view.IndicesAre16Bit ? sizeof(USHORT) : sizeof(UINT)) * IndexCount;
 
+	if (IndexCount > 0)
+	{
 		hr = device->CreateBuffer(&bufferDesc, &resourceData, &IB);
 		MUKASHIDEBUG_CRITICALERROR_ONFAILED(hr);
 	}
 
-	bool containsAnimations = DataReader::Read<bool>(data, readerPosition);
-
-	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	UINT vertexStride = 0;
-	
-
-	if (containsAnimations)
+	// Levels of detail only come from v2 files, which store indices in the size the buffer takes
+	Lods.resize(view.Lods.size());
+	for (size_t l = 0; l < view.Lods.size(); ++l)
 	{
-		vector<VertexPositionNormalTextureBoneWeight> vertices;
+		CredibleMeshLod& lod = Lods[l];
+		lod.IndexCount = view.Lods[l].IndexCount;
+		lod.Error = view.Lods[l].Error;
 
-		VertexPositionNormalTextureBoneWeight* vPtr = DataReader::ReadArray<VertexPositionNormalTextureBoneWeight>(data, VertexCount, readerPosition);
-		for (UINT i = 0; i < VertexCount; ++i)
+		bufferDesc.ByteWidth = view.IndexSize * lod.IndexCount;
+		resourceData.pSysMem = view.Lods[l].IndexData;
+
+		if (lod.IndexCount > 0)
 		{
-			vertices.push_back(vPtr[i]);
-			PositionalVertices.push_back(vPtr[i].position);
+			hr = device->CreateBuffer(&bufferDesc, &resourceData, &lod.IB);
+			MUKASHIDEBUG_CRITICALERROR_ONFAILED(hr);
 		}
+	}
 
-		vertexStride = sizeof(VertexPositionNormalTextureBoneWeight);
-		resourceData.pSysMem = &vertices[0];
-
-		bufferDesc.ByteWidth = vertexStride * VertexCount;
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	bufferDesc.ByteWidth = view.VertexStride * VertexCount;
+	resourceData.pSysMem = view.Vertices;
 
+	if (VertexCount > 0)
+	{
 		hr = device->CreateBuffer(&bufferDesc, &resourceData, &VB);
 		MUKASHIDEBUG_CRITICALERROR_ONFAILED(hr);
 	}
-	else
-	{
-		vector<VertexPositionNormalTexture> vertices;
 
-		VertexPositionNormalTexture* vPtr = DataReader::ReadArray<VertexPositionNormalTexture>(data, VertexCount, readerPosition);
-		for (UINT i = 0; i < VertexCount; ++i)
+	if (keepCpuGeometry)
+	{
+		Indices.resize(IndexCount);
+		for (UINT i = 0; i < IndexCount; ++i)
 		{
-			vertices.push_back(vPtr[i]);
-			PositionalVertices.push_back(vPtr[i].position);
+			Indices[i] = view.GetIndex(i);
 		}
 
-		vertexStride = sizeof(VertexPositionNormalTexture);
-		resourceData.pSysMem = &vertices[0];
+		KsmReader::ReadPositions(view, PositionalVertices);
 
-		bufferDesc.ByteWidth = vertexStride * VertexCount;
-
-		hr = device->CreateBuffer(&bufferDesc, &resourceData, &VB);
-		MUKASHIDEBUG_CRITICALERROR_ONFAILED(hr);
+		Bvh.Build(PositionalVertices, Indices);
 	}
 
 	//
 	// Load Textures
-	wstring diffusePath = DataReader::ReadString<wchar_t, UINT>(data, readerPosition);
-	if (!diffusePath.empty())
+	if (!view.DiffusePath.empty())
 	{
-		DiffuseTexture = AssetManager::Instance()->GetTexture(diffusePath);
+		DiffuseTextureHandle = AssetManager::Instance()->AcquireTexture(view.DiffusePath);
+		DiffuseTexture = DiffuseTextureHandle.IsValid() ? DiffuseTextureHandle.Get().Get() : nullptr;
 
 		// Store the name of the default texture
-		PathString defaultTextureName(diffusePath.c_str());
+		PathString defaultTextureName(view.DiffusePath.c_str());
 		DefaultDiffuseTextureName = defaultTextureName.GetFullFileName();
 	}
 
-	wstring normalPath = DataReader::ReadString<wchar_t, UINT>(data, readerPosition);
-	if (!normalPath.empty())
+	if (!view.NormalPath.empty())
 	{
-		NormalTexture = AssetManager::Instance()->GetTexture(normalPath);
+		NormalTextureHandle = AssetManager::Instance()->AcquireTexture(view.NormalPath);
+		NormalTexture = NormalTextureHandle.IsValid() ? NormalTextureHandle.Get().Get() : nullptr;
 	}
 
 	//
 	// Load Bones
+	Bones.resize(NumBones);
 	for (UINT b = 0; b < NumBones; ++b)
 	{
-		CredibleBone bone;
-		
-		bone.Name = DataReader::ReadString<wchar_t, UINT>(data, readerPosition);
-		bone.Offset = DataReader::Read<XMFLOAT4X4>(data, readerPosition);
-
-		Bones.push_back(bone);
+		Bones[b].Name = view.Bones[b].Name;
+		Bones[b].Offset = view.Bones[b].Offset;
 	}
 
 	//
 	// Load Mesh BoundingBox
-	MeshBoundingBox.Center = DataReader::Read<XMFLOAT3>(data, readerPosition);
-	MeshBoundingBox.Extents = DataReader::Read<XMFLOAT3>(data, readerPosition);
+	MeshBoundingBox.Center = view.BoundsCenter;
+	MeshBoundingBox.Extents = view.BoundsExtents;
 }
 
 CredibleMesh::CredibleMesh(
@@ -810,6 +1294,7 @@ CredibleMesh::CredibleMesh(
 	_In_ ID3D11ShaderResourceView* diffuseTexture,
 	_In_ ID3D11ShaderResourceView* normalTexture,
 	_In_ ID3D11Device* device)
+	: CredibleMesh()
 {
 	NumBones = 0;
 	FaceCount = meshData.Indices.size() / 3;
@@ -877,6 +1362,8 @@ CredibleMesh::CredibleMesh(
 		PositionalVertices.push_back(vertex.position);
 	}
 
+	Bvh.Build(PositionalVertices, Indices);
+
 	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
 	UINT vertexStride = 0;
 	vertexStride = sizeof(VertexPositionNormalTexture);
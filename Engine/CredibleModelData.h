@@ -15,7 +15,15 @@
 #include "AnimationData.h"
 #include "InstanceSaveTypes.h"
 #include "ConstantBuffer.h"
-#include "Bullet\src\BulletCollision\CollisionShapes\btShapeHull.h"
+#include "KsmReader.h"
+#include "AssetCaches.h"
+#include "MeshBvh.h"
+#include "Skeleton.h"
+#include "RenderQueue.h"
+#include "SceneCuller.h"
+#include "CompressedClip.h"
+#include "CredibleModelPose.h"
+#include "CollisionGeometry.h"
 
 using namespace DirectX;
 using namespace Microsoft::WRL;
@@ -30,8 +38,58 @@ namespace Engine
 	//
 	struct CredibleBone
 	{
+		CredibleBone() :
+			NodeIndex(0)
+		{}
+
 		wstring Name;
 		XMFLOAT4X4 Offset;
+
+		// Index of the node named Name, resolved when the model is loaded
+		UINT NodeIndex;
+	};
+
+	//
+	// A coarser level of detail of a mesh, drawn from the mesh's own vertex buffer with its own indices
+	//
+	struct CredibleMeshLod
+	{
+		CredibleMeshLod() :
+			IndexCount(0), Error(0.0f), RenderGeometry(0)
+		{}
+
+		ComPtr<ID3D11Buffer> IB;
+		UINT IndexCount;
+
+		// The largest distance, in model units, this level's surface may be from the full mesh's
+		float Error;
+
+		// The id the render backend gave the vertex buffer with this level's index buffer
+		UINT RenderGeometry;
+	};
+
+	//
+	// Where to look from when picking levels of detail, and how much they may show. See
+	// CredibleModelData::SelectLod
+	//
+	struct LodSelection
+	{
+		LodSelection() :
+			EyePosition(0.0f, 0.0f, 0.0f), ProjectionScale(1.0f), PixelError(1.0f), Hysteresis(0.15f)
+		{}
+
+		XMFLOAT3 EyePosition;
+
+		// Pixels a world unit covers one unit in front of the eye: the viewport height over
+		// 2 * tan(fovY / 2)
+		float ProjectionScale;
+
+		// The error, in pixels on screen, a level of detail may show
+		float PixelError;
+
+		// How far past the size at which a level becomes right, as a fraction of that size, a model has to
+		// get before it changes level. Keeps models at the edge of a threshold from flickering between levels
+		float Hysteresis;
 	};
 
 	//
@@ -42,13 +100,19 @@ namespace Engine
 		CredibleMesh() :
 			VertexCount(0), FaceCount(0), IndexCount(0), DiffuseTexture(nullptr), NormalTexture(nullptr),
 			Instance(INSTANCE_TYPE_BEGIN), VB(nullptr), IB(nullptr), NumBones(0), MaterialOpacity(0),
-			MaterialShininess(0), SpecularStrength(0), IndexBufferFormat(DXGI_FORMAT_R32_UINT)
+			MaterialShininess(0), SpecularStrength(0), IndexBufferFormat(DXGI_FORMAT_R32_UINT), PaletteOffset(0),
+			RenderGeometry(0), RenderTexture(0)
 		{}
 
+		//
+		// Creates a mesh from KSM data. The index and vertex buffers are created straight from the
+		// data the view points to; the CPU side copies (Indices and PositionalVertices) are only kept
+		// if asked for
+		//
 		CredibleMesh(
-			_In_ byte* data,
-			_Inout_ int& readerPosition,
-			_In_ ID3D11Device* device);
+			_In_ const KsmMeshView& meshView,
+			_In_ ID3D11Device* device,
+			_In_opt_ bool keepCpuGeometry = true);
 
 		CredibleMesh(
 			_In_ GeometryGenerator::MeshData& meshData,
@@ -56,6 +120,20 @@ namespace Engine
 			_In_ ID3D11ShaderResourceView* normalTexture,
 			_In_ ID3D11Device* device);
 
+		//
+		// Returns the level of detail to draw for the model's level lod, null for the full resolution mesh.
+		// Meshes with fewer levels than the model draw their coarsest one
+		//
+		const CredibleMeshLod* GetLod(_In_ UINT lod) const
+		{
+			if (lod == 0 || Lods.empty())
+			{
+				return nullptr;
+			}
+
+			return &Lods[min(lod, static_cast<UINT>(Lods.size())) - 1];
+		}
+
 		//
 		// Returns bool indicating if this mesh's vertices are associated with (affected by) any bones
 		//
@@ -101,6 +179,11 @@ namespace Engine
 		// The normal texture for this mesh
 		ID3D11ShaderResourceView* NormalTexture;
 
+		// Keep DiffuseTexture and NormalTexture resident for as long as the mesh exists. Empty for
+		// meshes whose textures were passed in rather than loaded
+		TextureHandle DiffuseTextureHandle;
+		TextureHandle NormalTextureHandle;
+
 		// The material for this node
 		Material MeshMaterial;
 
@@ -128,20 +211,34 @@ namespace Engine
 		// The names of the bone nodes that affect this mesh
 		vector<CredibleBone> Bones;
 
+		// Where this mesh's NumBones skinning matrices start in CredibleModelPose::BonePalettes
+		UINT PaletteOffset;
+
+		// The ids the render backend gave the mesh's buffers and diffuse texture, see
+		// CredibleModelData::AddToRenderBackend
+		UINT RenderGeometry;
+		UINT RenderTexture;
+
 		// The format for the index buffer
 		DXGI_FORMAT IndexBufferFormat;
 
 		// Holds only the position coords for every mesh in this model; useful for sharing only the 
-		// positional data for ray intersection checking. Not used for drawing
+		// positional data for ray intersection checking. Not used for drawing. Empty if the model
+		// was loaded without CPU geometry
 		std::vector<XMFLOAT3> PositionalVertices;
 
-		// Used when detecting intersections on polygons
+		// Used when detecting intersections on polygons. Empty if the model was loaded without CPU geometry
 		std::vector<UINT> Indices;
 
+		// Hierarchy over the triangles in Indices/PositionalVertices for ray queries, in the mesh's own space.
+		// Empty if the model was loaded without CPU geometry
+		MeshBvh Bvh;
+
 		// The bounding box surrounding the vertices in this mesh
 		BoundingBox MeshBoundingBox;
 
-		vector<XMFLOAT3> translatedVertices;
+		// Coarser levels of detail, finest first. Empty unless the KSM file has them
+		vector<CredibleMeshLod> Lods;
 	};
 
 	//
@@ -153,17 +250,18 @@ namespace Engine
 	struct CredibleNode
 	{
 		CredibleNode() :
-			Parent(nullptr), ChannelIndex((size_t)-1), Enabled(true)
+			Parent(nullptr), ChannelIndex((size_t)-1), Enabled(true), Index(0)
 		{
 			XMStoreFloat4x4(&LocalTransform, XMMatrixIdentity());
 			XMStoreFloat4x4(&GlobalTransform, XMMatrixIdentity());
 		}
 
 		CredibleNode(
-			_In_ byte* data,
+			_In_ const KsmNodeView& nodeView,
+			_In_ const vector<KsmMeshView>& meshViews,
 			_In_ CredibleNode* parent,
-			_Inout_ int& readerPosition,
-			_In_ ID3D11Device* device);
+			_In_ ID3D11Device* device,
+			_In_opt_ bool keepCpuGeometry = true);
 
 		CredibleNode(const wstring& name)
 			: CredibleNode()
@@ -186,7 +284,8 @@ namespace Engine
 		// Most recently calculated local transform
 		XMFLOAT4X4 LocalTransform;
 
-		// Most recently calculated global transform. This includes the local bone transform if applicable
+		// The global transform in the pose the model was loaded in. The node is shared by every instance of
+		// the model, so animated poses are kept in a CredibleModelPose instead
 		XMFLOAT4X4 GlobalTransform;
 
 		// The meshes associated with this node
@@ -194,27 +293,67 @@ namespace Engine
 
 		// Index in the current animation's channel array. -1 if not animated.
 		size_t ChannelIndex;
+
+		// Position of this node in the model's Nodes, and in its skeleton's arrays
+		UINT Index;
+	};
+
+	//
+	// The nearest triangle of a model a ray hits
+	//
+	struct CredibleModelHit
+	{
+		// Distance along the ray in units of the ray direction's length. Transforming the ray doesn't change
+		// it, so hits on different meshes and models compare directly and the hit point is origin + T * direction
+		float T;
+
+		// Barycentric coordinates of the hit point on the triangle
+		float U;
+		float V;
+
+		// Index of the triangle in the mesh's index list
+		UINT Triangle;
+
+		// The node and mesh the triangle belongs to
+		const CredibleNode* Node;
+		const CredibleMesh* Mesh;
 	};
 
-	class CredibleModelData
+	class CredibleModelData : public PoseEvaluator, public CollisionGeometry
 	{
 
 	public:
 
 		CredibleModelData()
+			: RootNode(nullptr), _bonePaletteSize(0), _renderBackend(nullptr)
 		{}
 
 		CredibleModelData(_In_ ID3D11Device* device)
-			: _device(device), _animationTimer(0)
+			: RootNode(nullptr), _device(device), _bonePaletteSize(0), _animationTimer(0), _renderBackend(nullptr)
 		{}
 
 		//
-		// Creates a CredibleModelData object by loading it from a stream of bytes
+		// Creates a CredibleModelData object by loading it from the contents of a v1 or v2 KSM file. The
+		// data only needs to stay valid for the duration of the call. Pass keepCpuGeometry = false for models
+		// that are never picked or used for collision to skip keeping a CPU copy of their indices and
+		// positions. If the data is malformed the model is left empty, see IsLoaded()
 		//
 		CredibleModelData(
 			_In_ byte* data,
+			_In_ size_t size,
+			_In_ ID3D11Device* device,
+			_In_opt_ bool readSubsetAsInstanceType = false,
+			_In_opt_ bool keepCpuGeometry = true);
+
+		//
+		// Creates a CredibleModelData object from a KSM file that has already been read (e.g. on a loader
+		// thread). The data the view points to only needs to stay valid for the duration of the call
+		//
+		CredibleModelData(
+			_In_ const KsmModelView& ksm,
 			_In_ ID3D11Device* device,
-			_In_opt_ bool readSubsetAsInstanceType = false);
+			_In_opt_ bool readSubsetAsInstanceType = false,
+			_In_opt_ bool keepCpuGeometry = true);
 
 		//
 		// Creates a CredibleModelData object by reading the data it needs from a 
@@ -243,6 +382,44 @@ namespace Engine
 		//
 		CredibleModelData& operator=(CredibleModelData&& rhs);
 
+		//
+		// Returns bool indicating if the model was loaded successfully
+		//
+		bool IsLoaded() const
+		{
+			return RootNode != nullptr;
+		}
+
+		//
+		// Returns the number of bytes the model keeps resident: its vertex and index buffers and any CPU
+		// side geometry and its compressed animation clips. Textures are shared between models and
+		// accounted for by the AssetManager
+		//
+		size_t GetResidentBytes() const;
+
+		//
+		// FullName:  Engine::CredibleModelData::FindCompressedClip
+		// Returns the compressed form of the named animation, null if the model was loaded without one.
+		// Animations that have one keep no keyframes in ModelAnimationData
+		//
+		const CompressedClip* FindCompressedClip(
+			_In_ const wstring& name) const;
+
+		static const UINT NoAnimation = 0xFFFFFFFF;
+
+		//
+		// FullName:  Engine::CredibleModelData::FindAnimation
+		// Returns the index of the named animation among the model's animations in the order they were
+		// loaded, or NoAnimation. PoseCache and AnimationStage tell a model's clips apart by it
+		//
+		UINT FindAnimation(
+			_In_ const wstring& name) const;
+
+		//
+		// The size of the vertex records in KSM files, for reading them with KsmReader
+		//
+		static const KsmVertexStrides KsmEngineVertexStrides;
+
 		//
 		// Returns if this model contains animation data or not
 		//
@@ -261,7 +438,23 @@ namespace Engine
 			_In_ XMFLOAT4X4 world,
 			_In_ const std::vector<XMFLOAT4X4>& localBoneTransforms,
 			_In_ const vector<wstring>& disabledNodes,
-			_In_ map<ItemSlot, ID3D11ShaderResourceView*>& textureOverrides);
+			_In_ map<ItemSlot, ID3D11ShaderResourceView*>& textureOverrides,
+			_In_opt_ UINT lod = 0);
+
+		//
+		// Draws one instance of the model in a pose evaluated with EvaluatePose. The model's own pose is left
+		// alone, so any number of instances can be drawn in different poses. lod is the level of detail to
+		// draw, see SelectLod
+		//
+		void Draw(
+			_In_ ID3D11DeviceContext* dc,
+			_In_ ConstantBuffer<ObjectConstBuffer>* cb,
+			_In_ ConstantBuffer<AnimatedConstBuffer>* aCb,
+			_In_ XMFLOAT4X4 world,
+			_In_ const CredibleModelPose& pose,
+			_In_ const vector<wstring>& disabledNodes,
+			_In_ map<ItemSlot, ID3D11ShaderResourceView*>& textureOverrides,
+			_In_opt_ UINT lod = 0);
 
 		void DrawNode(
 			_In_ ID3D11DeviceContext* dc,
@@ -269,15 +462,76 @@ namespace Engine
 			_In_ ConstantBuffer<AnimatedConstBuffer>* aCb,
 			CredibleNode* node,
 			_In_ XMFLOAT4X4 localBoneTransforms,
+			_In_ const CredibleModelPose& pose,
 			_In_ const vector<wstring>& disabledNodes,
-			_In_ map<ItemSlot, ID3D11ShaderResourceView*>& textureOverrides);
+			_In_ map<ItemSlot, ID3D11ShaderResourceView*>& textureOverrides,
+			_In_opt_ UINT lod = 0);
+
+		//
+		// Returns the number of levels of detail the model can be drawn at, 1 if it only has its full
+		// resolution meshes
+		//
+		UINT GetLodCount() const
+		{
+			return static_cast<UINT>(_lodErrors.size());
+		}
 
+		//
+		// FullName:  Engine::CredibleModelData::SelectLod
+		// Returns the coarsest level of detail whose error, scaled to the size the model's bounding box
+		// projects to on screen, stays within selection.PixelError. currentLod is the level the instance was
+		// drawn at last; the level only changes once the projected size is a Hysteresis margin past the
+		// threshold, so keep it per instance
+		//
+		UINT SelectLod(
+			_In_ const LodSelection& selection,
+			_In_ const XMFLOAT4X4& world,
+			_In_ UINT currentLod) const;
+
+		//
+		// FullName:  Engine::CredibleModelData::AddToRenderBackend
+		// Adds the buffers and textures of every mesh to the backend so the model can be recorded into a
+		// RenderQueue. Call once after loading, with the backend Record will be used with, which has to
+		// outlive the model. A model that is evicted and loaded again is a new model and has to be added again
+		//
+		void AddToRenderBackend(_Inout_ RenderBackend& backend);
+
+		//
+		// FullName:  Engine::CredibleModelData::RemoveFromRenderBackend
+		// Removes everything AddToRenderBackend and Record added to the backend. Done by the destructor, so
+		// only needed to move the model to another backend
+		//
+		void RemoveFromRenderBackend();
+
+		//
+		// FullName:  Engine::CredibleModelData::Record
+		// Records the draws the Draw overload taking a pose would issue into the queue instead, to be sorted
+		// by state and submitted once the whole scene is recorded. The pose has to stay valid until then, and
+		// backend has to be the one the model was added to. Given a frustum, the nodes of models with several
+		// nodes are culled by their meshes' bounds. Meshes are recorded at level of detail lod
+		//
+		void Record(
+			_Inout_ RenderQueue& queue,
+			_Inout_ RenderBackend& backend,
+			_In_ UINT shader,
+			_In_ const XMFLOAT4X4& world,
+			_In_ const CredibleModelPose& pose,
+			_In_ const vector<wstring>& disabledNodes,
+			_In_ const map<ItemSlot, ID3D11ShaderResourceView*>& textureOverrides,
+			_In_opt_ const CullingFrustum* frustum = nullptr,
+			_In_opt_ UINT lod = 0) const;
+
+		//
+		// Draws count instances of the mesh at level of detail lod. Instances that need different levels
+		// have to be drawn in separate batches
+		//
 		void DrawInstancedNode(
 			_In_ ID3D11DeviceContext* dc,
 			_In_ ID3D11Buffer* instanceDataBuffer,
 			_In_ UINT count,
 			_In_ ConstantBuffer<ObjectConstBuffer>* cb,
-			_In_ CredibleMesh* mesh);
+			_In_ CredibleMesh* mesh,
+			_In_opt_ UINT lod = 0);
 
 		//
 		// Sets the texture names that are associated with item slots. This allows us to, in the future, swap
@@ -289,9 +543,19 @@ namespace Engine
 			_In_ wstring textureName);
 
 		//
-		// Updates the bone 
+		// Poses the model itself, for drawing and picking it with the overloads that don't take a pose. The
+		// nodes are left in the pose the model was loaded in. See EvaluatePose
 		//
-		void UpdateTransforms(CredibleNode* pNode, const std::vector<XMFLOAT4X4>& pTransforms);
+		void UpdateTransforms(_In_ const std::vector<XMFLOAT4X4>& transforms);
+
+		//
+		// FullName:  Engine::CredibleModelData::EvaluatePose
+		// Evaluates the global transform of every node from the local transforms of the animation channels in
+		// one pass over the skeleton, then the bone palette of every skinned mesh
+		//
+		void EvaluatePose(
+			_In_ const std::vector<XMFLOAT4X4>& transforms,
+			_Out_ CredibleModelPose& pose) const override;
 
 		//
 		// Concatenates all parent transforms to get the global transform for the given node. Static so it 
@@ -300,7 +564,9 @@ namespace Engine
 		static void CalculateGlobalTransform(CredibleNode* node);
 
 		//
-		// Checks if the given ray and direction of given ray intersects with any of the mesh data in this model
+		// Checks if the given ray and direction of given ray intersects with any of the mesh data in this model.
+		// Stops at the first triangle found, use IntersectNearest when it matters which one. The model is in
+		// its own pose, see UpdateTransforms
 		//
 		bool IntersectedBy(
 			_In_ const XMVECTOR& rayOrigin,
@@ -308,6 +574,43 @@ namespace Engine
 			_In_ const XMFLOAT4X4& worldTransform,
 			_In_ const XMMATRIX& inverseView);
 
+		//
+		// As above for one instance of the model in the given pose
+		//
+		bool IntersectedBy(
+			_In_ const XMVECTOR& rayOrigin,
+			_In_ const XMVECTOR& rayDirection,
+			_In_ const XMFLOAT4X4& worldTransform,
+			_In_ const XMMATRIX& inverseView,
+			_In_ const CredibleModelPose& pose) const;
+
+		//
+		// FullName:  Engine::CredibleModelData::IntersectNearest
+		// Finds the nearest triangle the given view space ray hits at a distance between 0 and maxT. Meshes are
+		// tested front to back and skipped once their bounds start beyond the closest hit so far. Pass the T of
+		// the closest hit on other models as maxT to prune across models. Returns false if nothing was hit. The
+		// model is in its own pose, see UpdateTransforms
+		//
+		bool IntersectNearest(
+			_In_ const XMVECTOR& rayOrigin,
+			_In_ const XMVECTOR& rayDirection,
+			_In_ const XMFLOAT4X4& worldTransform,
+			_In_ const XMMATRIX& inverseView,
+			_In_ float maxT,
+			_Out_ CredibleModelHit& hit) const;
+
+		//
+		// As above for one instance of the model in the given pose
+		//
+		bool IntersectNearest(
+			_In_ const XMVECTOR& rayOrigin,
+			_In_ const XMVECTOR& rayDirection,
+			_In_ const XMFLOAT4X4& worldTransform,
+			_In_ const XMMATRIX& inverseView,
+			_In_ const CredibleModelPose& pose,
+			_In_ float maxT,
+			_Out_ CredibleModelHit& hit) const;
+
 		//
 		// Checks if the given ray and direction of given ray intersects with any of the mesh data in this model
 		// and returns all points at which that intersection occurs
@@ -325,43 +628,15 @@ namespace Engine
 			return _boundingBox;
 		}
 
-		btBvhTriangleMeshShape* GenerateBtConvexShape(_In_ XMFLOAT4X4 scale)
-		{
-			//unique_ptr<btConvexHullShape> originalConvexShape = make_unique<btConvexHullShape>();
-			btBvhTriangleMeshShape* originalConvexShape = nullptr;
-
-			btTriangleIndexVertexArray* shapeVertexArray = new btTriangleIndexVertexArray();
-			generateBtConvexShapeTraverse(RootNode, shapeVertexArray, scale);
-
-			//for (const auto& mesh : _allMeshes)
-			//{
-			//	for (const auto& vertex : mesh->PositionalVertices)
-			//	{
-			//		originalConvexShape->addPoint(btVector3(vertex.x, vertex.y, vertex.z));
-			//	}
-			//}
-
-				//create a hull approximation
-			//unique_ptr<btShapeHull> hull = make_unique<btShapeHull>(originalConvexShape);
-			//btShapeHull* hull = new btShapeHull(originalConvexShape);
-			//btScalar margin = originalConvexShape->getMargin();
-			//hull->buildHull(margin);
-
-			//btConvexHullShape* simplifiedConvexShape = new btConvexHullShape();
-			//for (int i = 0; i < hull->numVertices(); i++)
-			//{
-			//	simplifiedConvexShape->addPoint(hull->getVertexPointer()[i], false);
-			//}
-			//simplifiedConvexShape->recalcLocalAabb();
-
-			originalConvexShape = new btBvhTriangleMeshShape(shapeVertexArray, false);
-			return originalConvexShape;
-		}
-
-		void generateBtConvexShapeTraverse(
-			_In_ CredibleNode* node,
-			_In_ btTriangleIndexVertexArray* shape,
-			_In_ XMFLOAT4X4 scale);
+		//
+		// FullName:  Engine::CredibleModelData::GetCollisionGeometry
+		// Fills vertices and indices with the triangles of every mesh that has CPU geometry, in model space
+		// with the node transforms of the loaded pose applied. CollisionShapeCache builds the model's shared
+		// collision shapes from it
+		//
+		void GetCollisionGeometry(
+			_Out_ vector<XMFLOAT3>& vertices,
+			_Out_ vector<UINT>& indices) const override;
 
 		//
 		// The animation data for this model
@@ -378,30 +653,54 @@ namespace Engine
 		//
 		CredibleNode* RootNode;		
 
+		//
+		// The node hierarchy flattened in the same order as Nodes
+		//
+		Skeleton ModelSkeleton;
+
+		//
+		// The animations of this model the file stores compressed
+		//
+		vector<CompressedClip> CompressedClips;
+
 	private:
 
 		//
 		// Initializes this model from a stream of bytes
 		//
 		void initializeFromKsm(
-			_In_ byte* data,
-			_In_opt_ bool readSubsetAsInstanceType = false);
+			_In_ const KsmModelView& ksm,
+			_In_opt_ bool readSubsetAsInstanceType = false,
+			_In_opt_ bool keepCpuGeometry = true);
 
 		//
-		// Called by readModelDataFromFile to read the node tree in from file
+		// Writes the skinning matrix of every bone of a mesh (offset * bone global transform * inverse mesh
+		// global transform) for the given pose into palette, in the layout the shader reads
 		//
-		CredibleNode* readNodeTree(
-			_In_ byte* data,
-			_In_ CredibleNode* parent,
-			_Inout_ int& readerPosition,
-			_In_ ID3D11Device* device);
+		void writeBonePalette(
+			_In_ const std::vector<XMFLOAT4X4>& globalTransforms,
+			_In_ const CredibleNode* node,
+			_In_ const CredibleMesh* mesh,
+			_Out_ XMFLOAT4X4* palette) const;
 
 		//
-		// Multiplies the bone offset by global bone transform to get final bone matrix
+		// Flattens the node tree once it's complete, lays out the bone palettes and poses the model in the
+		// pose it was loaded in
+		//
+		void initializeSkeleton();
+
 		//
-		void calculateGlobalBoneMatrices(
+		// Gathers the error of each level of detail over all the meshes, see SelectLod
+		//
+		void initializeLods();
+
+		//
+		// Appends the triangles of node and its children to the collision geometry, see GetCollisionGeometry
+		//
+		void collectCollisionGeometry(
 			_In_ const CredibleNode* node,
-			_In_ const CredibleMesh* mesh);
+			_Inout_ vector<XMFLOAT3>& vertices,
+			_Inout_ vector<UINT>& indices) const;
 
 		//
 		// Initializes this model from a GeometryGenerator::MeshData object
@@ -419,8 +718,11 @@ namespace Engine
 		// Cached sizeof Vertex
 		UINT _vertexStride;
 
-		// Bones transformed from local space to world space
-		std::vector<XMFLOAT4X4> _globalBoneTransforms;
+		// The model's own pose, set by UpdateTransforms
+		CredibleModelPose _pose;
+
+		// The number of skinning matrices in a CredibleModelPose::BonePalettes
+		UINT _bonePaletteSize;
 
 		// The total number of meshes in this model
 		UINT _numMeshes;
@@ -443,13 +745,34 @@ namespace Engine
 		// Holds total time for animation calculations
 		double _animationTimer;
 
+		// The name of every animation, indexed as FindAnimation returns them
+		vector<wstring> _animationNames;
+
 		// Pointers to all the meshes in the model for quick reference
 		vector <CredibleMesh*>_allMeshes;
 
-		// Nodes that are bone nodes for easy reference
-		map<wstring, const CredibleNode*> _boneNodesByName;
+		// The inverse of every node's global transform in the pose the model was loaded in. Nodes the skeleton
+		// never animates stay in that pose, so skinned meshes under them don't need to invert it every draw
+		std::vector<XMFLOAT4X4> _inverseBindGlobalTransforms;
 
 		// The textures that map to each item slot
 		map<ID3D11ShaderResourceView*, ItemSlot> _textureMapping;
+
+		// Node indices by name, for turning Record's disabled node names into indices
+		std::unordered_multimap<wstring, UINT> _nodeIndicesByName;
+
+		// The bounds of each node's meshes in the node's space, indexed by node index. Only KSM models
+		// have mesh bounds, so this is empty for the rest and their nodes aren't culled
+		std::vector<BoundingBox> _nodeBounds;
+
+		// The largest error of any mesh at each level of detail, the full resolution level 0 first. Never
+		// empty once loaded
+		std::vector<float> _lodErrors;
+
+		// The backend the meshes were added to, null if they haven't been
+		RenderBackend* _renderBackend;
+
+		// The ids Record added item slot override textures under, each added once and removed with the rest
+		mutable map<ID3D11ShaderResourceView*, UINT> _overrideTextureIds;
 	};
 }
\ No newline at end of file
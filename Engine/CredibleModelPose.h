@@ -0,0 +1,48 @@
+//////////////////////////////////////////////////////////////////////////
+// CredibleModelPose.h
+// The pose of one instance of a model: the global transform of every
+// node and the bone palettes of its skinned meshes, as evaluated by
+// CredibleModelData::EvaluatePose, and the interface the animation code
+// evaluates poses through
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+namespace Engine
+{
+	//
+	// The pose of one instance of a model. Instances keep their own (or share one through a PoseCache) rather
+	// than posing the model itself, which is shared by every instance of it
+	//
+	struct CredibleModelPose
+	{
+		// The global transform of every node, indexed by CredibleNode::Index
+		std::vector<DirectX::XMFLOAT4X4> GlobalTransforms;
+
+		// The skinning matrices of every skinned mesh back to back, starting at CredibleMesh::PaletteOffset.
+		// They are already laid out as gBoneTransforms is, so a draw uploads a mesh's range with one memcpy
+		std::vector<DirectX::XMFLOAT4X4> BonePalettes;
+	};
+
+	//
+	// Evaluates the poses of a model. Implemented by CredibleModelData; PoseCache and AnimationStage only go
+	// through this, so they don't depend on the model's Direct3D resources
+	//
+	class PoseEvaluator
+	{
+	public:
+
+		virtual ~PoseEvaluator() {}
+
+		//
+		// Evaluates the pose from the local transforms of the model's animation channels
+		//
+		virtual void EvaluatePose(
+			_In_ const std::vector<DirectX::XMFLOAT4X4>& transforms,
+			_Out_ CredibleModelPose& pose) const = 0;
+	};
+}
@@ -0,0 +1,252 @@
+//////////////////////////////////////////////////////////////////////////
+// D3D11RenderBackend.cpp
+// Issues submitted RenderQueue packets to a D3D11 device context
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "D3D11RenderBackend.h"
+#include "ObjectInstance.h"
+
+using namespace DirectX;
+using namespace Engine;
+
+D3D11RenderBackend::D3D11RenderBackend(
+	_In_ ID3D11DeviceContext* dc,
+	_In_ ConstantBuffer<ObjectConstBuffer>* cb,
+	_In_ ConstantBuffer<AnimatedConstBuffer>* aCb,
+	_In_opt_ UINT instanceCapacity /*= DefaultInstanceCapacity*/)
+	: _dc(dc), _cb(cb), _aCb(aCb), _objectConstantsDirty(true), _instanceCapacity(std::max(instanceCapacity, 1U))
+{
+	_textures.push_back(nullptr);
+	_textureReferences.push_back(0);
+
+	// Start out full so the first instanced draw discards the buffer
+	_instanceCursor = _instanceCapacity;
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+	_dc->GetDevice(device.GetAddressOf());
+
+	D3D11_BUFFER_DESC desc = {};
+	desc.ByteWidth = _instanceCapacity * sizeof(RenderTransform);
+	desc.Usage = D3D11_USAGE_DYNAMIC;
+	desc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	if (FAILED(device->CreateBuffer(&desc, nullptr, _instanceBuffer.GetAddressOf())))
+	{
+		MUKASHIDEBUG_CRITICALERROR(L"Failed to create the instance buffer");
+	}
+}
+
+UINT D3D11RenderBackend::AddShader(
+	_In_ ID3D11InputLayout* inputLayout,
+	_In_ ID3D11VertexShader* vertexShader,
+	_In_ ID3D11PixelShader* pixelShader)
+{
+	Shader shader;
+	shader.InputLayout = inputLayout;
+	shader.VertexShader = vertexShader;
+	shader.PixelShader = pixelShader;
+
+	_shaders.push_back(shader);
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(_shaders.size() - 1 <= RenderQueue::MaxShader);
+
+	return static_cast<UINT>(_shaders.size() - 1);
+}
+
+UINT D3D11RenderBackend::AddTexture(_In_opt_ ID3D11ShaderResourceView* texture)
+{
+	if (texture == nullptr)
+	{
+		return 0;
+	}
+
+	auto found = _textureIds.find(texture);
+	if (found != _textureIds.end())
+	{
+		++_textureReferences[found->second];
+		return found->second;
+	}
+
+	UINT id;
+	if (!_freeTextures.empty())
+	{
+		id = _freeTextures.back();
+		_freeTextures.pop_back();
+	}
+	else
+	{
+		id = static_cast<UINT>(_textures.size());
+		MUKASHIDEBUG_CRITICALERROR_ONFALSE(id <= RenderQueue::MaxTexture);
+
+		_textures.emplace_back();
+		_textureReferences.push_back(0);
+	}
+
+	_textures[id] = texture;
+	_textureReferences[id] = 1;
+	_textureIds[texture] = id;
+	return id;
+}
+
+void D3D11RenderBackend::RemoveTexture(_In_ UINT texture)
+{
+	if (texture == 0)
+	{
+		return;
+	}
+
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(texture < _textures.size() && _textureReferences[texture] > 0);
+	if (--_textureReferences[texture] > 0)
+	{
+		return;
+	}
+
+	_textureIds.erase(_textures[texture].Get());
+	_textures[texture].Reset();
+	_freeTextures.push_back(texture);
+}
+
+UINT D3D11RenderBackend::AddGeometry(
+	_In_ ID3D11Buffer* vertexBuffer,
+	_In_ UINT vertexStride,
+	_In_ ID3D11Buffer* indexBuffer,
+	_In_ UINT indexSize,
+	_In_ const Material& material)
+{
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(indexSize == 2 || indexSize == 4);
+
+	Geometry geometry;
+	geometry.VertexBuffer = vertexBuffer;
+	geometry.IndexBuffer = indexBuffer;
+	geometry.VertexStride = vertexStride;
+	geometry.IndexFormat = (indexSize == 2) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	geometry.GeometryMaterial = material;
+
+	if (!_freeGeometry.empty())
+	{
+		UINT id = _freeGeometry.back();
+		_freeGeometry.pop_back();
+		_geometry[id] = geometry;
+		return id;
+	}
+
+	_geometry.push_back(geometry);
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(_geometry.size() - 1 <= RenderQueue::MaxGeometry);
+
+	return static_cast<UINT>(_geometry.size() - 1);
+}
+
+void D3D11RenderBackend::RemoveGeometry(_In_ UINT geometry)
+{
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(geometry < _geometry.size() && _geometry[geometry].VertexBuffer);
+
+	// Let go of the buffers now rather than when the id is reused
+	_geometry[geometry].VertexBuffer.Reset();
+	_geometry[geometry].IndexBuffer.Reset();
+	_freeGeometry.push_back(geometry);
+}
+
+void D3D11RenderBackend::BindShader(_In_ UINT shader)
+{
+	const Shader& bound = _shaders[shader];
+
+	_dc->IASetInputLayout(bound.InputLayout.Get());
+	_dc->VSSetShader(bound.VertexShader.Get(), nullptr, 0);
+	_dc->PSSetShader(bound.PixelShader.Get(), nullptr, 0);
+}
+
+void D3D11RenderBackend::BindTexture(_In_ UINT texture)
+{
+	ID3D11ShaderResourceView* view = _textures[texture].Get();
+	_dc->PSSetShaderResources(0, 1, &view);
+}
+
+void D3D11RenderBackend::BindGeometry(_In_ UINT geometry)
+{
+	const Geometry& bound = _geometry[geometry];
+
+	UINT offset = 0;
+	_dc->IASetVertexBuffers(0, 1, bound.VertexBuffer.GetAddressOf(), &bound.VertexStride, &offset);
+	_dc->IASetIndexBuffer(bound.IndexBuffer.Get(), bound.IndexFormat, 0);
+
+	_cb->Data.Mat = bound.GeometryMaterial;
+	_objectConstantsDirty = true;
+}
+
+void D3D11RenderBackend::SetTransform(_In_ const RenderTransform& transform)
+{
+	_cb->Data.World = transform.World;
+	_cb->Data.WorldInvTranspose = transform.WorldInvTranspose;
+	_objectConstantsDirty = true;
+}
+
+void D3D11RenderBackend::SetBonePalette(
+	_In_ const XMFLOAT4X4* palette,
+	_In_ UINT count)
+{
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(count <= _countof(_aCb->Data.gBoneTransforms));
+	count = min(count, static_cast<UINT>(_countof(_aCb->Data.gBoneTransforms)));
+
+	memcpy(_aCb->Data.gBoneTransforms, palette, count * sizeof(XMFLOAT4X4));
+	_aCb->ApplyChanges(_dc);
+}
+
+void D3D11RenderBackend::DrawIndexed(_In_ UINT indexCount)
+{
+	if (_objectConstantsDirty)
+	{
+		_cb->ApplyChanges(_dc);
+		_objectConstantsDirty = false;
+	}
+
+	_dc->DrawIndexed(indexCount, 0, 0);
+}
+
+void D3D11RenderBackend::DrawIndexedInstanced(
+	_In_ UINT indexCount,
+	_In_ const RenderTransform* transforms,
+	_In_ UINT instanceCount)
+{
+	if (_objectConstantsDirty)
+	{
+		_cb->ApplyChanges(_dc);
+		_objectConstantsDirty = false;
+	}
+
+	UINT stride = sizeof(RenderTransform);
+	UINT offset = 0;
+	_dc->IASetVertexBuffers(1, 1, _instanceBuffer.GetAddressOf(), &stride, &offset);
+
+	//
+	// Runs longer than the ring are drawn in ring sized pieces
+	while (instanceCount > 0)
+	{
+		UINT count = std::min(instanceCount, _instanceCapacity);
+
+		// Append behind what earlier draws are still reading, and only discard once the ring is full
+		D3D11_MAP mapType = D3D11_MAP_WRITE_NO_OVERWRITE;
+		if (count > _instanceCapacity - _instanceCursor)
+		{
+			mapType = D3D11_MAP_WRITE_DISCARD;
+			_instanceCursor = 0;
+		}
+
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (FAILED(_dc->Map(_instanceBuffer.Get(), 0, mapType, 0, &mapped)))
+		{
+			MUKASHIDEBUG_CRITICALERROR(L"Failed to map the instance buffer");
+			return;
+		}
+
+		memcpy(static_cast<byte*>(mapped.pData) + _instanceCursor * sizeof(RenderTransform), transforms, count * sizeof(RenderTransform));
+		_dc->Unmap(_instanceBuffer.Get(), 0);
+
+		_dc->DrawIndexedInstanced(indexCount, count, 0, 0, _instanceCursor);
+
+		_instanceCursor += count;
+		transforms += count;
+		instanceCount -= count;
+	}
+}
@@ -0,0 +1,136 @@
+//////////////////////////////////////////////////////////////////////////
+// D3D11RenderBackend.h
+// Issues submitted RenderQueue packets to a D3D11 device context. Owns
+// the tables that turn the queue's integer ids back into shaders,
+// textures and mesh buffers, and only uploads the object constants
+// when a draw actually needs different ones. The transforms of instanced
+// draws are streamed through a dynamic vertex buffer used as a ring: each
+// draw appends to it without waiting on the GPU, and it is only discarded
+// when it wraps around.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderQueue.h"
+#include "ConstantBuffer.h"
+#include "../KsmCreatorLib/LightHelper.h"
+#include <d3d11.h>
+#include <unordered_map>
+#include <vector>
+#include <wrl/client.h>
+
+namespace Engine
+{
+	struct ObjectConstBuffer;
+	struct AnimatedConstBuffer;
+
+	class D3D11RenderBackend : public RenderBackend
+	{
+	public:
+
+		// The default number of instance transforms the ring buffer holds
+		static const UINT DefaultInstanceCapacity = 8192;
+
+		//
+		// Creates the instance ring buffer on the context's device. Instanced shaders read the instance
+		// transforms (a RenderTransform each) from vertex buffer slot 1
+		//
+		D3D11RenderBackend(
+			_In_ ID3D11DeviceContext* dc,
+			_In_ ConstantBuffer<ObjectConstBuffer>* cb,
+			_In_ ConstantBuffer<AnimatedConstBuffer>* aCb,
+			_In_opt_ UINT instanceCapacity = DefaultInstanceCapacity);
+
+		//
+		// FullName:  Engine::D3D11RenderBackend::AddShader
+		// Returns the id to record draws using the given shaders with
+		//
+		UINT AddShader(
+			_In_ ID3D11InputLayout* inputLayout,
+			_In_ ID3D11VertexShader* vertexShader,
+			_In_ ID3D11PixelShader* pixelShader);
+
+		UINT AddTexture(_In_opt_ ID3D11ShaderResourceView* texture) override;
+
+		void RemoveTexture(_In_ UINT texture) override;
+
+		UINT AddGeometry(
+			_In_ ID3D11Buffer* vertexBuffer,
+			_In_ UINT vertexStride,
+			_In_ ID3D11Buffer* indexBuffer,
+			_In_ UINT indexSize,
+			_In_ const Material& material) override;
+
+		void RemoveGeometry(_In_ UINT geometry) override;
+
+		void BindShader(_In_ UINT shader) override;
+
+		void BindTexture(_In_ UINT texture) override;
+
+		void BindGeometry(_In_ UINT geometry) override;
+
+		void SetTransform(_In_ const RenderTransform& transform) override;
+
+		void SetBonePalette(
+			_In_ const DirectX::XMFLOAT4X4* palette,
+			_In_ UINT count) override;
+
+		void DrawIndexed(_In_ UINT indexCount) override;
+
+		void DrawIndexedInstanced(
+			_In_ UINT indexCount,
+			_In_ const RenderTransform* transforms,
+			_In_ UINT instanceCount) override;
+
+	private:
+
+		// Make class not copyable
+		D3D11RenderBackend(const D3D11RenderBackend&);
+		D3D11RenderBackend& operator=(const D3D11RenderBackend&);
+
+		struct Shader
+		{
+			Microsoft::WRL::ComPtr<ID3D11InputLayout> InputLayout;
+			Microsoft::WRL::ComPtr<ID3D11VertexShader> VertexShader;
+			Microsoft::WRL::ComPtr<ID3D11PixelShader> PixelShader;
+		};
+
+		struct Geometry
+		{
+			Microsoft::WRL::ComPtr<ID3D11Buffer> VertexBuffer;
+			Microsoft::WRL::ComPtr<ID3D11Buffer> IndexBuffer;
+			UINT VertexStride;
+			DXGI_FORMAT IndexFormat;
+			Material GeometryMaterial;
+		};
+
+	private:
+
+		ID3D11DeviceContext* _dc;
+		ConstantBuffer<ObjectConstBuffer>* _cb;
+		ConstantBuffer<AnimatedConstBuffer>* _aCb;
+
+		std::vector<Shader> _shaders;
+
+		// Indexed by texture id, the first being the null texture. Removed textures leave a null entry whose
+		// id is on _freeTextures
+		std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> _textures;
+		std::vector<UINT> _textureReferences;
+		std::unordered_map<ID3D11ShaderResourceView*, UINT> _textureIds;
+		std::vector<UINT> _freeTextures;
+
+		// Indexed by geometry id, with the ids of removed geometry on _freeGeometry
+		std::vector<Geometry> _geometry;
+		std::vector<UINT> _freeGeometry;
+
+		// Set when the transform or material changed since the object constants were last applied
+		bool _objectConstantsDirty;
+
+		Microsoft::WRL::ComPtr<ID3D11Buffer> _instanceBuffer;
+
+		// The number of transforms _instanceBuffer holds and where the next ones go
+		UINT _instanceCapacity;
+		UINT _instanceCursor;
+	};
+}
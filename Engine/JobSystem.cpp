@@ -0,0 +1,173 @@
+//////////////////////////////////////////////////////////////////////////
+// JobSystem.cpp
+// Splits per-frame work (such as posing every visible instance) across
+// all cores, with idle threads stealing queued tasks from busy ones
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "JobSystem.h"
+
+using namespace Engine;
+
+JobSystem::JobSystem(_In_ UINT workerCount)
+	: _queuedTasks(0), _stopping(false)
+{
+	_queues.reserve(workerCount + 1);
+	for (UINT i = 0; i < workerCount + 1; ++i)
+	{
+		_queues.push_back(std::unique_ptr<TaskQueue>(new TaskQueue()));
+	}
+
+	_workers.reserve(workerCount);
+	for (UINT i = 0; i < workerCount; ++i)
+	{
+		_workers.push_back(std::thread(&JobSystem::workerMain, this, i));
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_wake.notify_all();
+
+	for (auto& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+void JobSystem::ParallelFor(
+	_In_ UINT count,
+	_In_ UINT grainSize,
+	_In_ const RangeJob& job)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	grainSize = std::max(grainSize, 1U);
+	UINT taskCount = (count - 1) / grainSize + 1;
+
+	Batch batch;
+	batch.Job = &job;
+	batch.Remaining = taskCount;
+
+	//
+	// Deal the ranges out over every thread's queue so the workers start on their own tasks and only steal
+	// once those run out. Counted first so no worker can take a task before it has been counted
+	UINT threadCount = GetThreadCount();
+	_queuedTasks += taskCount;
+
+	for (UINT thread = 0; thread < threadCount && thread < taskCount; ++thread)
+	{
+		TaskQueue& queue = *_queues[thread];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+
+		for (UINT t = thread; t < taskCount; t += threadCount)
+		{
+			Task task;
+			task.Owner = &batch;
+			task.Begin = t * grainSize;
+			task.End = std::min(task.Begin + grainSize, count);
+			queue.Tasks.push_back(task);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+	}
+	_wake.notify_all();
+
+	//
+	// Help out until every range has been taken, then wait for the ones still running elsewhere
+	UINT self = threadCount - 1;
+	while (batch.Remaining > 0)
+	{
+		Task task;
+		if (takeTask(self, task))
+		{
+			runTask(self, task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_finished.wait(lock, [&batch]() { return batch.Remaining == 0; });
+	}
+}
+
+void JobSystem::workerMain(_In_ UINT thread)
+{
+	for (;;)
+	{
+		Task task;
+		if (takeTask(thread, task))
+		{
+			runTask(thread, task);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(_mutex);
+		_wake.wait(lock, [this]() { return _stopping || _queuedTasks > 0; });
+
+		if (_stopping)
+		{
+			return;
+		}
+	}
+}
+
+bool JobSystem::takeTask(
+	_In_ UINT thread,
+	_Out_ Task& task)
+{
+	{
+		TaskQueue& own = *_queues[thread];
+		std::lock_guard<std::mutex> lock(own.Mutex);
+
+		if (!own.Tasks.empty())
+		{
+			task = own.Tasks.back();
+			own.Tasks.pop_back();
+			--_queuedTasks;
+			return true;
+		}
+	}
+
+	UINT threadCount = GetThreadCount();
+	for (UINT i = 1; i < threadCount; ++i)
+	{
+		TaskQueue& victim = *_queues[(thread + i) % threadCount];
+		std::lock_guard<std::mutex> lock(victim.Mutex);
+
+		if (!victim.Tasks.empty())
+		{
+			task = victim.Tasks.front();
+			victim.Tasks.pop_front();
+			--_queuedTasks;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::runTask(
+	_In_ UINT thread,
+	_In_ const Task& task)
+{
+	(*task.Owner->Job)(thread, task.Begin, task.End);
+
+	// The batch can be gone as soon as the count reaches zero, so it isn't touched after this
+	if (--task.Owner->Remaining == 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+		}
+		_finished.notify_all();
+	}
+}
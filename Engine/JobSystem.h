@@ -0,0 +1,137 @@
+//////////////////////////////////////////////////////////////////////////
+// JobSystem.h
+// Splits per-frame work (such as posing every visible instance) across
+// all cores. Each thread has its own queue of tasks and works through
+// it newest first; threads that run out take the oldest tasks from the
+// others, so uneven tasks still keep every core busy. Unlike ThreadPool
+// the thread that submits the work joins in and returns once all of it
+// is done.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Engine
+{
+	class JobSystem
+	{
+	public:
+
+		//
+		// Runs the elements [begin, end) on the given thread. thread is below GetThreadCount() and no two
+		// ranges run at the same time on the same thread, so it can index per thread scratch data
+		//
+		typedef std::function<void(UINT thread, UINT begin, UINT end)> RangeJob;
+
+		//
+		// Starts the given number of workers. Zero is allowed, in which case all work runs on the
+		// submitting thread
+		//
+		JobSystem(_In_ UINT workerCount);
+
+		//
+		// Stops the workers. Must not be called while a ParallelFor is running
+		//
+		~JobSystem();
+
+		//
+		// FullName:  Engine::JobSystem::ParallelFor
+		// Runs job over [0, count) in ranges of up to grainSize elements spread over the workers and the
+		// calling thread, and returns when every range has run. Only one thread may call it at a time
+		//
+		void ParallelFor(
+			_In_ UINT count,
+			_In_ UINT grainSize,
+			_In_ const RangeJob& job);
+
+		//
+		// Returns the number of threads that run jobs: the workers plus the thread calling ParallelFor
+		//
+		UINT GetThreadCount() const
+		{
+			return static_cast<UINT>(_queues.size());
+		}
+
+		UINT GetWorkerCount() const
+		{
+			return static_cast<UINT>(_workers.size());
+		}
+
+	private:
+
+		// Make class not copyable
+		JobSystem(const JobSystem&);
+		JobSystem& operator=(const JobSystem&);
+
+		//
+		// One ParallelFor call
+		//
+		struct Batch
+		{
+			const RangeJob* Job;
+
+			// Ranges that haven't finished running
+			std::atomic<UINT> Remaining;
+		};
+
+		struct Task
+		{
+			Batch* Owner;
+			UINT Begin;
+			UINT End;
+		};
+
+		//
+		// The tasks queued on one thread. The thread itself takes from the back, others steal from the front
+		//
+		struct TaskQueue
+		{
+			std::mutex Mutex;
+			std::deque<Task> Tasks;
+		};
+
+		void workerMain(_In_ UINT thread);
+
+		//
+		// Returns bool indicating if a task was found, from the thread's own queue first and then from the
+		// others, starting with the next one along
+		//
+		bool takeTask(
+			_In_ UINT thread,
+			_Out_ Task& task);
+
+		void runTask(
+			_In_ UINT thread,
+			_In_ const Task& task);
+
+	private:
+
+		std::vector<std::thread> _workers;
+
+		// One queue per worker, followed by the one for the thread calling ParallelFor
+		std::vector<std::unique_ptr<TaskQueue>> _queues;
+
+		// Tasks queued and not yet taken, so idle workers can sleep rather than poll
+		std::atomic<UINT> _queuedTasks;
+
+		// Guards _stopping and the sleeping of workers and of the thread waiting for a batch
+		std::mutex _mutex;
+
+		// Signaled when tasks are queued or the workers are stopping
+		std::condition_variable _wake;
+
+		// Signaled when the last range of a batch finishes
+		std::condition_variable _finished;
+
+		bool _stopping;
+	};
+}
@@ -0,0 +1,252 @@
+//////////////////////////////////////////////////////////////////////////
+// KsmFormat.h
+// On-disk layout of version 2 KSM model files.
+//
+// A v2 file starts with a KsmFileHeader followed by a directory of
+// KsmSectionEntry records. Every section starts on a 16 byte boundary and
+// holds either an array of fixed size records or a blob of bulk data
+// (indices, vertices, keyframes, strings). Records refer to each other by
+// index and into blobs by byte offset, so a mapped file can be used in
+// place and sections can be decoded independently of each other. All
+// fields have a fixed size regardless of the platform.
+//
+// Animations can additionally carry a compressed clip (see
+// CompressedClip.h) in the clips section. Files written before that
+// section existed have none and readers that predate it skip it.
+//
+// Meshes can likewise carry coarser levels of detail in the LODs
+// section (see MeshSimplifier.h): extra index lists into the mesh's own
+// vertices, stored in the indices section.
+//
+// Version 1 files have no header; they are a packed stream of the same
+// data in tree order, written by the 32 bit KsmCreator. KsmReader reads
+// both.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+namespace Engine
+{
+	// "KSM2" read as a little endian uint32
+	const uint32_t KsmMagic = 0x324D534B;
+
+	const uint16_t KsmVersion = 2;
+
+	// Alignment of every section and of every blob inside the bulk data sections
+	const uint32_t KsmAlignment = 16;
+
+	// Used for node parents, channel indices and string offsets that are not set
+	const uint32_t KsmNone = 0xFFFFFFFF;
+
+	enum KsmSectionType : uint32_t
+	{
+		KSM_SECTION_MODEL = 1,		// a single KsmModelRecord
+		KSM_SECTION_NODES,			// KsmNodeRecord[], parents before children
+		KSM_SECTION_MESHES,			// KsmMeshRecord[], in node order
+		KSM_SECTION_BONES,			// KsmBoneRecord[]
+		KSM_SECTION_INDICES,		// index blob, 16 or 32 bit per mesh
+		KSM_SECTION_VERTICES,		// vertex blob
+		KSM_SECTION_ANIMATIONS,		// KsmAnimationRecord[]
+		KSM_SECTION_TRACKS,			// KsmTrackRecord[]
+		KSM_SECTION_KEYFRAMES,		// KsmKeyframeRecord[]
+		KSM_SECTION_STRINGS,		// uint32 length followed by that many UTF-16 code units
+		KSM_SECTION_CLIPS,			// compressed clip blobs, see KsmClipHeader
+		KSM_SECTION_LODS,			// KsmLodRecord[], in mesh order
+
+		KSM_SECTION_END
+	};
+
+	enum KsmMeshFlags : uint32_t
+	{
+		KSM_MESH_16BIT_INDICES = 0x1,
+		KSM_MESH_SKINNED = 0x2,
+	};
+
+	struct KsmFileHeader
+	{
+		uint32_t Magic;
+		uint16_t Version;
+		uint16_t HeaderSize;
+		uint32_t SectionCount;
+		uint32_t Flags;
+		uint64_t FileSize;
+		uint64_t Reserved;
+	};
+
+	struct KsmSectionEntry
+	{
+		uint32_t Type;
+		uint32_t Reserved;
+		uint64_t Offset;
+		uint64_t Size;
+	};
+
+	struct KsmModelRecord
+	{
+		uint32_t NumMeshes;
+		uint32_t NumMaterials;
+		uint32_t NumTextures;
+		uint32_t NumAnimations;
+		float BoundsCenter[3];
+		float BoundsExtents[3];
+		uint32_t Reserved[2];
+	};
+
+	struct KsmNodeRecord
+	{
+		uint32_t NameOffset;
+		uint32_t Parent;
+		uint32_t ChannelIndex;
+		uint32_t FirstMesh;
+		uint32_t MeshCount;
+		uint32_t Reserved[3];
+		float LocalTransform[16];
+	};
+
+	struct KsmMeshRecord
+	{
+		uint32_t NumBones;
+		uint32_t FaceCount;
+		uint32_t VertexCount;
+		uint32_t IndexCount;
+		float Diffuse[4];
+		float Ambient[4];
+		float Reflect[4];
+		float Specular[4];
+		float Opacity;
+		float Shininess;
+		float SpecularStrength;
+		uint32_t Flags;
+		uint32_t IndexOffset;
+		uint32_t VertexOffset;
+		uint32_t VertexStride;
+		uint32_t FirstBone;
+		uint32_t DiffusePathOffset;
+		uint32_t NormalPathOffset;
+		float BoundsCenter[3];
+		float BoundsExtents[3];
+	};
+
+	//
+	// A coarser level of detail of a mesh, drawn with the mesh's vertices. Indices are stored like the mesh's
+	// own, 16 bit if the mesh's are. A mesh's levels follow each other from finest to coarsest
+	//
+	struct KsmLodRecord
+	{
+		uint32_t Mesh;
+		uint32_t IndexOffset;
+		uint32_t IndexCount;
+
+		// The largest distance, in model units, the level's surface may be from the full mesh's
+		float Error;
+	};
+
+	struct KsmBoneRecord
+	{
+		uint32_t NameOffset;
+		uint32_t Reserved[3];
+		float Offset[16];
+	};
+
+	struct KsmAnimationRecord
+	{
+		uint32_t NameOffset;
+		float Duration;
+		float TicksPerSecond;
+		uint32_t TotalFrames;
+		uint32_t FirstTrack;
+		uint32_t TrackCount;
+
+		// The animation's compressed clip in the clips section. ClipSize is 0 if it has none
+		uint32_t ClipOffset;
+		uint32_t ClipSize;
+	};
+
+	struct KsmTrackRecord
+	{
+		uint32_t KeyframeOffset;
+		uint32_t KeyframeCount;
+	};
+
+	// Same field order as a v1 keyframe, padded so every keyframe is 16 byte aligned
+	struct KsmKeyframeRecord
+	{
+		float Translation[3];
+		float Scale[3];
+		float RotationQuat[4];
+		float TimePos;
+		uint32_t Reserved;
+	};
+
+	// "KSCL" read as a little endian uint32
+	const uint32_t KsmClipMagic = 0x4C43534B;
+
+	const uint32_t KsmClipVersion = 1;
+
+	enum KsmClipTrackFlags : uint32_t
+	{
+		KSM_CLIP_CONSTANT_ROTATION = 0x1,
+		KSM_CLIP_CONSTANT_TRANSLATION = 0x2,
+		KSM_CLIP_CONSTANT_SCALE = 0x4,
+	};
+
+	//
+	// A compressed clip: the clip's tracks sampled at a uniform rate, with keys that linear interpolation
+	// reproduces within tolerance removed. The header is followed by TrackCount KsmClipTrackRecords, KeyCount
+	// uint16 sample indices and then the uint16 rotation, translation and scale words
+	//
+	struct KsmClipHeader
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t TrackCount;
+		uint32_t SampleCount;
+
+		// Time between samples, in the same units as keyframe times
+		float SampleInterval;
+		float Duration;
+
+		uint32_t KeyCount;
+		uint32_t RotationWordCount;
+		uint32_t TranslationWordCount;
+		uint32_t ScaleWordCount;
+		uint32_t Reserved[2];
+	};
+
+	//
+	// One channel of a compressed clip. Its keys are the sample indices [FirstKey, FirstKey + KeyCount), the
+	// first always being sample 0 and the last the final sample; tracks whose channels are all constant have
+	// no keys. Animated rotations are 3 words per key in smallest three form, animated translations and
+	// scales 3 words per key quantized over [Min, Min + Extent]. Constant rotations are stored in Rotation,
+	// constant translations and scales in Min
+	//
+	struct KsmClipTrackRecord
+	{
+		uint32_t Flags;
+		uint32_t FirstKey;
+		uint32_t KeyCount;
+		uint32_t RotationOffset;
+		uint32_t TranslationOffset;
+		uint32_t ScaleOffset;
+		float Rotation[4];
+		float TranslationMin[3];
+		float TranslationExtent[3];
+		float ScaleMin[3];
+		float ScaleExtent[3];
+	};
+
+	static_assert(sizeof(KsmFileHeader) == 32, "KSM layout must not depend on the platform");
+	static_assert(sizeof(KsmSectionEntry) == 24, "KSM layout must not depend on the platform");
+	static_assert(sizeof(KsmModelRecord) == 48, "KSM layout must not depend on the platform");
+	static_assert(sizeof(KsmNodeRecord) == 96, "KSM layout must not depend on the platform");
+	static_assert(sizeof(KsmMeshRecord) == 144, "KSM layout must not depend on the platform");
+	static_assert(sizeof(KsmBoneRecord) == 80, "KSM layout must not depend on the platform");
+	static_assert(sizeof(KsmAnimationRecord) == 32, "KSM layout must not depend on the platform");
+	static_assert(sizeof(KsmTrackRecord) == 8, "KSM layout must not depend on the platform");
+	static_assert(sizeof(KsmKeyframeRecord) == 48, "KSM layout must not depend on the platform");
+	static_assert(sizeof(KsmClipHeader) == 48, "KSM layout must not depend on the platform");
+	static_assert(sizeof(KsmClipTrackRecord) == 88, "KSM layout must not depend on the platform");
+}
@@ -0,0 +1,726 @@
+//////////////////////////////////////////////////////////////////////////
+// KsmReader.cpp
+// Parses KSM model files (v1 and v2) into views that point straight into
+// the loaded (or mapped) file. Every read is bounds checked so corrupt
+// files are rejected rather than crashing the loader. Has no dependency
+// on the graphics device so it can be run and profiled headless
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "KsmReader.h"
+
+using namespace Engine;
+using namespace DirectX;
+
+namespace
+{
+	// Smallest possible v1 records, used to reject counts that can't fit in the rest of the file
+	// before anything is allocated for them
+	const size_t KsmV1MinNodeSize = sizeof(UINT) + sizeof(XMFLOAT4X4) + 3 * sizeof(UINT);
+	const size_t KsmV1MinMeshSize = 4 * sizeof(UINT) + 4 * sizeof(XMFLOAT4) + 3 * sizeof(float) + 2 * sizeof(uint8_t) + 2 * sizeof(UINT) + 2 * sizeof(XMFLOAT3);
+	const size_t KsmV1MinBoneSize = sizeof(UINT) + sizeof(XMFLOAT4X4);
+	const size_t KsmV1MinAnimationSize = sizeof(UINT) + 2 * sizeof(float) + 2 * sizeof(UINT);
+
+	// v1 keyframes are a packed translation, scale, rotation and time
+	const UINT KsmV1KeyframeSize = 2 * sizeof(XMFLOAT3) + sizeof(XMFLOAT4) + sizeof(float);
+
+	//
+	// KSM strings are UTF-16, which is what wchar_t holds on Windows. Elsewhere each code unit is widened
+	//
+	std::wstring decodeString(
+		_In_ const byte* units,
+		_In_ size_t length)
+	{
+		std::wstring result(length, L'\0');
+		for (size_t i = 0; i < length; ++i)
+		{
+			uint16_t unit;
+			memcpy(&unit, units + i * sizeof(uint16_t), sizeof(uint16_t));
+			result[i] = static_cast<wchar_t>(unit);
+		}
+		return result;
+	}
+
+	//
+	// Bounds checked cursor over v1 data. Once a read runs off the end of the data every following read
+	// fails as well and returns zeroes, so callers only need to check Failed() at the end
+	//
+	class KsmStream
+	{
+	public:
+
+		KsmStream(_In_ byte* data, _In_ size_t size)
+			: _data(data), _size(size), _position(0), _failed(false)
+		{}
+
+		template<class T>
+		T Read()
+		{
+			T value;
+			memset(&value, 0, sizeof(T));
+
+			const byte* source = Skip(1, sizeof(T));
+			if (source)
+			{
+				memcpy(&value, source, sizeof(T));
+			}
+			return value;
+		}
+
+		//
+		// Returns a pointer to count elements of elementSize bytes and steps over them
+		//
+		byte* Skip(_In_ size_t count, _In_ size_t elementSize)
+		{
+			if (!CanHold(count, elementSize))
+			{
+				_failed = true;
+				return nullptr;
+			}
+
+			byte* result = _data + _position;
+			_position += count * elementSize;
+			return result;
+		}
+
+		std::wstring ReadString()
+		{
+			UINT length = Read<UINT>();
+			const byte* units = Skip(length, sizeof(uint16_t));
+			return units ? decodeString(units, length) : std::wstring();
+		}
+
+		//
+		// Returns bool indicating if count elements of elementSize bytes fit in what is left of the data
+		//
+		bool CanHold(_In_ size_t count, _In_ size_t elementSize) const
+		{
+			return !_failed && (elementSize == 0 || count <= (_size - _position) / elementSize);
+		}
+
+		bool Failed() const
+		{
+			return _failed;
+		}
+
+	private:
+
+		byte* _data;
+		size_t _size;
+		size_t _position;
+		bool _failed;
+	};
+
+	//
+	// A section of a v2 file. Offset and size have already been checked against the file
+	//
+	struct KsmSection
+	{
+		KsmSection()
+			: Data(nullptr), Size(0)
+		{}
+
+		template<class T>
+		UINT GetRecordCount() const
+		{
+			return static_cast<UINT>(Size / sizeof(T));
+		}
+
+		template<class T>
+		T GetRecord(_In_ UINT i) const
+		{
+			T record;
+			memcpy(&record, Data + (size_t)i * sizeof(T), sizeof(T));
+			return record;
+		}
+
+		//
+		// Returns bool indicating if count elements of elementSize bytes at offset are inside the section
+		//
+		bool Contains(_In_ uint64_t offset, _In_ uint64_t count, _In_ uint64_t elementSize) const
+		{
+			return offset <= Size && (elementSize == 0 || count <= (Size - offset) / elementSize);
+		}
+
+		byte* Data;
+		uint64_t Size;
+	};
+
+	bool readStringV2(
+		_In_ const KsmSection& strings,
+		_In_ uint32_t offset,
+		_Out_ std::wstring& result)
+	{
+		result.clear();
+		if (offset == KsmNone)
+		{
+			return true;
+		}
+
+		if (!strings.Contains(offset, 1, sizeof(uint32_t)))
+		{
+			return false;
+		}
+
+		uint32_t length;
+		memcpy(&length, strings.Data + offset, sizeof(uint32_t));
+		if (!strings.Contains((uint64_t)offset + sizeof(uint32_t), length, sizeof(uint16_t)))
+		{
+			return false;
+		}
+
+		result = decodeString(strings.Data + offset + sizeof(uint32_t), length);
+		return true;
+	}
+
+	void readMeshV1(
+		_Inout_ KsmStream& stream,
+		_In_ const KsmVertexStrides& strides,
+		_Out_ KsmMeshView& mesh)
+	{
+		mesh.NumBones = stream.Read<UINT>();
+		mesh.FaceCount = stream.Read<UINT>();
+		mesh.VertexCount = stream.Read<UINT>();
+		mesh.IndexCount = stream.Read<UINT>();
+
+		mesh.Diffuse = stream.Read<XMFLOAT4>();
+		mesh.Ambient = stream.Read<XMFLOAT4>();
+		mesh.Reflect = stream.Read<XMFLOAT4>();
+		mesh.Specular = stream.Read<XMFLOAT4>();
+
+		mesh.Opacity = stream.Read<float>();
+		mesh.Shininess = stream.Read<float>();
+		mesh.SpecularStrength = stream.Read<float>();
+
+		// v1 always stores 32 bit indices
+		mesh.IndicesAre16Bit = stream.Read<uint8_t>() != 0;
+		mesh.IndexSize = sizeof(UINT);
+		mesh.IndexData = stream.Skip(mesh.IndexCount, sizeof(UINT));
+
+		mesh.ContainsAnimations = stream.Read<uint8_t>() != 0;
+		mesh.VertexStride = mesh.ContainsAnimations ? strides.Skinned : strides.Static;
+		mesh.Vertices = stream.Skip(mesh.VertexCount, mesh.VertexStride);
+
+		mesh.DiffusePath = stream.ReadString();
+		mesh.NormalPath = stream.ReadString();
+
+		if (!stream.CanHold(mesh.NumBones, KsmV1MinBoneSize))
+		{
+			stream.Skip(mesh.NumBones, KsmV1MinBoneSize);
+			return;
+		}
+
+		mesh.Bones.resize(mesh.NumBones);
+		for (UINT b = 0; b < mesh.NumBones; ++b)
+		{
+			mesh.Bones[b].Name = stream.ReadString();
+			mesh.Bones[b].Offset = stream.Read<XMFLOAT4X4>();
+		}
+
+		mesh.BoundsCenter = stream.Read<XMFLOAT3>();
+		mesh.BoundsExtents = stream.Read<XMFLOAT3>();
+	}
+
+	void readNodeV1(
+		_Inout_ KsmStream& stream,
+		_In_ UINT parent,
+		_In_ const KsmVertexStrides& strides,
+		_Inout_ KsmModelView& model)
+	{
+		model.Nodes.push_back(KsmNodeView());
+		KsmNodeView& node = model.Nodes.back();
+
+		node.Name = stream.ReadString();
+		node.LocalTransform = stream.Read<XMFLOAT4X4>();
+		node.Parent = parent;
+
+		// Written as a size_t by the 32 bit KsmCreator, so it is always 4 bytes
+		node.ChannelIndex = stream.Read<uint32_t>();
+
+		UINT meshCount = stream.Read<UINT>();
+		if (!stream.CanHold(meshCount, KsmV1MinMeshSize))
+		{
+			stream.Skip(meshCount, KsmV1MinMeshSize);
+			return;
+		}
+
+		node.FirstMesh = static_cast<UINT>(model.Meshes.size());
+		node.MeshCount = meshCount;
+
+		for (UINT m = 0; m < meshCount && !stream.Failed(); ++m)
+		{
+			model.Meshes.push_back(KsmMeshView());
+			readMeshV1(stream, strides, model.Meshes.back());
+		}
+	}
+
+	bool readV1(
+		_In_ byte* data,
+		_In_ size_t size,
+		_In_ const KsmVertexStrides& strides,
+		_Out_ KsmModelView& model)
+	{
+		KsmStream stream(data, size);
+
+		model.Version = 1;
+		model.NumMeshes = stream.Read<UINT>();
+		model.NumMaterials = stream.Read<UINT>();
+		model.NumTextures = stream.Read<UINT>();
+		model.NumAnimations = stream.Read<UINT>();
+
+		//
+		// The node tree is stored depth first with each node followed by its child count and then its
+		// children. Walk it with an explicit stack of (node, children left to read) rather than recursing,
+		// so a malformed file can't run us out of stack
+		//
+		std::vector<std::pair<UINT, UINT>> open;
+		UINT parent = KsmNone;
+		while (!stream.Failed())
+		{
+			readNodeV1(stream, parent, strides, model);
+
+			UINT childCount = stream.Read<UINT>();
+			if (!stream.CanHold(childCount, KsmV1MinNodeSize))
+			{
+				return false;
+			}
+
+			if (childCount > 0)
+			{
+				open.push_back(std::make_pair(static_cast<UINT>(model.Nodes.size() - 1), childCount));
+			}
+
+			while (!open.empty() && open.back().second == 0)
+			{
+				open.pop_back();
+			}
+
+			if (open.empty())
+			{
+				break;
+			}
+
+			open.back().second--;
+			parent = open.back().first;
+		}
+
+		if (!stream.CanHold(model.NumAnimations, KsmV1MinAnimationSize))
+		{
+			return false;
+		}
+
+		model.Animations.resize(model.NumAnimations);
+		for (auto& animation : model.Animations)
+		{
+			animation.Name = stream.ReadString();
+			animation.Duration = stream.Read<float>();
+			animation.TicksPerSecond = stream.Read<float>();
+
+			UINT trackCount = stream.Read<UINT>();
+			if (!stream.CanHold(trackCount, sizeof(UINT)))
+			{
+				return false;
+			}
+
+			animation.Tracks.resize(trackCount);
+			for (auto& track : animation.Tracks)
+			{
+				track.KeyframeCount = stream.Read<UINT>();
+				track.KeyframeStride = KsmV1KeyframeSize;
+				track.Keyframes = stream.Skip(track.KeyframeCount, KsmV1KeyframeSize);
+			}
+
+			animation.TotalFrames = stream.Read<UINT>();
+			animation.Clip = nullptr;
+			animation.ClipSize = 0;
+		}
+
+		model.BoundsCenter = stream.Read<XMFLOAT3>();
+		model.BoundsExtents = stream.Read<XMFLOAT3>();
+
+		return !stream.Failed();
+	}
+
+	bool readV2(
+		_In_ byte* data,
+		_In_ size_t size,
+		_In_ const KsmVertexStrides& strides,
+		_Out_ KsmModelView& model)
+	{
+		KsmFileHeader header;
+		memcpy(&header, data, sizeof(KsmFileHeader));
+
+		if (header.Version != KsmVersion ||
+			header.HeaderSize < sizeof(KsmFileHeader) ||
+			header.FileSize > size ||
+			header.HeaderSize > header.FileSize)
+		{
+			return false;
+		}
+
+		// Ignore anything past the end of the file as described by the header
+		uint64_t fileSize = header.FileSize;
+		if (header.SectionCount > (fileSize - header.HeaderSize) / sizeof(KsmSectionEntry))
+		{
+			return false;
+		}
+
+		//
+		// Read the section directory. Unknown section types are skipped so newer files with extra
+		// sections still load
+		//
+		KsmSection sections[KSM_SECTION_END];
+		for (uint32_t s = 0; s < header.SectionCount; ++s)
+		{
+			KsmSectionEntry entry;
+			memcpy(&entry, data + header.HeaderSize + s * sizeof(KsmSectionEntry), sizeof(KsmSectionEntry));
+
+			if (entry.Offset % KsmAlignment != 0 ||
+				entry.Offset > fileSize ||
+				entry.Size > fileSize - entry.Offset)
+			{
+				return false;
+			}
+
+			if (entry.Type >= KSM_SECTION_MODEL && entry.Type < KSM_SECTION_END)
+			{
+				sections[entry.Type].Data = data + entry.Offset;
+				sections[entry.Type].Size = entry.Size;
+			}
+		}
+
+		const KsmSection& modelSection = sections[KSM_SECTION_MODEL];
+		const KsmSection& nodes = sections[KSM_SECTION_NODES];
+		const KsmSection& meshes = sections[KSM_SECTION_MESHES];
+		const KsmSection& bones = sections[KSM_SECTION_BONES];
+		const KsmSection& indices = sections[KSM_SECTION_INDICES];
+		const KsmSection& vertices = sections[KSM_SECTION_VERTICES];
+		const KsmSection& animations = sections[KSM_SECTION_ANIMATIONS];
+		const KsmSection& tracks = sections[KSM_SECTION_TRACKS];
+		const KsmSection& keyframes = sections[KSM_SECTION_KEYFRAMES];
+		const KsmSection& strings = sections[KSM_SECTION_STRINGS];
+		const KsmSection& clips = sections[KSM_SECTION_CLIPS];
+		const KsmSection& lods = sections[KSM_SECTION_LODS];
+
+		if (modelSection.Size < sizeof(KsmModelRecord) ||
+			nodes.Size % sizeof(KsmNodeRecord) != 0 ||
+			meshes.Size % sizeof(KsmMeshRecord) != 0 ||
+			bones.Size % sizeof(KsmBoneRecord) != 0 ||
+			animations.Size % sizeof(KsmAnimationRecord) != 0 ||
+			tracks.Size % sizeof(KsmTrackRecord) != 0 ||
+			lods.Size % sizeof(KsmLodRecord) != 0)
+		{
+			return false;
+		}
+
+		//
+		// Model
+		//
+		KsmModelRecord modelRecord = modelSection.GetRecord<KsmModelRecord>(0);
+		model.Version = KsmVersion;
+		model.NumMeshes = modelRecord.NumMeshes;
+		model.NumMaterials = modelRecord.NumMaterials;
+		model.NumTextures = modelRecord.NumTextures;
+		model.NumAnimations = modelRecord.NumAnimations;
+		model.BoundsCenter = XMFLOAT3(modelRecord.BoundsCenter[0], modelRecord.BoundsCenter[1], modelRecord.BoundsCenter[2]);
+		model.BoundsExtents = XMFLOAT3(modelRecord.BoundsExtents[0], modelRecord.BoundsExtents[1], modelRecord.BoundsExtents[2]);
+
+		//
+		// Meshes
+		//
+		UINT meshCount = meshes.GetRecordCount<KsmMeshRecord>();
+		UINT boneCount = bones.GetRecordCount<KsmBoneRecord>();
+
+		model.Meshes.resize(meshCount);
+		for (UINT m = 0; m < meshCount; ++m)
+		{
+			KsmMeshRecord record = meshes.GetRecord<KsmMeshRecord>(m);
+			KsmMeshView& mesh = model.Meshes[m];
+
+			mesh.NumBones = record.NumBones;
+			mesh.FaceCount = record.FaceCount;
+			mesh.VertexCount = record.VertexCount;
+			mesh.IndexCount = record.IndexCount;
+
+			mesh.Diffuse = XMFLOAT4(record.Diffuse[0], record.Diffuse[1], record.Diffuse[2], record.Diffuse[3]);
+			mesh.Ambient = XMFLOAT4(record.Ambient[0], record.Ambient[1], record.Ambient[2], record.Ambient[3]);
+			mesh.Reflect = XMFLOAT4(record.Reflect[0], record.Reflect[1], record.Reflect[2], record.Reflect[3]);
+			mesh.Specular = XMFLOAT4(record.Specular[0], record.Specular[1], record.Specular[2], record.Specular[3]);
+
+			mesh.Opacity = record.Opacity;
+			mesh.Shininess = record.Shininess;
+			mesh.SpecularStrength = record.SpecularStrength;
+
+			mesh.IndicesAre16Bit = (record.Flags & KSM_MESH_16BIT_INDICES) != 0;
+			mesh.IndexSize = mesh.IndicesAre16Bit ? sizeof(uint16_t) : sizeof(uint32_t);
+			if (record.IndexOffset % KsmAlignment != 0 ||
+				!indices.Contains(record.IndexOffset, record.IndexCount, mesh.IndexSize))
+			{
+				return false;
+			}
+			mesh.IndexData = indices.Data + record.IndexOffset;
+
+			// The vertex layout has to match the engine's exactly for the data to be used in place
+			mesh.ContainsAnimations = (record.Flags & KSM_MESH_SKINNED) != 0;
+			mesh.VertexStride = mesh.ContainsAnimations ? strides.Skinned : strides.Static;
+			if (record.VertexStride != mesh.VertexStride ||
+				record.VertexOffset % KsmAlignment != 0 ||
+				!vertices.Contains(record.VertexOffset, record.VertexCount, mesh.VertexStride))
+			{
+				return false;
+			}
+			mesh.Vertices = vertices.Data + record.VertexOffset;
+
+			if (!readStringV2(strings, record.DiffusePathOffset, mesh.DiffusePath) ||
+				!readStringV2(strings, record.NormalPathOffset, mesh.NormalPath))
+			{
+				return false;
+			}
+
+			if (record.FirstBone > boneCount || record.NumBones > boneCount - record.FirstBone)
+			{
+				return false;
+			}
+
+			mesh.Bones.resize(record.NumBones);
+			for (UINT b = 0; b < record.NumBones; ++b)
+			{
+				KsmBoneRecord boneRecord = bones.GetRecord<KsmBoneRecord>(record.FirstBone + b);
+				if (!readStringV2(strings, boneRecord.NameOffset, mesh.Bones[b].Name))
+				{
+					return false;
+				}
+				memcpy(&mesh.Bones[b].Offset, boneRecord.Offset, sizeof(XMFLOAT4X4));
+			}
+
+			mesh.BoundsCenter = XMFLOAT3(record.BoundsCenter[0], record.BoundsCenter[1], record.BoundsCenter[2]);
+			mesh.BoundsExtents = XMFLOAT3(record.BoundsExtents[0], record.BoundsExtents[1], record.BoundsExtents[2]);
+		}
+
+		//
+		// Levels of detail, grouped by mesh
+		//
+		UINT lodCount = lods.GetRecordCount<KsmLodRecord>();
+		for (UINT l = 0; l < lodCount; ++l)
+		{
+			KsmLodRecord record = lods.GetRecord<KsmLodRecord>(l);
+			if (record.Mesh >= meshCount ||
+				(l > 0 && record.Mesh < lods.GetRecord<KsmLodRecord>(l - 1).Mesh))
+			{
+				return false;
+			}
+
+			KsmMeshView& mesh = model.Meshes[record.Mesh];
+			if (record.IndexOffset % KsmAlignment != 0 ||
+				!indices.Contains(record.IndexOffset, record.IndexCount, mesh.IndexSize))
+			{
+				return false;
+			}
+
+			KsmLodView lod;
+			lod.IndexCount = record.IndexCount;
+			lod.IndexData = indices.Data + record.IndexOffset;
+			lod.Error = record.Error;
+			mesh.Lods.push_back(lod);
+		}
+
+		//
+		// Nodes. Every parent has to come before its children and only the first node may be a root
+		//
+		UINT nodeCount = nodes.GetRecordCount<KsmNodeRecord>();
+
+		model.Nodes.resize(nodeCount);
+		for (UINT n = 0; n < nodeCount; ++n)
+		{
+			KsmNodeRecord record = nodes.GetRecord<KsmNodeRecord>(n);
+			KsmNodeView& node = model.Nodes[n];
+
+			bool validParent = (n == 0) ? (record.Parent == KsmNone) : (record.Parent < n);
+			if (!validParent ||
+				record.FirstMesh > meshCount ||
+				record.MeshCount > meshCount - record.FirstMesh ||
+				!readStringV2(strings, record.NameOffset, node.Name))
+			{
+				return false;
+			}
+
+			memcpy(&node.LocalTransform, record.LocalTransform, sizeof(XMFLOAT4X4));
+			node.Parent = record.Parent;
+			node.ChannelIndex = record.ChannelIndex;
+			node.FirstMesh = record.FirstMesh;
+			node.MeshCount = record.MeshCount;
+		}
+
+		//
+		// Animations
+		//
+		UINT animationCount = animations.GetRecordCount<KsmAnimationRecord>();
+		UINT trackCount = tracks.GetRecordCount<KsmTrackRecord>();
+		if (animationCount != model.NumAnimations)
+		{
+			return false;
+		}
+
+		model.Animations.resize(animationCount);
+		for (UINT a = 0; a < animationCount; ++a)
+		{
+			KsmAnimationRecord record = animations.GetRecord<KsmAnimationRecord>(a);
+			KsmAnimationView& animation = model.Animations[a];
+
+			if (!readStringV2(strings, record.NameOffset, animation.Name) ||
+				record.FirstTrack > trackCount ||
+				record.TrackCount > trackCount - record.FirstTrack ||
+				!clips.Contains(record.ClipOffset, record.ClipSize, sizeof(byte)))
+			{
+				return false;
+			}
+
+			animation.Duration = record.Duration;
+			animation.TicksPerSecond = record.TicksPerSecond;
+			animation.TotalFrames = record.TotalFrames;
+			animation.Clip = (record.ClipSize > 0) ? clips.Data + record.ClipOffset : nullptr;
+			animation.ClipSize = record.ClipSize;
+
+			animation.Tracks.resize(record.TrackCount);
+			for (UINT t = 0; t < record.TrackCount; ++t)
+			{
+				KsmTrackRecord trackRecord = tracks.GetRecord<KsmTrackRecord>(record.FirstTrack + t);
+				if (trackRecord.KeyframeOffset % KsmAlignment != 0 ||
+					!keyframes.Contains(trackRecord.KeyframeOffset, trackRecord.KeyframeCount, sizeof(KsmKeyframeRecord)))
+				{
+					return false;
+				}
+
+				animation.Tracks[t].KeyframeCount = trackRecord.KeyframeCount;
+				animation.Tracks[t].KeyframeStride = sizeof(KsmKeyframeRecord);
+				animation.Tracks[t].Keyframes = keyframes.Data + trackRecord.KeyframeOffset;
+			}
+		}
+
+		return true;
+	}
+
+	//
+	// Checks that hold for both versions and that the engine relies on
+	//
+	bool validateModel(_In_ const KsmModelView& model)
+	{
+		if (model.Nodes.empty() || model.NumMeshes != model.Meshes.size())
+		{
+			return false;
+		}
+
+		// The nodes' mesh ranges must each lie within the meshes and together cover every mesh exactly
+		// once, since the loader creates each mesh for the node that lists it and then walks all of them
+		std::vector<bool> owned(model.Meshes.size(), false);
+		size_t ownedCount = 0;
+		for (const auto& node : model.Nodes)
+		{
+			if (node.FirstMesh > model.Meshes.size() || node.MeshCount > model.Meshes.size() - node.FirstMesh)
+			{
+				return false;
+			}
+
+			for (UINT m = node.FirstMesh; m < node.FirstMesh + node.MeshCount; ++m)
+			{
+				if (owned[m])
+				{
+					return false;
+				}
+				owned[m] = true;
+			}
+			ownedCount += node.MeshCount;
+		}
+
+		if (ownedCount != model.Meshes.size())
+		{
+			return false;
+		}
+
+		// Indices are used to look up CPU side positions for picking and collision
+		for (const auto& mesh : model.Meshes)
+		{
+			for (UINT i = 0; i < mesh.IndexCount; ++i)
+			{
+				if (mesh.GetIndex(i) >= mesh.VertexCount)
+				{
+					return false;
+				}
+			}
+
+			// Levels of detail are drawn from the mesh's vertex buffer as triangle lists
+			for (UINT l = 0; l < mesh.Lods.size(); ++l)
+			{
+				if (mesh.Lods[l].IndexCount % 3 != 0)
+				{
+					return false;
+				}
+
+				for (UINT i = 0; i < mesh.Lods[l].IndexCount; ++i)
+				{
+					if (mesh.GetLodIndex(l, i) >= mesh.VertexCount)
+					{
+						return false;
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+}
+
+bool KsmReader::Read(
+	_In_ byte* data,
+	_In_ size_t size,
+	_In_ const KsmVertexStrides& strides,
+	_Out_ KsmModelView& model)
+{
+	model = KsmModelView();
+
+	if (data == nullptr)
+	{
+		return false;
+	}
+
+	uint32_t magic = 0;
+	if (size >= sizeof(KsmFileHeader))
+	{
+		memcpy(&magic, data, sizeof(uint32_t));
+	}
+
+	bool result = (magic == KsmMagic) ?
+		readV2(data, size, strides, model) :
+		readV1(data, size, strides, model);
+
+	return result && validateModel(model);
+}
+
+void KsmReader::ReadPositions(
+	_In_ const KsmMeshView& mesh,
+	_Out_ std::vector<XMFLOAT3>& positions)
+{
+	positions.resize(mesh.VertexCount);
+
+	const byte* vertex = mesh.Vertices;
+	for (UINT i = 0; i < mesh.VertexCount; ++i, vertex += mesh.VertexStride)
+	{
+		memcpy(&positions[i], vertex, sizeof(XMFLOAT3));
+	}
+}
+
+KsmKeyframe KsmReader::ReadKeyframe(
+	_In_ const KsmTrackView& track,
+	_In_ UINT k)
+{
+	// v1 and v2 keyframes share the same field order, v2 only pads them out
+	const byte* source = track.Keyframes + (size_t)k * track.KeyframeStride;
+
+	KsmKeyframe keyframe;
+	memcpy(&keyframe.Translation, source, sizeof(XMFLOAT3));
+	memcpy(&keyframe.Scale, source + sizeof(XMFLOAT3), sizeof(XMFLOAT3));
+	memcpy(&keyframe.RotationQuat, source + 2 * sizeof(XMFLOAT3), sizeof(XMFLOAT4));
+	memcpy(&keyframe.TimePos, source + 2 * sizeof(XMFLOAT3) + sizeof(XMFLOAT4), sizeof(float));
+	return keyframe;
+}
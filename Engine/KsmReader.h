@@ -0,0 +1,248 @@
+//////////////////////////////////////////////////////////////////////////
+// KsmReader.h
+// Parses KSM model files (v1 and v2) into views that point straight into
+// the loaded (or mapped) file. Every read is bounds checked so corrupt
+// files are rejected rather than crashing the loader. Has no dependency
+// on the graphics device so it can be run and profiled headless
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "KsmFormat.h"
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+namespace Engine
+{
+	//
+	// A bone as stored in the KSM file
+	//
+	struct KsmBoneView
+	{
+		std::wstring Name;
+		DirectX::XMFLOAT4X4 Offset;
+	};
+
+	//
+	// Returns index i of data holding indices of indexSize bytes
+	//
+	inline UINT ReadKsmIndex(
+		_In_ const byte* data,
+		_In_ UINT indexSize,
+		_In_ UINT i)
+	{
+		if (indexSize == sizeof(uint16_t))
+		{
+			uint16_t index;
+			memcpy(&index, data + i * sizeof(uint16_t), sizeof(uint16_t));
+			return index;
+		}
+
+		UINT index;
+		memcpy(&index, data + i * sizeof(UINT), sizeof(UINT));
+		return index;
+	}
+
+	//
+	// Stores index at position i of data holding indices of indexSize bytes. The index must fit
+	//
+	inline void WriteKsmIndex(
+		_Out_ byte* data,
+		_In_ UINT indexSize,
+		_In_ UINT i,
+		_In_ UINT index)
+	{
+		if (indexSize == sizeof(uint16_t))
+		{
+			uint16_t shortIndex = static_cast<uint16_t>(index);
+			memcpy(data + i * sizeof(uint16_t), &shortIndex, sizeof(uint16_t));
+			return;
+		}
+
+		memcpy(data + i * sizeof(UINT), &index, sizeof(UINT));
+	}
+
+	//
+	// A coarser level of detail of a mesh. IndexData points into the file data and holds indices of the
+	// mesh's IndexSize
+	//
+	struct KsmLodView
+	{
+		UINT IndexCount;
+		byte* IndexData;
+		float Error;
+	};
+
+	//
+	// A mesh as stored in the KSM file. IndexData and Vertices point into the file data, so the view
+	// is only valid for as long as that data is
+	//
+	struct KsmMeshView
+	{
+		//
+		// Returns the index at the given position regardless of how it is stored
+		//
+		UINT GetIndex(_In_ UINT i) const
+		{
+			return ReadKsmIndex(IndexData, IndexSize, i);
+		}
+
+		UINT GetLodIndex(
+			_In_ UINT lod,
+			_In_ UINT i) const
+		{
+			return ReadKsmIndex(Lods[lod].IndexData, IndexSize, i);
+		}
+
+		UINT NumBones;
+		UINT FaceCount;
+		UINT VertexCount;
+		UINT IndexCount;
+
+		DirectX::XMFLOAT4 Diffuse;
+		DirectX::XMFLOAT4 Ambient;
+		DirectX::XMFLOAT4 Reflect;
+		DirectX::XMFLOAT4 Specular;
+
+		float Opacity;
+		float Shininess;
+		float SpecularStrength;
+
+		// Indicates all indices fit in 16 bits. v1 files always store 32 bit indices (IndexSize == 4)
+		// so those need narrowing before they can be used for a 16 bit index buffer
+		bool IndicesAre16Bit;
+		UINT IndexSize;
+		byte* IndexData;
+
+		// Skinned meshes store VertexPositionNormalTextureBoneWeight, the rest VertexPositionNormalTexture
+		bool ContainsAnimations;
+		byte* Vertices;
+		UINT VertexStride;
+
+		std::wstring DiffusePath;
+		std::wstring NormalPath;
+
+		std::vector<KsmBoneView> Bones;
+
+		DirectX::XMFLOAT3 BoundsCenter;
+		DirectX::XMFLOAT3 BoundsExtents;
+
+		// Coarser levels of detail, finest first. Empty if the file has none for the mesh
+		std::vector<KsmLodView> Lods;
+	};
+
+	//
+	// A node as stored in the KSM file. Nodes are listed parents first, the root node being the first
+	//
+	struct KsmNodeView
+	{
+		std::wstring Name;
+		DirectX::XMFLOAT4X4 LocalTransform;
+
+		// Index of the parent node, KsmNone for the root
+		UINT Parent;
+
+		// Index in the animation's channel array, KsmNone if not animated
+		UINT ChannelIndex;
+
+		// The range of KsmModelView::Meshes that belong to this node
+		UINT FirstMesh;
+		UINT MeshCount;
+	};
+
+	//
+	// A keyframe as stored in the KSM file
+	//
+	struct KsmKeyframe
+	{
+		DirectX::XMFLOAT3 Translation;
+		DirectX::XMFLOAT3 Scale;
+		DirectX::XMFLOAT4 RotationQuat;
+		float TimePos;
+	};
+
+	//
+	// The keyframes of one bone in an animation. Keyframes points into the file data
+	//
+	struct KsmTrackView
+	{
+		UINT KeyframeCount;
+		UINT KeyframeStride;
+		byte* Keyframes;
+	};
+
+	struct KsmAnimationView
+	{
+		std::wstring Name;
+		float Duration;
+		float TicksPerSecond;
+		UINT TotalFrames;
+		std::vector<KsmTrackView> Tracks;
+
+		// The compressed form of the clip (see CompressedClip) if the file has one, null otherwise.
+		// Points into the file data
+		byte* Clip;
+		UINT ClipSize;
+	};
+
+	struct KsmModelView
+	{
+		// The version of the file that was read
+		UINT Version;
+
+		UINT NumMeshes;
+		UINT NumMaterials;
+		UINT NumTextures;
+		UINT NumAnimations;
+
+		std::vector<KsmNodeView> Nodes;
+		std::vector<KsmMeshView> Meshes;
+		std::vector<KsmAnimationView> Animations;
+
+		DirectX::XMFLOAT3 BoundsCenter;
+		DirectX::XMFLOAT3 BoundsExtents;
+	};
+
+	//
+	// Size of the vertex records stored in a KSM file. The engine checks these against its vertex types,
+	// headless tools just need them to step over the vertex data
+	//
+	struct KsmVertexStrides
+	{
+		UINT Static;
+		UINT Skinned;
+	};
+
+	namespace KsmReader
+	{
+		//
+		// FullName:  Engine::KsmReader::Read
+		// Reads a whole v1 or v2 KSM file. No index, vertex or keyframe data is copied. Returns false
+		// if the data is truncated, references anything outside of the file or is otherwise malformed
+		//
+		bool Read(
+			_In_ byte* data,
+			_In_ size_t size,
+			_In_ const KsmVertexStrides& strides,
+			_Out_ KsmModelView& model);
+
+		//
+		// FullName:  Engine::KsmReader::ReadPositions
+		// Gathers the positions of the mesh's vertices into the given array. Positions are the first
+		// member of both KSM vertex types
+		//
+		void ReadPositions(
+			_In_ const KsmMeshView& mesh,
+			_Out_ std::vector<DirectX::XMFLOAT3>& positions);
+
+		//
+		// FullName:  Engine::KsmReader::ReadKeyframe
+		// Returns keyframe k of the given track
+		//
+		KsmKeyframe ReadKeyframe(
+			_In_ const KsmTrackView& track,
+			_In_ UINT k);
+	}
+}
@@ -0,0 +1,269 @@
+//////////////////////////////////////////////////////////////////////////
+// KsmWriter.cpp
+// Writes models in the v2 KSM layout described in KsmFormat.h. Used by
+// the asset pipeline to convert models read by KsmReader (v1 or v2)
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "KsmWriter.h"
+
+using namespace Engine;
+using namespace DirectX;
+
+namespace
+{
+	template<class T>
+	void append(
+		_Inout_ std::vector<byte>& blob,
+		_In_ const T& value)
+	{
+		const byte* bytes = reinterpret_cast<const byte*>(&value);
+		blob.insert(blob.end(), bytes, bytes + sizeof(T));
+	}
+
+	//
+	// Pads the blob with zeroes up to the next KsmAlignment boundary and returns the new size
+	//
+	uint32_t align(_Inout_ std::vector<byte>& blob)
+	{
+		blob.resize((blob.size() + KsmAlignment - 1) & ~(size_t)(KsmAlignment - 1), 0);
+		return static_cast<uint32_t>(blob.size());
+	}
+
+	//
+	// Collects the strings of the model, storing each distinct one once
+	//
+	class StringTable
+	{
+	public:
+
+		uint32_t Add(_In_ const std::wstring& value)
+		{
+			if (value.empty())
+			{
+				return KsmNone;
+			}
+
+			auto found = _offsets.find(value);
+			if (found != _offsets.end())
+			{
+				return found->second;
+			}
+
+			uint32_t offset = static_cast<uint32_t>(Blob.size());
+			append(Blob, static_cast<uint32_t>(value.size()));
+			for (wchar_t c : value)
+			{
+				append(Blob, static_cast<uint16_t>(c));
+			}
+
+			_offsets[value] = offset;
+			return offset;
+		}
+
+		std::vector<byte> Blob;
+
+	private:
+
+		std::map<std::wstring, uint32_t> _offsets;
+	};
+}
+
+void KsmWriter::Write(
+	_In_ const KsmModelView& model,
+	_Out_ std::vector<byte>& output,
+	_In_opt_ const ClipCompressionSettings* compression)
+{
+	std::vector<byte> sections[KSM_SECTION_END];
+	StringTable strings;
+
+	//
+	// Model
+	//
+	KsmModelRecord modelRecord = {};
+	modelRecord.NumMeshes = model.NumMeshes;
+	modelRecord.NumMaterials = model.NumMaterials;
+	modelRecord.NumTextures = model.NumTextures;
+	modelRecord.NumAnimations = static_cast<uint32_t>(model.Animations.size());
+	memcpy(modelRecord.BoundsCenter, &model.BoundsCenter, sizeof(XMFLOAT3));
+	memcpy(modelRecord.BoundsExtents, &model.BoundsExtents, sizeof(XMFLOAT3));
+	append(sections[KSM_SECTION_MODEL], modelRecord);
+
+	//
+	// Nodes
+	//
+	for (const auto& node : model.Nodes)
+	{
+		KsmNodeRecord record = {};
+		record.NameOffset = strings.Add(node.Name);
+		record.Parent = node.Parent;
+		record.ChannelIndex = node.ChannelIndex;
+		record.FirstMesh = node.FirstMesh;
+		record.MeshCount = node.MeshCount;
+		memcpy(record.LocalTransform, &node.LocalTransform, sizeof(XMFLOAT4X4));
+		append(sections[KSM_SECTION_NODES], record);
+	}
+
+	//
+	// Meshes, their bones and their index and vertex data
+	//
+	uint32_t boneCount = 0;
+	for (size_t m = 0; m < model.Meshes.size(); ++m)
+	{
+		const KsmMeshView& mesh = model.Meshes[m];
+
+		KsmMeshRecord record = {};
+		record.NumBones = static_cast<uint32_t>(mesh.Bones.size());
+		record.FaceCount = mesh.FaceCount;
+		record.VertexCount = mesh.VertexCount;
+		record.IndexCount = mesh.IndexCount;
+
+		memcpy(record.Diffuse, &mesh.Diffuse, sizeof(XMFLOAT4));
+		memcpy(record.Ambient, &mesh.Ambient, sizeof(XMFLOAT4));
+		memcpy(record.Reflect, &mesh.Reflect, sizeof(XMFLOAT4));
+		memcpy(record.Specular, &mesh.Specular, sizeof(XMFLOAT4));
+
+		record.Opacity = mesh.Opacity;
+		record.Shininess = mesh.Shininess;
+		record.SpecularStrength = mesh.SpecularStrength;
+
+		record.Flags = (mesh.IndicesAre16Bit ? KSM_MESH_16BIT_INDICES : 0) | (mesh.ContainsAnimations ? KSM_MESH_SKINNED : 0);
+
+		std::vector<byte>& indices = sections[KSM_SECTION_INDICES];
+		record.IndexOffset = align(indices);
+		for (UINT i = 0; i < mesh.IndexCount; ++i)
+		{
+			if (mesh.IndicesAre16Bit)
+			{
+				append(indices, static_cast<uint16_t>(mesh.GetIndex(i)));
+			}
+			else
+			{
+				append(indices, static_cast<uint32_t>(mesh.GetIndex(i)));
+			}
+		}
+
+		for (UINT l = 0; l < mesh.Lods.size(); ++l)
+		{
+			KsmLodRecord lodRecord = {};
+			lodRecord.Mesh = static_cast<uint32_t>(m);
+			lodRecord.IndexOffset = align(indices);
+			lodRecord.IndexCount = mesh.Lods[l].IndexCount;
+			lodRecord.Error = mesh.Lods[l].Error;
+			append(sections[KSM_SECTION_LODS], lodRecord);
+
+			for (UINT i = 0; i < lodRecord.IndexCount; ++i)
+			{
+				if (mesh.IndicesAre16Bit)
+				{
+					append(indices, static_cast<uint16_t>(mesh.GetLodIndex(l, i)));
+				}
+				else
+				{
+					append(indices, static_cast<uint32_t>(mesh.GetLodIndex(l, i)));
+				}
+			}
+		}
+
+		std::vector<byte>& vertices = sections[KSM_SECTION_VERTICES];
+		record.VertexOffset = align(vertices);
+		record.VertexStride = mesh.VertexStride;
+		vertices.insert(vertices.end(), mesh.Vertices, mesh.Vertices + (size_t)mesh.VertexCount * mesh.VertexStride);
+
+		record.FirstBone = boneCount;
+		for (const auto& bone : mesh.Bones)
+		{
+			KsmBoneRecord boneRecord = {};
+			boneRecord.NameOffset = strings.Add(bone.Name);
+			memcpy(boneRecord.Offset, &bone.Offset, sizeof(XMFLOAT4X4));
+			append(sections[KSM_SECTION_BONES], boneRecord);
+			++boneCount;
+		}
+
+		record.DiffusePathOffset = strings.Add(mesh.DiffusePath);
+		record.NormalPathOffset = strings.Add(mesh.NormalPath);
+
+		memcpy(record.BoundsCenter, &mesh.BoundsCenter, sizeof(XMFLOAT3));
+		memcpy(record.BoundsExtents, &mesh.BoundsExtents, sizeof(XMFLOAT3));
+		append(sections[KSM_SECTION_MESHES], record);
+	}
+
+	//
+	// Animations, their tracks and keyframes and, if asked for, their compressed clips
+	//
+	std::vector<byte> clip;
+	uint32_t trackCount = 0;
+	for (const auto& animation : model.Animations)
+	{
+		KsmAnimationRecord record = {};
+		record.NameOffset = strings.Add(animation.Name);
+		record.Duration = animation.Duration;
+		record.TicksPerSecond = animation.TicksPerSecond;
+		record.TotalFrames = animation.TotalFrames;
+		record.FirstTrack = trackCount;
+		record.TrackCount = static_cast<uint32_t>(animation.Tracks.size());
+
+		if (compression != nullptr)
+		{
+			CompressedClip::Compress(animation, *compression, clip);
+
+			std::vector<byte>& clips = sections[KSM_SECTION_CLIPS];
+			record.ClipOffset = align(clips);
+			record.ClipSize = static_cast<uint32_t>(clip.size());
+			clips.insert(clips.end(), clip.begin(), clip.end());
+		}
+
+		append(sections[KSM_SECTION_ANIMATIONS], record);
+
+		for (const auto& track : animation.Tracks)
+		{
+			KsmTrackRecord trackRecord;
+			trackRecord.KeyframeOffset = static_cast<uint32_t>(sections[KSM_SECTION_KEYFRAMES].size());
+			trackRecord.KeyframeCount = track.KeyframeCount;
+			append(sections[KSM_SECTION_TRACKS], trackRecord);
+			++trackCount;
+
+			for (UINT k = 0; k < track.KeyframeCount; ++k)
+			{
+				KsmKeyframe keyframe = KsmReader::ReadKeyframe(track, k);
+
+				KsmKeyframeRecord keyframeRecord = {};
+				memcpy(keyframeRecord.Translation, &keyframe.Translation, sizeof(XMFLOAT3));
+				memcpy(keyframeRecord.Scale, &keyframe.Scale, sizeof(XMFLOAT3));
+				memcpy(keyframeRecord.RotationQuat, &keyframe.RotationQuat, sizeof(XMFLOAT4));
+				keyframeRecord.TimePos = keyframe.TimePos;
+				append(sections[KSM_SECTION_KEYFRAMES], keyframeRecord);
+			}
+		}
+	}
+
+	sections[KSM_SECTION_STRINGS].swap(strings.Blob);
+
+	//
+	// Lay out the header, the section directory and then each section on an aligned offset
+	//
+	const uint32_t sectionCount = KSM_SECTION_END - KSM_SECTION_MODEL;
+
+	output.clear();
+	output.resize(sizeof(KsmFileHeader) + sectionCount * sizeof(KsmSectionEntry), 0);
+
+	for (uint32_t type = KSM_SECTION_MODEL; type < KSM_SECTION_END; ++type)
+	{
+		KsmSectionEntry entry = {};
+		entry.Type = type;
+		entry.Offset = align(output);
+		entry.Size = sections[type].size();
+		output.insert(output.end(), sections[type].begin(), sections[type].end());
+
+		memcpy(&output[sizeof(KsmFileHeader) + (type - KSM_SECTION_MODEL) * sizeof(KsmSectionEntry)], &entry, sizeof(KsmSectionEntry));
+	}
+
+	KsmFileHeader header = {};
+	header.Magic = KsmMagic;
+	header.Version = KsmVersion;
+	header.HeaderSize = sizeof(KsmFileHeader);
+	header.SectionCount = sectionCount;
+	header.FileSize = output.size();
+	memcpy(&output[0], &header, sizeof(KsmFileHeader));
+}
@@ -0,0 +1,29 @@
+//////////////////////////////////////////////////////////////////////////
+// KsmWriter.h
+// Writes models in the v2 KSM layout described in KsmFormat.h. Used by
+// the asset pipeline to convert models read by KsmReader (v1 or v2)
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CompressedClip.h"
+#include "KsmReader.h"
+
+namespace Engine
+{
+	namespace KsmWriter
+	{
+		//
+		// FullName:  Engine::KsmWriter::Write
+		// Serializes the model into output as a v2 KSM file. Meshes flagged as IndicesAre16Bit are
+		// written with 16 bit indices so the engine can create their index buffers in place, along
+		// with their levels of detail. If compression settings are given, every animation is also
+		// written as a compressed clip, which the engine loads instead of the keyframes
+		//
+		void Write(
+			_In_ const KsmModelView& model,
+			_Out_ std::vector<byte>& output,
+			_In_opt_ const ClipCompressionSettings* compression = nullptr);
+	}
+}
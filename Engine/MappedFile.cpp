@@ -0,0 +1,158 @@
+//////////////////////////////////////////////////////////////////////////
+// MappedFile.cpp
+// Maps a file on disk into the address space of the process so assets can
+// be parsed and handed to the GPU straight from the page cache instead of
+// being read into an intermediate heap copy first
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include "../KsmCreatorLib/PathString.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace Engine;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+	: _file(INVALID_HANDLE_VALUE), _mapping(nullptr), _data(nullptr), _size(0)
+{}
+
+bool MappedFile::Open(_In_ const std::wstring& path)
+{
+	Close();
+
+	_file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(_file, &size) || size.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	// Mapping with PAGE_WRITECOPY gives us a writable view without touching the file. Pages are only
+	// copied if something actually writes to them, which the loaders never do
+	_mapping = CreateFileMappingW(_file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (_mapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	_data = static_cast<byte*>(MapViewOfFile(_mapping, FILE_MAP_COPY, 0, 0, 0));
+	if (_data == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	_size = (size_t)size.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data)
+	{
+		UnmapViewOfFile(_data);
+		_data = nullptr;
+	}
+
+	if (_mapping)
+	{
+		CloseHandle(_mapping);
+		_mapping = nullptr;
+	}
+
+	if (_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(_file);
+		_file = INVALID_HANDLE_VALUE;
+	}
+
+	_size = 0;
+}
+
+#else
+
+MappedFile::MappedFile()
+	: _file(-1), _data(nullptr), _size(0)
+{}
+
+bool MappedFile::Open(_In_ const std::wstring& path)
+{
+	Close();
+
+	PathString narrowPath(path.c_str());
+	_file = open(narrowPath.ToCStr(), O_RDONLY);
+	if (_file < 0)
+	{
+		return false;
+	}
+
+	struct stat info;
+	if (fstat(_file, &info) != 0 || info.st_size == 0)
+	{
+		Close();
+		return false;
+	}
+
+	// MAP_PRIVATE gives us a copy-on-write view, see the note in the Windows implementation
+	void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, _file, 0);
+	if (view == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	_data = static_cast<byte*>(view);
+	_size = (size_t)info.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (_data)
+	{
+		munmap(_data, _size);
+		_data = nullptr;
+	}
+
+	if (_file >= 0)
+	{
+		close(_file);
+		_file = -1;
+	}
+
+	_size = 0;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+void MappedFile::Prefetch() const
+{
+	const size_t pageSize = 4096;
+
+	volatile byte sink = 0;
+	for (size_t offset = 0; offset < _size; offset += pageSize)
+	{
+		sink ^= _data[offset];
+	}
+}
@@ -0,0 +1,91 @@
+//////////////////////////////////////////////////////////////////////////
+// MappedFile.h
+// Maps a file on disk into the address space of the process so assets can
+// be parsed and handed to the GPU straight from the page cache instead of
+// being read into an intermediate heap copy first
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+
+namespace Engine
+{
+	class MappedFile
+	{
+	public:
+
+		MappedFile();
+		~MappedFile();
+
+		//
+		// FullName:  Engine::MappedFile::Open
+		// Maps the whole file at the given path. The view is copy-on-write so the loaders can keep
+		// taking a byte* without ever modifying the file on disk. Returns false if the file could not
+		// be opened or mapped
+		//
+		bool Open(_In_ const std::wstring& path);
+
+		//
+		// Unmaps the view and closes the file. Any pointers into the view are invalid after this
+		//
+		void Close();
+
+		//
+		// FullName:  Engine::MappedFile::Prefetch
+		// Touches every page of the view so it is read from disk now, on the calling thread, instead of
+		// on first use. Lets a background loader take the I/O cost off the thread that uses the data
+		//
+		void Prefetch() const;
+
+		//
+		// Returns bool indicating if a file is currently mapped
+		//
+		bool IsOpen() const
+		{
+			return _data != nullptr;
+		}
+
+		//
+		// Pointer to the first byte of the mapped file
+		//
+		byte* GetData() const
+		{
+			return _data;
+		}
+
+		//
+		// Size of the mapped file in bytes
+		//
+		size_t GetSize() const
+		{
+			return _size;
+		}
+
+	private:
+
+		// Make class not copyable
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+	private:
+
+#ifdef _WIN32
+		// Handle to the file on disk
+		HANDLE _file;
+
+		// Handle to the file mapping object
+		HANDLE _mapping;
+#else
+		// Descriptor of the file on disk
+		int _file;
+#endif
+
+		// Start of the mapped view
+		byte* _data;
+
+		// Size of the mapped view in bytes
+		size_t _size;
+	};
+}
@@ -0,0 +1,940 @@
+//////////////////////////////////////////////////////////////////////////
+// MeshBvh.cpp
+// A bounding volume hierarchy over the triangles of one mesh, in the
+// mesh's own space. Built once at load time with a binned surface area
+// heuristic so ray queries only test the triangles in the boxes the ray
+// actually passes through. Callers transform the ray into mesh space
+// rather than transforming the triangles. Leaves store their triangles
+// as structure-of-arrays packets of four that are tested at once with
+// SSE where it is available (unless MESHBVH_NO_SIMD is defined).
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "MeshBvh.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if !defined(MESHBVH_NO_SIMD) && (defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__))
+#define MESHBVH_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace DirectX;
+using namespace Engine;
+
+namespace
+{
+	// Nodes with this many triangles or fewer are never split
+	const UINT MaxLeafTriangles = 4;
+
+	// Number of centroid bins per axis the split candidates are taken from
+	const UINT BinCount = 12;
+
+	// Deepest the tree is built. Traversal keeps at most one pending sibling per level on its stack
+	const UINT MaxDepth = 64;
+
+	// The triangle index of the unused lanes of a leaf's last packet
+	const UINT NoTriangle = 0xFFFFFFFF;
+
+	// Number of rays the batched any-hit query traverses together, one per bit of a uint64_t
+	const UINT RayGroupSize = 64;
+
+	// 1 + 2 * gamma(3), what a slab's exit distance is scaled by to cover its rounding error
+	const float SlabExitScale = 1.0f + 2.0f * (1.5f * FLT_EPSILON) / (1.0f - 1.5f * FLT_EPSILON);
+
+	float component(_In_ const XMFLOAT3& v, _In_ UINT axis)
+	{
+		return (&v.x)[axis];
+	}
+
+	XMFLOAT3 subtract(_In_ const XMFLOAT3& a, _In_ const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+#ifndef MESHBVH_SSE
+	// Only the scalar triangle test needs these
+	XMFLOAT3 cross(_In_ const XMFLOAT3& a, _In_ const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	float dot(_In_ const XMFLOAT3& a, _In_ const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+#endif
+
+	struct Bounds
+	{
+		Bounds()
+			: Min(FLT_MAX, FLT_MAX, FLT_MAX), Max(-FLT_MAX, -FLT_MAX, -FLT_MAX)
+		{}
+
+		void Grow(_In_ const XMFLOAT3& point)
+		{
+			Min = XMFLOAT3(std::min(Min.x, point.x), std::min(Min.y, point.y), std::min(Min.z, point.z));
+			Max = XMFLOAT3(std::max(Max.x, point.x), std::max(Max.y, point.y), std::max(Max.z, point.z));
+		}
+
+		void Grow(_In_ const Bounds& other)
+		{
+			if (other.IsEmpty())
+			{
+				return;
+			}
+
+			Grow(other.Min);
+			Grow(other.Max);
+		}
+
+		bool IsEmpty() const
+		{
+			return Min.x > Max.x;
+		}
+
+		float SurfaceArea() const
+		{
+			if (IsEmpty())
+			{
+				return 0.0f;
+			}
+
+			XMFLOAT3 size = subtract(Max, Min);
+			return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+		}
+
+		XMFLOAT3 Min;
+		XMFLOAT3 Max;
+	};
+
+	struct Bin
+	{
+		Bin()
+			: Count(0)
+		{}
+
+		Bounds Box;
+		UINT Count;
+	};
+
+	//
+	// Narrows [tEnter, tExit] to where the ray is between the two slabs of one axis. An axis the ray is
+	// parallel to has an infinite inverse direction and is decided by where the origin is alone: the slab
+	// distances would be 0 * inf = NaN for an origin on a slab, or an interval that ends at 0 for a
+	// negative zero direction, and either would cut off a ray lying in the face of the box. The exit is
+	// pushed out by the most the rounding of the two operations can have pulled it in (Ize, "Robust BVH
+	// Ray Traversal"), so a ray through an edge or corner of the box isn't lost to rounding either
+	//
+	void clipToSlab(
+		_In_ float boxMin,
+		_In_ float boxMax,
+		_In_ float origin,
+		_In_ float inverseDirection,
+		_Inout_ float& tEnter,
+		_Inout_ float& tExit)
+	{
+		if (std::isinf(inverseDirection))
+		{
+			if (origin < boxMin || origin > boxMax)
+			{
+				tExit = -1.0f;
+			}
+			return;
+		}
+
+		float t1 = (boxMin - origin) * inverseDirection;
+		float t2 = (boxMax - origin) * inverseDirection;
+		tEnter = std::max(tEnter, std::min(t1, t2));
+		tExit = std::min(tExit, std::max(t1, t2) * SlabExitScale);
+	}
+
+	//
+	// Slab test of a ray against a box, edges and faces included
+	//
+	bool intersectsBox(
+		_In_ const XMFLOAT3& boxMin,
+		_In_ const XMFLOAT3& boxMax,
+		_In_ const XMFLOAT3& origin,
+		_In_ const XMFLOAT3& inverseDirection,
+		_In_ float maxT,
+		_Out_ float& tEnter)
+	{
+		tEnter = 0.0f;
+		float tExit = maxT;
+		clipToSlab(boxMin.x, boxMax.x, origin.x, inverseDirection.x, tEnter, tExit);
+		clipToSlab(boxMin.y, boxMax.y, origin.y, inverseDirection.y, tEnter, tExit);
+		clipToSlab(boxMin.z, boxMax.z, origin.z, inverseDirection.z, tEnter, tExit);
+		return tEnter <= tExit;
+	}
+
+	XMFLOAT3 inverse(_In_ const XMFLOAT3& direction)
+	{
+		return XMFLOAT3(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+	}
+
+#ifdef MESHBVH_SSE
+	UINT lowestSetBit(_In_ uint64_t mask)
+	{
+#if defined(__GNUC__)
+		return static_cast<UINT>(__builtin_ctzll(mask));
+#elif defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, mask);
+		return index;
+#elif defined(_MSC_VER)
+		unsigned long index;
+		if (_BitScanForward(&index, static_cast<unsigned long>(mask)))
+		{
+			return index;
+		}
+		_BitScanForward(&index, static_cast<unsigned long>(mask >> 32));
+		return index + 32;
+#else
+		UINT index = 0;
+		while (!(mask & 1))
+		{
+			mask >>= 1;
+			++index;
+		}
+		return index;
+#endif
+	}
+
+	//
+	// A group of the batched any-hit query's rays as structure-of-arrays, so their box tests can be
+	// made four rays at a time
+	//
+	struct RayGroup
+	{
+		float Origin[3][RayGroupSize];
+		float InverseDirection[3][RayGroupSize];
+		float MaxT[RayGroupSize];
+	};
+
+	//
+	// intersectsBox for the four rays of a group starting at first, returning a bit per ray that passes
+	// through the box. The same slab clipping as clipToSlab: a lane parallel to an axis leaves its
+	// interval alone and misses if its origin is outside that axis's slab
+	//
+	UINT intersectsBoxes(
+		_In_ const XMFLOAT3& boxMin,
+		_In_ const XMFLOAT3& boxMax,
+		_In_ const RayGroup& group,
+		_In_ UINT first)
+	{
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		const __m128 infinity = _mm_set1_ps(INFINITY);
+
+		__m128 tEnter = _mm_setzero_ps();
+		__m128 tExit = _mm_loadu_ps(group.MaxT + first);
+		__m128 outside = _mm_setzero_ps();
+
+		for (UINT axis = 0; axis < 3; ++axis)
+		{
+			__m128 origin = _mm_loadu_ps(group.Origin[axis] + first);
+			__m128 inverseDirection = _mm_loadu_ps(group.InverseDirection[axis] + first);
+			__m128 slabMin = _mm_set1_ps(component(boxMin, axis));
+			__m128 slabMax = _mm_set1_ps(component(boxMax, axis));
+
+			__m128 t1 = _mm_mul_ps(_mm_sub_ps(slabMin, origin), inverseDirection);
+			__m128 t2 = _mm_mul_ps(_mm_sub_ps(slabMax, origin), inverseDirection);
+			__m128 parallel = _mm_cmpeq_ps(_mm_andnot_ps(signBit, inverseDirection), infinity);
+
+			// tEnter is never negative, so zeroing the parallel lanes' entry leaves it alone
+			tEnter = _mm_max_ps(tEnter, _mm_andnot_ps(parallel, _mm_min_ps(t1, t2)));
+			__m128 exit = _mm_mul_ps(_mm_max_ps(t1, t2), _mm_set1_ps(SlabExitScale));
+			tExit = _mm_min_ps(tExit, _mm_or_ps(_mm_and_ps(parallel, infinity), _mm_andnot_ps(parallel, exit)));
+
+			__m128 outsideSlab = _mm_or_ps(_mm_cmplt_ps(origin, slabMin), _mm_cmpgt_ps(origin, slabMax));
+			outside = _mm_or_ps(outside, _mm_and_ps(parallel, outsideSlab));
+		}
+
+		return static_cast<UINT>(_mm_movemask_ps(_mm_andnot_ps(outside, _mm_cmple_ps(tEnter, tExit))));
+	}
+#endif
+}
+
+MeshBvh::MeshBvh()
+{}
+
+void MeshBvh::Clear()
+{
+	_nodes.clear();
+	_packets.clear();
+	_triangles.clear();
+}
+
+void MeshBvh::Build(
+	_In_ const std::vector<XMFLOAT3>& positions,
+	_In_ const std::vector<UINT>& indices)
+{
+	Clear();
+
+	//
+	// Gather the bounds and centroid of every valid triangle
+	std::vector<UINT> order;
+	std::vector<Bounds> triangleBounds;
+	std::vector<XMFLOAT3> centroids;
+
+	UINT triangleCount = static_cast<UINT>(indices.size() / 3);
+	order.reserve(triangleCount);
+	triangleBounds.reserve(triangleCount);
+	centroids.reserve(triangleCount);
+
+	for (UINT n = 0; n < triangleCount; ++n)
+	{
+		UINT i0 = indices[n * 3 + 0];
+		UINT i1 = indices[n * 3 + 1];
+		UINT i2 = indices[n * 3 + 2];
+
+		if (i0 >= positions.size() || i1 >= positions.size() || i2 >= positions.size())
+		{
+			continue;
+		}
+
+		Bounds box;
+		box.Grow(positions[i0]);
+		box.Grow(positions[i1]);
+		box.Grow(positions[i2]);
+
+		order.push_back(n);
+		triangleBounds.push_back(box);
+		centroids.push_back(XMFLOAT3(
+			(box.Min.x + box.Max.x) * 0.5f,
+			(box.Min.y + box.Max.y) * 0.5f,
+			(box.Min.z + box.Max.z) * 0.5f));
+	}
+
+	if (order.empty())
+	{
+		return;
+	}
+
+	// order holds indices into the gathered arrays from here on, mapped back to mesh triangles at the end
+	std::vector<UINT> triangleOfEntry(order);
+	for (UINT i = 0; i < order.size(); ++i)
+	{
+		order[i] = i;
+	}
+
+	// A binary tree with one triangle per leaf at most has 2n - 1 nodes. Reserving keeps references valid
+	_nodes.reserve(order.size() * 2);
+
+	Node root;
+	root.First = 0;
+	root.Count = static_cast<UINT>(order.size());
+	_nodes.push_back(root);
+
+	// Nodes still to be split, with their depth
+	std::vector<std::pair<UINT, UINT>> pending(1, std::make_pair(0U, 1U));
+	while (!pending.empty())
+	{
+		UINT nodeIndex = pending.back().first;
+		UINT depth = pending.back().second;
+		pending.pop_back();
+
+		Node& node = _nodes[nodeIndex];
+
+		Bounds nodeBounds;
+		Bounds centroidBounds;
+		for (UINT i = node.First; i < node.First + node.Count; ++i)
+		{
+			nodeBounds.Grow(triangleBounds[order[i]]);
+			centroidBounds.Grow(centroids[order[i]]);
+		}
+
+		node.Min = nodeBounds.Min;
+		node.Max = nodeBounds.Max;
+
+		if (node.Count <= MaxLeafTriangles || depth >= MaxDepth)
+		{
+			continue;
+		}
+
+		//
+		// Find the cheapest split over the bins of every axis
+		float bestCost = FLT_MAX;
+		UINT bestAxis = 0;
+		UINT bestSplit = 0;
+
+		for (UINT axis = 0; axis < 3; ++axis)
+		{
+			float low = component(centroidBounds.Min, axis);
+			float extent = component(centroidBounds.Max, axis) - low;
+			if (!(extent > 0.0f))
+			{
+				continue;
+			}
+
+			float scale = BinCount / extent;
+
+			Bin bins[BinCount];
+			for (UINT i = node.First; i < node.First + node.Count; ++i)
+			{
+				UINT bin = std::min(static_cast<UINT>((component(centroids[order[i]], axis) - low) * scale), BinCount - 1);
+				bins[bin].Count++;
+				bins[bin].Box.Grow(triangleBounds[order[i]]);
+			}
+
+			// Sweep from the right to get the cost of everything right of each split, then from the left
+			float rightArea[BinCount];
+			UINT rightCount[BinCount];
+			Bounds rightBox;
+			UINT count = 0;
+			for (UINT b = BinCount - 1; b > 0; --b)
+			{
+				rightBox.Grow(bins[b].Box);
+				count += bins[b].Count;
+				rightArea[b] = rightBox.SurfaceArea();
+				rightCount[b] = count;
+			}
+
+			Bounds leftBox;
+			count = 0;
+			for (UINT split = 1; split < BinCount; ++split)
+			{
+				leftBox.Grow(bins[split - 1].Box);
+				count += bins[split - 1].Count;
+
+				if (count == 0 || rightCount[split] == 0)
+				{
+					continue;
+				}
+
+				float cost = leftBox.SurfaceArea() * count + rightArea[split] * rightCount[split];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split;
+				}
+			}
+		}
+
+		// All the centroids are in the same spot, nothing to split on
+		if (bestSplit == 0)
+		{
+			continue;
+		}
+
+		//
+		// Partition the triangles around the chosen split
+		float low = component(centroidBounds.Min, bestAxis);
+		float scale = BinCount / (component(centroidBounds.Max, bestAxis) - low);
+
+		auto middle = std::partition(order.begin() + node.First, order.begin() + node.First + node.Count, [&](UINT entry)
+		{
+			UINT bin = std::min(static_cast<UINT>((component(centroids[entry], bestAxis) - low) * scale), BinCount - 1);
+			return bin < bestSplit;
+		});
+
+		UINT leftCount = static_cast<UINT>(middle - order.begin()) - node.First;
+
+		Node left;
+		left.First = node.First;
+		left.Count = leftCount;
+
+		Node right;
+		right.First = node.First + leftCount;
+		right.Count = node.Count - leftCount;
+
+		UINT leftIndex = static_cast<UINT>(_nodes.size());
+		node.First = leftIndex;
+		node.Count = 0;
+
+		_nodes.push_back(left);
+		_nodes.push_back(right);
+
+		pending.push_back(std::make_pair(leftIndex, depth + 1));
+		pending.push_back(std::make_pair(leftIndex + 1, depth + 1));
+	}
+
+	//
+	// Store the triangles of every leaf as packets so a leaf reads one contiguous range. Lanes left over in
+	// a leaf's last packet get a degenerate triangle, which the kernel never reports as hit
+	size_t packetCount = 0;
+	for (const auto& node : _nodes)
+	{
+		packetCount += (node.Count + PacketWidth - 1) / PacketWidth;
+	}
+
+	_packets.reserve(packetCount);
+	_triangles.reserve(packetCount * PacketWidth);
+
+	for (auto& node : _nodes)
+	{
+		if (node.Count == 0)
+		{
+			continue;
+		}
+
+		UINT firstPacket = static_cast<UINT>(_packets.size());
+
+		for (UINT i = 0; i < node.Count; i += PacketWidth)
+		{
+			TrianglePacket packet;
+			memset(&packet, 0, sizeof(packet));
+
+			for (UINT lane = 0; lane < PacketWidth; ++lane)
+			{
+				if (i + lane >= node.Count)
+				{
+					_triangles.push_back(NoTriangle);
+					continue;
+				}
+
+				UINT triangle = triangleOfEntry[order[node.First + i + lane]];
+				_triangles.push_back(triangle);
+
+				const XMFLOAT3& v0 = positions[indices[triangle * 3 + 0]];
+				XMFLOAT3 edge1 = subtract(positions[indices[triangle * 3 + 1]], v0);
+				XMFLOAT3 edge2 = subtract(positions[indices[triangle * 3 + 2]], v0);
+
+				for (UINT axis = 0; axis < 3; ++axis)
+				{
+					packet.V0[axis][lane] = component(v0, axis);
+					packet.Edge1[axis][lane] = component(edge1, axis);
+					packet.Edge2[axis][lane] = component(edge2, axis);
+				}
+			}
+
+			_packets.push_back(packet);
+		}
+
+		node.First = firstPacket;
+	}
+}
+
+UINT MeshBvh::intersectPacket(
+	_In_ const XMFLOAT3& origin,
+	_In_ const XMFLOAT3& direction,
+	_In_ float maxT,
+	_In_ const TrianglePacket& packet,
+	_Out_ float* t,
+	_Out_ float* u,
+	_Out_ float* v)
+{
+	//
+	// Moller-Trumbore without back face culling, on four triangles at once
+#ifdef MESHBVH_SSE
+	__m128 dx = _mm_set1_ps(direction.x);
+	__m128 dy = _mm_set1_ps(direction.y);
+	__m128 dz = _mm_set1_ps(direction.z);
+
+	__m128 e1x = _mm_loadu_ps(packet.Edge1[0]);
+	__m128 e1y = _mm_loadu_ps(packet.Edge1[1]);
+	__m128 e1z = _mm_loadu_ps(packet.Edge1[2]);
+	__m128 e2x = _mm_loadu_ps(packet.Edge2[0]);
+	__m128 e2y = _mm_loadu_ps(packet.Edge2[1]);
+	__m128 e2z = _mm_loadu_ps(packet.Edge2[2]);
+
+	// p = direction x edge2
+	__m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+	__m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+	__m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+	__m128 determinant = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+	__m128 inverseDeterminant = _mm_div_ps(_mm_set1_ps(1.0f), determinant);
+
+	// s = origin - v0
+	__m128 sx = _mm_sub_ps(_mm_set1_ps(origin.x), _mm_loadu_ps(packet.V0[0]));
+	__m128 sy = _mm_sub_ps(_mm_set1_ps(origin.y), _mm_loadu_ps(packet.V0[1]));
+	__m128 sz = _mm_sub_ps(_mm_set1_ps(origin.z), _mm_loadu_ps(packet.V0[2]));
+
+	__m128 hitU = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), inverseDeterminant);
+
+	// q = s x edge1
+	__m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+	__m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+	__m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+	__m128 hitV = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), inverseDeterminant);
+	__m128 hitT = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), inverseDeterminant);
+
+	// Parallel rays and the degenerate padding triangles have a zero determinant; the NaNs and infinities
+	// they produce fail the ordered comparisons
+	__m128 zero = _mm_setzero_ps();
+	__m128 hit = _mm_cmpneq_ps(determinant, zero);
+	hit = _mm_and_ps(hit, _mm_cmpge_ps(hitU, zero));
+	hit = _mm_and_ps(hit, _mm_cmpge_ps(hitV, zero));
+	hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(hitU, hitV), _mm_set1_ps(1.0f)));
+	hit = _mm_and_ps(hit, _mm_cmpge_ps(hitT, zero));
+	hit = _mm_and_ps(hit, _mm_cmple_ps(hitT, _mm_set1_ps(maxT)));
+
+	_mm_storeu_ps(t, hitT);
+	_mm_storeu_ps(u, hitU);
+	_mm_storeu_ps(v, hitV);
+
+	return static_cast<UINT>(_mm_movemask_ps(hit));
+#else
+	UINT mask = 0;
+
+	for (UINT lane = 0; lane < PacketWidth; ++lane)
+	{
+		XMFLOAT3 edge1(packet.Edge1[0][lane], packet.Edge1[1][lane], packet.Edge1[2][lane]);
+		XMFLOAT3 edge2(packet.Edge2[0][lane], packet.Edge2[1][lane], packet.Edge2[2][lane]);
+		XMFLOAT3 v0(packet.V0[0][lane], packet.V0[1][lane], packet.V0[2][lane]);
+
+		XMFLOAT3 p = cross(direction, edge2);
+		float determinant = dot(edge1, p);
+		if (determinant == 0.0f)
+		{
+			continue;
+		}
+
+		float inverseDeterminant = 1.0f / determinant;
+
+		XMFLOAT3 s = subtract(origin, v0);
+		XMFLOAT3 q = cross(s, edge1);
+
+		u[lane] = dot(s, p) * inverseDeterminant;
+		v[lane] = dot(direction, q) * inverseDeterminant;
+		t[lane] = dot(edge2, q) * inverseDeterminant;
+
+		if (u[lane] >= 0.0f && v[lane] >= 0.0f && u[lane] + v[lane] <= 1.0f && t[lane] >= 0.0f && t[lane] <= maxT)
+		{
+			mask |= 1 << lane;
+		}
+	}
+
+	return mask;
+#endif
+}
+
+template<class Visitor>
+bool MeshBvh::traverse(
+	_In_ const XMFLOAT3& origin,
+	_In_ const XMFLOAT3& direction,
+	_In_ float maxT,
+	_In_ Visitor visit) const
+{
+	if (_nodes.empty())
+	{
+		return false;
+	}
+
+	XMFLOAT3 inverseDirection = inverse(direction);
+
+	UINT stack[MaxDepth + 1];
+	UINT stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const Node& node = _nodes[stack[--stackSize]];
+
+		float tEnter;
+		if (!intersectsBox(node.Min, node.Max, origin, inverseDirection, maxT, tEnter))
+		{
+			continue;
+		}
+
+		if (node.Count > 0)
+		{
+			UINT packetCount = (node.Count + PacketWidth - 1) / PacketWidth;
+			for (UINT packet = node.First; packet < node.First + packetCount; ++packet)
+			{
+				if (visit(packet))
+				{
+					return true;
+				}
+			}
+		}
+		else
+		{
+			stack[stackSize++] = node.First + 1;
+			stack[stackSize++] = node.First;
+		}
+	}
+
+	return false;
+}
+
+bool MeshBvh::IntersectAny(
+	_In_ const XMFLOAT3& origin,
+	_In_ const XMFLOAT3& direction,
+	_In_ float maxT) const
+{
+	return traverse(origin, direction, maxT, [&](UINT packet) -> bool
+	{
+		float t[PacketWidth], u[PacketWidth], v[PacketWidth];
+		return intersectPacket(origin, direction, maxT, _packets[packet], t, u, v) != 0;
+	});
+}
+
+void MeshBvh::IntersectAll(
+	_In_ const XMFLOAT3& origin,
+	_In_ const XMFLOAT3& direction,
+	_In_ float maxT,
+	_Inout_ std::vector<MeshBvhHit>& hits) const
+{
+	traverse(origin, direction, maxT, [&](UINT packet) -> bool
+	{
+		float t[PacketWidth], u[PacketWidth], v[PacketWidth];
+		UINT mask = intersectPacket(origin, direction, maxT, _packets[packet], t, u, v);
+
+		for (UINT lane = 0; lane < PacketWidth; ++lane)
+		{
+			if (mask & (1 << lane))
+			{
+				MeshBvhHit hit;
+				hit.T = t[lane];
+				hit.U = u[lane];
+				hit.V = v[lane];
+				hit.Triangle = _triangles[packet * PacketWidth + lane];
+				hits.push_back(hit);
+			}
+		}
+		return false;
+	});
+}
+
+bool MeshBvh::IntersectNearest(
+	_In_ const XMFLOAT3& origin,
+	_In_ const XMFLOAT3& direction,
+	_In_ float maxT,
+	_Out_ MeshBvhHit& hit) const
+{
+	if (_nodes.empty())
+	{
+		return false;
+	}
+
+	XMFLOAT3 inverseDirection = inverse(direction);
+
+	struct Entry
+	{
+		UINT Node;
+		float TEnter;
+	};
+
+	float tEnter;
+	if (!intersectsBox(_nodes[0].Min, _nodes[0].Max, origin, inverseDirection, maxT, tEnter))
+	{
+		return false;
+	}
+
+	// Visiting one node pushes at most one more entry than it pops, so a level never needs more than one slot
+	Entry stack[MaxDepth + 1];
+	UINT stackSize = 0;
+	stack[stackSize].Node = 0;
+	stack[stackSize].TEnter = tEnter;
+	++stackSize;
+
+	float best = maxT;
+	bool found = false;
+
+	while (stackSize > 0)
+	{
+		Entry entry = stack[--stackSize];
+
+		// Boxes pushed before a closer hit was found may be entirely behind it by now
+		if (entry.TEnter > best)
+		{
+			continue;
+		}
+
+		const Node& node = _nodes[entry.Node];
+
+		if (node.Count > 0)
+		{
+			UINT packetCount = (node.Count + PacketWidth - 1) / PacketWidth;
+
+			for (UINT packet = node.First; packet < node.First + packetCount; ++packet)
+			{
+				float t[PacketWidth], u[PacketWidth], v[PacketWidth];
+				UINT mask = intersectPacket(origin, direction, best, _packets[packet], t, u, v);
+
+				for (UINT lane = 0; lane < PacketWidth; ++lane)
+				{
+					if ((mask & (1 << lane)) && (!found || t[lane] < best))
+					{
+						best = t[lane];
+						found = true;
+
+						hit.T = t[lane];
+						hit.U = u[lane];
+						hit.V = v[lane];
+						hit.Triangle = _triangles[packet * PacketWidth + lane];
+					}
+				}
+			}
+
+			continue;
+		}
+
+		//
+		// Visit the nearer child first so that its hits prune the farther one
+		const Node& left = _nodes[node.First];
+		const Node& right = _nodes[node.First + 1];
+
+		float tLeft, tRight;
+		bool hitLeft = intersectsBox(left.Min, left.Max, origin, inverseDirection, best, tLeft);
+		bool hitRight = intersectsBox(right.Min, right.Max, origin, inverseDirection, best, tRight);
+
+		if (hitLeft && hitRight)
+		{
+			bool leftFirst = tLeft <= tRight;
+
+			stack[stackSize].Node = leftFirst ? node.First + 1 : node.First;
+			stack[stackSize].TEnter = leftFirst ? tRight : tLeft;
+			++stackSize;
+
+			stack[stackSize].Node = leftFirst ? node.First : node.First + 1;
+			stack[stackSize].TEnter = leftFirst ? tLeft : tRight;
+			++stackSize;
+		}
+		else if (hitLeft || hitRight)
+		{
+			stack[stackSize].Node = hitLeft ? node.First : node.First + 1;
+			stack[stackSize].TEnter = hitLeft ? tLeft : tRight;
+			++stackSize;
+		}
+	}
+
+	return found;
+}
+
+bool MeshBvh::IntersectBounds(
+	_In_ const XMFLOAT3& origin,
+	_In_ const XMFLOAT3& direction,
+	_In_ float maxT,
+	_Out_ float& tEnter) const
+{
+	if (_nodes.empty())
+	{
+		return false;
+	}
+
+	return intersectsBox(_nodes[0].Min, _nodes[0].Max, origin, inverse(direction), maxT, tEnter);
+}
+
+void MeshBvh::IntersectAny(
+	_In_ const MeshBvhRay* rays,
+	_In_ UINT count,
+	_Out_ bool* results) const
+{
+#ifdef MESHBVH_SSE
+	for (UINT first = 0; first < count; first += RayGroupSize)
+	{
+		intersectAnyGroup(rays + first, std::min(RayGroupSize, count - first), results + first);
+	}
+#else
+	// Without the four-ray box tests sharing the traversal costs more than it saves
+	for (UINT r = 0; r < count; ++r)
+	{
+		results[r] = IntersectAny(rays[r].Origin, rays[r].Direction, rays[r].MaxT);
+	}
+#endif
+}
+
+#ifdef MESHBVH_SSE
+void MeshBvh::intersectAnyGroup(
+	_In_ const MeshBvhRay* rays,
+	_In_ UINT count,
+	_Out_ bool* results) const
+{
+	// The rays again as structure-of-arrays, padded to a whole number of box test lanes with rays that miss
+	RayGroup group;
+	for (UINT r = 0; r < RayGroupSize; ++r)
+	{
+		bool used = r < count;
+		XMFLOAT3 inverseDirection = used ? inverse(rays[r].Direction) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		for (UINT axis = 0; axis < 3; ++axis)
+		{
+			group.Origin[axis][r] = used ? component(rays[r].Origin, axis) : 0.0f;
+			group.InverseDirection[axis][r] = component(inverseDirection, axis);
+		}
+		group.MaxT[r] = used ? rays[r].MaxT : -1.0f;
+	}
+
+	for (UINT r = 0; r < count; ++r)
+	{
+		results[r] = false;
+	}
+
+	if (_nodes.empty())
+	{
+		return;
+	}
+
+	// Rays that haven't hit anything yet. Every node is visited once for all the rays that reach it
+	uint64_t unresolved = (count == RayGroupSize) ? ~0ULL : ((1ULL << count) - 1);
+
+	struct Entry
+	{
+		UINT Node;
+		uint64_t Rays;
+	};
+
+	Entry stack[MaxDepth + 1];
+	UINT stackSize = 0;
+	stack[stackSize].Node = 0;
+	stack[stackSize].Rays = unresolved;
+	++stackSize;
+
+	while (stackSize > 0 && unresolved)
+	{
+		Entry entry = stack[--stackSize];
+		const Node& node = _nodes[entry.Node];
+		uint64_t active = entry.Rays & unresolved;
+
+		// Four neighbouring rays per test, skipping the fours that have none left to test
+		uint64_t inside = 0;
+		for (uint64_t pending = active; pending; )
+		{
+			UINT first = lowestSetBit(pending) & ~3u;
+			inside |= static_cast<uint64_t>(intersectsBoxes(node.Min, node.Max, group, first)) << first;
+			pending &= ~(0xFULL << first);
+		}
+		inside &= active;
+
+		if (!inside)
+		{
+			continue;
+		}
+
+		if (node.Count > 0)
+		{
+			UINT packetCount = (node.Count + PacketWidth - 1) / PacketWidth;
+
+			for (uint64_t pending = inside; pending; pending &= pending - 1)
+			{
+				UINT r = lowestSetBit(pending);
+
+				for (UINT packet = node.First; packet < node.First + packetCount; ++packet)
+				{
+					float t[PacketWidth], u[PacketWidth], v[PacketWidth];
+					if (intersectPacket(rays[r].Origin, rays[r].Direction, rays[r].MaxT, _packets[packet], t, u, v))
+					{
+						results[r] = true;
+						unresolved &= ~(1ULL << r);
+						break;
+					}
+				}
+			}
+		}
+		else
+		{
+			stack[stackSize].Node = node.First + 1;
+			stack[stackSize].Rays = inside;
+			++stackSize;
+
+			stack[stackSize].Node = node.First;
+			stack[stackSize].Rays = inside;
+			++stackSize;
+		}
+	}
+}
+#endif
+
+size_t MeshBvh::GetMemoryUsage() const
+{
+	return _nodes.capacity() * sizeof(Node) +
+		_packets.capacity() * sizeof(TrianglePacket) +
+		_triangles.capacity() * sizeof(UINT);
+}
@@ -0,0 +1,195 @@
+//////////////////////////////////////////////////////////////////////////
+// MeshBvh.h
+// A bounding volume hierarchy over the triangles of one mesh, in the
+// mesh's own space. Built once at load time with a binned surface area
+// heuristic so ray queries only test the triangles in the boxes the ray
+// actually passes through. Callers transform the ray into mesh space
+// rather than transforming the triangles. Leaves store their triangles
+// as structure-of-arrays packets of four that are tested at once with
+// SSE where it is available.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+namespace Engine
+{
+	//
+	// A triangle hit by a ray. The hit point is origin + T * direction, or equivalently
+	// (1 - U - V) * v0 + U * v1 + V * v2
+	//
+	struct MeshBvhHit
+	{
+		// Distance along the ray in units of the ray direction's length
+		float T;
+
+		// Barycentric coordinates of the hit point
+		float U;
+		float V;
+
+		// Index of the triangle in the mesh's index list (its indices start at Triangle * 3)
+		UINT Triangle;
+	};
+
+	//
+	// One ray of a batch
+	//
+	struct MeshBvhRay
+	{
+		DirectX::XMFLOAT3 Origin;
+
+		// Does not need to be unit length; distances are in units of its length
+		DirectX::XMFLOAT3 Direction;
+
+		// Hits further along the ray than this are ignored
+		float MaxT;
+	};
+
+	class MeshBvh
+	{
+	public:
+
+		MeshBvh();
+
+		//
+		// FullName:  Engine::MeshBvh::Build
+		// Builds the hierarchy over the triangles of an indexed triangle list. Triangles that refer to
+		// vertices outside of positions are left out
+		//
+		void Build(
+			_In_ const std::vector<DirectX::XMFLOAT3>& positions,
+			_In_ const std::vector<UINT>& indices);
+
+		//
+		// Frees the hierarchy
+		//
+		void Clear();
+
+		//
+		// Returns bool indicating if there are no triangles to test against
+		//
+		bool IsEmpty() const
+		{
+			return _nodes.empty();
+		}
+
+		//
+		// FullName:  Engine::MeshBvh::IntersectAny
+		// Returns true if the ray hits any triangle at a distance between 0 and maxT. The direction does
+		// not need to be unit length; distances are in units of its length
+		//
+		bool IntersectAny(
+			_In_ const DirectX::XMFLOAT3& origin,
+			_In_ const DirectX::XMFLOAT3& direction,
+			_In_ float maxT) const;
+
+		//
+		// FullName:  Engine::MeshBvh::IntersectNearest
+		// Finds the nearest triangle the ray hits at a distance between 0 and maxT. Boxes are visited nearest
+		// first and skipped once they start beyond the closest hit so far. Returns false if nothing was hit
+		//
+		bool IntersectNearest(
+			_In_ const DirectX::XMFLOAT3& origin,
+			_In_ const DirectX::XMFLOAT3& direction,
+			_In_ float maxT,
+			_Out_ MeshBvhHit& hit) const;
+
+		//
+		// FullName:  Engine::MeshBvh::IntersectBounds
+		// Returns true if the ray passes through the box around all of the triangles between 0 and maxT, and
+		// the distance at which it enters it. Lets callers order several hierarchies front to back
+		//
+		bool IntersectBounds(
+			_In_ const DirectX::XMFLOAT3& origin,
+			_In_ const DirectX::XMFLOAT3& direction,
+			_In_ float maxT,
+			_Out_ float& tEnter) const;
+
+		//
+		// FullName:  Engine::MeshBvh::IntersectAll
+		// Appends every triangle the ray hits at a distance between 0 and maxT to hits, in no particular order
+		//
+		void IntersectAll(
+			_In_ const DirectX::XMFLOAT3& origin,
+			_In_ const DirectX::XMFLOAT3& direction,
+			_In_ float maxT,
+			_Inout_ std::vector<MeshBvhHit>& hits) const;
+
+		//
+		// FullName:  Engine::MeshBvh::IntersectAny
+		// Sets results[i] to whether rays[i] hits any triangle. With SSE rays are traversed in groups of 64
+		// that share every node visit and test the boxes four rays at a time, which pays off the more
+		// neighbouring rays take the same path; without it they are traced one at a time
+		//
+		void IntersectAny(
+			_In_ const MeshBvhRay* rays,
+			_In_ UINT count,
+			_Out_ bool* results) const;
+
+		//
+		// Returns the number of bytes the hierarchy uses
+		//
+		size_t GetMemoryUsage() const;
+
+	private:
+
+		static const UINT PacketWidth = 4;
+
+		// Inner nodes have Count == 0 and their children at First and First + 1. Leaves hold Count
+		// triangles in the packets starting at First
+		struct Node
+		{
+			DirectX::XMFLOAT3 Min;
+			UINT First;
+			DirectX::XMFLOAT3 Max;
+			UINT Count;
+		};
+
+		// Four triangles as their first vertex and two edges, one array per axis
+		struct TrianglePacket
+		{
+			float V0[3][PacketWidth];
+			float Edge1[3][PacketWidth];
+			float Edge2[3][PacketWidth];
+		};
+
+		// Tests the ray against the four triangles of a packet. Returns a bit per lane hit at a distance
+		// between 0 and maxT; t, u and v are only meaningful for those lanes
+		static UINT intersectPacket(
+			_In_ const DirectX::XMFLOAT3& origin,
+			_In_ const DirectX::XMFLOAT3& direction,
+			_In_ float maxT,
+			_In_ const TrianglePacket& packet,
+			_Out_ float* t,
+			_Out_ float* u,
+			_Out_ float* v);
+
+		// Runs the batched any-hit query on up to 64 rays (only with SSE)
+		void intersectAnyGroup(
+			_In_ const MeshBvhRay* rays,
+			_In_ UINT count,
+			_Out_ bool* results) const;
+
+		// Calls visit(packet) for every leaf packet in a box the ray passes through. Stops early and
+		// returns true if visit returns true
+		template<class Visitor>
+		bool traverse(
+			_In_ const DirectX::XMFLOAT3& origin,
+			_In_ const DirectX::XMFLOAT3& direction,
+			_In_ float maxT,
+			_In_ Visitor visit) const;
+
+	private:
+
+		std::vector<Node> _nodes;
+
+		std::vector<TrianglePacket> _packets;
+
+		// The index in the mesh's index list of the triangle in every packet lane
+		std::vector<UINT> _triangles;
+	};
+}
@@ -0,0 +1,566 @@
+//////////////////////////////////////////////////////////////////////////
+// MeshOptimizer.cpp
+// Vertex cache, overdraw and vertex fetch ordering of KSM meshes
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+using namespace Engine;
+
+namespace
+{
+	//
+	// The LRU cache Forsyth's scores model, and the weights of its scoring function. These are the values
+	// from the paper, which work well for any real cache size
+	//
+	const UINT ScoringCacheSize = 32;
+	const float CacheDecayPower = 1.5f;
+	const float LastTriangleScore = 0.75f;
+	const float ValenceBoostScale = 2.0f;
+	const float ValenceBoostPower = 0.5f;
+
+	// Vertices used by more triangles than this score as if they were used by this many
+	const UINT MaxScoredValence = 32;
+
+	const UINT NotCached = ~0U;
+	const UINT NoTriangle = ~0U;
+
+	//
+	// Scores by cache position and by the number of triangles still to draw with the vertex, worked out once
+	//
+	class VertexScores
+	{
+	public:
+
+		VertexScores()
+		{
+			for (UINT i = 0; i < ScoringCacheSize; ++i)
+			{
+				// The last triangle's vertices score the same whichever order they were used in, so it
+				// doesn't pay to pick a triangle that just reuses them
+				_cache[i] = (i < 3) ?
+					LastTriangleScore :
+					powf(1.0f - (i - 3) / static_cast<float>(ScoringCacheSize - 3), CacheDecayPower);
+			}
+
+			_valence[0] = 0.0f;
+			for (UINT i = 1; i <= MaxScoredValence; ++i)
+			{
+				_valence[i] = ValenceBoostScale * powf(static_cast<float>(i), -ValenceBoostPower);
+			}
+		}
+
+		float Get(
+			_In_ UINT cachePosition,
+			_In_ UINT remainingTriangles) const
+		{
+			// Nothing left to draw with it, so it shouldn't pull any triangle forwards
+			if (remainingTriangles == 0)
+			{
+				return -1.0f;
+			}
+
+			float score = (cachePosition < ScoringCacheSize) ? _cache[cachePosition] : 0.0f;
+			return score + _valence[std::min(remainingTriangles, MaxScoredValence)];
+		}
+
+	private:
+
+		float _cache[ScoringCacheSize];
+		float _valence[MaxScoredValence + 1];
+	};
+
+	//
+	// A FIFO post-transform cache. A vertex is in it if it was added less than cacheSize misses ago
+	//
+	class FifoCache
+	{
+	public:
+
+		FifoCache(
+			_In_ UINT vertexCount,
+			_In_ UINT cacheSize) :
+			_addedAt(vertexCount, 0), _misses(0), _cacheSize(cacheSize)
+		{}
+
+		//
+		// Returns bool indicating if the vertex had to be transformed
+		//
+		bool Use(_In_ UINT index)
+		{
+			if (_addedAt[index] != 0 && _misses - _addedAt[index] < _cacheSize)
+			{
+				return false;
+			}
+
+			++_misses;
+			_addedAt[index] = _misses;
+			return true;
+		}
+
+		//
+		// Evicts every vertex
+		//
+		void Flush()
+		{
+			_misses += _cacheSize;
+		}
+
+	private:
+
+		std::vector<UINT> _addedAt;
+		UINT _misses;
+		UINT _cacheSize;
+	};
+
+	//
+	// Returns the number of vertices transformed drawing indices through a FIFO cache of the given size
+	//
+	UINT countCacheMisses(
+		_In_ const std::vector<UINT>& indices,
+		_In_ UINT vertexCount,
+		_In_ UINT cacheSize)
+	{
+		FifoCache cache(vertexCount, cacheSize);
+		UINT misses = 0;
+
+		for (UINT index : indices)
+		{
+			misses += cache.Use(index) ? 1 : 0;
+		}
+
+		return misses;
+	}
+
+	UINT countVertices(_In_ const std::vector<UINT>& indices)
+	{
+		UINT vertexCount = 0;
+		for (UINT index : indices)
+		{
+			vertexCount = std::max(vertexCount, index + 1);
+		}
+
+		return vertexCount;
+	}
+}
+
+float MeshOptimizer::ComputeAcmr(
+	_In_ const std::vector<UINT>& indices,
+	_In_ UINT vertexCount,
+	_In_ UINT cacheSize)
+{
+	if (indices.size() < 3)
+	{
+		return 0.0f;
+	}
+
+	return countCacheMisses(indices, vertexCount, cacheSize) / static_cast<float>(indices.size() / 3);
+}
+
+void MeshOptimizer::OptimizeVertexCache(
+	_Inout_ std::vector<UINT>& indices,
+	_In_ UINT vertexCount)
+{
+	VertexScores scores;
+
+	UINT triangleCount = static_cast<UINT>(indices.size() / 3);
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	//
+	// The triangles using each vertex, each vertex's range starting at triangleOffsets[v]. A vertex's
+	// remaining triangles are kept at the front of its range so drawn ones drop off the end
+	std::vector<UINT> remaining(vertexCount, 0);
+	for (UINT index : indices)
+	{
+		++remaining[index];
+	}
+
+	std::vector<UINT> triangleOffsets(vertexCount, 0);
+	UINT offset = 0;
+	for (UINT v = 0; v < vertexCount; ++v)
+	{
+		triangleOffsets[v] = offset;
+		offset += remaining[v];
+	}
+
+	std::vector<UINT> vertexTriangles(indices.size());
+	std::vector<UINT> filled(vertexCount, 0);
+	for (UINT t = 0; t < triangleCount; ++t)
+	{
+		for (UINT k = 0; k < 3; ++k)
+		{
+			UINT v = indices[t * 3 + k];
+			vertexTriangles[triangleOffsets[v] + filled[v]++] = t;
+		}
+	}
+
+	std::vector<float> vertexScore(vertexCount);
+	for (UINT v = 0; v < vertexCount; ++v)
+	{
+		vertexScore[v] = scores.Get(NotCached, remaining[v]);
+	}
+
+	std::vector<float> triangleScore(triangleCount);
+	for (UINT t = 0; t < triangleCount; ++t)
+	{
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+	}
+
+	std::vector<bool> drawn(triangleCount, false);
+	std::vector<UINT> cachePosition(vertexCount, NotCached);
+
+	// The cache, most recently used first. The new cache can briefly hold three more than the old one
+	std::vector<UINT> cache;
+	std::vector<UINT> newCache;
+	cache.reserve(ScoringCacheSize + 3);
+	newCache.reserve(ScoringCacheSize + 3);
+
+	std::vector<UINT> output;
+	output.reserve(indices.size());
+
+	UINT next = static_cast<UINT>(std::max_element(triangleScore.begin(), triangleScore.end()) - triangleScore.begin());
+	UINT inputCursor = 0;
+
+	for (UINT drawnCount = 0; drawnCount < triangleCount; ++drawnCount)
+	{
+		//
+		// Nothing in the cache has triangles left, so carry on with the first triangle not yet drawn. Forsyth
+		// suggests a full search for the best, but this keeps the whole pass linear and costs very little
+		if (next == NoTriangle)
+		{
+			while (drawn[inputCursor])
+			{
+				++inputCursor;
+			}
+			next = inputCursor;
+		}
+
+		const UINT* triangle = &indices[next * 3];
+		output.insert(output.end(), triangle, triangle + 3);
+		drawn[next] = true;
+
+		newCache.clear();
+		for (UINT k = 0; k < 3; ++k)
+		{
+			UINT v = triangle[k];
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+			{
+				newCache.push_back(v);
+			}
+
+			// Drop the triangle from the vertex's remaining ones
+			UINT* begin = &vertexTriangles[triangleOffsets[v]];
+			UINT* end = begin + remaining[v];
+			UINT* found = std::find(begin, end, next);
+			std::swap(*found, *(end - 1));
+			--remaining[v];
+		}
+
+		for (UINT v : cache)
+		{
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+			{
+				newCache.push_back(v);
+			}
+		}
+
+		//
+		// Rescore every vertex that was or is in the cache, and the triangles still to draw with them
+		for (UINT i = 0; i < newCache.size(); ++i)
+		{
+			UINT v = newCache[i];
+			cachePosition[v] = (i < ScoringCacheSize) ? i : NotCached;
+
+			float score = scores.Get(cachePosition[v], remaining[v]);
+			float change = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			for (UINT j = 0; j < remaining[v]; ++j)
+			{
+				triangleScore[vertexTriangles[triangleOffsets[v] + j]] += change;
+			}
+		}
+
+		newCache.resize(std::min(newCache.size(), static_cast<size_t>(ScoringCacheSize)));
+		cache.swap(newCache);
+
+		// The best of the triangles still to draw with the cached vertices comes next
+		next = NoTriangle;
+		float bestScore = -1.0f;
+
+		for (UINT v : cache)
+		{
+			for (UINT j = 0; j < remaining[v]; ++j)
+			{
+				UINT t = vertexTriangles[triangleOffsets[v] + j];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					next = t;
+				}
+			}
+		}
+	}
+
+	indices.swap(output);
+}
+
+bool MeshOptimizer::OptimizeOverdraw(
+	_Inout_ std::vector<UINT>& indices,
+	_In_ const std::vector<XMFLOAT3>& positions,
+	_In_ UINT cacheSize,
+	_In_ float threshold)
+{
+	UINT triangleCount = static_cast<UINT>(indices.size() / 3);
+	UINT vertexCount = static_cast<UINT>(positions.size());
+	if (triangleCount < 2)
+	{
+		return false;
+	}
+
+	//
+	// Tipsify's hard boundaries: a triangle that misses the cache on all three vertices starts a new part of
+	// the mesh, so drawing the parts in any order costs about the same in transforms
+	std::vector<UINT> hardStarts;
+	UINT missesBefore = 0;
+	{
+		FifoCache cache(vertexCount, cacheSize);
+
+		for (UINT t = 0; t < triangleCount; ++t)
+		{
+			UINT triangleMisses = 0;
+			for (UINT k = 0; k < 3; ++k)
+			{
+				triangleMisses += cache.Use(indices[t * 3 + k]) ? 1 : 0;
+			}
+
+			if (triangleMisses == 3)
+			{
+				hardStarts.push_back(t);
+			}
+			missesBefore += triangleMisses;
+		}
+	}
+
+	//
+	// Soft boundaries split those parts further. Each cluster starts with a cold cache and ends as soon as its
+	// own ACMR is within the threshold of the whole mesh's, so however the clusters are ordered the ACMR stays
+	// about within the threshold
+	std::vector<UINT> clusterStarts;
+	{
+		float targetAcmr = missesBefore / static_cast<float>(triangleCount) * threshold;
+		FifoCache cache(vertexCount, cacheSize);
+
+		for (size_t h = 0; h < hardStarts.size(); ++h)
+		{
+			UINT end = (h + 1 < hardStarts.size()) ? hardStarts[h + 1] : triangleCount;
+			UINT clusterStart = hardStarts[h];
+			UINT clusterMisses = 0;
+
+			clusterStarts.push_back(clusterStart);
+			cache.Flush();
+
+			for (UINT t = clusterStart; t < end; ++t)
+			{
+				for (UINT k = 0; k < 3; ++k)
+				{
+					clusterMisses += cache.Use(indices[t * 3 + k]) ? 1 : 0;
+				}
+
+				if (t + 1 < end && clusterMisses <= targetAcmr * (t - clusterStart + 1))
+				{
+					clusterStart = t + 1;
+					clusterMisses = 0;
+
+					clusterStarts.push_back(clusterStart);
+					cache.Flush();
+				}
+			}
+		}
+	}
+
+	if (clusterStarts.size() < 2)
+	{
+		return false;
+	}
+
+	//
+	// Every cluster's area weighted center and normal
+	struct Cluster
+	{
+		UINT Start;
+		UINT End;
+		XMFLOAT3 Center;
+		XMFLOAT3 Normal;
+		float SortKey;
+	};
+
+	std::vector<Cluster> clusters(clusterStarts.size());
+	XMVECTOR meshCenter = XMVectorZero();
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusters.size(); ++c)
+	{
+		Cluster& cluster = clusters[c];
+		cluster.Start = clusterStarts[c];
+		cluster.End = (c + 1 < clusters.size()) ? clusterStarts[c + 1] : triangleCount;
+
+		XMVECTOR center = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+
+		for (UINT t = cluster.Start; t < cluster.End; ++t)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&positions[indices[t * 3]]);
+			XMVECTOR p1 = XMLoadFloat3(&positions[indices[t * 3 + 1]]);
+			XMVECTOR p2 = XMLoadFloat3(&positions[indices[t * 3 + 2]]);
+
+			XMVECTOR cross = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+			float triangleArea = XMVectorGetX(XMVector3Length(cross));
+
+			normal = XMVectorAdd(normal, cross);
+			center = XMVectorAdd(center, XMVectorScale(XMVectorAdd(XMVectorAdd(p0, p1), p2), triangleArea / 3.0f));
+			area += triangleArea;
+		}
+
+		meshCenter = XMVectorAdd(meshCenter, center);
+		meshArea += area;
+
+		XMStoreFloat3(&cluster.Center, (area > 0.0f) ? XMVectorScale(center, 1.0f / area) : center);
+		XMStoreFloat3(&cluster.Normal, XMVector3Normalize(normal));
+	}
+
+	if (meshArea > 0.0f)
+	{
+		meshCenter = XMVectorScale(meshCenter, 1.0f / meshArea);
+	}
+
+	//
+	// Clusters further out along their normal are more likely to hide the others, so they go first
+	for (auto& cluster : clusters)
+	{
+		XMVECTOR outwards = XMVectorSubtract(XMLoadFloat3(&cluster.Center), meshCenter);
+		cluster.SortKey = XMVectorGetX(XMVector3Dot(outwards, XMLoadFloat3(&cluster.Normal)));
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b)
+	{
+		return a.SortKey > b.SortKey;
+	});
+
+	std::vector<UINT> sorted;
+	sorted.reserve(indices.size());
+	for (const auto& cluster : clusters)
+	{
+		sorted.insert(sorted.end(), indices.begin() + cluster.Start * 3, indices.begin() + cluster.End * 3);
+	}
+
+	UINT missesAfter = countCacheMisses(sorted, vertexCount, cacheSize);
+	if (missesAfter > missesBefore * threshold)
+	{
+		return false;
+	}
+
+	indices.swap(sorted);
+	return true;
+}
+
+UINT MeshOptimizer::OptimizeVertexFetch(
+	_Inout_ std::vector<UINT>& indices,
+	_Inout_ std::vector<byte>& vertices,
+	_In_ UINT vertexStride)
+{
+	UINT vertexCount = static_cast<UINT>(vertices.size() / vertexStride);
+	std::vector<UINT> remap(vertexCount, NotCached);
+	std::vector<byte> reordered;
+	reordered.reserve(vertices.size());
+
+	UINT used = 0;
+	for (auto& index : indices)
+	{
+		if (remap[index] == NotCached)
+		{
+			remap[index] = used++;
+
+			const byte* vertex = &vertices[(size_t)index * vertexStride];
+			reordered.insert(reordered.end(), vertex, vertex + vertexStride);
+		}
+
+		index = remap[index];
+	}
+
+	vertices.swap(reordered);
+	return used;
+}
+
+void MeshOptimizer::OptimizeModel(
+	_Inout_ KsmModelView& model,
+	_In_ const MeshOptimizationSettings& settings,
+	_Out_ std::vector<OptimizedMesh>& meshes)
+{
+	// Sized up front so the views can point into the meshes as they're done
+	meshes.clear();
+	meshes.resize(model.Meshes.size());
+
+	for (size_t m = 0; m < model.Meshes.size(); ++m)
+	{
+		KsmMeshView& view = model.Meshes[m];
+		OptimizedMesh& mesh = meshes[m];
+
+		std::vector<UINT> indices(view.IndexCount);
+		for (UINT i = 0; i < view.IndexCount; ++i)
+		{
+			indices[i] = view.GetIndex(i);
+		}
+
+		MUKASHIDEBUG_CRITICALERROR_ONFALSE(indices.size() % 3 == 0 && countVertices(indices) <= view.VertexCount);
+
+		// Levels of detail index the vertices this renumbers, so they have to be generated afterwards
+		MUKASHIDEBUG_CRITICALERROR_ONFALSE(view.Lods.empty());
+
+		std::vector<XMFLOAT3> positions;
+		KsmReader::ReadPositions(view, positions);
+
+		mesh.Vertices.assign(view.Vertices, view.Vertices + (size_t)view.VertexCount * view.VertexStride);
+
+		MeshOptimizationStats& stats = mesh.Stats;
+		memset(&stats, 0, sizeof(stats));
+		UINT misses = countCacheMisses(indices, view.VertexCount, settings.CacheSize);
+		stats.AcmrBefore = ComputeAcmr(indices, view.VertexCount, settings.CacheSize);
+		stats.AtvrBefore = (view.VertexCount > 0) ? misses / static_cast<float>(view.VertexCount) : 0.0f;
+
+		OptimizeVertexCache(indices, view.VertexCount);
+
+		if (settings.OptimizeOverdraw)
+		{
+			stats.OverdrawOrderKept = OptimizeOverdraw(indices, positions, settings.CacheSize, settings.OverdrawThreshold);
+		}
+
+		UINT vertexCount = OptimizeVertexFetch(indices, mesh.Vertices, view.VertexStride);
+		stats.UnusedVertices = view.VertexCount - vertexCount;
+
+		misses = countCacheMisses(indices, vertexCount, settings.CacheSize);
+		stats.AcmrAfter = ComputeAcmr(indices, vertexCount, settings.CacheSize);
+		stats.AtvrAfter = (vertexCount > 0) ? misses / static_cast<float>(vertexCount) : 0.0f;
+
+		//
+		// Indices go back in the size they came in, which still fits since renumbering only lowers them
+		mesh.Indices.resize(indices.size() * view.IndexSize);
+		for (UINT i = 0; i < indices.size(); ++i)
+		{
+			WriteKsmIndex(mesh.Indices.data(), view.IndexSize, i, indices[i]);
+		}
+
+		view.IndexData = mesh.Indices.data();
+		view.Vertices = mesh.Vertices.data();
+		view.VertexCount = vertexCount;
+	}
+}
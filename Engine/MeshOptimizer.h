@@ -0,0 +1,124 @@
+//////////////////////////////////////////////////////////////////////////
+// MeshOptimizer.h
+// Reorders the triangles and vertices of KSM meshes for the GPU before
+// they're written. Triangles are ordered for the post-transform vertex
+// cache with Forsyth's linear-speed algorithm, then grouped into
+// clusters that are drawn outward-facing first to cut overdraw, as in
+// Tipsify. Vertices are then renumbered in the order the triangles first
+// use them so vertex fetch walks memory front to back. The average cache
+// miss ratio (ACMR) is measured before and after so the pipeline can
+// report what it gained. Has no dependency on the graphics device so it
+// can be run headless.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "KsmReader.h"
+#include <DirectXMath.h>
+#include <vector>
+
+namespace Engine
+{
+	struct MeshOptimizationSettings
+	{
+		MeshOptimizationSettings() :
+			CacheSize(16), OptimizeOverdraw(true), OverdrawThreshold(1.05f)
+		{}
+
+		// Entries of the FIFO cache the ACMR is measured with. 16 is a conservative figure for current GPUs
+		UINT CacheSize;
+
+		// Reorders clusters of triangles to cut overdraw after ordering them for the vertex cache
+		bool OptimizeOverdraw;
+
+		// How much worse the ACMR may get from the overdraw pass, as a ratio. The cache order is kept if the
+		// cluster order costs more than that
+		float OverdrawThreshold;
+	};
+
+	//
+	// What optimizing one mesh did. ACMR is transformed vertices per triangle (0.5 at best for large
+	// regular meshes, 3 at worst) and ATVR transformed vertices per vertex (1 at best)
+	//
+	struct MeshOptimizationStats
+	{
+		float AcmrBefore;
+		float AcmrAfter;
+		float AtvrBefore;
+		float AtvrAfter;
+
+		// Vertices no triangle used, which were dropped
+		UINT UnusedVertices;
+
+		// Indicates the overdraw pass's order was kept
+		bool OverdrawOrderKept;
+	};
+
+	//
+	// The reordered data of one mesh. A KsmMeshView points into it after OptimizeModel, so it has to live
+	// as long as the view
+	//
+	struct OptimizedMesh
+	{
+		std::vector<byte> Indices;
+		std::vector<byte> Vertices;
+		MeshOptimizationStats Stats;
+	};
+
+	namespace MeshOptimizer
+	{
+		//
+		// FullName:  Engine::MeshOptimizer::ComputeAcmr
+		// Returns the average number of vertices transformed per triangle when the indices are drawn
+		// through a FIFO post-transform cache of the given size
+		//
+		float ComputeAcmr(
+			_In_ const std::vector<UINT>& indices,
+			_In_ UINT vertexCount,
+			_In_ UINT cacheSize);
+
+		//
+		// FullName:  Engine::MeshOptimizer::OptimizeVertexCache
+		// Reorders the triangles of indices for the post-transform vertex cache with Forsyth's algorithm.
+		// Triangles keep their winding
+		//
+		void OptimizeVertexCache(
+			_Inout_ std::vector<UINT>& indices,
+			_In_ UINT vertexCount);
+
+		//
+		// FullName:  Engine::MeshOptimizer::OptimizeOverdraw
+		// Splits cache ordered indices into clusters wherever a triangle misses the cache on all three
+		// vertices or the cluster so far already transforms few enough vertices, and sorts the clusters so
+		// the ones facing away from the mesh's center are drawn first.
+		// Returns false and leaves indices alone if that costs more than threshold times the ACMR
+		//
+		bool OptimizeOverdraw(
+			_Inout_ std::vector<UINT>& indices,
+			_In_ const std::vector<DirectX::XMFLOAT3>& positions,
+			_In_ UINT cacheSize,
+			_In_ float threshold);
+
+		//
+		// FullName:  Engine::MeshOptimizer::OptimizeVertexFetch
+		// Renumbers the vertices in the order indices first use them, moving the vertex records of the given
+		// stride to match and dropping the ones never used. Returns the new vertex count
+		//
+		UINT OptimizeVertexFetch(
+			_Inout_ std::vector<UINT>& indices,
+			_Inout_ std::vector<byte>& vertices,
+			_In_ UINT vertexStride);
+
+		//
+		// FullName:  Engine::MeshOptimizer::OptimizeModel
+		// Runs every pass over every mesh of the model and points the mesh views at the reordered data in
+		// meshes, so the model can be passed to KsmWriter::Write as it is. Runs before levels of detail are
+		// generated (see MeshSimplifier::GenerateLods), since it renumbers the vertices they'd index
+		//
+		void OptimizeModel(
+			_Inout_ KsmModelView& model,
+			_In_ const MeshOptimizationSettings& settings,
+			_Out_ std::vector<OptimizedMesh>& meshes);
+	}
+}
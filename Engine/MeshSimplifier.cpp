@@ -0,0 +1,484 @@
+//////////////////////////////////////////////////////////////////////////
+// MeshSimplifier.cpp
+// Quadric error edge collapse and the level of detail chains built
+// with it
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+using namespace DirectX;
+using namespace Engine;
+
+namespace
+{
+	const UINT NoVertex = ~0U;
+
+	//
+	// A level that keeps more than this fraction of the previous level's triangles isn't worth its memory
+	//
+	const float MinimumLevelReduction = 0.85f;
+
+	//
+	// Collapses that turn a triangle by more than this (as the cosine between its normal before and after)
+	// would fold the surface over, so they're refused
+	//
+	const float MaxNormalChange = 0.25f;
+
+	//
+	// The sum of the squared distances to a set of planes, weighted by the area of the triangles they came
+	// from, as the symmetric matrix of x^2, xy, xz, x, y^2, yz, y, z^2, z, 1 terms
+	//
+	struct Quadric
+	{
+		Quadric()
+		{
+			memset(this, 0, sizeof(*this));
+		}
+
+		void AddPlane(
+			_In_ double a,
+			_In_ double b,
+			_In_ double c,
+			_In_ double d,
+			_In_ double weight)
+		{
+			Terms[0] += weight * a * a;
+			Terms[1] += weight * a * b;
+			Terms[2] += weight * a * c;
+			Terms[3] += weight * a * d;
+			Terms[4] += weight * b * b;
+			Terms[5] += weight * b * c;
+			Terms[6] += weight * b * d;
+			Terms[7] += weight * c * c;
+			Terms[8] += weight * c * d;
+			Terms[9] += weight * d * d;
+			Weight += weight;
+		}
+
+		void Add(_In_ const Quadric& other)
+		{
+			for (UINT i = 0; i < 10; ++i)
+			{
+				Terms[i] += other.Terms[i];
+			}
+			Weight += other.Weight;
+		}
+
+		//
+		// Returns the weighted mean squared distance of the point to the planes
+		//
+		double Evaluate(_In_ const XMFLOAT3& p) const
+		{
+			double x = p.x;
+			double y = p.y;
+			double z = p.z;
+
+			double error =
+				Terms[0] * x * x + 2.0 * Terms[1] * x * y + 2.0 * Terms[2] * x * z + 2.0 * Terms[3] * x +
+				Terms[4] * y * y + 2.0 * Terms[5] * y * z + 2.0 * Terms[6] * y +
+				Terms[7] * z * z + 2.0 * Terms[8] * z +
+				Terms[9];
+
+			// Rounding can take a point that lies on every plane slightly below zero
+			return (Weight > 0.0) ? std::max(error / Weight, 0.0) : 0.0;
+		}
+
+		double Terms[10];
+		double Weight;
+	};
+
+	//
+	// Moving vertex From onto vertex To. Corner is the vertex To is drawn with on From's side, which differs
+	// from To when a seam runs through To
+	//
+	struct Collapse
+	{
+		UINT From;
+		UINT To;
+		UINT Corner;
+		double Cost;
+	};
+
+	//
+	// Hashes positions by their exact bits, to find the vertices split along seams
+	//
+	struct PositionHash
+	{
+		size_t operator()(_In_ const XMFLOAT3& p) const
+		{
+			UINT bits[3];
+			memcpy(bits, &p, sizeof(bits));
+			return (bits[0] * 73856093U) ^ (bits[1] * 19349663U) ^ (bits[2] * 83492791U);
+		}
+	};
+
+	struct PositionEqual
+	{
+		bool operator()(
+			_In_ const XMFLOAT3& a,
+			_In_ const XMFLOAT3& b) const
+		{
+			return memcmp(&a, &b, sizeof(XMFLOAT3)) == 0;
+		}
+	};
+
+	XMVECTOR triangleNormal(
+		_In_ const XMFLOAT3& p0,
+		_In_ const XMFLOAT3& p1,
+		_In_ const XMFLOAT3& p2)
+	{
+		XMVECTOR v0 = XMLoadFloat3(&p0);
+		return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p1), v0), XMVectorSubtract(XMLoadFloat3(&p2), v0));
+	}
+}
+
+float MeshSimplifier::Simplify(
+	_In_ const std::vector<UINT>& indices,
+	_In_ const std::vector<XMFLOAT3>& positions,
+	_In_ UINT targetIndexCount,
+	_In_ float targetError,
+	_Out_ std::vector<UINT>& destination)
+{
+	UINT vertexCount = static_cast<UINT>(positions.size());
+	destination = indices;
+
+	//
+	// Collapses are worked out on welded vertices, the first vertex at each position, so the triangles
+	// either side of a seam stay connected. corner holds the one vertex drawn at each welded position that
+	// isn't on a seam
+	std::vector<UINT> welded(vertexCount);
+	{
+		std::unordered_map<XMFLOAT3, UINT, PositionHash, PositionEqual> firstAtPosition;
+		for (UINT v = 0; v < vertexCount; ++v)
+		{
+			welded[v] = firstAtPosition.insert(std::make_pair(positions[v], v)).first->second;
+		}
+	}
+
+	std::vector<bool> locked(vertexCount, false);
+	std::vector<UINT> corner(vertexCount, NoVertex);
+	for (UINT index : destination)
+	{
+		UINT w = welded[index];
+		if (corner[w] == NoVertex)
+		{
+			corner[w] = index;
+		}
+		else if (corner[w] != index)
+		{
+			locked[w] = true;
+		}
+	}
+
+	//
+	// Edges only one triangle uses are on the open edge of the mesh, and edges more than two use can't be
+	// collapsed without tearing the surface, so neither end of either may move
+	{
+		std::unordered_map<uint64_t, UINT> edgeUses;
+		for (size_t t = 0; t < destination.size(); t += 3)
+		{
+			for (UINT k = 0; k < 3; ++k)
+			{
+				UINT a = welded[destination[t + k]];
+				UINT b = welded[destination[t + (k + 1) % 3]];
+				++edgeUses[((uint64_t)std::min(a, b) << 32) | std::max(a, b)];
+			}
+		}
+
+		for (const auto& edge : edgeUses)
+		{
+			if (edge.second != 2)
+			{
+				locked[static_cast<UINT>(edge.first >> 32)] = true;
+				locked[static_cast<UINT>(edge.first & 0xFFFFFFFF)] = true;
+			}
+		}
+	}
+
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t t = 0; t < destination.size(); t += 3)
+	{
+		UINT a = welded[destination[t]];
+		UINT b = welded[destination[t + 1]];
+		UINT c = welded[destination[t + 2]];
+
+		XMVECTOR normal = triangleNormal(positions[a], positions[b], positions[c]);
+		float area = XMVectorGetX(XMVector3Length(normal));
+		if (area <= 0.0f)
+		{
+			continue;
+		}
+
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, XMVectorScale(normal, 1.0f / area));
+		double d = -(n.x * positions[a].x + n.y * positions[a].y + n.z * positions[a].z);
+
+		Quadric plane;
+		plane.AddPlane(n.x, n.y, n.z, d, area);
+		quadrics[a].Add(plane);
+		quadrics[b].Add(plane);
+		quadrics[c].Add(plane);
+	}
+
+	double maxCost = (targetError > 0.0f) ? (double)targetError * targetError : 0.0;
+	double largestCost = 0.0;
+	UINT indexCount = static_cast<UINT>(destination.size());
+
+	std::vector<UINT> triangleOffsets(vertexCount + 1);
+	std::vector<UINT> vertexTriangles;
+	std::vector<Collapse> collapses;
+	std::vector<bool> touched(vertexCount);
+
+	//
+	// Each pass collapses the cheapest edges that don't share a neighbourhood with one collapsed before them
+	// in the same pass, so the costs and adjacency worked out at the start of the pass stay right
+	while (indexCount > targetIndexCount)
+	{
+		// The triangles around each welded vertex
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (UINT index : destination)
+		{
+			++triangleOffsets[welded[index] + 1];
+		}
+		for (UINT v = 0; v < vertexCount; ++v)
+		{
+			triangleOffsets[v + 1] += triangleOffsets[v];
+		}
+
+		vertexTriangles.resize(destination.size());
+		std::vector<UINT> filled(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (UINT i = 0; i < destination.size(); ++i)
+		{
+			vertexTriangles[filled[welded[destination[i]]]++] = i / 3;
+		}
+
+		//
+		// An edge that can be collapsed has a triangle on either side, each going round it the other way, so
+		// taking every triangle's edges in its own winding order finds both directions of every collapse once
+		collapses.clear();
+		for (UINT t = 0; t < destination.size() / 3; ++t)
+		{
+			for (UINT k = 0; k < 3; ++k)
+			{
+				UINT from = welded[destination[t * 3 + k]];
+				UINT toCorner = destination[t * 3 + (k + 1) % 3];
+				UINT to = welded[toCorner];
+
+				if (locked[from])
+				{
+					continue;
+				}
+
+				Quadric merged = quadrics[from];
+				merged.Add(quadrics[to]);
+
+				Collapse collapse;
+				collapse.From = from;
+				collapse.To = to;
+				collapse.Corner = toCorner;
+				collapse.Cost = merged.Evaluate(positions[to]);
+
+				if (collapse.Cost <= maxCost)
+				{
+					collapses.push_back(collapse);
+				}
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b)
+		{
+			return a.Cost < b.Cost;
+		});
+
+		std::fill(touched.begin(), touched.end(), false);
+		UINT passCollapses = 0;
+
+		for (const auto& collapse : collapses)
+		{
+			if (indexCount <= targetIndexCount)
+			{
+				break;
+			}
+
+			if (touched[collapse.From] || touched[collapse.To])
+			{
+				continue;
+			}
+
+			//
+			// Refuse to fold any of the triangles that stay over
+			bool flips = false;
+			for (UINT i = triangleOffsets[collapse.From]; i < triangleOffsets[collapse.From + 1] && !flips; ++i)
+			{
+				const UINT* triangle = &destination[vertexTriangles[i] * 3];
+				UINT a = welded[triangle[0]];
+				UINT b = welded[triangle[1]];
+				UINT c = welded[triangle[2]];
+				if (a == collapse.To || b == collapse.To || c == collapse.To)
+				{
+					continue;
+				}
+
+				XMVECTOR before = triangleNormal(positions[a], positions[b], positions[c]);
+				XMVECTOR after = triangleNormal(
+					positions[(a == collapse.From) ? collapse.To : a],
+					positions[(b == collapse.From) ? collapse.To : b],
+					positions[(c == collapse.From) ? collapse.To : c]);
+
+				// Slivers with no area have no facing to lose
+				float lengths = XMVectorGetX(XMVector3Length(before)) * XMVectorGetX(XMVector3Length(after));
+				flips = lengths > 0.0f && XMVectorGetX(XMVector3Dot(before, after)) < MaxNormalChange * lengths;
+			}
+
+			if (flips)
+			{
+				continue;
+			}
+
+			for (UINT i = triangleOffsets[collapse.From]; i < triangleOffsets[collapse.From + 1]; ++i)
+			{
+				UINT* triangle = &destination[vertexTriangles[i] * 3];
+				bool degenerate = false;
+
+				for (UINT k = 0; k < 3; ++k)
+				{
+					UINT w = welded[triangle[k]];
+					degenerate = degenerate || (w == collapse.To);
+					touched[w] = true;
+
+					if (w == collapse.From)
+					{
+						triangle[k] = collapse.Corner;
+					}
+				}
+
+				// The triangles across the edge vanish; they're dropped at the end of the pass
+				if (degenerate)
+				{
+					indexCount -= 3;
+				}
+			}
+
+			quadrics[collapse.To].Add(quadrics[collapse.From]);
+			largestCost = std::max(largestCost, collapse.Cost);
+			++passCollapses;
+		}
+
+		if (passCollapses == 0)
+		{
+			break;
+		}
+
+		size_t kept = 0;
+		for (size_t t = 0; t < destination.size(); t += 3)
+		{
+			UINT a = welded[destination[t]];
+			UINT b = welded[destination[t + 1]];
+			UINT c = welded[destination[t + 2]];
+
+			if (a != b && b != c && a != c)
+			{
+				destination[kept++] = destination[t];
+				destination[kept++] = destination[t + 1];
+				destination[kept++] = destination[t + 2];
+			}
+		}
+		destination.resize(kept);
+		indexCount = static_cast<UINT>(kept);
+	}
+
+	return static_cast<float>(sqrt(largestCost));
+}
+
+void MeshSimplifier::GenerateLods(
+	_Inout_ KsmModelView& model,
+	_In_ const LodChainSettings& settings,
+	_Out_ std::vector<MeshLodChain>& lods)
+{
+	lods.clear();
+	lods.resize(model.Meshes.size());
+
+	for (size_t m = 0; m < model.Meshes.size(); ++m)
+	{
+		KsmMeshView& view = model.Meshes[m];
+		MeshLodChain& chain = lods[m];
+
+		// Sized up front so the views can point into the chain as it grows
+		view.Lods.clear();
+		chain.Indices.reserve(settings.MaxLevels);
+
+		std::vector<UINT> previous(view.IndexCount);
+		for (UINT i = 0; i < view.IndexCount; ++i)
+		{
+			previous[i] = view.GetIndex(i);
+		}
+
+		std::vector<XMFLOAT3> positions;
+		KsmReader::ReadPositions(view, positions);
+		if (positions.empty())
+		{
+			continue;
+		}
+
+		XMVECTOR minimum = XMLoadFloat3(&positions[0]);
+		XMVECTOR maximum = minimum;
+		for (const auto& position : positions)
+		{
+			minimum = XMVectorMin(minimum, XMLoadFloat3(&position));
+			maximum = XMVectorMax(maximum, XMLoadFloat3(&position));
+		}
+		float maxError = settings.MaxError * XMVectorGetX(XMVector3Length(XMVectorSubtract(maximum, minimum)));
+
+		float error = 0.0f;
+		std::vector<UINT> level;
+
+		for (UINT l = 0; l < settings.MaxLevels; ++l)
+		{
+			UINT triangleCount = static_cast<UINT>(previous.size() / 3);
+			if (triangleCount < settings.MinimumTriangles)
+			{
+				break;
+			}
+
+			//
+			// Each level starts from the one before, so it only has to meet its own share of the error budget
+			// and the errors of the chain add up to no more than maxError
+			if (error >= maxError)
+			{
+				break;
+			}
+
+			UINT targetIndexCount = static_cast<UINT>(triangleCount * settings.Reduction) * 3;
+			float levelError = Simplify(previous, positions, targetIndexCount, maxError - error, level);
+
+			if (level.size() > previous.size() * MinimumLevelReduction)
+			{
+				break;
+			}
+
+			error += levelError;
+			MeshOptimizer::OptimizeVertexCache(level, view.VertexCount);
+
+			std::vector<byte> bytes(level.size() * view.IndexSize);
+			for (UINT i = 0; i < level.size(); ++i)
+			{
+				WriteKsmIndex(bytes.data(), view.IndexSize, i, level[i]);
+			}
+			chain.Indices.push_back(std::move(bytes));
+
+			KsmLodView lod;
+			lod.IndexCount = static_cast<UINT>(level.size());
+			lod.IndexData = chain.Indices.back().data();
+			lod.Error = error;
+			view.Lods.push_back(lod);
+
+			previous.swap(level);
+		}
+	}
+}
@@ -0,0 +1,78 @@
+//////////////////////////////////////////////////////////////////////////
+// MeshSimplifier.h
+// Builds coarser levels of detail of KSM meshes with quadric error
+// edge collapse (Garland and Heckbert). Every collapse moves a vertex
+// onto one of its neighbours rather than to a new position, so a level
+// is just another index list into the mesh's own vertices and costs no
+// vertex memory. Vertices on a texture or normal seam or on the open
+// edge of a mesh never move, which keeps seams closed and silhouettes
+// intact. Has no dependency on the graphics device so it can be run
+// headless.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "KsmReader.h"
+#include <DirectXMath.h>
+#include <vector>
+
+namespace Engine
+{
+	struct LodChainSettings
+	{
+		LodChainSettings() :
+			MaxLevels(3), Reduction(0.5f), MaxError(0.05f), MinimumTriangles(32)
+		{}
+
+		// The most levels to build after the full resolution mesh
+		UINT MaxLevels;
+
+		// The fraction of the previous level's triangles each level aims for
+		float Reduction;
+
+		// The largest error any level may have, as a fraction of the size of the mesh's bounding box
+		float MaxError;
+
+		// Meshes with fewer triangles than this get no more levels
+		UINT MinimumTriangles;
+	};
+
+	//
+	// The index lists of the levels of detail of one mesh. A KsmMeshView points into them after
+	// GenerateLods, so they have to live as long as the view
+	//
+	struct MeshLodChain
+	{
+		std::vector<std::vector<byte>> Indices;
+	};
+
+	namespace MeshSimplifier
+	{
+		//
+		// FullName:  Engine::MeshSimplifier::Simplify
+		// Collapses edges of the triangle list, cheapest first, until it has no more than targetIndexCount
+		// indices or the next collapse would move the surface further than targetError. The error of a
+		// collapse is the root mean square distance of the vertex it keeps to the planes of every triangle
+		// merged into it, weighted by area. Returns the largest error of the collapses made
+		//
+		float Simplify(
+			_In_ const std::vector<UINT>& indices,
+			_In_ const std::vector<DirectX::XMFLOAT3>& positions,
+			_In_ UINT targetIndexCount,
+			_In_ float targetError,
+			_Out_ std::vector<UINT>& destination);
+
+		//
+		// FullName:  Engine::MeshSimplifier::GenerateLods
+		// Builds levels of detail for every mesh of the model, each simplified from the one before, and
+		// points the mesh views at them in lods so the model can be passed to KsmWriter::Write. A mesh's
+		// chain stops early once simplifying stops paying off or would exceed the error allowed. Run
+		// MeshOptimizer::OptimizeModel first, if at all, since it renumbers the vertices
+		//
+		void GenerateLods(
+			_Inout_ KsmModelView& model,
+			_In_ const LodChainSettings& settings,
+			_Out_ std::vector<MeshLodChain>& lods);
+	}
+}
@@ -0,0 +1,236 @@
+//////////////////////////////////////////////////////////////////////////
+// NullRenderBackend.h
+// A RenderBackend that draws nothing. It counts the calls it gets and
+// touches the data it is given the way a real backend would copy it, so
+// recording and submitting a RenderQueue can be profiled on any platform.
+// It hands out and reuses ids like a real backend and fails on binds of
+// ids that aren't registered, so it also catches resources used after
+// they were removed
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "RenderQueue.h"
+#include <unordered_map>
+
+namespace Engine
+{
+	struct NullRenderBackendStats
+	{
+		UINT ShaderBinds;
+		UINT TextureBinds;
+		UINT GeometryBinds;
+		UINT TransformUploads;
+		UINT BonePaletteUploads;
+		UINT Draws;
+		ULONG64 Indices;
+
+		// Instanced draws are also counted in Draws
+		UINT InstancedDraws;
+		UINT Instances;
+	};
+
+	class NullRenderBackend : public RenderBackend
+	{
+	public:
+
+		// Palettes longer than this are cut short, as a constant buffer would
+		static const UINT MaxBones = 96;
+
+		NullRenderBackend()
+			: _textures(1, nullptr), _textureReferences(1, 0)
+		{
+			ResetCounters();
+		}
+
+		UINT AddTexture(_In_opt_ ID3D11ShaderResourceView* texture) override
+		{
+			if (texture == nullptr)
+			{
+				return 0;
+			}
+
+			auto found = _textureIds.find(texture);
+			if (found != _textureIds.end())
+			{
+				++_textureReferences[found->second];
+				return found->second;
+			}
+
+			UINT id = takeId(_freeTextures, _textureReferences);
+			_textures.resize(_textureReferences.size());
+			_textures[id] = texture;
+			_textureReferences[id] = 1;
+			_textureIds[texture] = id;
+			return id;
+		}
+
+		void RemoveTexture(_In_ UINT texture) override
+		{
+			if (texture == 0)
+			{
+				return;
+			}
+
+			MUKASHIDEBUG_CRITICALERROR_ONFALSE(texture < _textureReferences.size() && _textureReferences[texture] > 0);
+			if (--_textureReferences[texture] > 0)
+			{
+				return;
+			}
+
+			_textureIds.erase(_textures[texture]);
+			_textures[texture] = nullptr;
+			_freeTextures.push_back(texture);
+		}
+
+		UINT AddGeometry(
+			_In_ ID3D11Buffer* vertexBuffer,
+			_In_ UINT vertexStride,
+			_In_ ID3D11Buffer* indexBuffer,
+			_In_ UINT indexSize,
+			_In_ const Material& material) override
+		{
+			UNREFERENCED_PARAMETER(vertexBuffer);
+			UNREFERENCED_PARAMETER(vertexStride);
+			UNREFERENCED_PARAMETER(indexBuffer);
+			UNREFERENCED_PARAMETER(material);
+			MUKASHIDEBUG_CRITICALERROR_ONFALSE(indexSize == 2 || indexSize == 4);
+
+			UINT id = takeId(_freeGeometry, _geometryLive);
+			_geometryLive[id] = 1;
+			return id;
+		}
+
+		void RemoveGeometry(_In_ UINT geometry) override
+		{
+			MUKASHIDEBUG_CRITICALERROR_ONFALSE(geometry < _geometryLive.size() && _geometryLive[geometry]);
+			_geometryLive[geometry] = 0;
+			_freeGeometry.push_back(geometry);
+		}
+
+		void BindShader(_In_ UINT shader) override
+		{
+			UNREFERENCED_PARAMETER(shader);
+			++_stats.ShaderBinds;
+		}
+
+		void BindTexture(_In_ UINT texture) override
+		{
+			MUKASHIDEBUG_CRITICALERROR_ONFALSE(texture == 0 || (texture < _textureReferences.size() && _textureReferences[texture] > 0));
+			++_stats.TextureBinds;
+		}
+
+		void BindGeometry(_In_ UINT geometry) override
+		{
+			MUKASHIDEBUG_CRITICALERROR_ONFALSE(geometry < _geometryLive.size() && _geometryLive[geometry]);
+			++_stats.GeometryBinds;
+		}
+
+		void SetTransform(_In_ const RenderTransform& transform) override
+		{
+			memcpy(&_transform, &transform, sizeof(_transform));
+			++_stats.TransformUploads;
+		}
+
+		void SetBonePalette(
+			_In_ const DirectX::XMFLOAT4X4* palette,
+			_In_ UINT count) override
+		{
+			if (count > MaxBones)
+			{
+				count = MaxBones;
+			}
+			memcpy(_bonePalette, palette, count * sizeof(DirectX::XMFLOAT4X4));
+			++_stats.BonePaletteUploads;
+		}
+
+		void DrawIndexed(_In_ UINT indexCount) override
+		{
+			++_stats.Draws;
+			_stats.Indices += indexCount;
+		}
+
+		void DrawIndexedInstanced(
+			_In_ UINT indexCount,
+			_In_ const RenderTransform* transforms,
+			_In_ UINT instanceCount) override
+		{
+			_instanceData.assign(transforms, transforms + instanceCount);
+
+			++_stats.Draws;
+			++_stats.InstancedDraws;
+			_stats.Instances += instanceCount;
+			_stats.Indices += (ULONG64)indexCount * instanceCount;
+		}
+
+		const NullRenderBackendStats& GetStats() const
+		{
+			return _stats;
+		}
+
+		void ResetCounters()
+		{
+			memset(&_stats, 0, sizeof(_stats));
+		}
+
+		//
+		// The number of textures and geometries currently added and not yet removed
+		//
+		UINT GetTextureCount() const
+		{
+			return static_cast<UINT>(_textureIds.size());
+		}
+
+		UINT GetGeometryCount() const
+		{
+			return static_cast<UINT>(_geometryLive.size() - _freeGeometry.size());
+		}
+
+	private:
+
+		// Make class not copyable
+		NullRenderBackend(const NullRenderBackend&);
+		NullRenderBackend& operator=(const NullRenderBackend&);
+
+		//
+		// Returns a removed id if there is one and otherwise a new one, growing table to hold it
+		//
+		static UINT takeId(
+			_Inout_ std::vector<UINT>& freeIds,
+			_Inout_ std::vector<UINT>& table)
+		{
+			if (!freeIds.empty())
+			{
+				UINT id = freeIds.back();
+				freeIds.pop_back();
+				return id;
+			}
+
+			table.push_back(0);
+			return static_cast<UINT>(table.size() - 1);
+		}
+
+	private:
+
+		NullRenderBackendStats _stats;
+
+		// Stand ins for the constant buffers the uploads would go to
+		RenderTransform _transform;
+		DirectX::XMFLOAT4X4 _bonePalette[MaxBones];
+
+		// Stand in for the instance buffer
+		std::vector<RenderTransform> _instanceData;
+
+		// The texture and the references to it of each texture id, the first being the null texture, and the
+		// ids of the textures added, by texture
+		std::vector<ID3D11ShaderResourceView*> _textures;
+		std::vector<UINT> _textureReferences;
+		std::unordered_map<ID3D11ShaderResourceView*, UINT> _textureIds;
+		std::vector<UINT> _freeTextures;
+
+		// 1 for each geometry id in use
+		std::vector<UINT> _geometryLive;
+		std::vector<UINT> _freeGeometry;
+	};
+}
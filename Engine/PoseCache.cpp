@@ -0,0 +1,112 @@
+//////////////////////////////////////////////////////////////////////////
+// PoseCache.cpp
+// Shares evaluated poses between instances playing the same clip at the
+// same quantized time.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "PoseCache.h"
+#include <cmath>
+
+using namespace Engine;
+
+size_t PoseCache::KeyHash::operator()(const Key& key) const
+{
+	size_t hash = std::hash<const void*>()(key.Model);
+	hash ^= std::hash<UINT>()(key.Clip) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	hash ^= std::hash<int64_t>()(key.Sample) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	return hash;
+}
+
+PoseCache::PoseCache(_In_opt_ float samplesPerSecond /*= 30.0f*/)
+	: _samplesPerSecond(samplesPerSecond), _frame(0), _hits(0), _misses(0)
+{
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(samplesPerSecond > 0.0f);
+}
+
+const CredibleModelPose& PoseCache::Acquire(
+	_In_ const PoseEvaluator* model,
+	_In_ UINT clip,
+	_In_ float time,
+	_In_ const Evaluator& evaluate)
+{
+	float sampleTime;
+	bool missed;
+	CredibleModelPose& pose = Reserve(model, clip, time, sampleTime, missed);
+
+	if (missed)
+	{
+		evaluate(sampleTime, pose);
+	}
+
+	return pose;
+}
+
+CredibleModelPose& PoseCache::Reserve(
+	_In_ const PoseEvaluator* model,
+	_In_ UINT clip,
+	_In_ float time,
+	_Out_ float& sampleTime,
+	_Out_ bool& evaluate)
+{
+	Key key;
+	key.Model = model;
+	key.Clip = clip;
+	key.Sample = static_cast<int64_t>(std::floor(time * _samplesPerSecond));
+
+	// Every instance in this sample gets the pose at the start of it
+	sampleTime = key.Sample / _samplesPerSecond;
+
+	auto& entry = _poses[key];
+	evaluate = !entry;
+	if (evaluate)
+	{
+		++_misses;
+		entry.reset(new Entry());
+	}
+	else
+	{
+		++_hits;
+	}
+
+	entry->LastFrame = _frame;
+	return entry->Pose;
+}
+
+void PoseCache::EndFrame()
+{
+	for (auto it = _poses.begin(); it != _poses.end();)
+	{
+		if (it->second->LastFrame != _frame)
+		{
+			it = _poses.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	++_frame;
+}
+
+void PoseCache::Clear()
+{
+	_poses.clear();
+}
+
+PoseCacheStats PoseCache::GetStats() const
+{
+	PoseCacheStats stats;
+	stats.PoseCount = _poses.size();
+	stats.Hits = _hits;
+	stats.Misses = _misses;
+	return stats;
+}
+
+void PoseCache::ResetCounters()
+{
+	_hits = 0;
+	_misses = 0;
+}
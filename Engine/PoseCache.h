@@ -0,0 +1,133 @@
+//////////////////////////////////////////////////////////////////////////
+// PoseCache.h
+// Shares evaluated poses between instances of a model that are playing
+// the same animation clip at (nearly) the same time. Time is quantized
+// to a fixed sample rate, so every instance of a crowd playing a clip
+// within the same sample reuses one CredibleModelPose and the cost of
+// posing scales with the number of distinct clips and times rather than
+// the number of instances. Poses nobody asks for during a frame are
+// dropped at the end of it.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "CredibleModelPose.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Engine
+{
+	struct PoseCacheStats
+	{
+		// Poses currently held
+		size_t PoseCount;
+
+		// Requests served from an existing pose, and ones that had to evaluate one, since the last ResetCounters
+		size_t Hits;
+		size_t Misses;
+	};
+
+	class PoseCache
+	{
+	public:
+
+		//
+		// Fills pose with the model's pose at the given time, e.g. by sampling the clip's channels and calling
+		// PoseEvaluator::EvaluatePose with them
+		//
+		typedef std::function<void(float time, CredibleModelPose& pose)> Evaluator;
+
+		//
+		// Instances whose times fall within the same 1 / samplesPerSecond share a pose
+		//
+		PoseCache(_In_opt_ float samplesPerSecond = 30.0f);
+
+		//
+		// FullName:  Engine::PoseCache::Acquire
+		// Returns the pose of the model playing the given clip (see CredibleModelData::FindAnimation) at the
+		// given time. If the pose isn't cached yet, evaluate is called with the time quantized to the cache's
+		// sample rate. The model is only told apart from others by its address. The pose stays
+		// valid until the EndFrame call after the last frame it was asked for in
+		//
+		const CredibleModelPose& Acquire(
+			_In_ const PoseEvaluator* model,
+			_In_ UINT clip,
+			_In_ float time,
+			_In_ const Evaluator& evaluate);
+
+		//
+		// FullName:  Engine::PoseCache::Reserve
+		// Like Acquire, but leaves evaluating a missing pose to the caller so several can be evaluated in
+		// parallel. If evaluate is set the returned pose is new and empty, and the caller has to fill it with
+		// the pose at sampleTime before anyone uses it. Only one thread may call Reserve or Acquire at a time
+		//
+		CredibleModelPose& Reserve(
+			_In_ const PoseEvaluator* model,
+			_In_ UINT clip,
+			_In_ float time,
+			_Out_ float& sampleTime,
+			_Out_ bool& evaluate);
+
+		//
+		// FullName:  Engine::PoseCache::EndFrame
+		// Drops the poses that weren't asked for since the previous call. Call once per frame after drawing
+		//
+		void EndFrame();
+
+		//
+		// Drops every pose, e.g. before a model is released
+		//
+		void Clear();
+
+		PoseCacheStats GetStats() const;
+
+		void ResetCounters();
+
+	private:
+
+		// Make class not copyable
+		PoseCache(const PoseCache&);
+		PoseCache& operator=(const PoseCache&);
+
+		struct Key
+		{
+			const PoseEvaluator* Model;
+			UINT Clip;
+			int64_t Sample;
+
+			bool operator==(const Key& other) const
+			{
+				return Model == other.Model && Clip == other.Clip && Sample == other.Sample;
+			}
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const;
+		};
+
+		struct Entry
+		{
+			CredibleModelPose Pose;
+
+			// The frame the pose was last asked for in
+			uint64_t LastFrame;
+		};
+
+	private:
+
+		float _samplesPerSecond;
+
+		// Counts EndFrame calls
+		uint64_t _frame;
+
+		std::unordered_map<Key, std::unique_ptr<Entry>, KeyHash> _poses;
+
+		size_t _hits;
+		size_t _misses;
+	};
+}
@@ -0,0 +1,194 @@
+//////////////////////////////////////////////////////////////////////////
+// RenderQueue.cpp
+// Records draws as sortable packets and submits them to a backend with
+// redundant state changes removed
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "RenderQueue.h"
+#include <algorithm>
+#include <climits>
+
+using namespace DirectX;
+using namespace Engine;
+
+namespace
+{
+	const UINT ShaderShift = 48;
+	const UINT TextureShift = 24;
+
+	// Never a valid sort key component, so the first packet always sets its state
+	const uint64_t NoState = ~0ULL;
+
+	const UINT NoInstancedShader = ~0U;
+}
+
+RenderQueue::RenderQueue()
+	: _minimumInstances(DefaultMinimumInstances)
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+void RenderQueue::SetInstancedShader(
+	_In_ UINT shader,
+	_In_ UINT instancedShader)
+{
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(shader <= MaxShader && instancedShader <= MaxShader);
+
+	if (_instancedShaders.size() <= shader)
+	{
+		_instancedShaders.resize(shader + 1, NoInstancedShader);
+	}
+	_instancedShaders[shader] = instancedShader;
+}
+
+UINT RenderQueue::AddTransform(_In_ const XMFLOAT4X4& world)
+{
+	XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
+
+	// Normals only need the inverse transpose of the upper 3x3, so leave the translation out of it
+	XMMATRIX withoutTranslation = worldMatrix;
+	withoutTranslation.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+	XMVECTOR determinant = XMMatrixDeterminant(withoutTranslation);
+	XMMATRIX worldInvTranspose = XMMatrixTranspose(XMMatrixInverse(&determinant, withoutTranslation));
+
+	RenderTransform transform;
+	XMStoreFloat4x4(&transform.World, XMMatrixTranspose(worldMatrix));
+	XMStoreFloat4x4(&transform.WorldInvTranspose, XMMatrixTranspose(worldInvTranspose));
+
+	_transforms.push_back(transform);
+	return static_cast<UINT>(_transforms.size() - 1);
+}
+
+void RenderQueue::Add(
+	_In_ UINT shader,
+	_In_ UINT texture,
+	_In_ UINT geometry,
+	_In_ UINT indexCount,
+	_In_ UINT transform,
+	_In_opt_ const XMFLOAT4X4* bonePalette,
+	_In_ UINT boneCount)
+{
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(shader <= MaxShader && texture <= MaxTexture && geometry <= MaxGeometry);
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(transform < _transforms.size());
+
+	Packet packet;
+	packet.Key = ((uint64_t)shader << ShaderShift) | ((uint64_t)texture << TextureShift) | geometry;
+	packet.BonePalette = (boneCount > 0) ? bonePalette : nullptr;
+	packet.BoneCount = boneCount;
+	packet.IndexCount = indexCount;
+	packet.Transform = transform;
+
+	_packets.push_back(packet);
+}
+
+void RenderQueue::Submit(_Inout_ RenderBackend& backend)
+{
+	memset(&_stats, 0, sizeof(_stats));
+	_stats.Packets = static_cast<UINT>(_packets.size());
+
+	// Packets with the same state keep the order they were recorded in, so a frame sorts the same every time
+	std::sort(_packets.begin(), _packets.end(), [](const Packet& a, const Packet& b)
+	{
+		return (a.Key != b.Key) ? a.Key < b.Key : a.Transform < b.Transform;
+	});
+
+	uint64_t shader = NoState;
+	uint64_t texture = NoState;
+	uint64_t geometry = NoState;
+	UINT transform = UINT_MAX;
+	const XMFLOAT4X4* bonePalette = nullptr;
+
+	for (size_t p = 0; p < _packets.size(); ++p)
+	{
+		const Packet& packet = _packets[p];
+
+		uint64_t packetShader = packet.Key >> ShaderShift;
+		uint64_t packetTexture = (packet.Key >> TextureShift) & MaxTexture;
+		uint64_t packetGeometry = packet.Key & MaxGeometry;
+
+		//
+		// Packets with the same key are next to each other, so the unskinned ones that follow this one make up
+		// an instanced draw if there are enough of them
+		UINT instancedShader = (packetShader < _instancedShaders.size()) ? _instancedShaders[packetShader] : NoInstancedShader;
+		size_t runEnd = p;
+		if (instancedShader != NoInstancedShader)
+		{
+			while (runEnd < _packets.size() &&
+				_packets[runEnd].Key == packet.Key &&
+				_packets[runEnd].IndexCount == packet.IndexCount &&
+				_packets[runEnd].BonePalette == nullptr)
+			{
+				++runEnd;
+			}
+		}
+
+		if (runEnd - p < _minimumInstances)
+		{
+			instancedShader = NoInstancedShader;
+		}
+
+		uint64_t boundShader = (instancedShader != NoInstancedShader) ? instancedShader : packetShader;
+		if (boundShader != shader)
+		{
+			shader = boundShader;
+			backend.BindShader(static_cast<UINT>(shader));
+			++_stats.ShaderChanges;
+		}
+
+		if (packetTexture != texture)
+		{
+			texture = packetTexture;
+			backend.BindTexture(static_cast<UINT>(texture));
+			++_stats.TextureChanges;
+		}
+
+		if (packetGeometry != geometry)
+		{
+			geometry = packetGeometry;
+			backend.BindGeometry(static_cast<UINT>(geometry));
+			++_stats.GeometryChanges;
+		}
+
+		if (instancedShader != NoInstancedShader)
+		{
+			_instanceTransforms.clear();
+			for (size_t i = p; i < runEnd; ++i)
+			{
+				_instanceTransforms.push_back(_transforms[_packets[i].Transform]);
+			}
+
+			backend.DrawIndexedInstanced(packet.IndexCount, _instanceTransforms.data(), static_cast<UINT>(_instanceTransforms.size()));
+			++_stats.InstancedDraws;
+			_stats.InstancedPackets += static_cast<UINT>(runEnd - p);
+
+			p = runEnd - 1;
+			continue;
+		}
+
+		if (packet.Transform != transform)
+		{
+			transform = packet.Transform;
+			backend.SetTransform(_transforms[transform]);
+			++_stats.TransformChanges;
+		}
+
+		if (packet.BonePalette != nullptr && packet.BonePalette != bonePalette)
+		{
+			bonePalette = packet.BonePalette;
+			backend.SetBonePalette(bonePalette, packet.BoneCount);
+			++_stats.BonePaletteChanges;
+		}
+
+		backend.DrawIndexed(packet.IndexCount);
+	}
+
+	Clear();
+}
+
+void RenderQueue::Clear()
+{
+	_packets.clear();
+	_transforms.clear();
+}
@@ -0,0 +1,231 @@
+//////////////////////////////////////////////////////////////////////////
+// RenderQueue.h
+// Records draws as compact packets instead of issuing them as models are
+// walked. Every packet carries an integer sort key built from its shader,
+// texture and geometry, so Submit can sort the frame's packets by state
+// and only tell the backend about the state that actually changes from
+// one draw to the next. Draws of the same unskinned geometry with the
+// same texture end up next to each other after sorting, so where the
+// shader has an instanced variant they are issued as one instanced draw.
+// Backends hand out the integer ids as resources are added to them and
+// map them back to API objects; the null backend only counts what it is
+// asked to do, so recording and submission can be profiled without a
+// device.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// The API objects backends are handed when resources are added, only ever passed through by pointer here
+struct ID3D11Buffer;
+struct ID3D11ShaderResourceView;
+struct Material;
+
+namespace Engine
+{
+	//
+	// The object constants of a draw, already transposed for the shaders
+	//
+	struct RenderTransform
+	{
+		DirectX::XMFLOAT4X4 World;
+		DirectX::XMFLOAT4X4 WorldInvTranspose;
+	};
+
+	//
+	// Receives the state changes and draws of a submitted RenderQueue. Ids are whatever the backend handed
+	// out when the resources were added to it; texture id 0 means no texture. The ids of removed resources
+	// are handed out again, so nothing may be recorded with an id after it is removed
+	//
+	class RenderBackend
+	{
+	public:
+
+		virtual ~RenderBackend() {}
+
+		//
+		// Returns the id of the texture, adding it the first time it is seen. Every call adds a reference to
+		// the texture that RemoveTexture releases. Null textures are id 0 and aren't counted
+		//
+		virtual UINT AddTexture(_In_opt_ ID3D11ShaderResourceView* texture) = 0;
+
+		//
+		// Releases a reference AddTexture added, dropping the texture once the last one is gone. Removing
+		// id 0 does nothing
+		//
+		virtual void RemoveTexture(_In_ UINT texture) = 0;
+
+		//
+		// Returns the id to record draws of a mesh with. indexSize is the size of an index in bytes, 2 or 4.
+		// The backend keeps the buffers alive until RemoveGeometry
+		//
+		virtual UINT AddGeometry(
+			_In_ ID3D11Buffer* vertexBuffer,
+			_In_ UINT vertexStride,
+			_In_ ID3D11Buffer* indexBuffer,
+			_In_ UINT indexSize,
+			_In_ const Material& material) = 0;
+
+		virtual void RemoveGeometry(_In_ UINT geometry) = 0;
+
+		virtual void BindShader(_In_ UINT shader) = 0;
+
+		virtual void BindTexture(_In_ UINT texture) = 0;
+
+		//
+		// Binds the vertex and index buffers of a mesh along with its material
+		//
+		virtual void BindGeometry(_In_ UINT geometry) = 0;
+
+		virtual void SetTransform(_In_ const RenderTransform& transform) = 0;
+
+		virtual void SetBonePalette(
+			_In_ const DirectX::XMFLOAT4X4* palette,
+			_In_ UINT count) = 0;
+
+		virtual void DrawIndexed(_In_ UINT indexCount) = 0;
+
+		//
+		// Draws indexCount indices once for every transform, which are per instance data rather than object
+		// constants. Only called with an instanced shader (see RenderQueue::SetInstancedShader) bound
+		//
+		virtual void DrawIndexedInstanced(
+			_In_ UINT indexCount,
+			_In_ const RenderTransform* transforms,
+			_In_ UINT instanceCount) = 0;
+	};
+
+	//
+	// What the last Submit did. Redundant changes are the ones sorting and merging saved
+	//
+	struct RenderQueueStats
+	{
+		UINT Packets;
+		UINT ShaderChanges;
+		UINT TextureChanges;
+		UINT GeometryChanges;
+		UINT TransformChanges;
+		UINT BonePaletteChanges;
+
+		// Instanced draws issued and the packets they drew
+		UINT InstancedDraws;
+		UINT InstancedPackets;
+	};
+
+	class RenderQueue
+	{
+	public:
+
+		// The largest ids that fit in a sort key
+		static const UINT MaxShader = 0xFFFF;
+		static const UINT MaxTexture = 0xFFFFFF;
+		static const UINT MaxGeometry = 0xFFFFFF;
+
+		// The default for SetMinimumInstances
+		static const UINT DefaultMinimumInstances = 4;
+
+		RenderQueue();
+
+		//
+		// FullName:  Engine::RenderQueue::SetInstancedShader
+		// Lets draws recorded with shader be drawn instanced with instancedShader, which takes the world
+		// transforms as per instance data instead of object constants
+		//
+		void SetInstancedShader(
+			_In_ UINT shader,
+			_In_ UINT instancedShader);
+
+		//
+		// Sets how many unskinned draws of the same geometry and texture it takes to draw them instanced.
+		// Fewer than that are drawn one at a time, since an instanced draw costs more to set up
+		//
+		void SetMinimumInstances(_In_ UINT count)
+		{
+			_minimumInstances = std::max(count, 2U);
+		}
+
+		//
+		// FullName:  Engine::RenderQueue::AddTransform
+		// Stores the object constants for a world transform (row vector, as passed to Draw) and returns the
+		// index to record packets with. Meshes of the same node share one
+		//
+		UINT AddTransform(_In_ const DirectX::XMFLOAT4X4& world);
+
+		//
+		// FullName:  Engine::RenderQueue::Add
+		// Records a draw of indexCount indices of the given geometry. bonePalette may be null for meshes that
+		// aren't skinned and otherwise has to stay valid until Submit
+		//
+		void Add(
+			_In_ UINT shader,
+			_In_ UINT texture,
+			_In_ UINT geometry,
+			_In_ UINT indexCount,
+			_In_ UINT transform,
+			_In_opt_ const DirectX::XMFLOAT4X4* bonePalette,
+			_In_ UINT boneCount);
+
+		//
+		// FullName:  Engine::RenderQueue::Submit
+		// Sorts the recorded packets by shader, texture and geometry and issues them to the backend, skipping
+		// every state change that would set what is already set and drawing runs of the same unskinned
+		// geometry instanced where the shader allows. Clears the queue for the next frame
+		//
+		void Submit(_Inout_ RenderBackend& backend);
+
+		//
+		// Drops everything recorded since the last Submit
+		//
+		void Clear();
+
+		size_t GetPacketCount() const
+		{
+			return _packets.size();
+		}
+
+		const RenderQueueStats& GetStats() const
+		{
+			return _stats;
+		}
+
+	private:
+
+		// Make class not copyable
+		RenderQueue(const RenderQueue&);
+		RenderQueue& operator=(const RenderQueue&);
+
+		//
+		// One recorded draw. The state it needs is packed into Key, shader in the top 16 bits, then texture
+		// and geometry in 24 bits each
+		//
+		struct Packet
+		{
+			uint64_t Key;
+			const DirectX::XMFLOAT4X4* BonePalette;
+			UINT BoneCount;
+			UINT IndexCount;
+			UINT Transform;
+		};
+
+	private:
+
+		std::vector<Packet> _packets;
+
+		std::vector<RenderTransform> _transforms;
+
+		// The instanced variant of each shader id, NoInstancedShader if it has none
+		std::vector<UINT> _instancedShaders;
+
+		UINT _minimumInstances;
+
+		// The transforms of the instanced draw being issued, gathered so they're contiguous
+		std::vector<RenderTransform> _instanceTransforms;
+
+		RenderQueueStats _stats;
+	};
+}
@@ -0,0 +1,375 @@
+//////////////////////////////////////////////////////////////////////////
+// ResidencyCache.h
+// Keeps loaded assets of one category resident within a memory budget.
+// Entries are kept alive by reference counted handles; once the last
+// handle to an entry goes away it stays cached but becomes evictable,
+// and the least recently released entries are evicted first whenever
+// the category is over its budget. Entries that must never be evicted
+// (e.g. ones handed out as raw pointers) can be pinned.
+//
+// Handles must not outlive their cache and, like the rest of the asset
+// management, the cache is only used from the render thread.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Engine
+{
+	//
+	// Residency and usage counters of a cache
+	//
+	struct ResidencyStats
+	{
+		// Bytes of all entries in the cache, referenced or not
+		size_t ResidentBytes;
+
+		// Bytes of the entries that are referenced or pinned and so can't be evicted
+		size_t ReferencedBytes;
+
+		// The budget the cache evicts down to
+		size_t BudgetBytes;
+
+		// Highest ResidentBytes seen since the counters were reset
+		size_t PeakResidentBytes;
+
+		UINT ResidentCount;
+		UINT ReferencedCount;
+
+		ULONG64 Hits;
+		ULONG64 Misses;
+		ULONG64 Evictions;
+		ULONG64 EvictedBytes;
+	};
+
+	template<class Key, class T, class Hash = std::hash<Key>>
+	class ResidencyCache
+	{
+		struct Entry;
+
+	public:
+
+		//
+		// Keeps an entry resident for as long as it (or a copy of it) exists
+		//
+		class Handle
+		{
+		public:
+
+			Handle()
+				: _cache(nullptr), _entry(nullptr)
+			{}
+
+			Handle(const Handle& other)
+				: _cache(other._cache), _entry(other._entry)
+			{
+				if (_entry)
+				{
+					_entry->References++;
+				}
+			}
+
+			Handle(Handle&& other)
+				: _cache(other._cache), _entry(other._entry)
+			{
+				other._cache = nullptr;
+				other._entry = nullptr;
+			}
+
+			~Handle()
+			{
+				Reset();
+			}
+
+			Handle& operator=(Handle other)
+			{
+				std::swap(_cache, other._cache);
+				std::swap(_entry, other._entry);
+				return *this;
+			}
+
+			//
+			// Releases the reference this handle holds, leaving it empty
+			//
+			void Reset()
+			{
+				if (_entry)
+				{
+					_cache->release(_entry);
+					_cache = nullptr;
+					_entry = nullptr;
+				}
+			}
+
+			bool IsValid() const
+			{
+				return _entry != nullptr;
+			}
+
+			const T& Get() const
+			{
+				return _entry->Value;
+			}
+
+			const Key& GetKey() const
+			{
+				return _entry->EntryKey;
+			}
+
+		private:
+
+			friend class ResidencyCache;
+
+			Handle(_In_ ResidencyCache* cache, _In_ Entry* entry)
+				: _cache(cache), _entry(entry)
+			{
+				_cache->acquire(_entry);
+			}
+
+			ResidencyCache* _cache;
+			Entry* _entry;
+		};
+
+		ResidencyCache(_In_ size_t budgetBytes)
+		{
+			memset(&_stats, 0, sizeof(_stats));
+			_stats.BudgetBytes = budgetBytes;
+		}
+
+		~ResidencyCache()
+		{
+			Clear();
+		}
+
+		//
+		// FullName:  Engine::ResidencyCache::Find
+		// Returns a handle to the entry with the given key, or an empty handle if it isn't resident.
+		// Counts as a hit or a miss unless countAccess is false (for re-checks of a lookup already counted)
+		//
+		Handle Find(
+			_In_ const Key& key,
+			_In_opt_ bool countAccess = true)
+		{
+			auto found = _entries.find(key);
+			if (found == _entries.end())
+			{
+				if (countAccess)
+				{
+					_stats.Misses++;
+				}
+				return Handle();
+			}
+
+			if (countAccess)
+			{
+				_stats.Hits++;
+			}
+			return Handle(this, found->second.get());
+		}
+
+		//
+		// FullName:  Engine::ResidencyCache::Insert
+		// Adds a newly loaded entry of the given size and returns a handle to it. If an entry with the
+		// key is already resident the new value is dropped and the resident one is returned
+		//
+		Handle Insert(
+			_In_ const Key& key,
+			_In_ T value,
+			_In_ size_t bytes)
+		{
+			auto found = _entries.find(key);
+			if (found != _entries.end())
+			{
+				return Handle(this, found->second.get());
+			}
+
+			std::unique_ptr<Entry> entry(new Entry(key, std::move(value), bytes));
+			Entry* added = entry.get();
+			_entries[key] = std::move(entry);
+
+			_stats.ResidentBytes += bytes;
+			_stats.ResidentCount++;
+			_stats.PeakResidentBytes = std::max(_stats.PeakResidentBytes, _stats.ResidentBytes);
+
+			// Take the reference before trimming so the new entry can't be the one evicted
+			Handle handle(this, added);
+			Trim();
+			return handle;
+		}
+
+		//
+		// Keeps the entry resident until Clear(true) is called, whether or not any handles to it remain
+		//
+		void Pin(_In_ const Handle& handle)
+		{
+			if (handle._entry && !handle._entry->Pinned)
+			{
+				handle._entry->Pinned = true;
+				handle._entry->References++;
+			}
+		}
+
+		//
+		// Changes the budget, evicting entries if the cache is now over it
+		//
+		void SetBudget(_In_ size_t budgetBytes)
+		{
+			_stats.BudgetBytes = budgetBytes;
+			Trim();
+		}
+
+		//
+		// Evicts the least recently released entries until the cache is within its budget or only
+		// referenced entries are left
+		//
+		void Trim()
+		{
+			while (_stats.ResidentBytes > _stats.BudgetBytes && !_unreferenced.empty())
+			{
+				evict(_unreferenced.front());
+			}
+		}
+
+		//
+		// Evicts every entry that isn't referenced. With unpin set pinned entries are unpinned first
+		//
+		void Clear(_In_opt_ bool unpin = true)
+		{
+			if (unpin)
+			{
+				std::vector<Entry*> pinned;
+				for (auto& entry : _entries)
+				{
+					if (entry.second->Pinned)
+					{
+						pinned.push_back(entry.second.get());
+					}
+				}
+
+				for (Entry* entry : pinned)
+				{
+					entry->Pinned = false;
+					release(entry);
+				}
+			}
+
+			while (!_unreferenced.empty())
+			{
+				evict(_unreferenced.front());
+			}
+		}
+
+		ResidencyStats GetStats() const
+		{
+			ResidencyStats stats = _stats;
+			stats.ReferencedBytes = 0;
+			stats.ReferencedCount = 0;
+
+			for (const auto& entry : _entries)
+			{
+				if (entry.second->References > 0)
+				{
+					stats.ReferencedBytes += entry.second->Bytes;
+					stats.ReferencedCount++;
+				}
+			}
+
+			return stats;
+		}
+
+		//
+		// Resets the hit, miss, eviction and peak counters
+		//
+		void ResetCounters()
+		{
+			_stats.Hits = 0;
+			_stats.Misses = 0;
+			_stats.Evictions = 0;
+			_stats.EvictedBytes = 0;
+			_stats.PeakResidentBytes = _stats.ResidentBytes;
+		}
+
+	private:
+
+		// Make class not copyable
+		ResidencyCache(const ResidencyCache&);
+		ResidencyCache& operator=(const ResidencyCache&);
+
+		struct Entry
+		{
+			Entry(_In_ const Key& key, _In_ T value, _In_ size_t bytes)
+				: EntryKey(key), Value(std::move(value)), Bytes(bytes), References(0), Pinned(false), Unreferenced(false)
+			{}
+
+			Key EntryKey;
+			T Value;
+			size_t Bytes;
+
+			// Handles plus one if pinned
+			UINT References;
+			bool Pinned;
+
+			// Position in _unreferenced, only valid while Unreferenced is set
+			bool Unreferenced;
+			typename std::list<Entry*>::iterator LruPosition;
+		};
+
+		// Adds a reference to the entry, taking it off the eviction list if it was on it
+		void acquire(_In_ Entry* entry)
+		{
+			if (entry->Unreferenced)
+			{
+				_unreferenced.erase(entry->LruPosition);
+				entry->Unreferenced = false;
+			}
+
+			entry->References++;
+		}
+
+		// Drops a reference to the entry, making it evictable once the last one is gone
+		void release(_In_ Entry* entry)
+		{
+			if (--entry->References > 0)
+			{
+				return;
+			}
+
+			entry->Unreferenced = true;
+			entry->LruPosition = _unreferenced.insert(_unreferenced.end(), entry);
+			Trim();
+		}
+
+		void evict(_In_ Entry* entry)
+		{
+			_unreferenced.erase(entry->LruPosition);
+
+			_stats.ResidentBytes -= entry->Bytes;
+			_stats.ResidentCount--;
+			_stats.Evictions++;
+			_stats.EvictedBytes += entry->Bytes;
+
+			// Take the entry out of the cache before destroying it, destroying the value may release
+			// handles into other caches
+			auto found = _entries.find(entry->EntryKey);
+			std::unique_ptr<Entry> evicted = std::move(found->second);
+			_entries.erase(found);
+		}
+
+	private:
+
+		std::unordered_map<Key, std::unique_ptr<Entry>, Hash> _entries;
+
+		// Entries without references, least recently released first
+		std::list<Entry*> _unreferenced;
+
+		ResidencyStats _stats;
+	};
+}
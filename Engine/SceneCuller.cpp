@@ -0,0 +1,420 @@
+//////////////////////////////////////////////////////////////////////////
+// SceneCuller.cpp
+// Frustum culling of model instances over a four wide bounding volume
+// hierarchy, testing four boxes at a time with SSE where available (and
+// SCENECULLER_NO_SIMD isn't defined)
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "SceneCuller.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if !defined(SCENECULLER_NO_SIMD) && (defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__))
+#define SCENECULLER_SSE
+#include <xmmintrin.h>
+#endif
+
+using namespace DirectX;
+using namespace Engine;
+
+namespace
+{
+	// Items per leaf, one box packet's worth
+	const UINT LeafSize = 4;
+
+	// The extent of unused lanes. Large enough that every plane rejects them, small enough that summing
+	// three of them stays finite
+	const float EmptyExtent = -1e30f;
+
+	const UINT NoChild = 0xFFFFFFFF;
+
+	float component(_In_ const XMFLOAT3& v, _In_ UINT axis)
+	{
+		return (&v.x)[axis];
+	}
+
+	XMFLOAT4 normalizePlane(_In_ float a, _In_ float b, _In_ float c, _In_ float d)
+	{
+		float length = std::sqrt(a * a + b * b + c * c);
+		float inverseLength = (length > 0.0f) ? 1.0f / length : 0.0f;
+		return XMFLOAT4(a * inverseLength, b * inverseLength, c * inverseLength, d * inverseLength);
+	}
+
+	//
+	// Tests the four boxes of a packet against the frustum. Sets bit i of outside if box i is entirely
+	// outside of a plane and bit i of intersecting if it isn't entirely inside all of them
+	//
+	template<class Packet>
+	void testPacket(
+		_In_ const CullingFrustum& frustum,
+		_In_ const Packet& packet,
+		_Out_ int& outside,
+		_Out_ int& intersecting)
+	{
+#ifdef SCENECULLER_SSE
+		__m128 centerX = _mm_loadu_ps(packet.CenterX);
+		__m128 centerY = _mm_loadu_ps(packet.CenterY);
+		__m128 centerZ = _mm_loadu_ps(packet.CenterZ);
+		__m128 extentX = _mm_loadu_ps(packet.ExtentX);
+		__m128 extentY = _mm_loadu_ps(packet.ExtentY);
+		__m128 extentZ = _mm_loadu_ps(packet.ExtentZ);
+
+		__m128 outsideMask = _mm_setzero_ps();
+		__m128 intersectingMask = _mm_setzero_ps();
+
+		for (UINT p = 0; p < 6; ++p)
+		{
+			const XMFLOAT4& plane = frustum.Planes[p];
+
+			// Distance of the centre from the plane, and how far the box reaches towards it
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(centerX, _mm_set1_ps(plane.x)), _mm_mul_ps(centerY, _mm_set1_ps(plane.y))),
+				_mm_add_ps(_mm_mul_ps(centerZ, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+			__m128 radius = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(extentX, _mm_set1_ps(std::fabs(plane.x))), _mm_mul_ps(extentY, _mm_set1_ps(std::fabs(plane.y)))),
+				_mm_mul_ps(extentZ, _mm_set1_ps(std::fabs(plane.z))));
+
+			outsideMask = _mm_or_ps(outsideMask, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+			intersectingMask = _mm_or_ps(intersectingMask, _mm_cmplt_ps(distance, radius));
+		}
+
+		outside = _mm_movemask_ps(outsideMask);
+		intersecting = _mm_movemask_ps(intersectingMask);
+#else
+		outside = 0;
+		intersecting = 0;
+
+		for (UINT i = 0; i < 4; ++i)
+		{
+			for (UINT p = 0; p < 6; ++p)
+			{
+				const XMFLOAT4& plane = frustum.Planes[p];
+
+				float distance = packet.CenterX[i] * plane.x + packet.CenterY[i] * plane.y + packet.CenterZ[i] * plane.z + plane.w;
+				float radius = packet.ExtentX[i] * std::fabs(plane.x) + packet.ExtentY[i] * std::fabs(plane.y) + packet.ExtentZ[i] * std::fabs(plane.z);
+
+				if (distance + radius < 0.0f)
+				{
+					outside |= 1 << i;
+				}
+				if (distance < radius)
+				{
+					intersecting |= 1 << i;
+				}
+			}
+		}
+#endif
+	}
+}
+
+CullingFrustum CullingFrustum::FromViewProjection(_In_ const XMFLOAT4X4& viewProjection)
+{
+	// Points are transformed as row vectors, so clip space x, y, z and w are the dot products with the columns
+	const auto& m = viewProjection.m;
+	float column[4][4];
+	for (UINT c = 0; c < 4; ++c)
+	{
+		for (UINT r = 0; r < 4; ++r)
+		{
+			column[c][r] = m[r][c];
+		}
+	}
+
+	CullingFrustum frustum;
+
+	// -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	frustum.Planes[0] = normalizePlane(column[3][0] + column[0][0], column[3][1] + column[0][1], column[3][2] + column[0][2], column[3][3] + column[0][3]);
+	frustum.Planes[1] = normalizePlane(column[3][0] - column[0][0], column[3][1] - column[0][1], column[3][2] - column[0][2], column[3][3] - column[0][3]);
+	frustum.Planes[2] = normalizePlane(column[3][0] + column[1][0], column[3][1] + column[1][1], column[3][2] + column[1][2], column[3][3] + column[1][3]);
+	frustum.Planes[3] = normalizePlane(column[3][0] - column[1][0], column[3][1] - column[1][1], column[3][2] - column[1][2], column[3][3] - column[1][3]);
+	frustum.Planes[4] = normalizePlane(column[2][0], column[2][1], column[2][2], column[2][3]);
+	frustum.Planes[5] = normalizePlane(column[3][0] - column[2][0], column[3][1] - column[2][1], column[3][2] - column[2][2], column[3][3] - column[2][3]);
+
+	return frustum;
+}
+
+bool CullingFrustum::Intersects(
+	_In_ const XMFLOAT3& center,
+	_In_ const XMFLOAT3& extents) const
+{
+	for (UINT p = 0; p < 6; ++p)
+	{
+		const XMFLOAT4& plane = Planes[p];
+
+		float distance = center.x * plane.x + center.y * plane.y + center.z * plane.z + plane.w;
+		float radius = extents.x * std::fabs(plane.x) + extents.y * std::fabs(plane.y) + extents.z * std::fabs(plane.z);
+
+		if (distance + radius < 0.0f)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+SceneCuller::SceneCuller()
+	: _dirty(false)
+{
+}
+
+UINT SceneCuller::Add(
+	_In_ const XMFLOAT3& center,
+	_In_ const XMFLOAT3& extents)
+{
+	UINT item;
+	if (!_freeItems.empty())
+	{
+		item = _freeItems.back();
+		_freeItems.pop_back();
+	}
+	else
+	{
+		item = static_cast<UINT>(_items.size());
+		_items.push_back(Item());
+	}
+
+	_items[item].Center = center;
+	_items[item].Extents = extents;
+	_items[item].Alive = true;
+
+	_dirty = true;
+	return item;
+}
+
+void SceneCuller::Move(
+	_In_ UINT item,
+	_In_ const XMFLOAT3& center,
+	_In_ const XMFLOAT3& extents)
+{
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(item < _items.size() && _items[item].Alive);
+
+	_items[item].Center = center;
+	_items[item].Extents = extents;
+	_dirty = true;
+}
+
+void SceneCuller::Remove(_In_ UINT item)
+{
+	MUKASHIDEBUG_CRITICALERROR_ONFALSE(item < _items.size() && _items[item].Alive);
+
+	_items[item].Alive = false;
+	_freeItems.push_back(item);
+	_dirty = true;
+}
+
+void SceneCuller::Cull(
+	_In_ const CullingFrustum& frustum,
+	_Out_ std::vector<UINT>& visible)
+{
+	visible.clear();
+
+	if (_dirty)
+	{
+		build();
+	}
+
+	if (_nodes.empty())
+	{
+		return;
+	}
+
+	_stack.clear();
+	_stack.push_back(std::make_pair(0U, false));
+
+	while (!_stack.empty())
+	{
+		UINT nodeIndex = _stack.back().first;
+		bool inside = _stack.back().second;
+		_stack.pop_back();
+
+		const Node& node = _nodes[nodeIndex];
+
+		// Everything under a node that is entirely inside is visible without testing
+		int outside = 0;
+		int intersecting = 0;
+		if (!inside)
+		{
+			testPacket(frustum, node.Bounds, outside, intersecting);
+		}
+
+		for (UINT lane = 0; lane < 4; ++lane)
+		{
+			if (node.Child[lane] == NoChild || (outside & (1 << lane)))
+			{
+				continue;
+			}
+
+			bool laneInside = !(intersecting & (1 << lane));
+
+			if (node.Count[lane] == 0)
+			{
+				_stack.push_back(std::make_pair(node.Child[lane], laneInside));
+				continue;
+			}
+
+			const UINT* items = &_leafItems[node.Child[lane] * LeafSize];
+
+			int itemsOutside = 0;
+			if (!laneInside)
+			{
+				int itemsIntersecting;
+				testPacket(frustum, _leaves[node.Child[lane]], itemsOutside, itemsIntersecting);
+			}
+
+			for (UINT i = 0; i < node.Count[lane]; ++i)
+			{
+				if (!(itemsOutside & (1 << i)))
+				{
+					visible.push_back(items[i]);
+				}
+			}
+		}
+	}
+}
+
+void SceneCuller::build()
+{
+	_order.clear();
+	for (UINT i = 0; i < _items.size(); ++i)
+	{
+		if (_items[i].Alive)
+		{
+			_order.push_back(i);
+		}
+	}
+
+	_nodes.clear();
+	_leaves.clear();
+	_leafItems.clear();
+	_dirty = false;
+
+	if (!_order.empty())
+	{
+		buildNode(0, static_cast<UINT>(_order.size()));
+	}
+}
+
+UINT SceneCuller::buildNode(
+	_In_ UINT begin,
+	_In_ UINT end)
+{
+	UINT nodeIndex = static_cast<UINT>(_nodes.size());
+	_nodes.push_back(Node());
+
+	//
+	// Split the items in two along the longest axis of their centres, then each half the same way, giving
+	// up to four groups. A range that already fits in a leaf becomes a single leaf
+	auto split = [this](UINT first, UINT last) -> UINT
+	{
+		XMFLOAT3 minimum(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 maximum(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (UINT i = first; i < last; ++i)
+		{
+			const XMFLOAT3& center = _items[_order[i]].Center;
+			minimum = XMFLOAT3(std::min(minimum.x, center.x), std::min(minimum.y, center.y), std::min(minimum.z, center.z));
+			maximum = XMFLOAT3(std::max(maximum.x, center.x), std::max(maximum.y, center.y), std::max(maximum.z, center.z));
+		}
+
+		UINT axis = 0;
+		for (UINT a = 1; a < 3; ++a)
+		{
+			if (component(maximum, a) - component(minimum, a) > component(maximum, axis) - component(minimum, axis))
+			{
+				axis = a;
+			}
+		}
+
+		UINT middle = first + (last - first) / 2;
+		std::nth_element(_order.begin() + first, _order.begin() + middle, _order.begin() + last, [this, axis](UINT a, UINT b)
+		{
+			return component(_items[a].Center, axis) < component(_items[b].Center, axis);
+		});
+		return middle;
+	};
+
+	UINT bounds[5] = { begin, begin, end, end, end };
+	if (end - begin > LeafSize)
+	{
+		bounds[2] = split(begin, end);
+		bounds[1] = (bounds[2] - begin > LeafSize) ? split(begin, bounds[2]) : bounds[2];
+		bounds[3] = (end - bounds[2] > LeafSize) ? split(bounds[2], end) : end;
+	}
+	else
+	{
+		bounds[1] = bounds[2] = bounds[3] = end;
+	}
+
+	for (UINT lane = 0; lane < 4; ++lane)
+	{
+		UINT first = bounds[lane];
+		UINT last = bounds[lane + 1];
+
+		UINT child = NoChild;
+		UINT count = 0;
+		XMFLOAT3 minimum(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 maximum(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+		if (first < last)
+		{
+			for (UINT i = first; i < last; ++i)
+			{
+				const Item& item = _items[_order[i]];
+				minimum = XMFLOAT3(
+					std::min(minimum.x, item.Center.x - item.Extents.x),
+					std::min(minimum.y, item.Center.y - item.Extents.y),
+					std::min(minimum.z, item.Center.z - item.Extents.z));
+				maximum = XMFLOAT3(
+					std::max(maximum.x, item.Center.x + item.Extents.x),
+					std::max(maximum.y, item.Center.y + item.Extents.y),
+					std::max(maximum.z, item.Center.z + item.Extents.z));
+			}
+
+			if (last - first <= LeafSize)
+			{
+				child = static_cast<UINT>(_leaves.size());
+				count = last - first;
+
+				BoxPacket leaf;
+				for (UINT i = 0; i < LeafSize; ++i)
+				{
+					bool used = i < count;
+					const Item& item = _items[_order[used ? first + i : first]];
+
+					leaf.CenterX[i] = item.Center.x;
+					leaf.CenterY[i] = item.Center.y;
+					leaf.CenterZ[i] = item.Center.z;
+					leaf.ExtentX[i] = used ? item.Extents.x : EmptyExtent;
+					leaf.ExtentY[i] = used ? item.Extents.y : EmptyExtent;
+					leaf.ExtentZ[i] = used ? item.Extents.z : EmptyExtent;
+
+					_leafItems.push_back(used ? _order[first + i] : NoChild);
+				}
+				_leaves.push_back(leaf);
+			}
+			else
+			{
+				child = buildNode(first, last);
+			}
+		}
+
+		// The recursion may have moved the node
+		Node& node = _nodes[nodeIndex];
+		node.Child[lane] = child;
+		node.Count[lane] = count;
+
+		bool used = child != NoChild;
+		node.Bounds.CenterX[lane] = used ? (minimum.x + maximum.x) * 0.5f : 0.0f;
+		node.Bounds.CenterY[lane] = used ? (minimum.y + maximum.y) * 0.5f : 0.0f;
+		node.Bounds.CenterZ[lane] = used ? (minimum.z + maximum.z) * 0.5f : 0.0f;
+		node.Bounds.ExtentX[lane] = used ? (maximum.x - minimum.x) * 0.5f : EmptyExtent;
+		node.Bounds.ExtentY[lane] = used ? (maximum.y - minimum.y) * 0.5f : EmptyExtent;
+		node.Bounds.ExtentZ[lane] = used ? (maximum.z - minimum.z) * 0.5f : EmptyExtent;
+	}
+
+	return nodeIndex;
+}
@@ -0,0 +1,148 @@
+//////////////////////////////////////////////////////////////////////////
+// SceneCuller.h
+// Finds the model instances inside the view frustum without testing
+// every one of them. Instance bounds are kept in a four wide bounding
+// volume hierarchy whose nodes store their children's boxes as
+// structure-of-arrays, so one SSE pass tests four boxes against a
+// frustum plane. Subtrees entirely inside the frustum are accepted
+// without further tests. The tree is rebuilt on the next Cull after
+// instances are added, moved or removed, which suits the mostly static
+// contents of a loaded zone. Has no dependency on the graphics device so
+// it can be run and profiled headless.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+namespace Engine
+{
+	struct CullingFrustum
+	{
+		//
+		// FullName:  Engine::CullingFrustum::FromViewProjection
+		// Extracts the frustum planes from a (row vector) view projection matrix with a [0, 1] depth range
+		//
+		static CullingFrustum FromViewProjection(_In_ const DirectX::XMFLOAT4X4& viewProjection);
+
+		//
+		// Returns bool indicating if the box is at least partly inside the frustum. Boxes near the frustum's
+		// corners can be reported inside when they aren't, never the other way around
+		//
+		bool Intersects(
+			_In_ const DirectX::XMFLOAT3& center,
+			_In_ const DirectX::XMFLOAT3& extents) const;
+
+		// (a, b, c, d) with points p inside when a * p.x + b * p.y + c * p.z + d >= 0
+		DirectX::XMFLOAT4 Planes[6];
+	};
+
+	class SceneCuller
+	{
+	public:
+
+		SceneCuller();
+
+		//
+		// Adds an instance's world space bounds and returns the id Cull reports it with
+		//
+		UINT Add(
+			_In_ const DirectX::XMFLOAT3& center,
+			_In_ const DirectX::XMFLOAT3& extents);
+
+		void Move(
+			_In_ UINT item,
+			_In_ const DirectX::XMFLOAT3& center,
+			_In_ const DirectX::XMFLOAT3& extents);
+
+		//
+		// Removes an instance. Its id may be handed out again by a later Add
+		//
+		void Remove(_In_ UINT item);
+
+		//
+		// FullName:  Engine::SceneCuller::Cull
+		// Fills visible with the ids of the instances whose bounds intersect the frustum, in no particular
+		// order. Rebuilds the tree first if anything changed since the last call
+		//
+		void Cull(
+			_In_ const CullingFrustum& frustum,
+			_Out_ std::vector<UINT>& visible);
+
+		UINT GetItemCount() const
+		{
+			return static_cast<UINT>(_items.size() - _freeItems.size());
+		}
+
+	private:
+
+		// Make class not copyable
+		SceneCuller(const SceneCuller&);
+		SceneCuller& operator=(const SceneCuller&);
+
+		struct Item
+		{
+			DirectX::XMFLOAT3 Center;
+			DirectX::XMFLOAT3 Extents;
+			bool Alive;
+		};
+
+		//
+		// Four boxes in structure-of-arrays form. Unused lanes have negative extents, which no frustum
+		// test accepts
+		//
+		struct BoxPacket
+		{
+			float CenterX[4];
+			float CenterY[4];
+			float CenterZ[4];
+			float ExtentX[4];
+			float ExtentY[4];
+			float ExtentZ[4];
+		};
+
+		//
+		// A node of the tree. Each lane is empty, another node (Count 0) or a leaf of Count items whose
+		// bounds are the packet _leaves[Child]
+		//
+		struct Node
+		{
+			BoxPacket Bounds;
+			UINT Child[4];
+			UINT Count[4];
+		};
+
+		void build();
+
+		//
+		// Builds the node for items [begin, end) of _order and returns its index
+		//
+		UINT buildNode(
+			_In_ UINT begin,
+			_In_ UINT end);
+
+	private:
+
+		std::vector<Item> _items;
+
+		// Ids of removed items, reused by Add
+		std::vector<UINT> _freeItems;
+
+		// Set when items changed since the tree was built
+		bool _dirty;
+
+		// Ids of the live items, reordered into leaf order by the build
+		std::vector<UINT> _order;
+
+		std::vector<Node> _nodes;
+
+		// The bounds of the items of each leaf, and the items themselves four per leaf
+		std::vector<BoxPacket> _leaves;
+		std::vector<UINT> _leafItems;
+
+		// Nodes still to visit during Cull, and if they're entirely inside the frustum
+		std::vector<std::pair<UINT, bool>> _stack;
+	};
+}
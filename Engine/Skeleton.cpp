@@ -0,0 +1,63 @@
+//////////////////////////////////////////////////////////////////////////
+// Skeleton.cpp
+// The node hierarchy of a model flattened for linear pose evaluation.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "Skeleton.h"
+#include "CredibleModelData.h"
+
+using namespace DirectX;
+using namespace Engine;
+
+namespace
+{
+	// The channel of nodes that aren't animated
+	const UINT NoChannel = 0xFFFFFFFF;
+}
+
+void Skeleton::Build(_In_ const std::vector<std::unique_ptr<CredibleNode>>& nodes)
+{
+	_parents.resize(nodes.size());
+	_channels.resize(nodes.size());
+	_animated.resize(nodes.size());
+	_bindLocalTransforms.resize(nodes.size());
+
+	for (UINT i = 0; i < nodes.size(); ++i)
+	{
+		const CredibleNode* node = nodes[i].get();
+		MUKASHIDEBUG_CRITICALERROR_ONFALSE(node->Index == i);
+
+		_parents[i] = node->Parent ? node->Parent->Index : NoParent;
+		MUKASHIDEBUG_CRITICALERROR_ONFALSE(_parents[i] == NoParent || _parents[i] < i);
+
+		_channels[i] = (node->ChannelIndex == (size_t)-1) ? NoChannel : static_cast<UINT>(node->ChannelIndex);
+		_animated[i] = (_channels[i] != NoChannel) || (_parents[i] != NoParent && _animated[_parents[i]]);
+		_bindLocalTransforms[i] = node->LocalTransform;
+	}
+}
+
+void Skeleton::Evaluate(
+	_In_ const std::vector<XMFLOAT4X4>& channelTransforms,
+	_Out_ std::vector<XMFLOAT4X4>& globalTransforms) const
+{
+	globalTransforms.resize(_parents.size());
+
+	for (size_t i = 0; i < _parents.size(); ++i)
+	{
+		UINT channel = _channels[i];
+		const XMFLOAT4X4& local = (channel < channelTransforms.size()) ? channelTransforms[channel] : _bindLocalTransforms[i];
+
+		// Parents come first, so the parent's global transform is always done by now
+		if (_parents[i] == NoParent)
+		{
+			globalTransforms[i] = local;
+		}
+		else
+		{
+			XMMATRIX parentGlobal = XMLoadFloat4x4(&globalTransforms[_parents[i]]);
+			XMStoreFloat4x4(&globalTransforms[i], XMMatrixMultiply(parentGlobal, XMLoadFloat4x4(&local)));
+		}
+	}
+}
@@ -0,0 +1,79 @@
+//////////////////////////////////////////////////////////////////////////
+// Skeleton.h
+// The node hierarchy of a model flattened into arrays in parents first
+// order, so a pose is evaluated in one linear pass over contiguous
+// matrices (global = parent global * local) instead of by walking the
+// parent chain of every node.
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+
+namespace Engine
+{
+	struct CredibleNode;
+
+	class Skeleton
+	{
+	public:
+
+		// The parent of the root node
+		static const UINT NoParent = 0xFFFFFFFF;
+
+		//
+		// FullName:  Engine::Skeleton::Build
+		// Flattens the given nodes, which must be listed parents first with every node's Index set to its
+		// position in the list
+		//
+		void Build(_In_ const std::vector<std::unique_ptr<CredibleNode>>& nodes);
+
+		UINT GetNodeCount() const
+		{
+			return static_cast<UINT>(_parents.size());
+		}
+
+		//
+		// Returns the index of the given node's parent, or NoParent for the root
+		//
+		UINT GetParent(_In_ UINT node) const
+		{
+			return _parents[node];
+		}
+
+		//
+		// Returns bool indicating if the node or any of its ancestors is driven by an animation channel, i.e.
+		// if its global transform can change from one pose to another
+		//
+		bool IsAnimated(_In_ UINT node) const
+		{
+			return _animated[node];
+		}
+
+		//
+		// FullName:  Engine::Skeleton::Evaluate
+		// Computes the global transform of every node. Nodes driven by an animation channel take their local
+		// transform from channelTransforms, the rest keep the local transform they were loaded with
+		//
+		void Evaluate(
+			_In_ const std::vector<DirectX::XMFLOAT4X4>& channelTransforms,
+			_Out_ std::vector<DirectX::XMFLOAT4X4>& globalTransforms) const;
+
+	private:
+
+		// The parent of every node, always lower than the node's own index
+		std::vector<UINT> _parents;
+
+		// The animation channel of every node, or NoChannel
+		std::vector<UINT> _channels;
+
+		// Whether every node's global transform depends on an animation channel
+		std::vector<bool> _animated;
+
+		// The local transform every node was loaded with
+		std::vector<DirectX::XMFLOAT4X4> _bindLocalTransforms;
+	};
+}
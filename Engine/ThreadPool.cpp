@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////
+// ThreadPool.cpp
+// A fixed set of worker threads that run queued jobs in the order they
+// were queued. Used for background work such as asset loading
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "ThreadPool.h"
+
+using namespace Engine;
+
+ThreadPool::ThreadPool(_In_ UINT workerCount)
+	: _stopping(false)
+{
+	workerCount = std::max(workerCount, 1U);
+
+	_workers.reserve(workerCount);
+	for (UINT i = 0; i < workerCount; ++i)
+	{
+		_workers.push_back(std::thread(&ThreadPool::workerMain, this));
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stopping = true;
+	}
+	_wake.notify_all();
+
+	for (auto& worker : _workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::Enqueue(_In_ std::function<void(void)> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_jobs.push(std::move(job));
+	}
+	_wake.notify_one();
+}
+
+void ThreadPool::workerMain()
+{
+	for (;;)
+	{
+		std::function<void(void)> job;
+
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_wake.wait(lock, [this]() { return _stopping || !_jobs.empty(); });
+
+			if (_stopping)
+			{
+				return;
+			}
+
+			job = std::move(_jobs.front());
+			_jobs.pop();
+		}
+
+		job();
+	}
+}
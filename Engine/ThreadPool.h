@@ -0,0 +1,66 @@
+//////////////////////////////////////////////////////////////////////////
+// ThreadPool.h
+// A fixed set of worker threads that run queued jobs in the order they
+// were queued. Used for background work such as asset loading
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace Engine
+{
+	class ThreadPool
+	{
+	public:
+
+		//
+		// Starts the given number of workers (at least one)
+		//
+		ThreadPool(_In_ UINT workerCount);
+
+		//
+		// Waits for the jobs that are running to finish. Jobs that haven't started yet are dropped
+		//
+		~ThreadPool();
+
+		//
+		// Queues a job to be run on one of the workers
+		//
+		void Enqueue(_In_ std::function<void(void)> job);
+
+		UINT GetWorkerCount() const
+		{
+			return static_cast<UINT>(_workers.size());
+		}
+
+	private:
+
+		// Make class not copyable
+		ThreadPool(const ThreadPool&);
+		ThreadPool& operator=(const ThreadPool&);
+
+		void workerMain();
+
+	private:
+
+		std::vector<std::thread> _workers;
+
+		// Jobs waiting for a worker
+		std::queue<std::function<void(void)>> _jobs;
+
+		// Guards _jobs and _stopping
+		std::mutex _mutex;
+
+		// Signaled when a job is queued or the pool is stopping
+		std::condition_variable _wake;
+
+		bool _stopping;
+	};
+}
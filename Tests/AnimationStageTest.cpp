@@ -0,0 +1,200 @@
+//////////////////////////////////////////////////////////////////////////
+// AnimationStageTest.cpp
+// Runs a crowd of instances of two models playing two clips through
+// AnimationStage and checks that each model, clip and sample is posed
+// once however many instances ask for it, that every instance gets the
+// pose of its own group, and that poses still cached from an earlier
+// frame aren't evaluated again
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestCheck.h"
+#include "../Engine/AnimationStage.h"
+#include <cmath>
+
+using namespace DirectX;
+using namespace Engine;
+using TestCheck::Check;
+
+namespace
+{
+	const float SamplesPerSecond = 10.0f;
+
+	//
+	// A model whose pose is just the sampled channels, followed by the model's tag
+	//
+	class FakeModel : public PoseEvaluator
+	{
+	public:
+
+		explicit FakeModel(_In_ float tag)
+			: Tag(tag), Evaluations(0)
+		{}
+
+		void EvaluatePose(
+			_In_ const std::vector<XMFLOAT4X4>& transforms,
+			_Out_ CredibleModelPose& pose) const override
+		{
+			++Evaluations;
+			pose.GlobalTransforms = transforms;
+
+			XMFLOAT4X4 tag = {};
+			tag.m[0][0] = Tag;
+			pose.BonePalettes.assign(1, tag);
+		}
+
+		float Tag;
+		mutable std::atomic<int> Evaluations;
+	};
+
+	// Samples one channel holding the time and the clip
+	AnimationRequest::Sampler makeSampler(_In_ UINT clip)
+	{
+		return [clip](float time, std::vector<XMFLOAT4X4>& channelTransforms)
+		{
+			XMFLOAT4X4 channel = {};
+			channel.m[0][0] = time;
+			channel.m[0][1] = static_cast<float>(clip);
+			channelTransforms.assign(1, channel);
+		};
+	}
+
+	struct Instance
+	{
+		const FakeModel* Model;
+		UINT Clip;
+		float Time;
+	};
+
+	// Five instances of every model and clip in each of the given samples, at different times within them
+	std::vector<Instance> makeCrowd(
+		_In_ const FakeModel& first,
+		_In_ const FakeModel& second,
+		_In_ const std::vector<int>& samples)
+	{
+		std::vector<Instance> crowd;
+		for (int sample : samples)
+		{
+			for (UINT k = 0; k < 5; ++k)
+			{
+				for (const FakeModel* model : { &first, &second })
+				{
+					for (UINT clip = 0; clip < 2; ++clip)
+					{
+						Instance instance;
+						instance.Model = model;
+						instance.Clip = clip;
+						instance.Time = (sample + 0.1f + 0.15f * k) / SamplesPerSecond;
+						crowd.push_back(instance);
+					}
+				}
+			}
+		}
+		return crowd;
+	}
+
+	// Queues the crowd, runs the stage and returns the pose every instance got
+	std::vector<const CredibleModelPose*> pose(
+		_Inout_ AnimationStage& stage,
+		_In_ const std::vector<Instance>& crowd)
+	{
+		std::vector<UINT> indices;
+		for (const Instance& instance : crowd)
+		{
+			AnimationRequest request;
+			request.Model = instance.Model;
+			request.ClipIndex = instance.Clip;
+			request.Sample = makeSampler(instance.Clip);
+			request.Time = instance.Time;
+			indices.push_back(stage.Add(request));
+		}
+		Check(stage.GetRequestCount() == crowd.size(), "requests queued");
+
+		stage.Run();
+		Check(stage.GetRequestCount() == 0, "queue empty after the run");
+
+		std::vector<const CredibleModelPose*> poses;
+		for (UINT index : indices)
+		{
+			poses.push_back(&stage.GetPose(index));
+		}
+		return poses;
+	}
+
+	bool isPoseOf(
+		_In_ const CredibleModelPose& pose,
+		_In_ const Instance& instance)
+	{
+		float sampleTime = static_cast<int64_t>(std::floor(instance.Time * SamplesPerSecond)) / SamplesPerSecond;
+		return pose.GlobalTransforms.size() == 1 && pose.BonePalettes.size() == 1 &&
+			pose.GlobalTransforms[0].m[0][0] == sampleTime &&
+			pose.GlobalTransforms[0].m[0][1] == instance.Clip &&
+			pose.BonePalettes[0].m[0][0] == instance.Model->Tag;
+	}
+
+	void checkGrouping(_In_ UINT workerCount)
+	{
+		JobSystem jobs(workerCount);
+		PoseCache cache(SamplesPerSecond);
+		AnimationStage stage(jobs, cache);
+		FakeModel first(1.0f);
+		FakeModel second(2.0f);
+
+		// 2 models * 2 clips * 3 samples
+		std::vector<Instance> crowd = makeCrowd(first, second, { 3, 4, -2 });
+		std::vector<const CredibleModelPose*> poses = pose(stage, crowd);
+
+		Check(first.Evaluations + second.Evaluations == 12, "every model, clip and sample posed once");
+		Check(cache.GetStats().Misses == 12 && cache.GetStats().Hits == crowd.size() - 12, "the rest of the crowd shares the poses");
+
+		bool right = true;
+		bool sharedWithinGroups = true;
+		bool distinctAcrossGroups = true;
+		for (size_t i = 0; i < crowd.size(); ++i)
+		{
+			right = right && isPoseOf(*poses[i], crowd[i]);
+
+			for (size_t j = 0; j < i; ++j)
+			{
+				bool sameGroup = crowd[i].Model == crowd[j].Model && crowd[i].Clip == crowd[j].Clip &&
+					std::floor(crowd[i].Time * SamplesPerSecond) == std::floor(crowd[j].Time * SamplesPerSecond);
+				if (sameGroup)
+				{
+					sharedWithinGroups = sharedWithinGroups && poses[i] == poses[j];
+				}
+				else
+				{
+					distinctAcrossGroups = distinctAcrossGroups && poses[i] != poses[j];
+				}
+			}
+		}
+		Check(right, "every instance gets the pose of its model and clip at the start of its sample");
+		Check(sharedWithinGroups, "instances in the same group share one pose");
+		Check(distinctAcrossGroups, "instances in different groups don't");
+
+		// The next frame the crowd has moved on to samples 4 and 5; only 5 is new
+		cache.EndFrame();
+		crowd = makeCrowd(first, second, { 4, 5 });
+		poses = pose(stage, crowd);
+		Check(first.Evaluations + second.Evaluations == 16, "poses cached from the last frame not evaluated again");
+
+		right = true;
+		for (size_t i = 0; i < crowd.size(); ++i)
+		{
+			right = right && isPoseOf(*poses[i], crowd[i]);
+		}
+		Check(right, "cached poses handed out to the right instances");
+
+		stage.Run();
+		Check(first.Evaluations + second.Evaluations == 16, "running without requests does nothing");
+	}
+}
+
+int main()
+{
+	checkGrouping(0);
+	checkGrouping(3);
+
+	return TestCheck::Report("AnimationStageTest");
+}
@@ -0,0 +1,202 @@
+//////////////////////////////////////////////////////////////////////////
+// AssetMetadataTest.cpp
+// Compiles model metadata into the binary table and reads it back,
+// directly and through Load, and checks that tables that are truncated,
+// were compiled from other XML or for other enumerations, or that point
+// outside the enumerations or the strings are rejected
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestCheck.h"
+#include "../Engine/AssetMetadata.h"
+
+using namespace Engine;
+using TestCheck::Check;
+
+namespace
+{
+	// The layout the table's header and texture records are written in
+	const size_t HeaderSize = 32;
+	const size_t InstanceTypeCountOffset = 16;
+	const size_t RecordSize = 16;
+	const size_t RecordsOffset = HeaderSize + INSTANCE_TYPE_END * sizeof(uint32_t);
+
+	AssetMetadata makeMetadata()
+	{
+		AssetMetadata metadata;
+		metadata.InstanceToModelInstance = { TREE, TREE, HUMAN, HUMAN };
+		metadata.DefaultTextures.assign(INSTANCE_TYPE_END, AssetMetadata::DefaultTextureSet());
+		metadata.DefaultTextures[TREE][HEAD] = L"bark.dds";
+		metadata.DefaultTextures[HUMAN][CHEST] = L"tunic.dds";
+		metadata.DefaultTextures[HUMAN][MAIN_HAND] = L"\x00e9p\x00e9" L"e.dds";
+		return metadata;
+	}
+
+	bool equal(
+		_In_ const AssetMetadata& left,
+		_In_ const AssetMetadata& right)
+	{
+		return left.InstanceToModelInstance == right.InstanceToModelInstance && left.DefaultTextures == right.DefaultTextures;
+	}
+
+	void patch(
+		_Inout_ std::vector<byte>& table,
+		_In_ size_t offset,
+		_In_ uint32_t value)
+	{
+		memcpy(table.data() + offset, &value, sizeof(value));
+	}
+
+	bool read(
+		_In_ const std::vector<byte>& table,
+		_In_ uint64_t sourceHash)
+	{
+		AssetMetadata metadata;
+		return AssetMetadataTable::Read(table.data(), table.size(), sourceHash, metadata);
+	}
+
+	void checkRoundTrip()
+	{
+		AssetMetadata metadata = makeMetadata();
+		std::vector<byte> table;
+		AssetMetadataTable::Compile(metadata, 42, table);
+		Check(table.size() == RecordsOffset + 3 * RecordSize + (8 + 9 + 8) * sizeof(uint16_t), "only slots with a texture are stored");
+
+		AssetMetadata readBack;
+		Check(AssetMetadataTable::Read(table.data(), table.size(), 42, readBack) && equal(metadata, readBack), "table reads back what was compiled");
+		Check(AssetMetadataTable::Read(table.data(), table.size(), 0, readBack) && equal(metadata, readBack), "hash 0 skips the source check");
+
+		AssetMetadata empty;
+		empty.InstanceToModelInstance = { TREE, ROCK, HUMAN, WOLF };
+		empty.DefaultTextures.assign(INSTANCE_TYPE_END, AssetMetadata::DefaultTextureSet());
+		AssetMetadataTable::Compile(empty, 42, table);
+		Check(AssetMetadataTable::Read(table.data(), table.size(), 42, readBack) && equal(empty, readBack), "table without textures reads back");
+	}
+
+	void checkRejected()
+	{
+		std::vector<byte> table;
+		AssetMetadataTable::Compile(makeMetadata(), 42, table);
+
+		Check(!read(table, 43), "table compiled from other XML rejected");
+
+		bool truncated = false;
+		for (size_t size = 0; size < table.size(); ++size)
+		{
+			AssetMetadata metadata;
+			truncated = truncated || AssetMetadataTable::Read(table.data(), size, 42, metadata);
+		}
+		Check(!truncated, "every truncation of the table rejected");
+
+		std::vector<byte> longer = table;
+		longer.push_back(0);
+		Check(!read(longer, 42), "trailing bytes rejected");
+
+		std::vector<byte> bad = table;
+		bad[0] ^= 1;
+		Check(!read(bad, 42), "wrong magic rejected");
+
+		bad = table;
+		patch(bad, InstanceTypeCountOffset, INSTANCE_TYPE_END + 1);
+		Check(!read(bad, 42), "table for other InstanceTypes rejected");
+
+		bad = table;
+		patch(bad, InstanceTypeCountOffset + 4, ITEM_SLOT_END - 1);
+		Check(!read(bad, 42), "table for other item slots rejected");
+
+		bad = table;
+		patch(bad, HeaderSize + ROCK * sizeof(uint32_t), INSTANCE_TYPE_END);
+		Check(!read(bad, 42), "mapping to an InstanceType out of range rejected");
+
+		// The second record, HUMAN's chest texture, with each of its fields pushed out of range
+		const size_t record = RecordsOffset + RecordSize;
+		bad = table;
+		patch(bad, record, INSTANCE_TYPE_END);
+		Check(!read(bad, 42), "texture of a model out of range rejected");
+
+		bad = table;
+		patch(bad, record + 4, ITEM_SLOT_END);
+		Check(!read(bad, 42), "texture of a slot out of range rejected");
+
+		bad = table;
+		patch(bad, record + 8, 26);
+		Check(!read(bad, 42), "name starting past the strings rejected");
+
+		bad = table;
+		patch(bad, record + 8, 20);
+		Check(!read(bad, 42), "name running past the strings rejected");
+
+		bad = table;
+		patch(bad, record + 8, 0xFFFFFFFF);
+		patch(bad, record + 12, 2);
+		Check(!read(bad, 42), "name offset wrapping around rejected");
+
+		// Pointing at another name in range is fine
+		bad = table;
+		patch(bad, record + 8, 0);
+		patch(bad, record + 12, 4);
+		AssetMetadata metadata;
+		Check(AssetMetadataTable::Read(bad.data(), bad.size(), 42, metadata) && metadata.DefaultTextures[HUMAN][CHEST] == L"bark", "name anywhere in the strings accepted");
+	}
+
+	bool writeFile(
+		_In_ const char* path,
+		_In_ const void* data,
+		_In_ size_t size)
+	{
+		FILE* file = fopen(path, "wb");
+		if (file == nullptr)
+		{
+			return false;
+		}
+		bool written = fwrite(data, 1, size, file) == size;
+		return fclose(file) == 0 && written;
+	}
+
+	void checkLoad()
+	{
+		AssetMetadata metadata = makeMetadata();
+		std::vector<byte> table;
+
+		// Without the XML the table is used as it is
+		AssetMetadataTable::Compile(metadata, 42, table);
+		Check(writeFile("obj/AssetMetaData.ksmd", table.data(), table.size()), "table written");
+		Check(AssetMetadataTable::HashSources(L"obj/") == 0, "no XML, no hash");
+
+		AssetMetadata loaded;
+		Check(AssetMetadataTable::Load(L"obj/", loaded) && equal(metadata, loaded), "table loaded without the XML");
+
+		// With the XML the table must have been compiled from it
+		const char models[] = "<models/>";
+		const char mappings[] = "<instances/>";
+		Check(writeFile("obj/ModelMetaData.xml", models, sizeof(models) - 1) &&
+			writeFile("obj/InstanceToModelMapping.xml", mappings, sizeof(mappings) - 1), "XML written");
+
+		uint64_t sourceHash = AssetMetadataTable::HashSources(L"obj/");
+		Check(sourceHash != 0 && sourceHash != 42, "XML hashed");
+
+		AssetMetadataTable::Compile(metadata, sourceHash, table);
+		Check(writeFile("obj/AssetMetaData.ksmd", table.data(), table.size()), "table written");
+		loaded = AssetMetadata();
+		Check(AssetMetadataTable::Load(L"obj/", loaded) && equal(metadata, loaded), "table compiled from the XML loaded");
+
+		// Moving a byte from one file to the other changes the hash
+		Check(writeFile("obj/ModelMetaData.xml", models, sizeof(models) - 2) &&
+			writeFile("obj/InstanceToModelMapping.xml", ">" "<instances/>", sizeof(mappings)), "XML changed");
+		Check(AssetMetadataTable::HashSources(L"obj/") != sourceHash, "changed XML hashes differently");
+
+		remove("obj/AssetMetaData.ksmd");
+		remove("obj/ModelMetaData.xml");
+		remove("obj/InstanceToModelMapping.xml");
+	}
+}
+
+int main()
+{
+	checkRoundTrip();
+	checkRejected();
+	checkLoad();
+
+	return TestCheck::Report("AssetMetadataTest");
+}
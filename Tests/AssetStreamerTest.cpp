@@ -0,0 +1,307 @@
+//////////////////////////////////////////////////////////////////////////
+// AssetStreamerTest.cpp
+// Streams generated KSM models through AssetStreamer the way the asset
+// manager does (map, prefetch and parse on the loader pool), with a null
+// upload step standing in for creating the device resources. Checks that
+// requests for the same asset share a load, that uploads run on the
+// calling thread a bounded number at a time, and that a failed load can
+// be requested again. Also streams reference counted ResidencyCache
+// handles, as the asset manager does, and checks that they are only
+// released on the calling thread. Also built with ThreadSanitizer by
+// "make tsan"
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestModels.h"
+#include "TestCheck.h"
+#include "../Engine/AssetStreamer.h"
+#include "../Engine/KsmWriter.h"
+#include "../Engine/MappedFile.h"
+#include "../Engine/ResidencyCache.h"
+#include <atomic>
+#include <chrono>
+
+using namespace Engine;
+using TestCheck::Check;
+
+namespace
+{
+	std::wstring modelPath(_In_ int m)
+	{
+		return L"obj/AssetStreamerTest" + std::to_wstring(m) + L".ksm";
+	}
+
+	bool writeModels(_In_ int modelCount)
+	{
+		for (int m = 0; m < modelCount; ++m)
+		{
+			TestModels::Model model;
+			for (int mesh = 0; mesh <= m % 4; ++mesh)
+			{
+				model.Meshes.push_back(TestModels::MakeGrid(64));
+			}
+			TestModels::BuildView(model);
+
+			std::vector<byte> file;
+			KsmWriter::Write(model.View, file);
+
+			std::wstring path = modelPath(m);
+			FILE* out = fopen(std::string(path.begin(), path.end()).c_str(), "wb");
+			if (out == nullptr)
+			{
+				return false;
+			}
+			fwrite(file.data(), 1, file.size(), out);
+			fclose(out);
+		}
+		return true;
+	}
+
+	// The load step of the asset manager's model requests, returning the number of meshes read
+	int loadModel(_In_ const std::wstring& path)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+		{
+			return 0;
+		}
+		file.Prefetch();
+
+		KsmModelView ksm;
+		if (!KsmReader::Read(file.GetData(), file.GetSize(), TestModels::Strides, ksm))
+		{
+			return 0;
+		}
+		return static_cast<int>(ksm.Meshes.size());
+	}
+
+	struct Counters
+	{
+		std::atomic<int> Loads;
+		std::atomic<int> LoadsOnCaller;
+		int Uploads;
+		int UploadsOffCaller;
+	};
+
+	std::shared_future<int> request(
+		_In_ AssetStreamer<int>& streamer,
+		_In_ const std::wstring& path,
+		_Inout_ Counters& counters,
+		_In_ std::thread::id caller)
+	{
+		return streamer.Request(path, [path, &counters, caller]() -> AssetStreamer<int>::UploadStep
+		{
+			++counters.Loads;
+			if (std::this_thread::get_id() == caller)
+			{
+				++counters.LoadsOnCaller;
+			}
+
+			int meshes = loadModel(path);
+			if (meshes == 0)
+			{
+				return nullptr;
+			}
+
+			return [meshes, &counters, caller]() -> int
+			{
+				++counters.Uploads;
+				if (std::this_thread::get_id() != caller)
+				{
+					++counters.UploadsOffCaller;
+				}
+				return meshes;
+			};
+		});
+	}
+
+	void checkStreaming(_In_ int modelCount)
+	{
+		ThreadPool pool(3);
+		AssetStreamer<int> streamer(pool);
+		Counters counters = {};
+		std::thread::id caller = std::this_thread::get_id();
+
+		std::vector<std::shared_future<int>> futures;
+		for (int m = 0; m < modelCount; ++m)
+		{
+			futures.push_back(request(streamer, modelPath(m), counters, caller));
+		}
+
+		// Asking again while the loads are in flight joins the earlier requests
+		std::vector<std::shared_future<int>> repeats;
+		for (int m = 0; m < modelCount; ++m)
+		{
+			repeats.push_back(request(streamer, modelPath(m), counters, caller));
+		}
+
+		const UINT MaxUploads = 4;
+		bool bounded = true;
+		while (streamer.GetPendingCount() > 0)
+		{
+			bounded = bounded && streamer.ProcessUploads(MaxUploads) <= MaxUploads;
+			std::this_thread::yield();
+		}
+
+		bool values = true;
+		for (int m = 0; m < modelCount; ++m)
+		{
+			values = values && futures[m].get() == m % 4 + 1 && repeats[m].get() == futures[m].get();
+		}
+
+		Check(values, "every request completes with its model");
+		Check(bounded, "no more uploads per call than asked for");
+		Check(counters.Loads == modelCount, "each model loaded once despite repeated requests");
+		Check(counters.LoadsOnCaller == 0, "loads run on the loader pool");
+		Check(counters.Uploads == modelCount && counters.UploadsOffCaller == 0, "uploads run on the calling thread");
+	}
+
+	void checkFailedLoad()
+	{
+		ThreadPool pool(1);
+		AssetStreamer<int> streamer(pool);
+		Counters counters = {};
+		std::thread::id caller = std::this_thread::get_id();
+
+		std::shared_future<int> missing = request(streamer, L"obj/NoSuchModel.ksm", counters, caller);
+		while (streamer.GetPendingCount() > 0)
+		{
+			streamer.ProcessUploads(1);
+		}
+		Check(missing.get() == 0, "missing file completes with an empty result");
+		Check(counters.Uploads == 0, "failed load has no upload");
+
+		// The failed request is forgotten, so asking again loads again
+		std::shared_future<int> retried = request(streamer, L"obj/NoSuchModel.ksm", counters, caller);
+		while (streamer.GetPendingCount() > 0)
+		{
+			streamer.ProcessUploads(1);
+		}
+		Check(retried.get() == 0 && counters.Loads == 2, "failed asset can be requested again");
+	}
+
+	//
+	// An asset held by the test's residency cache, counting destructions on threads other than its owner's
+	//
+	struct TrackedAsset
+	{
+		TrackedAsset(
+			_In_ std::thread::id owner,
+			_Inout_ std::atomic<int>& destroyedElsewhere)
+			: Owner(owner), DestroyedElsewhere(destroyedElsewhere)
+		{}
+
+		~TrackedAsset()
+		{
+			if (std::this_thread::get_id() != Owner)
+			{
+				++DestroyedElsewhere;
+			}
+		}
+
+		std::thread::id Owner;
+		std::atomic<int>& DestroyedElsewhere;
+	};
+
+	typedef ResidencyCache<std::wstring, std::unique_ptr<TrackedAsset>> TrackedCache;
+
+	// Requests complete with handles into a cache too small to keep anything unreferenced, so every handle
+	// released evicts its asset. The handles' counts aren't atomic and the cache is only for the calling
+	// thread, so the streamer must never release one on a worker
+	void checkHandleStreaming(_In_ int modelCount)
+	{
+		ThreadPool pool(3);
+		TrackedCache cache(0);
+		AssetStreamer<TrackedCache::Handle> streamer(pool);
+		std::atomic<int> destroyedElsewhere(0);
+		std::thread::id caller = std::this_thread::get_id();
+
+		const int Rounds = 500;
+		bool values = true;
+		for (int round = 0; round < Rounds; ++round)
+		{
+			std::wstring path = modelPath(round % modelCount);
+			std::shared_future<TrackedCache::Handle> future = streamer.Request(path,
+				[path, &cache, &destroyedElsewhere, caller]() -> AssetStreamer<TrackedCache::Handle>::UploadStep
+			{
+				int meshes = loadModel(path);
+				return [path, meshes, &cache, &destroyedElsewhere, caller]() -> TrackedCache::Handle
+				{
+					std::unique_ptr<TrackedAsset> asset(new TrackedAsset(caller, destroyedElsewhere));
+					return cache.Insert(path, std::move(asset), meshes);
+				};
+			});
+
+			while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				streamer.ProcessUploads(1);
+			}
+			values = values && future.get().IsValid();
+
+			// Dropping the last handle here evicts the asset, unless a worker still holds the request
+			future = std::shared_future<TrackedCache::Handle>();
+			values = values && !cache.Find(path, false).IsValid();
+		}
+
+		Check(values, "every request completes with a handle that is evicted once dropped");
+		Check(cache.GetStats().Evictions == static_cast<ULONG64>(Rounds), "every streamed asset evicted");
+		Check(destroyedElsewhere == 0, "handles only released on the calling thread");
+	}
+
+	// Loading every model on the calling thread against streaming them through a pool of the given size
+	void timeStreaming(
+		_In_ int modelCount,
+		_In_ UINT workers)
+	{
+		auto start = std::chrono::steady_clock::now();
+		int meshes = 0;
+		for (int m = 0; m < modelCount; ++m)
+		{
+			meshes += loadModel(modelPath(m));
+		}
+		double onCaller = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		start = std::chrono::steady_clock::now();
+		{
+			ThreadPool pool(workers);
+			AssetStreamer<int> streamer(pool);
+			Counters counters = {};
+			for (int m = 0; m < modelCount; ++m)
+			{
+				request(streamer, modelPath(m), counters, std::this_thread::get_id());
+			}
+			while (streamer.GetPendingCount() > 0)
+			{
+				streamer.ProcessUploads(4);
+				std::this_thread::yield();
+			}
+		}
+		double streamed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		printf("%d models (%d meshes): %.1f ms loaded on the caller, %.1f ms streamed on %u workers\n", modelCount, meshes, onCaller, streamed, workers);
+	}
+}
+
+int main()
+{
+	const int ModelCount = 32;
+	if (!writeModels(ModelCount))
+	{
+		printf("AssetStreamerTest: can't write the test models\n");
+		return 1;
+	}
+
+	checkStreaming(ModelCount);
+	checkFailedLoad();
+	checkHandleStreaming(ModelCount);
+	timeStreaming(ModelCount, std::max(2u, std::thread::hardware_concurrency()) - 1);
+
+	for (int m = 0; m < ModelCount; ++m)
+	{
+		std::wstring path = modelPath(m);
+		remove(std::string(path.begin(), path.end()).c_str());
+	}
+
+	return TestCheck::Report("AssetStreamerTest");
+}
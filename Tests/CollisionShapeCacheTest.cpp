@@ -0,0 +1,179 @@
+//////////////////////////////////////////////////////////////////////////
+// CollisionShapeCacheTest.cpp
+// Checks CollisionShapeCache against the headless Bullet stand-ins: that
+// the same scale of a model shares one shape and every scale shares the
+// model's one BVH and hull, that each model's geometry is collected once,
+// and that Release, Clear and destroying a model drop its shapes so a new
+// model at the same address builds its own
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestCheck.h"
+#include "../Engine/CollisionShapeCache.h"
+#include <new>
+
+using namespace DirectX;
+using namespace Engine;
+using TestCheck::Check;
+
+namespace
+{
+	//
+	// A model whose geometry is a unit cube, or nothing, that counts how often it's collected
+	//
+	class FakeModel : public CollisionGeometry
+	{
+	public:
+
+		explicit FakeModel(_In_ bool hasGeometry)
+			: HasGeometry(hasGeometry), Collected(0)
+		{}
+
+		void GetCollisionGeometry(
+			_Out_ std::vector<XMFLOAT3>& vertices,
+			_Out_ std::vector<UINT>& indices) const override
+		{
+			++Collected;
+			vertices.clear();
+			indices.clear();
+
+			if (!HasGeometry)
+			{
+				return;
+			}
+
+			for (UINT corner = 0; corner < 8; ++corner)
+			{
+				vertices.push_back(XMFLOAT3((corner & 1) ? 1.0f : 0.0f, (corner & 2) ? 1.0f : 0.0f, (corner & 4) ? 1.0f : 0.0f));
+			}
+
+			// Two triangles on each face, sharing the corners
+			const UINT faces[6][4] = { { 0, 1, 3, 2 }, { 4, 6, 7, 5 }, { 0, 4, 5, 1 }, { 2, 3, 7, 6 }, { 0, 2, 6, 4 }, { 1, 5, 7, 3 } };
+			for (const auto& face : faces)
+			{
+				indices.insert(indices.end(), { face[0], face[1], face[2], face[0], face[2], face[3] });
+			}
+		}
+
+		bool HasGeometry;
+		mutable int Collected;
+	};
+
+	bool hasScale(
+		_In_ const btVector3& scaling,
+		_In_ const XMFLOAT3& scale)
+	{
+		return scaling.getX() == scale.x && scaling.getY() == scale.y && scaling.getZ() == scale.z;
+	}
+
+	void checkSharing()
+	{
+		CollisionShapeCache cache;
+		FakeModel house(true);
+		FakeModel tower(true);
+		const XMFLOAT3 unit(1.0f, 1.0f, 1.0f);
+		const XMFLOAT3 wide(2.0f, 1.0f, 1.0f);
+
+		btScaledBvhTriangleMeshShape* first = cache.GetTriangleMesh(house, unit);
+		btScaledBvhTriangleMeshShape* again = cache.GetTriangleMesh(house, XMFLOAT3(1.0f, 1.0f, 1.0f));
+		Check(first != nullptr && first == again, "the same scale shares one shape");
+
+		btScaledBvhTriangleMeshShape* wider = cache.GetTriangleMesh(house, wide);
+		Check(wider != first && wider->getChildShape() == first->getChildShape(), "other scales share the model's BVH");
+		Check(hasScale(first->getLocalScaling(), unit) && hasScale(wider->getLocalScaling(), wide), "each shape scales the BVH");
+
+		btTriangleIndexVertexArray* mesh = static_cast<btTriangleIndexVertexArray*>(first->getChildShape()->getMeshInterface());
+		Check(mesh->getIndexedMeshArray().size() == 1 && mesh->getIndexedMeshArray()[0].m_numTriangles == 12 &&
+			mesh->getIndexedMeshArray()[0].m_numVertices == 8, "BVH built over the model's triangles");
+
+		btScaledBvhTriangleMeshShape* other = cache.GetTriangleMesh(tower, unit);
+		Check(other != first && other->getChildShape() != first->getChildShape(), "other models get their own BVH");
+
+		btConvexHullShape* hull = cache.GetConvexHull(house, unit);
+		Check(hull != nullptr && hull == cache.GetConvexHull(house, unit), "the same scale shares one hull");
+		btConvexHullShape* widerHull = cache.GetConvexHull(house, wide);
+		Check(widerHull != hull && hasScale(widerHull->getLocalScaling(), wide), "other scales get a scaled copy of the hull");
+		Check(hull->getNumPoints() == 8 && widerHull->getNumPoints() == 8, "hull built from the model's corners");
+
+		Check(house.Collected == 1 && tower.Collected == 1, "each model's geometry collected once");
+
+		CollisionShapeCacheStats stats = cache.GetStats();
+		Check(stats.TriangleMeshes == 2 && stats.ScaledTriangleMeshes == 3 && stats.Hulls == 1 && stats.ScaledHulls == 2, "shapes counted");
+	}
+
+	void checkWithoutGeometry()
+	{
+		CollisionShapeCache cache;
+		FakeModel marker(false);
+
+		Check(cache.GetTriangleMesh(marker, XMFLOAT3(1.0f, 1.0f, 1.0f)) == nullptr, "no triangle mesh without geometry");
+		Check(cache.GetConvexHull(marker, XMFLOAT3(1.0f, 1.0f, 1.0f)) == nullptr, "no hull without geometry");
+		Check(marker.Collected == 1, "models without geometry aren't collected again");
+
+		CollisionShapeCacheStats stats = cache.GetStats();
+		Check(stats.TriangleMeshes == 0 && stats.ScaledTriangleMeshes == 0 && stats.Hulls == 0, "nothing built");
+	}
+
+	void checkRelease()
+	{
+		CollisionShapeCache cache;
+		FakeModel house(true);
+		const XMFLOAT3 unit(1.0f, 1.0f, 1.0f);
+
+		cache.GetTriangleMesh(house, unit);
+		cache.GetConvexHull(house, unit);
+		cache.Release(house);
+		Check(cache.GetStats().TriangleMeshes == 0 && cache.GetStats().ScaledHulls == 0, "release drops the model's shapes");
+
+		cache.GetTriangleMesh(house, unit);
+		Check(house.Collected == 2, "released model collected again");
+
+		cache.Clear();
+		Check(cache.GetStats().TriangleMeshes == 0, "clear drops every shape");
+
+		// A model released by Clear can be built by another cache
+		CollisionShapeCache other;
+		Check(other.GetTriangleMesh(house, unit) != nullptr && house.Collected == 3, "cleared model built by another cache");
+	}
+
+	void checkModelDestroyed()
+	{
+		CollisionShapeCache cache;
+		const XMFLOAT3 unit(1.0f, 1.0f, 1.0f);
+
+		//
+		// Models at the same address one after the other, as when the model cache evicts one and loads another
+		// into the freed memory
+		alignas(FakeModel) unsigned char storage[sizeof(FakeModel)];
+
+		FakeModel* evicted = new (storage) FakeModel(true);
+		btScaledBvhTriangleMeshShape* shape = cache.GetTriangleMesh(*evicted, unit);
+		Check(shape != nullptr, "shape built");
+		evicted->~FakeModel();
+		Check(cache.GetStats().TriangleMeshes == 0 && cache.GetStats().ScaledTriangleMeshes == 0, "destroyed model's shapes released");
+
+		FakeModel* loaded = new (storage) FakeModel(true);
+		cache.GetTriangleMesh(*loaded, unit);
+		Check(loaded->Collected == 1, "new model at the same address collected rather than given the old shapes");
+		loaded->~FakeModel();
+
+		// A model outliving its cache doesn't reach back into it
+		FakeModel survivor(true);
+		{
+			CollisionShapeCache shortLived;
+			shortLived.GetTriangleMesh(survivor, unit);
+		}
+		Check(cache.GetTriangleMesh(survivor, unit) != nullptr && survivor.Collected == 2, "model outliving its cache built again by another");
+	}
+}
+
+int main()
+{
+	checkSharing();
+	checkWithoutGeometry();
+	checkRelease();
+	checkModelDestroyed();
+
+	return TestCheck::Report("CollisionShapeCacheTest");
+}
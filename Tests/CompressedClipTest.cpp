@@ -0,0 +1,185 @@
+//////////////////////////////////////////////////////////////////////////
+// CompressedClipTest.cpp
+// Compresses generated animations with CompressedClip and checks that
+// sampling them follows the keyframes they came from, that a cursor gives
+// the same poses as sampling from scratch, also when it is handed from
+// one clip to another, and that truncated clips are refused
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestCheck.h"
+#include "../Engine/CompressedClip.h"
+#include <cmath>
+
+using namespace DirectX;
+using namespace Engine;
+using TestCheck::Check;
+
+namespace
+{
+	// An animation and the keyframes its tracks point at
+	struct Animation
+	{
+		KsmAnimationView View;
+		std::vector<std::vector<KsmKeyframeRecord>> Keyframes;
+	};
+
+	// Tracks that turn about the y axis and move along a curve, sampled at keyCount evenly spaced keyframes
+	Animation makeAnimation(
+		_In_ const wchar_t* name,
+		_In_ UINT trackCount,
+		_In_ UINT keyCount)
+	{
+		Animation animation;
+		animation.View.Name = name;
+		animation.View.Duration = 96.0f;
+		animation.View.TicksPerSecond = 24.0f;
+		animation.View.TotalFrames = 96;
+		animation.View.Clip = nullptr;
+		animation.View.ClipSize = 0;
+
+		animation.Keyframes.resize(trackCount);
+		for (UINT t = 0; t < trackCount; ++t)
+		{
+			std::vector<KsmKeyframeRecord>& keyframes = animation.Keyframes[t];
+			for (UINT k = 0; k < keyCount; ++k)
+			{
+				KsmKeyframeRecord keyframe = {};
+				keyframe.TimePos = animation.View.Duration * k / (keyCount - 1);
+
+				float angle = (keyframe.TimePos * 0.05f + t) * 0.5f;
+				keyframe.RotationQuat[1] = std::sin(angle);
+				keyframe.RotationQuat[3] = std::cos(angle);
+				for (UINT axis = 0; axis < 3; ++axis)
+				{
+					keyframe.Translation[axis] = std::sin(keyframe.TimePos * 0.1f + axis + t) * 10.0f;
+					keyframe.Scale[axis] = 1.0f;
+				}
+				keyframes.push_back(keyframe);
+			}
+
+			KsmTrackView track;
+			track.KeyframeCount = keyCount;
+			track.KeyframeStride = sizeof(KsmKeyframeRecord);
+			track.Keyframes = reinterpret_cast<byte*>(keyframes.data());
+			animation.View.Tracks.push_back(track);
+		}
+		return animation;
+	}
+
+	// The translation of a track at the given time, interpolated linearly between its keyframes
+	XMFLOAT3 keyframeTranslation(
+		_In_ const std::vector<KsmKeyframeRecord>& keyframes,
+		_In_ float time)
+	{
+		size_t k = 0;
+		while (k + 2 < keyframes.size() && keyframes[k + 1].TimePos <= time)
+		{
+			++k;
+		}
+
+		const KsmKeyframeRecord& first = keyframes[k];
+		const KsmKeyframeRecord& second = keyframes[k + 1];
+		float blend = std::min(std::max((time - first.TimePos) / (second.TimePos - first.TimePos), 0.0f), 1.0f);
+		return XMFLOAT3(
+			first.Translation[0] + (second.Translation[0] - first.Translation[0]) * blend,
+			first.Translation[1] + (second.Translation[1] - first.Translation[1]) * blend,
+			first.Translation[2] + (second.Translation[2] - first.Translation[2]) * blend);
+	}
+
+	bool samePoses(
+		_In_ const std::vector<XMFLOAT4X4>& a,
+		_In_ const std::vector<XMFLOAT4X4>& b)
+	{
+		return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(XMFLOAT4X4)) == 0;
+	}
+
+	bool compress(
+		_In_ const Animation& animation,
+		_Out_ std::vector<byte>& blob,
+		_Out_ CompressedClip& clip)
+	{
+		CompressedClip::Compress(animation.View, ClipCompressionSettings(), blob);
+		return clip.Read(animation.View.Name, blob.data(), blob.size());
+	}
+
+	void checkSampling()
+	{
+		Animation animation = makeAnimation(L"walk", 8, 97);
+		std::vector<byte> blob;
+		CompressedClip clip;
+		Check(compress(animation, blob, clip), "compressed clip reads back");
+		Check(clip.GetTrackCount() == 8, "every track kept");
+
+		// Twice through the clip and a bit past either end, so the cursor both steps forward and starts over
+		CompressedClipCursor cursor;
+		std::vector<XMFLOAT4X4> poses;
+		std::vector<XMFLOAT4X4> fresh;
+		bool matchesFresh = true;
+		float largestError = 0.0f;
+		for (int loop = 0; loop < 2; ++loop)
+		{
+			for (float time = -2.0f; time <= animation.View.Duration + 2.0f; time += 0.37f)
+			{
+				clip.Sample(time, cursor, poses);
+				CompressedClipCursor freshCursor;
+				clip.Sample(time, freshCursor, fresh);
+				matchesFresh = matchesFresh && samePoses(poses, fresh);
+
+				float clamped = std::min(std::max(time, 0.0f), animation.View.Duration);
+				for (size_t t = 0; t < animation.Keyframes.size(); ++t)
+				{
+					XMFLOAT3 expected = keyframeTranslation(animation.Keyframes[t], clamped);
+					largestError = std::max(largestError, std::abs(poses[t].m[0][3] - expected.x));
+					largestError = std::max(largestError, std::abs(poses[t].m[1][3] - expected.y));
+					largestError = std::max(largestError, std::abs(poses[t].m[2][3] - expected.z));
+				}
+			}
+		}
+
+		Check(matchesFresh, "sampling with a cursor gives the same poses as sampling from the start");
+		Check(largestError < 0.05f, "sampled translations follow the keyframes");
+		printf("%u keyframes compressed to %zu bytes, largest translation error %g\n", 8 * 97, blob.size(), largestError);
+
+		bool truncatedRefused = true;
+		for (size_t size = 0; size < blob.size(); size += 5)
+		{
+			CompressedClip truncated;
+			truncatedRefused = truncatedRefused && !truncated.Read(L"truncated", blob.data(), size);
+		}
+		Check(truncatedRefused, "truncated clips refused");
+	}
+
+	// A cursor moved on to another clip with as many tracks but fewer keys starts over rather than
+	// reading past that clip's keys
+	void checkCursorChangesClip()
+	{
+		Animation walk = makeAnimation(L"walk", 8, 97);
+		Animation idle = makeAnimation(L"idle", 8, 3);
+		std::vector<byte> walkBlob;
+		std::vector<byte> idleBlob;
+		CompressedClip walkClip;
+		CompressedClip idleClip;
+		Check(compress(walk, walkBlob, walkClip) && compress(idle, idleBlob, idleClip), "both clips read back");
+
+		CompressedClipCursor cursor;
+		std::vector<XMFLOAT4X4> poses;
+		walkClip.Sample(90.0f, cursor, poses);
+		idleClip.Sample(95.0f, cursor, poses);
+
+		CompressedClipCursor freshCursor;
+		std::vector<XMFLOAT4X4> fresh;
+		idleClip.Sample(95.0f, freshCursor, fresh);
+		Check(cursor.Clip == &idleClip, "cursor follows the clip it was last used with");
+		Check(samePoses(poses, fresh), "cursor handed to another clip starts over");
+	}
+}
+
+int main()
+{
+	checkSampling();
+	checkCursorChangesClip();
+
+	return TestCheck::Report("CompressedClipTest");
+}
@@ -0,0 +1,194 @@
+//////////////////////////////////////////////////////////////////////////
+// ConfigSnapshotBenchmark.cpp
+// Measures how long configuring a script engine with a large generated
+// interface takes when every declaration is parsed, when a configuration
+// snapshot is recorded, and when one is restored
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include <angelscript.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../Engine/AngelScript Addons/scriptstdstring.h"
+
+namespace
+{
+	void messageCallback(const asSMessageInfo* msg, void*)
+	{
+		if (msg->type == asMSGTYPE_ERROR)
+		{
+			printf("%s (%d, %d): %s\n", msg->section, msg->row, msg->col, msg->message);
+		}
+	}
+
+	void stub(asIScriptGeneric*)
+	{
+	}
+
+	class MemoryStream : public asIBinaryStream
+	{
+	public:
+		MemoryStream() : _read(0) {}
+
+		void Rewind() { _read = 0; }
+		size_t Size() const { return _data.size(); }
+
+		void Write(const void* ptr, asUINT size) override
+		{
+			_data.insert(_data.end(), (const char*)ptr, (const char*)ptr + size);
+		}
+
+		void Read(void* ptr, asUINT size) override
+		{
+			memcpy(ptr, &_data[_read], size);
+			_read += size;
+		}
+
+	private:
+		std::vector<char> _data;
+		size_t _read;
+	};
+
+	struct Registration
+	{
+		enum Kind { Type, Method, Property, Function, GlobalProperty, Namespace } kind;
+		std::string object;
+		std::string decl;
+	};
+
+	std::string format(const char* fmt, int a, int b = 0, int c = 0)
+	{
+		char buf[256];
+		snprintf(buf, sizeof(buf), fmt, a, b, c);
+		return buf;
+	}
+
+	// An interface about the size of the game's, with types referring to each other
+	std::vector<Registration> buildInterface(int typeCount, int methodsPerType, int functionCount)
+	{
+		std::vector<Registration> interface;
+		for (int t = 0; t < typeCount; ++t)
+		{
+			interface.push_back({ Registration::Type, format("Type%d", t), "" });
+		}
+		for (int t = 0; t < typeCount; ++t)
+		{
+			std::string type = format("Type%d", t);
+			for (int m = 0; m < methodsPerType; ++m)
+			{
+				int other = (t * 7 + m) % typeCount;
+				switch (m % 4)
+				{
+				case 0: interface.push_back({ Registration::Method, type, format("Type%d@ link%d(const Type%d &in, int, float scale = 1.5) const", other, m, t) }); break;
+				case 1: interface.push_back({ Registration::Method, type, format("void set%d(const string &in, double, uint8 flags = %d)", m, t % 200) }); break;
+				case 2: interface.push_back({ Registration::Method, type, format("int get%d() const", m) }); break;
+				default: interface.push_back({ Registration::Method, type, format("Type%d@ pick%d(Type%d@, bool &out)", t, m, other) }); break;
+				}
+			}
+			for (int p = 0; p < methodsPerType / 4; ++p)
+			{
+				interface.push_back({ Registration::Property, type, format("int field%d", p) });
+			}
+		}
+		for (int f = 0; f < functionCount; ++f)
+		{
+			interface.push_back({ Registration::Function, "", format("void call%d(const Type%d &in, int, const string &in tag = \"\")", f, f % typeCount) });
+			if (f % 8 == 0)
+			{
+				interface.push_back({ Registration::Namespace, "", format("Settings%d", f / 800) });
+				interface.push_back({ Registration::GlobalProperty, "", format("const float value%d", f) });
+				interface.push_back({ Registration::Namespace, "", "" });
+			}
+		}
+		return interface;
+	}
+
+	asIScriptEngine* configure(const std::vector<Registration>& interface, MemoryStream* snapshotIn, MemoryStream* snapshotOut, asUINT* parsed)
+	{
+		static float setting = 0;
+		static const asQWORD Fingerprint = 1;
+
+		asIScriptEngine* engine = asCreateScriptEngine(ANGELSCRIPT_VERSION);
+		engine->SetMessageCallback(asFUNCTION(messageCallback), 0, asCALL_CDECL);
+		if (snapshotOut)
+		{
+			engine->BeginConfigSnapshot(snapshotIn, Fingerprint);
+		}
+
+		RegisterStdString(engine);
+		for (const Registration& r : interface)
+		{
+			int result = 0;
+			switch (r.kind)
+			{
+			case Registration::Type: result = engine->RegisterObjectType(r.object.c_str(), 0, asOBJ_REF | asOBJ_NOCOUNT); break;
+			case Registration::Method: result = engine->RegisterObjectMethod(r.object.c_str(), r.decl.c_str(), asFUNCTION(stub), asCALL_GENERIC); break;
+			case Registration::Property: result = engine->RegisterObjectProperty(r.object.c_str(), r.decl.c_str(), 0); break;
+			case Registration::Function: result = engine->RegisterGlobalFunction(r.decl.c_str(), asFUNCTION(stub), asCALL_GENERIC); break;
+			case Registration::GlobalProperty: result = engine->RegisterGlobalProperty(r.decl.c_str(), &setting); break;
+			case Registration::Namespace: result = engine->SetDefaultNamespace(r.decl.c_str()); break;
+			}
+			if (result < 0)
+			{
+				printf("registering '%s' failed with %d\n", r.decl.empty() ? r.object.c_str() : r.decl.c_str(), result);
+				exit(1);
+			}
+		}
+		engine->SetDefaultNamespace("");
+
+		if (snapshotOut)
+		{
+			engine->EndConfigSnapshot(snapshotOut, parsed);
+		}
+		return engine;
+	}
+
+	template <typename F> double bestOf(int passes, F f)
+	{
+		double best = 1e30;
+		for (int pass = 0; pass < passes; ++pass)
+		{
+			auto start = std::chrono::steady_clock::now();
+			asIScriptEngine* engine = f();
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			engine->Release();
+			best = (ms < best) ? ms : best;
+		}
+		return best;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int typeCount = (argc > 1) ? atoi(argv[1]) : 300;
+	int functionCount = (argc > 2) ? atoi(argv[2]) : 4000;
+	int passes = (argc > 3) ? atoi(argv[3]) : 5;
+
+	std::vector<Registration> interface = buildInterface(typeCount, 24, functionCount);
+
+	MemoryStream snapshot;
+	asUINT recorded = 0;
+	configure(interface, nullptr, &snapshot, &recorded)->Release();
+
+	double parsing = bestOf(passes, [&]() { return configure(interface, nullptr, nullptr, nullptr); });
+	double recording = bestOf(passes, [&]() { MemoryStream out; return configure(interface, nullptr, &out, nullptr); });
+
+	asUINT parsed = 0;
+	double restoring = bestOf(passes, [&]() { MemoryStream out; snapshot.Rewind(); return configure(interface, &snapshot, &out, &parsed); });
+	if (parsed != 0)
+	{
+		printf("restoring the snapshot still parsed %u declarations\n", parsed);
+		return 1;
+	}
+
+	printf("%zu registrations, %u parsed declarations, snapshot of %.1f KB\n", interface.size(), recorded, snapshot.Size() / 1024.0);
+	printf("parsing:   %.1f ms\n", parsing);
+	printf("recording: %.1f ms\n", recording);
+	printf("restoring: %.1f ms (%.1fx faster than parsing)\n", restoring, parsing / restoring);
+	return 0;
+}
@@ -0,0 +1,8 @@
+//////////////////////////////////////////////////////////////////////////
+// AssetTypeEnum.h
+// Stands in for the game's asset type enumeration in headless builds,
+// where none of the engine sources built for the tests use it
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
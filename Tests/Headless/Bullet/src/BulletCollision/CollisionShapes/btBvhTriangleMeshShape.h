@@ -0,0 +1,25 @@
+//////////////////////////////////////////////////////////////////////////
+// btBvhTriangleMeshShape.h
+// Stands in for Bullet's btBvhTriangleMeshShape in headless builds.
+// Builds no tree, it only remembers the mesh it would be built over
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "btTriangleIndexVertexArray.h"
+
+class btBvhTriangleMeshShape
+{
+public:
+	btBvhTriangleMeshShape(btStridingMeshInterface* meshInterface, bool useQuantizedAabbCompression)
+		: m_meshInterface(meshInterface), m_useQuantizedAabbCompression(useQuantizedAabbCompression)
+	{}
+
+	btStridingMeshInterface* getMeshInterface() { return m_meshInterface; }
+	bool usesQuantizedAabbCompression() const { return m_useQuantizedAabbCompression; }
+
+private:
+	btStridingMeshInterface* m_meshInterface;
+	bool m_useQuantizedAabbCompression;
+};
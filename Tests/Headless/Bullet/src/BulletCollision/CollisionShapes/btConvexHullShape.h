@@ -0,0 +1,38 @@
+//////////////////////////////////////////////////////////////////////////
+// btConvexHullShape.h
+// Stands in for Bullet's btConvexHullShape in headless builds. Copies
+// the points like Bullet does, but computes nothing from them
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "../../LinearMath/btVector3.h"
+#include <vector>
+
+class btConvexHullShape
+{
+public:
+	btConvexHullShape(const btScalar* points, int numPoints, int stride)
+		: m_localScaling(1.0f, 1.0f, 1.0f)
+	{
+		const unsigned char* point = reinterpret_cast<const unsigned char*>(points);
+		for (int i = 0; i < numPoints; ++i, point += stride)
+		{
+			const btScalar* coordinates = reinterpret_cast<const btScalar*>(point);
+			m_points.push_back(btVector3(coordinates[0], coordinates[1], coordinates[2]));
+		}
+	}
+
+	int getNumPoints() const { return static_cast<int>(m_points.size()); }
+	const btVector3* getUnscaledPoints() const { return m_points.data(); }
+
+	void setLocalScaling(const btVector3& scaling) { m_localScaling = scaling; }
+	const btVector3& getLocalScaling() const { return m_localScaling; }
+
+	btScalar getMargin() const { return 0.04f; }
+
+private:
+	std::vector<btVector3> m_points;
+	btVector3 m_localScaling;
+};
@@ -0,0 +1,25 @@
+//////////////////////////////////////////////////////////////////////////
+// btScaledBvhTriangleMeshShape.h
+// Stands in for Bullet's btScaledBvhTriangleMeshShape in headless builds
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "btBvhTriangleMeshShape.h"
+#include "../../LinearMath/btVector3.h"
+
+class btScaledBvhTriangleMeshShape
+{
+public:
+	btScaledBvhTriangleMeshShape(btBvhTriangleMeshShape* childShape, const btVector3& localScaling)
+		: m_childShape(childShape), m_localScaling(localScaling)
+	{}
+
+	btBvhTriangleMeshShape* getChildShape() { return m_childShape; }
+	const btVector3& getLocalScaling() const { return m_localScaling; }
+
+private:
+	btBvhTriangleMeshShape* m_childShape;
+	btVector3 m_localScaling;
+};
@@ -0,0 +1,41 @@
+//////////////////////////////////////////////////////////////////////////
+// btShapeHull.h
+// Stands in for Bullet's btShapeHull in headless builds. Simplifies
+// nothing: the hull is the shape's points with duplicates dropped
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "btConvexHullShape.h"
+#include <algorithm>
+#include <vector>
+
+class btShapeHull
+{
+public:
+	explicit btShapeHull(const btConvexHullShape* shape)
+		: m_shape(shape)
+	{}
+
+	bool buildHull(btScalar)
+	{
+		m_vertices.clear();
+		for (int i = 0; i < m_shape->getNumPoints(); ++i)
+		{
+			const btVector3& point = m_shape->getUnscaledPoints()[i];
+			if (std::find(m_vertices.begin(), m_vertices.end(), point) == m_vertices.end())
+			{
+				m_vertices.push_back(point);
+			}
+		}
+		return true;
+	}
+
+	int numVertices() const { return static_cast<int>(m_vertices.size()); }
+	const btVector3* getVertexPointer() const { return m_vertices.data(); }
+
+private:
+	const btConvexHullShape* m_shape;
+	std::vector<btVector3> m_vertices;
+};
@@ -0,0 +1,49 @@
+//////////////////////////////////////////////////////////////////////////
+// btTriangleIndexVertexArray.h
+// Stands in for Bullet's btTriangleIndexVertexArray in headless builds.
+// Keeps the meshes added to it without copying what they point at
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+enum PHY_ScalarType
+{
+	PHY_FLOAT,
+	PHY_INTEGER
+};
+
+struct btIndexedMesh
+{
+	int m_numTriangles;
+	const unsigned char* m_triangleIndexBase;
+	int m_triangleIndexStride;
+	int m_numVertices;
+	const unsigned char* m_vertexBase;
+	int m_vertexStride;
+	PHY_ScalarType m_indexType;
+	PHY_ScalarType m_vertexType;
+};
+
+class btStridingMeshInterface
+{
+public:
+	virtual ~btStridingMeshInterface() {}
+};
+
+class btTriangleIndexVertexArray : public btStridingMeshInterface
+{
+public:
+	void addIndexedMesh(const btIndexedMesh& mesh, PHY_ScalarType indexType = PHY_INTEGER)
+	{
+		m_meshes.push_back(mesh);
+		m_meshes.back().m_indexType = indexType;
+	}
+
+	const std::vector<btIndexedMesh>& getIndexedMeshArray() const { return m_meshes; }
+
+private:
+	std::vector<btIndexedMesh> m_meshes;
+};
@@ -0,0 +1,24 @@
+//////////////////////////////////////////////////////////////////////////
+// btAlignedObjectArray.h
+// Stands in for Bullet's btAlignedObjectArray in headless builds
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <vector>
+
+template<class T>
+class btAlignedObjectArray
+{
+public:
+	int size() const { return static_cast<int>(m_data.size()); }
+	void resize(int size) { m_data.resize(size); }
+	void push_back(const T& value) { m_data.push_back(value); }
+
+	T& operator[](int i) { return m_data[i]; }
+	const T& operator[](int i) const { return m_data[i]; }
+
+private:
+	std::vector<T> m_data;
+};
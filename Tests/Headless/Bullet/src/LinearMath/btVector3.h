@@ -0,0 +1,40 @@
+//////////////////////////////////////////////////////////////////////////
+// btVector3.h
+// Stands in for Bullet's btVector3 in headless builds. Bullet isn't
+// built for the tests; the stand-ins under Headless/Bullet only hold on
+// to what the engine hands them, so the tests can check which shapes
+// were built and what they share
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+typedef float btScalar;
+
+class btVector3
+{
+public:
+	btVector3()
+	{
+		m_floats[0] = m_floats[1] = m_floats[2] = 0.0f;
+	}
+
+	btVector3(const btScalar& x, const btScalar& y, const btScalar& z)
+	{
+		m_floats[0] = x;
+		m_floats[1] = y;
+		m_floats[2] = z;
+	}
+
+	const btScalar& getX() const { return m_floats[0]; }
+	const btScalar& getY() const { return m_floats[1]; }
+	const btScalar& getZ() const { return m_floats[2]; }
+
+	bool operator==(const btVector3& other) const
+	{
+		return m_floats[0] == other.m_floats[0] && m_floats[1] == other.m_floats[1] && m_floats[2] == other.m_floats[2];
+	}
+
+private:
+	btScalar m_floats[3];
+};
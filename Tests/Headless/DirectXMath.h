@@ -0,0 +1,239 @@
+//////////////////////////////////////////////////////////////////////////
+// DirectXMath.h
+// The part of DirectXMath used by the engine sources built headless for
+// the tests, written out in plain C++ without SIMD. Only the storage
+// types, the vector and matrix types and the functions those sources
+// call are provided
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+namespace DirectX
+{
+	struct XMFLOAT2
+	{
+		float x, y;
+
+		XMFLOAT2() = default;
+		XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+	};
+
+	struct XMFLOAT3
+	{
+		float x, y, z;
+
+		XMFLOAT3() = default;
+		XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+	};
+
+	struct XMFLOAT4
+	{
+		float x, y, z, w;
+
+		XMFLOAT4() = default;
+		XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+	};
+
+	struct XMFLOAT4X4
+	{
+		float m[4][4];
+	};
+
+	struct XMVECTOR
+	{
+		float v[4];
+	};
+
+	struct XMMATRIX
+	{
+		XMVECTOR r[4];
+	};
+
+	inline XMVECTOR XMVectorSet(float x, float y, float z, float w)
+	{
+		XMVECTOR result = { { x, y, z, w } };
+		return result;
+	}
+
+	inline XMVECTOR XMVectorZero()
+	{
+		return XMVectorSet(0.0f, 0.0f, 0.0f, 0.0f);
+	}
+
+	inline XMVECTOR XMLoadFloat3(const XMFLOAT3* source)
+	{
+		return XMVectorSet(source->x, source->y, source->z, 0.0f);
+	}
+
+	inline void XMStoreFloat3(XMFLOAT3* destination, const XMVECTOR& v)
+	{
+		destination->x = v.v[0];
+		destination->y = v.v[1];
+		destination->z = v.v[2];
+	}
+
+	inline float XMVectorGetX(const XMVECTOR& v)
+	{
+		return v.v[0];
+	}
+
+	inline XMVECTOR XMVectorAdd(const XMVECTOR& a, const XMVECTOR& b)
+	{
+		return XMVectorSet(a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]);
+	}
+
+	inline XMVECTOR XMVectorSubtract(const XMVECTOR& a, const XMVECTOR& b)
+	{
+		return XMVectorSet(a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]);
+	}
+
+	inline XMVECTOR XMVectorScale(const XMVECTOR& v, float scale)
+	{
+		return XMVectorSet(v.v[0] * scale, v.v[1] * scale, v.v[2] * scale, v.v[3] * scale);
+	}
+
+	inline XMVECTOR XMVectorMin(const XMVECTOR& a, const XMVECTOR& b)
+	{
+		return XMVectorSet(std::min(a.v[0], b.v[0]), std::min(a.v[1], b.v[1]), std::min(a.v[2], b.v[2]), std::min(a.v[3], b.v[3]));
+	}
+
+	inline XMVECTOR XMVectorMax(const XMVECTOR& a, const XMVECTOR& b)
+	{
+		return XMVectorSet(std::max(a.v[0], b.v[0]), std::max(a.v[1], b.v[1]), std::max(a.v[2], b.v[2]), std::max(a.v[3], b.v[3]));
+	}
+
+	// The 3D vector functions return their scalar results in every component, as DirectXMath does
+	inline XMVECTOR XMVector3Dot(const XMVECTOR& a, const XMVECTOR& b)
+	{
+		float dot = a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2];
+		return XMVectorSet(dot, dot, dot, dot);
+	}
+
+	inline XMVECTOR XMVector3Cross(const XMVECTOR& a, const XMVECTOR& b)
+	{
+		return XMVectorSet(a.v[1] * b.v[2] - a.v[2] * b.v[1], a.v[2] * b.v[0] - a.v[0] * b.v[2], a.v[0] * b.v[1] - a.v[1] * b.v[0], 0.0f);
+	}
+
+	inline XMVECTOR XMVector3Length(const XMVECTOR& v)
+	{
+		float length = std::sqrt(XMVectorGetX(XMVector3Dot(v, v)));
+		return XMVectorSet(length, length, length, length);
+	}
+
+	// Zero length vectors are returned as they are
+	inline XMVECTOR XMVector3Normalize(const XMVECTOR& v)
+	{
+		float length = XMVectorGetX(XMVector3Length(v));
+		return (length > 0.0f) ? XMVectorScale(v, 1.0f / length) : v;
+	}
+
+	inline XMMATRIX XMLoadFloat4x4(const XMFLOAT4X4* source)
+	{
+		XMMATRIX result;
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				result.r[row].v[column] = source->m[row][column];
+			}
+		}
+		return result;
+	}
+
+	inline void XMStoreFloat4x4(XMFLOAT4X4* destination, const XMMATRIX& m)
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				destination->m[row][column] = m.r[row].v[column];
+			}
+		}
+	}
+
+	inline XMMATRIX XMMatrixTranspose(const XMMATRIX& m)
+	{
+		XMMATRIX result;
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				result.r[row].v[column] = m.r[column].v[row];
+			}
+		}
+		return result;
+	}
+
+	inline XMMATRIX XMMatrixMultiply(const XMMATRIX& a, const XMMATRIX& b)
+	{
+		XMMATRIX result;
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				result.r[row].v[column] = a.r[row].v[0] * b.r[0].v[column] + a.r[row].v[1] * b.r[1].v[column] +
+					a.r[row].v[2] * b.r[2].v[column] + a.r[row].v[3] * b.r[3].v[column];
+			}
+		}
+		return result;
+	}
+
+	inline XMMATRIX operator*(const XMMATRIX& a, const XMMATRIX& b)
+	{
+		return XMMatrixMultiply(a, b);
+	}
+
+	//
+	// The inverse by cofactors, with the determinant in every component of *determinant if it isn't null
+	//
+	inline XMMATRIX XMMatrixInverse(XMVECTOR* determinant, const XMMATRIX& m)
+	{
+		float a[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			a[i] = m.r[i / 4].v[i % 4];
+		}
+
+		float c[16];
+		c[0] = a[5] * a[10] * a[15] - a[5] * a[11] * a[14] - a[9] * a[6] * a[15] + a[9] * a[7] * a[14] + a[13] * a[6] * a[11] - a[13] * a[7] * a[10];
+		c[4] = -a[4] * a[10] * a[15] + a[4] * a[11] * a[14] + a[8] * a[6] * a[15] - a[8] * a[7] * a[14] - a[12] * a[6] * a[11] + a[12] * a[7] * a[10];
+		c[8] = a[4] * a[9] * a[15] - a[4] * a[11] * a[13] - a[8] * a[5] * a[15] + a[8] * a[7] * a[13] + a[12] * a[5] * a[11] - a[12] * a[7] * a[9];
+		c[12] = -a[4] * a[9] * a[14] + a[4] * a[10] * a[13] + a[8] * a[5] * a[14] - a[8] * a[6] * a[13] - a[12] * a[5] * a[10] + a[12] * a[6] * a[9];
+		c[1] = -a[1] * a[10] * a[15] + a[1] * a[11] * a[14] + a[9] * a[2] * a[15] - a[9] * a[3] * a[14] - a[13] * a[2] * a[11] + a[13] * a[3] * a[10];
+		c[5] = a[0] * a[10] * a[15] - a[0] * a[11] * a[14] - a[8] * a[2] * a[15] + a[8] * a[3] * a[14] + a[12] * a[2] * a[11] - a[12] * a[3] * a[10];
+		c[9] = -a[0] * a[9] * a[15] + a[0] * a[11] * a[13] + a[8] * a[1] * a[15] - a[8] * a[3] * a[13] - a[12] * a[1] * a[11] + a[12] * a[3] * a[9];
+		c[13] = a[0] * a[9] * a[14] - a[0] * a[10] * a[13] - a[8] * a[1] * a[14] + a[8] * a[2] * a[13] + a[12] * a[1] * a[10] - a[12] * a[2] * a[9];
+		c[2] = a[1] * a[6] * a[15] - a[1] * a[7] * a[14] - a[5] * a[2] * a[15] + a[5] * a[3] * a[14] + a[13] * a[2] * a[7] - a[13] * a[3] * a[6];
+		c[6] = -a[0] * a[6] * a[15] + a[0] * a[7] * a[14] + a[4] * a[2] * a[15] - a[4] * a[3] * a[14] - a[12] * a[2] * a[7] + a[12] * a[3] * a[6];
+		c[10] = a[0] * a[5] * a[15] - a[0] * a[7] * a[13] - a[4] * a[1] * a[15] + a[4] * a[3] * a[13] + a[12] * a[1] * a[7] - a[12] * a[3] * a[5];
+		c[14] = -a[0] * a[5] * a[14] + a[0] * a[6] * a[13] + a[4] * a[1] * a[14] - a[4] * a[2] * a[13] - a[12] * a[1] * a[6] + a[12] * a[2] * a[5];
+		c[3] = -a[1] * a[6] * a[11] + a[1] * a[7] * a[10] + a[5] * a[2] * a[11] - a[5] * a[3] * a[10] - a[9] * a[2] * a[7] + a[9] * a[3] * a[6];
+		c[7] = a[0] * a[6] * a[11] - a[0] * a[7] * a[10] - a[4] * a[2] * a[11] + a[4] * a[3] * a[10] + a[8] * a[2] * a[7] - a[8] * a[3] * a[6];
+		c[11] = -a[0] * a[5] * a[11] + a[0] * a[7] * a[9] + a[4] * a[1] * a[11] - a[4] * a[3] * a[9] - a[8] * a[1] * a[7] + a[8] * a[3] * a[5];
+		c[15] = a[0] * a[5] * a[10] - a[0] * a[6] * a[9] - a[4] * a[1] * a[10] + a[4] * a[2] * a[9] + a[8] * a[1] * a[6] - a[8] * a[2] * a[5];
+
+		float det = a[0] * c[0] + a[1] * c[4] + a[2] * c[8] + a[3] * c[12];
+		if (determinant != nullptr)
+		{
+			*determinant = XMVectorSet(det, det, det, det);
+		}
+
+		XMMATRIX result;
+		for (int i = 0; i < 16; ++i)
+		{
+			result.r[i / 4].v[i % 4] = c[i] / det;
+		}
+		return result;
+	}
+
+	inline XMVECTOR XMMatrixDeterminant(const XMMATRIX& m)
+	{
+		XMVECTOR determinant;
+		XMMatrixInverse(&determinant, m);
+		return determinant;
+	}
+}
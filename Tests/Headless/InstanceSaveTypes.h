@@ -0,0 +1,46 @@
+//////////////////////////////////////////////////////////////////////////
+// InstanceSaveTypes.h
+// Stands in for the game's InstanceSaveTypes in headless builds. A few
+// instance types and item slots are enough for the engine sources built
+// for the tests, which only need the enumerations' ranges
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+
+enum InstanceType
+{
+	INSTANCE_TYPE_BEGIN = 0,
+	TREE = INSTANCE_TYPE_BEGIN,
+	ROCK,
+	HUMAN,
+	WOLF,
+	INSTANCE_TYPE_END
+};
+
+enum ItemSlot
+{
+	ITEM_SLOT_BEGIN = 0,
+	HEAD,
+	CHEST,
+	MAIN_HAND,
+	ITEM_SLOT_END
+};
+
+namespace InstanceSaveTypes
+{
+	inline ItemSlot StringToItemSlot(const std::wstring& slot)
+	{
+		const wchar_t* names[] = { L"head", L"chest", L"mainhand" };
+		for (int i = 0; i < ITEM_SLOT_END - 1; ++i)
+		{
+			if (slot == names[i])
+			{
+				return static_cast<ItemSlot>(i + 1);
+			}
+		}
+		return ITEM_SLOT_END;
+	}
+}
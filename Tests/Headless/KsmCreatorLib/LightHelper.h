@@ -0,0 +1,18 @@
+//////////////////////////////////////////////////////////////////////////
+// LightHelper.h
+// Stands in for KsmCreatorLib's LightHelper in headless builds. Only the
+// Material render backends are handed with each mesh is needed
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <DirectXMath.h>
+
+struct Material
+{
+	DirectX::XMFLOAT4 Ambient;
+	DirectX::XMFLOAT4 Diffuse;
+	DirectX::XMFLOAT4 Specular;
+	DirectX::XMFLOAT4 Reflect;
+};
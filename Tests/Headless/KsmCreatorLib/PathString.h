@@ -0,0 +1,31 @@
+//////////////////////////////////////////////////////////////////////////
+// PathString.h
+// Stands in for KsmCreatorLib's PathString in headless builds. Narrows a
+// wide path one code unit at a time, which is all the tests' ASCII paths
+// need
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+
+class PathString
+{
+public:
+	PathString(const wchar_t* path)
+	{
+		while (*path)
+		{
+			_path += static_cast<char>(*path++);
+		}
+	}
+
+	const char* ToCStr() const
+	{
+		return _path.c_str();
+	}
+
+private:
+	std::string _path;
+};
@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////////
+// TinyUtilities.h
+// Stands in for the engine's tinyxml2 helpers in headless builds. There
+// is no XML parser: every document fails to load, so the sources built
+// for the tests link but only read the compiled forms of their data
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "InstanceSaveTypes.h"
+#include <string>
+
+namespace tinyxml2
+{
+	enum XMLError
+	{
+		XML_NO_ERROR = 0,
+		XML_ERROR_FILE_NOT_FOUND = 3
+	};
+
+	class XMLElement
+	{
+	public:
+		XMLElement* FirstChildElement(const char*)
+		{
+			return nullptr;
+		}
+
+		XMLElement* NextSiblingElement()
+		{
+			return nullptr;
+		}
+	};
+
+	class XMLDocument
+	{
+	public:
+		XMLError LoadFile(const char*)
+		{
+			return XML_ERROR_FILE_NOT_FOUND;
+		}
+
+		XMLElement* FirstChildElement(const char*)
+		{
+			return nullptr;
+		}
+	};
+}
+
+namespace TinyUtilities
+{
+	inline InstanceType GetInstanceTypeAttribute(const char*, tinyxml2::XMLElement*)
+	{
+		return INSTANCE_TYPE_END;
+	}
+
+	inline std::wstring GetStringAttribute(const char*, tinyxml2::XMLElement*)
+	{
+		return std::wstring();
+	}
+}
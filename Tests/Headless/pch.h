@@ -0,0 +1,51 @@
+//////////////////////////////////////////////////////////////////////////
+// pch.h
+// Stands in for the engine's precompiled header when engine sources are
+// built headless for the tests. Only what those sources use without
+// including it themselves belongs here: the Windows integer types, SAL
+// annotations and the debug macros, which abort so a test can't carry on
+// past a failed check
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef unsigned char byte;
+typedef unsigned int UINT;
+typedef long HRESULT;
+typedef unsigned long long ULONG64;
+
+#define _In_
+#define _In_opt_
+#define _In_z_
+#define _Out_
+#define _Out_opt_
+#define _Inout_
+#define _Inout_opt_
+
+#define S_OK ((HRESULT)0)
+#define E_FAIL ((HRESULT)0x80004005L)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+#define UNREFERENCED_PARAMETER(p) (void)(p)
+
+#define MUKASHIDEBUG_CRITICALERROR(...) \
+	do { fprintf(stderr, "%s(%d): critical error\n", __FILE__, __LINE__); abort(); } while (false)
+#define MUKASHIDEBUG_CRITICALERROR_ONFALSE(x) \
+	do { if (!(x)) { fprintf(stderr, "%s(%d): %s is false\n", __FILE__, __LINE__, #x); abort(); } } while (false)
+#define MUKASHIDEBUG_CRITICALERROR_ONTRUE(x) \
+	do { if (x) { fprintf(stderr, "%s(%d): %s is true\n", __FILE__, __LINE__, #x); abort(); } } while (false)
+#define MUKASHIDEBUG_CRITICALERROR_ONFAILED(hr) MUKASHIDEBUG_CRITICALERROR_ONFALSE(SUCCEEDED(hr))
@@ -0,0 +1,145 @@
+//////////////////////////////////////////////////////////////////////////
+// JobSystemTest.cpp
+// Checks that ParallelFor runs every element exactly once, hands each
+// thread index to one range at a time, runs everything on the calling
+// thread without workers, and that the tasks queued on a thread that is
+// stuck on a long one are stolen by the others
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestCheck.h"
+#include "../Engine/JobSystem.h"
+#include <chrono>
+#include <memory>
+
+using namespace Engine;
+using TestCheck::Check;
+
+namespace
+{
+	void checkEveryElementOnce(_In_ UINT workerCount)
+	{
+		JobSystem jobs(workerCount);
+		Check(jobs.GetWorkerCount() == workerCount && jobs.GetThreadCount() == workerCount + 1, "a thread per worker plus the caller");
+
+		const UINT count = 1000;
+		std::unique_ptr<std::atomic<UINT>[]> runs(new std::atomic<UINT>[count]);
+		std::unique_ptr<std::atomic<bool>[]> busy(new std::atomic<bool>[jobs.GetThreadCount()]);
+		std::atomic<bool> badRange(false);
+		std::atomic<bool> badThread(false);
+		std::atomic<bool> overlapped(false);
+
+		for (UINT grainSize : { 0U, 1U, 7U, 64U, 2000U })
+		{
+			for (UINT i = 0; i < count; ++i)
+			{
+				runs[i] = 0;
+			}
+			for (UINT thread = 0; thread < jobs.GetThreadCount(); ++thread)
+			{
+				busy[thread] = false;
+			}
+
+			jobs.ParallelFor(count, grainSize,
+				[&](UINT thread, UINT begin, UINT end)
+				{
+					if (thread >= jobs.GetThreadCount())
+					{
+						badThread = true;
+						return;
+					}
+					if (busy[thread].exchange(true))
+					{
+						overlapped = true;
+					}
+					if (begin >= end || end > count || end - begin > std::max(grainSize, 1U))
+					{
+						badRange = true;
+					}
+					for (UINT i = begin; i < end && i < count; ++i)
+					{
+						++runs[i];
+					}
+					busy[thread] = false;
+				});
+
+			bool once = true;
+			for (UINT i = 0; i < count; ++i)
+			{
+				once = once && runs[i] == 1;
+			}
+			Check(once, "every element run exactly once");
+		}
+
+		Check(!badRange, "ranges within the count and the grain size");
+		Check(!badThread, "thread indices below the thread count");
+		Check(!overlapped, "no two ranges at once on the same thread");
+
+		bool called = false;
+		jobs.ParallelFor(0, 1, [&called](UINT, UINT, UINT) { called = true; });
+		Check(!called, "nothing run for no elements");
+	}
+
+	void checkWithoutWorkers()
+	{
+		JobSystem jobs(0);
+
+		UINT ranges = 0;
+		bool otherThread = false;
+		std::thread::id caller = std::this_thread::get_id();
+		jobs.ParallelFor(10, 3,
+			[&](UINT thread, UINT, UINT)
+			{
+				++ranges;
+				otherThread = otherThread || thread != 0 || std::this_thread::get_id() != caller;
+			});
+
+		Check(ranges == 4 && !otherThread, "without workers every range runs on the calling thread as thread 0");
+	}
+
+	void checkStealing()
+	{
+		JobSystem jobs(3);
+		const UINT count = jobs.GetThreadCount() * 4;
+
+		//
+		// The first range to start holds its thread until every other range has run. The ranges still queued on
+		// that thread can only run if the other threads steal them
+		std::atomic<bool> holding(false);
+		std::atomic<UINT> finished(0);
+		std::atomic<bool> timedOut(false);
+
+		jobs.ParallelFor(count, 1,
+			[&](UINT, UINT, UINT)
+			{
+				if (!holding.exchange(true))
+				{
+					auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+					while (finished < count - 1)
+					{
+						if (std::chrono::steady_clock::now() > deadline)
+						{
+							timedOut = true;
+							break;
+						}
+						std::this_thread::yield();
+					}
+				}
+				++finished;
+			});
+
+		Check(!timedOut && finished == count, "ranges queued on a busy thread stolen by the others");
+	}
+}
+
+int main()
+{
+	checkEveryElementOnce(0);
+	checkEveryElementOnce(1);
+	checkEveryElementOnce(4);
+	checkWithoutWorkers();
+	checkStealing();
+
+	return TestCheck::Report("JobSystemTest");
+}
@@ -0,0 +1,187 @@
+//////////////////////////////////////////////////////////////////////////
+// KsmLoadBenchmark.cpp
+// Times loading a large KSM model the way the engine did before models
+// were memory-mapped (read into a heap block, then copied element by
+// element into per-mesh arrays) against mapping the file and handing the
+// data to the upload in place. Both paths finish by copying the index and
+// vertex data once, standing in for the buffer upload
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestModels.h"
+#include "../Engine/KsmWriter.h"
+#include "../Engine/MappedFile.h"
+#include <chrono>
+#include <fstream>
+
+using namespace Engine;
+
+namespace
+{
+	// Where the index and vertex data ends up, reused across passes like a driver's staging memory
+	struct Upload
+	{
+		std::vector<byte> Indices;
+		std::vector<byte> Vertices;
+		uint64_t Checksum;
+
+		void Add(
+			_In_ size_t mesh,
+			_In_ const void* indices,
+			_In_ size_t indexBytes,
+			_In_ const void* vertices,
+			_In_ size_t vertexBytes)
+		{
+			Indices.resize(indexBytes);
+			Vertices.resize(vertexBytes);
+			memcpy(Indices.data(), indices, indexBytes);
+			memcpy(Vertices.data(), vertices, vertexBytes);
+
+			Checksum = Checksum * 31 + mesh;
+			for (size_t i = 0; i < indexBytes; i += 64)
+			{
+				Checksum = Checksum * 31 + Indices[i];
+			}
+			for (size_t i = 0; i < vertexBytes; i += 64)
+			{
+				Checksum = Checksum * 31 + Vertices[i];
+			}
+		}
+	};
+
+	bool loadCopied(
+		_In_ const char* path,
+		_Inout_ Upload& upload)
+	{
+		std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		size_t size = (size_t)file.tellg();
+		std::unique_ptr<byte[]> memBlock(new byte[size]);
+		file.seekg(0, std::ios::beg);
+		file.read((char*)memBlock.get(), size);
+
+		KsmModelView model;
+		if (!KsmReader::Read(memBlock.get(), size, TestModels::Strides, model))
+		{
+			return false;
+		}
+
+		for (size_t m = 0; m < model.Meshes.size(); ++m)
+		{
+			const KsmMeshView& mesh = model.Meshes[m];
+
+			std::vector<uint16_t> indices;
+			for (UINT i = 0; i < mesh.IndexCount; ++i)
+			{
+				indices.push_back(static_cast<uint16_t>(mesh.GetIndex(i)));
+			}
+
+			std::vector<TestModels::StaticVertex> vertices;
+			std::vector<DirectX::XMFLOAT3> positions;
+			for (UINT v = 0; v < mesh.VertexCount; ++v)
+			{
+				TestModels::StaticVertex vertex;
+				memcpy(&vertex, mesh.Vertices + (size_t)v * mesh.VertexStride, sizeof(vertex));
+				vertices.push_back(vertex);
+				positions.push_back(vertex.Position);
+			}
+
+			upload.Add(m, indices.data(), indices.size() * sizeof(uint16_t), vertices.data(), vertices.size() * sizeof(TestModels::StaticVertex));
+		}
+		return true;
+	}
+
+	bool loadMapped(
+		_In_ const wchar_t* path,
+		_Inout_ Upload& upload)
+	{
+		MappedFile file;
+		if (!file.Open(path))
+		{
+			return false;
+		}
+
+		KsmModelView model;
+		if (!KsmReader::Read(file.GetData(), file.GetSize(), TestModels::Strides, model))
+		{
+			return false;
+		}
+
+		for (size_t m = 0; m < model.Meshes.size(); ++m)
+		{
+			const KsmMeshView& mesh = model.Meshes[m];
+			upload.Add(m, mesh.IndexData, (size_t)mesh.IndexCount * mesh.IndexSize, mesh.Vertices, (size_t)mesh.VertexCount * mesh.VertexStride);
+		}
+		return true;
+	}
+
+	template <typename F> double bestOf(int passes, F f)
+	{
+		double best = 1e30;
+		for (int pass = 0; pass < passes; ++pass)
+		{
+			auto start = std::chrono::steady_clock::now();
+			if (!f())
+			{
+				return -1.0;
+			}
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			best = (ms < best) ? ms : best;
+		}
+		return best;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int meshCount = (argc > 1) ? atoi(argv[1]) : 64;
+	UINT cells = (argc > 2) ? (UINT)atoi(argv[2]) : 128;
+	int passes = (argc > 3) ? atoi(argv[3]) : 5;
+
+	TestModels::Model model;
+	for (int m = 0; m < meshCount; ++m)
+	{
+		model.Meshes.push_back(TestModels::MakeGrid(cells));
+	}
+	TestModels::BuildView(model);
+
+	std::vector<byte> file;
+	KsmWriter::Write(model.View, file);
+
+	const char* path = "obj/KsmLoadBenchmark.ksm";
+	const wchar_t* widePath = L"obj/KsmLoadBenchmark.ksm";
+	FILE* out = fopen(path, "wb");
+	if (out == nullptr || fwrite(file.data(), 1, file.size(), out) != file.size())
+	{
+		printf("KsmLoadBenchmark: can't write %s\n", path);
+		return 1;
+	}
+	fclose(out);
+
+	Upload copied = {};
+	Upload mapped = {};
+	double copying = bestOf(passes, [&]() { return loadCopied(path, copied); });
+	double mapping = bestOf(passes, [&]() { return loadMapped(widePath, mapped); });
+	if (copying < 0.0 || mapping < 0.0)
+	{
+		printf("KsmLoadBenchmark: loading %s failed\n", path);
+		return 1;
+	}
+	if (copied.Checksum != mapped.Checksum)
+	{
+		printf("KsmLoadBenchmark: mapped and copied loads uploaded different data\n");
+		return 1;
+	}
+
+	remove(path);
+
+	printf("%d meshes of %u vertices, %.1f MB file\n", meshCount, (cells + 1) * (cells + 1), file.size() / (1024.0 * 1024.0));
+	printf("read and copy: %.1f ms\n", copying);
+	printf("map in place:  %.1f ms (%.1fx faster)\n", mapping, copying / mapping);
+	return 0;
+}
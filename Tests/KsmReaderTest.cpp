@@ -0,0 +1,162 @@
+//////////////////////////////////////////////////////////////////////////
+// KsmReaderTest.cpp
+// Writes generated models with KsmWriter and checks that KsmReader reads
+// them back, and that it rejects files whose node mesh ranges, mesh
+// counts, indices or levels of detail the loader couldn't trust
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestModels.h"
+#include "TestCheck.h"
+#include "../Engine/KsmWriter.h"
+
+using namespace Engine;
+using TestCheck::Check;
+
+namespace
+{
+	// Three small meshes, the first under the root node and the other two under its child
+	TestModels::Model makeModel()
+	{
+		TestModels::Model model;
+		model.Meshes.push_back(TestModels::MakeGrid(2));
+		model.Meshes.push_back(TestModels::MakeGrid(3));
+		model.Meshes.push_back(TestModels::MakeSphere(4, 6));
+		TestModels::BuildView(model);
+
+		KsmNodeView child = model.View.Nodes[0];
+		child.Name = L"child";
+		child.Parent = 0;
+		child.FirstMesh = 1;
+		child.MeshCount = 2;
+		model.View.Nodes[0].MeshCount = 1;
+		model.View.Nodes.push_back(child);
+		return model;
+	}
+
+	// Gives the sphere a level of detail of every other triangle of it, kept in indices
+	void addLod(
+		_Inout_ TestModels::Model& model,
+		_Out_ std::vector<UINT>& indices)
+	{
+		const std::vector<UINT>& sphere = model.Meshes[2].Indices;
+		indices.clear();
+		for (size_t i = 0; i < sphere.size(); i += 6)
+		{
+			indices.insert(indices.end(), sphere.begin() + i, sphere.begin() + i + 3);
+		}
+
+		KsmLodView lod;
+		lod.IndexCount = static_cast<UINT>(indices.size());
+		lod.IndexData = reinterpret_cast<byte*>(indices.data());
+		lod.Error = 0.25f;
+		model.View.Meshes[2].Lods.push_back(lod);
+	}
+
+	bool writeAndRead(
+		_In_ const KsmModelView& view,
+		_Out_ std::vector<byte>& file,
+		_Out_ KsmModelView& read)
+	{
+		KsmWriter::Write(view, file);
+		return KsmReader::Read(file.data(), file.size(), TestModels::Strides, read);
+	}
+
+	void checkRoundTrip()
+	{
+		TestModels::Model model = makeModel();
+		std::vector<byte> file;
+		KsmModelView read;
+		Check(writeAndRead(model.View, file, read), "written model reads back");
+		Check(read.NumMeshes == 3 && read.Meshes.size() == 3 && read.Nodes.size() == 2, "mesh and node counts survive");
+		Check(read.Nodes[1].FirstMesh == 1 && read.Nodes[1].MeshCount == 2, "node mesh range survives");
+
+		bool same = true;
+		for (size_t m = 0; m < read.Meshes.size(); ++m)
+		{
+			const TestModels::Mesh& mesh = model.Meshes[m];
+			same = same && read.Meshes[m].IndexCount == mesh.Indices.size() && read.Meshes[m].VertexCount == mesh.Vertices.size();
+			for (UINT i = 0; same && i < read.Meshes[m].IndexCount; ++i)
+			{
+				same = read.Meshes[m].GetIndex(i) == mesh.Indices[i];
+			}
+		}
+		Check(same, "indices survive");
+
+		std::vector<UINT> lodIndices;
+		addLod(model, lodIndices);
+		Check(writeAndRead(model.View, file, read), "model with a level of detail reads back");
+
+		const KsmMeshView& sphere = read.Meshes[2];
+		same = read.Meshes[0].Lods.empty() && sphere.Lods.size() == 1 &&
+			sphere.Lods[0].IndexCount == lodIndices.size() && sphere.Lods[0].Error == 0.25f;
+		for (UINT i = 0; same && i < sphere.Lods[0].IndexCount; ++i)
+		{
+			same = sphere.GetLodIndex(0, i) == lodIndices[i];
+		}
+		Check(same, "level of detail survives");
+
+		// Every truncation of the file is refused rather than read past its end
+		bool truncatedRefused = true;
+		for (size_t size = 0; size < file.size(); size += 7)
+		{
+			std::vector<byte> truncated(file.begin(), file.begin() + size);
+			KsmModelView partial;
+			truncatedRefused = truncatedRefused && !KsmReader::Read(truncated.data(), truncated.size(), TestModels::Strides, partial);
+		}
+		Check(truncatedRefused, "truncated files refused");
+	}
+
+	void checkRefused(
+		_In_ const KsmModelView& view,
+		_In_ const char* what)
+	{
+		std::vector<byte> file;
+		KsmModelView read;
+		Check(!writeAndRead(view, file, read), what);
+	}
+
+	void checkMalformed()
+	{
+		TestModels::Model model = makeModel();
+		model.View.Nodes[1].MeshCount = 3;
+		checkRefused(model.View, "node mesh range past the last mesh refused");
+
+		model = makeModel();
+		model.View.Nodes[1].FirstMesh = 0;
+		checkRefused(model.View, "overlapping node mesh ranges refused");
+
+		model = makeModel();
+		model.View.Nodes[1].MeshCount = 1;
+		checkRefused(model.View, "mesh without a node refused");
+
+		model = makeModel();
+		model.View.NumMeshes = 2;
+		checkRefused(model.View, "mesh count not matching the meshes refused");
+
+		model = makeModel();
+		model.Meshes[2].Indices[5] = static_cast<UINT>(model.Meshes[2].Vertices.size());
+		TestModels::BuildView(model);
+		checkRefused(model.View, "index past the last vertex refused");
+
+		std::vector<UINT> lodIndices;
+		model = makeModel();
+		addLod(model, lodIndices);
+		lodIndices[4] = static_cast<UINT>(model.Meshes[2].Vertices.size());
+		checkRefused(model.View, "level of detail index past the last vertex refused");
+
+		model = makeModel();
+		addLod(model, lodIndices);
+		model.View.Meshes[2].Lods[0].IndexCount -= 1;
+		checkRefused(model.View, "level of detail with a partial triangle refused");
+	}
+}
+
+int main()
+{
+	checkRoundTrip();
+	checkMalformed();
+
+	return TestCheck::Report("KsmReaderTest");
+}
@@ -0,0 +1,292 @@
+//////////////////////////////////////////////////////////////////////////
+// MeshBvhTest.cpp
+// Checks MeshBvh's ray queries against testing every triangle, on random
+// triangle soups with random, aimed and axis-parallel rays, including
+// rays that lie exactly on the planes of the hierarchy's boxes. Then
+// times both on a large grid
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestModels.h"
+#include "TestCheck.h"
+#include "../Engine/MeshBvh.h"
+#include <cfloat>
+#include <chrono>
+#include <random>
+#include <set>
+
+using namespace DirectX;
+using namespace Engine;
+using TestCheck::Check;
+
+namespace
+{
+	XMFLOAT3 subtract(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	XMFLOAT3 cross(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+	}
+
+	float dot(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x * b.x + a.y * b.y + a.z * b.z;
+	}
+
+	struct Soup
+	{
+		std::vector<XMFLOAT3> Positions;
+		std::vector<UINT> Indices;
+	};
+
+	// Every triangle hit at a distance between 0 and maxT, with the same arithmetic as MeshBvh's leaf test
+	std::map<UINT, float> bruteForce(
+		_In_ const Soup& soup,
+		_In_ const MeshBvhRay& ray)
+	{
+		std::map<UINT, float> hits;
+		for (UINT triangle = 0; triangle < soup.Indices.size() / 3; ++triangle)
+		{
+			const XMFLOAT3& v0 = soup.Positions[soup.Indices[triangle * 3]];
+			XMFLOAT3 edge1 = subtract(soup.Positions[soup.Indices[triangle * 3 + 1]], v0);
+			XMFLOAT3 edge2 = subtract(soup.Positions[soup.Indices[triangle * 3 + 2]], v0);
+
+			XMFLOAT3 p = cross(ray.Direction, edge2);
+			float determinant = dot(edge1, p);
+			if (determinant == 0.0f)
+			{
+				continue;
+			}
+
+			float inverseDeterminant = 1.0f / determinant;
+			XMFLOAT3 s = subtract(ray.Origin, v0);
+			XMFLOAT3 q = cross(s, edge1);
+			float u = dot(s, p) * inverseDeterminant;
+			float v = dot(ray.Direction, q) * inverseDeterminant;
+			float t = dot(edge2, q) * inverseDeterminant;
+			if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t >= 0.0f && t <= ray.MaxT)
+			{
+				hits[triangle] = t;
+			}
+		}
+		return hits;
+	}
+
+	// Compares every query of the hierarchy with testing every triangle. Returns false on the first difference
+	bool matchesBruteForce(
+		_In_ const Soup& soup,
+		_In_ const MeshBvh& bvh,
+		_In_ const std::vector<MeshBvhRay>& rays)
+	{
+		std::unique_ptr<bool[]> batched(new bool[rays.size()]);
+		bvh.IntersectAny(rays.data(), static_cast<UINT>(rays.size()), batched.get());
+
+		for (size_t r = 0; r < rays.size(); ++r)
+		{
+			const MeshBvhRay& ray = rays[r];
+			std::map<UINT, float> expected = bruteForce(soup, ray);
+
+			std::vector<MeshBvhHit> hits;
+			bvh.IntersectAll(ray.Origin, ray.Direction, ray.MaxT, hits);
+			std::set<UINT> found;
+			for (const auto& hit : hits)
+			{
+				found.insert(hit.Triangle);
+			}
+
+			std::set<UINT> expectedTriangles;
+			float nearest = FLT_MAX;
+			for (const auto& hit : expected)
+			{
+				expectedTriangles.insert(hit.first);
+				nearest = std::min(nearest, hit.second);
+			}
+
+			MeshBvhHit nearestHit;
+			bool anyNearest = bvh.IntersectNearest(ray.Origin, ray.Direction, ray.MaxT, nearestHit);
+
+			if (found != expectedTriangles ||
+				found.size() != hits.size() ||
+				bvh.IntersectAny(ray.Origin, ray.Direction, ray.MaxT) != !expected.empty() ||
+				batched[r] != !expected.empty() ||
+				anyNearest != !expected.empty() ||
+				(anyNearest && nearestHit.T != nearest))
+			{
+				printf("ray %zu from (%g, %g, %g) along (%g, %g, %g): %zu hits, expected %zu, any %d, batched %d, nearest %d\n", r,
+					ray.Origin.x, ray.Origin.y, ray.Origin.z, ray.Direction.x, ray.Direction.y, ray.Direction.z, found.size(), expected.size(), (int)bvh.IntersectAny(ray.Origin, ray.Direction, ray.MaxT), (int)batched[r], (int)anyNearest);
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void checkRandomSoups()
+	{
+		std::mt19937 random(37);
+		std::uniform_real_distribution<float> coordinate(-10.0f, 10.0f);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		int rayCount = 0;
+		int hitCount = 0;
+		bool matches = true;
+		for (int m = 0; m < 50 && matches; ++m)
+		{
+			// Half of the soups sit on a half unit lattice so rays and box faces share planes exactly
+			bool lattice = (m % 2) == 0;
+			auto place = [&](float value) { return lattice ? std::floor(value * 2.0f) * 0.5f : value; };
+
+			Soup soup;
+			UINT triangleCount = 1 + random() % 3000;
+			for (UINT t = 0; t < triangleCount; ++t)
+			{
+				XMFLOAT3 center(coordinate(random), coordinate(random), coordinate(random));
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					soup.Positions.push_back(XMFLOAT3(place(center.x + unit(random) * 2.0f), place(center.y + unit(random) * 2.0f), place(center.z + unit(random) * 2.0f)));
+					soup.Indices.push_back(static_cast<UINT>(soup.Positions.size() - 1));
+				}
+			}
+
+			MeshBvh bvh;
+			bvh.Build(soup.Positions, soup.Indices);
+
+			std::vector<MeshBvhRay> rays;
+			for (int r = 0; r < 200; ++r)
+			{
+				MeshBvhRay ray;
+				ray.MaxT = (r % 5 == 0) ? FLT_MAX : 5.0f + 40.0f * std::abs(unit(random));
+
+				switch (r % 3)
+				{
+				case 0:
+					// Anywhere, in any direction
+					ray.Origin = XMFLOAT3(coordinate(random) * 1.5f, coordinate(random) * 1.5f, coordinate(random) * 1.5f);
+					ray.Direction = XMFLOAT3(unit(random), unit(random), unit(random));
+					break;
+				case 1:
+				{
+					// Along an axis, either way, from a point whose other coordinates are taken from vertices so the
+					// ray runs exactly along the planes the boxes are bounded by
+					const XMFLOAT3& a = soup.Positions[random() % soup.Positions.size()];
+					const XMFLOAT3& b = soup.Positions[random() % soup.Positions.size()];
+					UINT axis = random() % 3;
+					float sign = (random() % 2) ? 1.0f : -1.0f;
+					ray.Origin = XMFLOAT3(a.x, b.y, a.z);
+					(&ray.Origin.x)[axis] = -15.0f * sign;
+					ray.Direction = XMFLOAT3((random() % 2) ? 0.0f : -0.0f, (random() % 2) ? 0.0f : -0.0f, (random() % 2) ? 0.0f : -0.0f);
+					(&ray.Direction.x)[axis] = sign;
+					break;
+				}
+				default:
+				{
+					// At a vertex of a random triangle
+					const XMFLOAT3& target = soup.Positions[random() % soup.Positions.size()];
+					ray.Origin = XMFLOAT3(coordinate(random) * 1.5f, coordinate(random) * 1.5f, coordinate(random) * 1.5f);
+					ray.Direction = subtract(target, ray.Origin);
+					ray.MaxT = (r % 5 == 0) ? FLT_MAX : 2.0f;
+					break;
+				}
+				}
+				rays.push_back(ray);
+			}
+
+			matches = matchesBruteForce(soup, bvh, rays);
+			rayCount += static_cast<int>(rays.size());
+			for (const auto& ray : rays)
+			{
+				hitCount += bruteForce(soup, ray).empty() ? 0 : 1;
+			}
+		}
+
+		Check(matches, "hierarchy finds the same hits as testing every triangle");
+		Check(hitCount > rayCount / 10, "enough rays hit something to make the comparison meaningful");
+	}
+
+	// A ray that runs along the face of the root box and hits the edge lying in that face
+	void checkRayOnBoxFace()
+	{
+		Soup soup;
+		soup.Positions.push_back(XMFLOAT3(0.0f, -1.0f, 5.0f));
+		soup.Positions.push_back(XMFLOAT3(0.0f, 1.0f, 5.0f));
+		soup.Positions.push_back(XMFLOAT3(2.0f, 0.0f, 5.0f));
+		soup.Indices = { 0, 1, 2 };
+
+		MeshBvh bvh;
+		bvh.Build(soup.Positions, soup.Indices);
+
+		MeshBvhRay positiveZero = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), 10.0f };
+		MeshBvhRay negativeZero = { XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(-0.0f, 0.0f, 1.0f), 10.0f };
+		Check(!bruteForce(soup, positiveZero).empty(), "ray along the box face hits the edge");
+		Check(bvh.IntersectAny(positiveZero.Origin, positiveZero.Direction, positiveZero.MaxT), "ray along the box face enters the box");
+		Check(bvh.IntersectAny(negativeZero.Origin, negativeZero.Direction, negativeZero.MaxT), "ray along the box face with a negative zero enters the box");
+
+		// The same through the batched query's four-ray box test, next to a parallel ray beside the box that
+		// nothing but its origin keeps out
+		MeshBvhRay beside = { XMFLOAT3(-1.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f), INFINITY };
+		MeshBvhRay rays[] = { positiveZero, negativeZero, beside };
+		bool batched[3];
+		bvh.IntersectAny(rays, 3, batched);
+		Check(batched[0] && batched[1] && !batched[2], "batched rays along the box face enter the box");
+	}
+
+	void timeGrid()
+	{
+		TestModels::Mesh grid = TestModels::MakeGrid(200);
+		Soup soup;
+		for (const auto& vertex : grid.Vertices)
+		{
+			soup.Positions.push_back(vertex.Position);
+		}
+		soup.Indices = grid.Indices;
+
+		auto start = std::chrono::steady_clock::now();
+		MeshBvh bvh;
+		bvh.Build(soup.Positions, soup.Indices);
+		double building = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::mt19937 random(38);
+		std::uniform_real_distribution<float> position(0.0f, 200.0f);
+		std::vector<MeshBvhRay> rays(10000);
+		for (auto& ray : rays)
+		{
+			ray.Origin = XMFLOAT3(position(random), 10.0f, position(random));
+			ray.Direction = XMFLOAT3(position(random) - ray.Origin.x, -10.0f, position(random) - ray.Origin.z);
+			ray.MaxT = 2.0f;
+		}
+
+		start = std::chrono::steady_clock::now();
+		int hits = 0;
+		for (const auto& ray : rays)
+		{
+			MeshBvhHit hit;
+			hits += bvh.IntersectNearest(ray.Origin, ray.Direction, ray.MaxT, hit) ? 1 : 0;
+		}
+		double nearest = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		// Every triangle is tested for one ray in a hundred, which is plenty to compare with
+		start = std::chrono::steady_clock::now();
+		int bruteHits = 0;
+		for (size_t r = 0; r < rays.size(); r += 100)
+		{
+			bruteHits += bruteForce(soup, rays[r]).empty() ? 0 : 1;
+		}
+		double brute = 100.0 * std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		Check(hits == static_cast<int>(rays.size()), "every ray at the grid hits it");
+		printf("%zu triangles: built in %.1f ms, %zu nearest hit rays in %.1f ms (testing every triangle: about %.0f ms)\n",
+			soup.Indices.size() / 3, building, rays.size(), nearest, brute);
+	}
+}
+
+int main()
+{
+	checkRayOnBoxFace();
+	checkRandomSoups();
+	timeGrid();
+
+	return TestCheck::Report("MeshBvhTest");
+}
@@ -0,0 +1,179 @@
+//////////////////////////////////////////////////////////////////////////
+// MeshOptimizerTest.cpp
+// Shuffles the triangles of a 200x200 grid and runs MeshOptimizer over
+// it, with 32 and 16 bit indices. Checks that the vertex cache miss
+// ratio (ACMR) drops from the worst case to near the best, that the
+// triangles drawn are the same ones with the same winding and that
+// unused vertices are dropped. Given a path, also writes the shuffled
+// grid there as a KSM file for KsmOptimize to be run on
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestModels.h"
+#include "TestCheck.h"
+#include "../Engine/KsmWriter.h"
+#include "../Engine/MeshOptimizer.h"
+#include <array>
+#include <chrono>
+#include <random>
+
+using namespace DirectX;
+using namespace Engine;
+using TestCheck::Check;
+
+namespace
+{
+	// The positions of a triangle's corners, starting from the smallest so the same triangle with the same
+	// winding always gives the same key however its indices are rotated
+	typedef std::array<float, 9> TriangleKey;
+
+	TriangleKey triangleKey(
+		_In_ const TestModels::StaticVertex* vertices,
+		_In_ UINT a,
+		_In_ UINT b,
+		_In_ UINT c)
+	{
+		const XMFLOAT3& p = vertices[a].Position;
+		const XMFLOAT3& q = vertices[b].Position;
+		const XMFLOAT3& r = vertices[c].Position;
+		TriangleKey rotations[3] =
+		{
+			{ { p.x, p.y, p.z, q.x, q.y, q.z, r.x, r.y, r.z } },
+			{ { q.x, q.y, q.z, r.x, r.y, r.z, p.x, p.y, p.z } },
+			{ { r.x, r.y, r.z, p.x, p.y, p.z, q.x, q.y, q.z } },
+		};
+		return *std::min_element(rotations, rotations + 3);
+	}
+
+	std::vector<TriangleKey> triangleKeys(_In_ const KsmMeshView& mesh)
+	{
+		const TestModels::StaticVertex* vertices = reinterpret_cast<const TestModels::StaticVertex*>(mesh.Vertices);
+		std::vector<TriangleKey> keys;
+		for (UINT i = 0; i + 2 < mesh.IndexCount; i += 3)
+		{
+			keys.push_back(triangleKey(vertices, mesh.GetIndex(i), mesh.GetIndex(i + 1), mesh.GetIndex(i + 2)));
+		}
+		std::sort(keys.begin(), keys.end());
+		return keys;
+	}
+
+	bool indicesInRange(_In_ const KsmMeshView& mesh)
+	{
+		for (UINT i = 0; i < mesh.IndexCount; ++i)
+		{
+			if (mesh.GetIndex(i) >= mesh.VertexCount)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	//
+	// A 200x200 grid over a few hills, its triangles in random order, with one vertex no triangle uses
+	//
+	TestModels::Model makeShuffledGrid()
+	{
+		TestModels::Model model;
+		model.Meshes.push_back(TestModels::MakeGrid(200));
+		TestModels::Mesh& grid = model.Meshes[0];
+		for (auto& vertex : grid.Vertices)
+		{
+			vertex.Position.y = std::sin(vertex.Position.x * 0.1f) * std::cos(vertex.Position.z * 0.1f) * 4.0f;
+		}
+		TestModels::StaticVertex unused = { XMFLOAT3(-5.0f, -5.0f, -5.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT2(0.0f, 0.0f) };
+		grid.Vertices.push_back(unused);
+
+		std::vector<std::array<UINT, 3>> triangles;
+		for (size_t i = 0; i < grid.Indices.size(); i += 3)
+		{
+			triangles.push_back({ { grid.Indices[i], grid.Indices[i + 1], grid.Indices[i + 2] } });
+		}
+		std::mt19937 random(49);
+		std::shuffle(triangles.begin(), triangles.end(), random);
+		grid.Indices.clear();
+		for (const auto& triangle : triangles)
+		{
+			grid.Indices.insert(grid.Indices.end(), triangle.begin(), triangle.end());
+		}
+
+		TestModels::BuildView(model);
+		return model;
+	}
+
+	void checkAcmr()
+	{
+		std::vector<UINT> triangle = { 0, 1, 2 };
+		Check(MeshOptimizer::ComputeAcmr(triangle, 3, 16) == 3.0f, "lone triangle transforms all three vertices");
+		std::vector<UINT> quad = { 0, 1, 2, 2, 1, 3 };
+		Check(MeshOptimizer::ComputeAcmr(quad, 4, 16) == 2.0f, "quad transforms its four vertices once");
+		Check(MeshOptimizer::ComputeAcmr(quad, 4, 1) == 2.5f, "one entry cache transforms the shared vertex it lost again");
+	}
+
+	void checkShuffledGrid(_In_ bool sixteenBit)
+	{
+		TestModels::Model model = makeShuffledGrid();
+		KsmMeshView& mesh = model.View.Meshes[0];
+
+		// 16 bit indices as KsmReader would hand them over from a file
+		std::vector<uint16_t> shortIndices(model.Meshes[0].Indices.begin(), model.Meshes[0].Indices.end());
+		if (sixteenBit)
+		{
+			mesh.IndexSize = sizeof(uint16_t);
+			mesh.IndexData = reinterpret_cast<byte*>(shortIndices.data());
+		}
+
+		std::vector<TriangleKey> before = triangleKeys(mesh);
+		UINT vertexCount = mesh.VertexCount;
+
+		MeshOptimizationSettings settings;
+		std::vector<OptimizedMesh> optimized;
+		auto start = std::chrono::steady_clock::now();
+		MeshOptimizer::OptimizeModel(model.View, settings, optimized);
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		const MeshOptimizationStats& stats = optimized[0].Stats;
+		Check(stats.AcmrBefore > 2.5f, "shuffled grid misses the cache on nearly every vertex");
+		Check(stats.AcmrAfter < 0.8f, "optimized grid close to the 0.5 best case");
+		Check(stats.AtvrAfter < 1.5f, "optimized grid transforms few vertices more than once");
+		Check(stats.UnusedVertices == 1 && mesh.VertexCount == vertexCount - 1, "unused vertex dropped");
+		Check(mesh.IndexData == optimized[0].Indices.data() && mesh.Vertices == optimized[0].Vertices.data(), "view points at the optimized data");
+		Check(mesh.IndexSize == (sixteenBit ? sizeof(uint16_t) : sizeof(UINT)), "indices kept their size");
+		Check(indicesInRange(mesh), "indices within the renumbered vertices");
+		Check(triangleKeys(mesh) == before, "same triangles with the same winding");
+
+		printf("%zu triangles, %s indices: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, overdraw order %s, %.1f ms\n",
+			before.size(), sixteenBit ? "16 bit" : "32 bit", stats.AcmrBefore, stats.AcmrAfter, stats.AtvrBefore, stats.AtvrAfter,
+			stats.OverdrawOrderKept ? "kept" : "dropped", ms);
+	}
+
+	bool writeShuffledGrid(_In_ const char* path)
+	{
+		TestModels::Model model = makeShuffledGrid();
+		std::vector<byte> file;
+		KsmWriter::Write(model.View, file);
+
+		FILE* out = fopen(path, "wb");
+		bool written = out != nullptr && fwrite(file.data(), 1, file.size(), out) == file.size();
+		if (out != nullptr)
+		{
+			fclose(out);
+		}
+		return written;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	checkAcmr();
+	checkShuffledGrid(false);
+	checkShuffledGrid(true);
+
+	if (argc > 1)
+	{
+		Check(writeShuffledGrid(argv[1]), "shuffled grid written");
+	}
+
+	return TestCheck::Report("MeshOptimizerTest");
+}
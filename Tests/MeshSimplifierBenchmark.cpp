@@ -0,0 +1,190 @@
+//////////////////////////////////////////////////////////////////////////
+// MeshSimplifierBenchmark.cpp
+// Times MeshSimplifier building a level of detail chain for a 65536
+// triangle sphere and measures each level: how many triangles it kept,
+// the error the simplifier reported, how far its surface strays from the
+// sphere and whether any triangle was flipped. Also checks the chain
+// survives a KSM write and read unchanged
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestModels.h"
+#include "../Engine/KsmWriter.h"
+#include "../Engine/MeshSimplifier.h"
+#include <chrono>
+#include <cmath>
+
+using namespace DirectX;
+using namespace Engine;
+
+namespace
+{
+	XMFLOAT3 subtract(
+		_In_ const XMFLOAT3& a,
+		_In_ const XMFLOAT3& b)
+	{
+		return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z);
+	}
+
+	// Twice the triangle's area along its normal, pointing out of the front face
+	XMFLOAT3 faceNormal(
+		_In_ const XMFLOAT3& a,
+		_In_ const XMFLOAT3& b,
+		_In_ const XMFLOAT3& c)
+	{
+		XMFLOAT3 u = subtract(b, a);
+		XMFLOAT3 v = subtract(c, a);
+		return XMFLOAT3(u.y * v.z - u.z * v.y, u.z * v.x - u.x * v.z, u.x * v.y - u.y * v.x);
+	}
+
+	float length(_In_ const XMFLOAT3& v)
+	{
+		return std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+	}
+
+	//
+	// What a level of detail of the unit sphere looks like
+	//
+	struct LevelQuality
+	{
+		// Triangles facing the other way from the sphere's own, which all face the same way. Slivers with
+		// no area to speak of aren't counted
+		UINT Flipped;
+
+		// Furthest any sampled point of a triangle is from the sphere's surface
+		float Deviation;
+
+		bool IndicesInRange;
+	};
+
+	LevelQuality measureLevel(
+		_In_ const KsmMeshView& mesh,
+		_In_ UINT lod,
+		_In_ const std::vector<TestModels::StaticVertex>& vertices,
+		_In_ float facing)
+	{
+		LevelQuality quality = { 0, 0.0f, true };
+		for (UINT i = 0; i + 2 < mesh.Lods[lod].IndexCount; i += 3)
+		{
+			UINT corners[3] = { mesh.GetLodIndex(lod, i), mesh.GetLodIndex(lod, i + 1), mesh.GetLodIndex(lod, i + 2) };
+			if (corners[0] >= vertices.size() || corners[1] >= vertices.size() || corners[2] >= vertices.size())
+			{
+				quality.IndicesInRange = false;
+				return quality;
+			}
+
+			const XMFLOAT3& a = vertices[corners[0]].Position;
+			const XMFLOAT3& b = vertices[corners[1]].Position;
+			const XMFLOAT3& c = vertices[corners[2]].Position;
+			XMFLOAT3 normal = faceNormal(a, b, c);
+			XMFLOAT3 center((a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f, (a.z + b.z + c.z) / 3.0f);
+			float outward = normal.x * center.x + normal.y * center.y + normal.z * center.z;
+
+			// The poles are rings of vertices at (nearly) one point, whose slivers face any way at all
+			bool sliver = length(normal) < 1e-6f;
+			quality.Flipped += (!sliver && outward * facing < 0.0f) ? 1 : 0;
+
+			// The corners sit on the sphere, so the surface strays furthest inside the triangle
+			XMFLOAT3 samples[4] =
+			{
+				center,
+				XMFLOAT3((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f),
+				XMFLOAT3((b.x + c.x) * 0.5f, (b.y + c.y) * 0.5f, (b.z + c.z) * 0.5f),
+				XMFLOAT3((c.x + a.x) * 0.5f, (c.y + a.y) * 0.5f, (c.z + a.z) * 0.5f),
+			};
+			for (const XMFLOAT3& sample : samples)
+			{
+				quality.Deviation = std::max(quality.Deviation, std::abs(1.0f - length(sample)));
+			}
+		}
+		return quality;
+	}
+
+	// Which way the full resolution sphere's triangles face, +1 outward or -1 inward
+	float sphereFacing(_In_ const TestModels::Mesh& sphere)
+	{
+		float facing = 0.0f;
+		for (size_t i = 0; i < sphere.Indices.size(); i += 3)
+		{
+			const XMFLOAT3& a = sphere.Vertices[sphere.Indices[i]].Position;
+			XMFLOAT3 normal = faceNormal(a, sphere.Vertices[sphere.Indices[i + 1]].Position, sphere.Vertices[sphere.Indices[i + 2]].Position);
+			facing += normal.x * a.x + normal.y * a.y + normal.z * a.z;
+		}
+		return (facing < 0.0f) ? -1.0f : 1.0f;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	UINT rings = (argc > 1) ? (UINT)atoi(argv[1]) : 128;
+	UINT segments = (argc > 2) ? (UINT)atoi(argv[2]) : 256;
+	int passes = (argc > 3) ? atoi(argv[3]) : 3;
+
+	TestModels::Model model;
+	model.Meshes.push_back(TestModels::MakeSphere(rings, segments));
+	const TestModels::Mesh& sphere = model.Meshes[0];
+	float facing = sphereFacing(sphere);
+
+	LodChainSettings settings;
+	settings.MaxLevels = 4;
+
+	// Each pass starts over from the full resolution mesh, keeping the chain of the fastest
+	std::vector<MeshLodChain> lods;
+	double best = 1e30;
+	for (int pass = 0; pass < passes; ++pass)
+	{
+		TestModels::BuildView(model);
+		auto start = std::chrono::steady_clock::now();
+		MeshSimplifier::GenerateLods(model.View, settings, lods);
+		best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	const KsmMeshView& mesh = model.View.Meshes[0];
+	printf("%zu triangles, %zu levels built in %.1f ms\n", sphere.Indices.size() / 3, mesh.Lods.size(), best);
+	if (mesh.Lods.empty())
+	{
+		printf("MeshSimplifierBenchmark: no levels of detail built\n");
+		return 1;
+	}
+
+	UINT previousIndexCount = mesh.IndexCount;
+	for (UINT l = 0; l < mesh.Lods.size(); ++l)
+	{
+		LevelQuality quality = measureLevel(mesh, l, sphere.Vertices, facing);
+		printf("level %u: %u triangles, error %.4f, %u flipped, surface within %.4f of the radius\n",
+			l + 1, mesh.Lods[l].IndexCount / 3, mesh.Lods[l].Error, quality.Flipped, quality.Deviation);
+
+		if (!quality.IndicesInRange || mesh.Lods[l].IndexCount % 3 != 0 || mesh.Lods[l].IndexCount >= previousIndexCount)
+		{
+			printf("MeshSimplifierBenchmark: level %u isn't a smaller triangle list of the sphere's vertices\n", l + 1);
+			return 1;
+		}
+		if (quality.Flipped > 0 || quality.Deviation > settings.MaxError)
+		{
+			printf("MeshSimplifierBenchmark: level %u flipped triangles or strayed from the sphere\n", l + 1);
+			return 1;
+		}
+		previousIndexCount = mesh.Lods[l].IndexCount;
+	}
+
+	std::vector<byte> file;
+	KsmWriter::Write(model.View, file);
+	KsmModelView read;
+	bool same = KsmReader::Read(file.data(), file.size(), TestModels::Strides, read) && read.Meshes[0].Lods.size() == mesh.Lods.size();
+	for (UINT l = 0; same && l < mesh.Lods.size(); ++l)
+	{
+		same = read.Meshes[0].Lods[l].IndexCount == mesh.Lods[l].IndexCount && read.Meshes[0].Lods[l].Error == mesh.Lods[l].Error;
+		for (UINT i = 0; same && i < mesh.Lods[l].IndexCount; ++i)
+		{
+			same = read.Meshes[0].GetLodIndex(l, i) == mesh.GetLodIndex(l, i);
+		}
+	}
+	if (!same)
+	{
+		printf("MeshSimplifierBenchmark: levels of detail changed through a KSM write and read\n");
+		return 1;
+	}
+
+	return 0;
+}
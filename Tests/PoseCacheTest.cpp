@@ -0,0 +1,123 @@
+//////////////////////////////////////////////////////////////////////////
+// PoseCacheTest.cpp
+// Checks that PoseCache evaluates a pose once per model, clip and
+// quantized sample and hands the same pose to every later request for
+// it, that Reserve leaves evaluating it to the caller, and that EndFrame
+// only drops the poses nobody asked for during the frame
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestCheck.h"
+#include "../Engine/PoseCache.h"
+
+using namespace DirectX;
+using namespace Engine;
+using TestCheck::Check;
+
+namespace
+{
+	// The cache only tells models apart by their addresses, so any distinct addresses will do
+	int modelStorage[2];
+	const PoseEvaluator* const ModelA = reinterpret_cast<const PoseEvaluator*>(&modelStorage[0]);
+	const PoseEvaluator* const ModelB = reinterpret_cast<const PoseEvaluator*>(&modelStorage[1]);
+
+	//
+	// Counts evaluations and leaves the time evaluated at in the pose
+	//
+	struct CountingEvaluator
+	{
+		CountingEvaluator()
+			: Evaluations(0)
+		{}
+
+		PoseCache::Evaluator Get()
+		{
+			return [this](float time, CredibleModelPose& pose)
+			{
+				++Evaluations;
+				XMFLOAT4X4 transform = {};
+				transform.m[0][0] = time;
+				pose.GlobalTransforms.assign(1, transform);
+			};
+		}
+
+		int Evaluations;
+	};
+
+	float poseTime(_In_ const CredibleModelPose& pose)
+	{
+		return pose.GlobalTransforms[0].m[0][0];
+	}
+
+	void checkHitsAndMisses()
+	{
+		PoseCache cache(10.0f);
+		CountingEvaluator counter;
+		PoseCache::Evaluator evaluate = counter.Get();
+
+		const CredibleModelPose& first = cache.Acquire(ModelA, 0, 0.57f, evaluate);
+		Check(counter.Evaluations == 1 && poseTime(first) == 0.5f, "miss evaluated at the start of its sample");
+
+		const CredibleModelPose& same = cache.Acquire(ModelA, 0, 0.52f, evaluate);
+		Check(counter.Evaluations == 1 && &same == &first, "request within the same sample shares the pose");
+
+		cache.Acquire(ModelA, 0, 0.6f, evaluate);
+		cache.Acquire(ModelA, 1, 0.57f, evaluate);
+		cache.Acquire(ModelB, 0, 0.57f, evaluate);
+		Check(counter.Evaluations == 4, "other samples, clips and models are evaluated separately");
+
+		const CredibleModelPose& negative = cache.Acquire(ModelB, 0, -0.01f, evaluate);
+		Check(counter.Evaluations == 5 && poseTime(negative) == -0.1f, "negative times round down to their sample");
+
+		PoseCacheStats stats = cache.GetStats();
+		Check(stats.PoseCount == 5 && stats.Hits == 1 && stats.Misses == 5, "hits and misses counted");
+
+		cache.ResetCounters();
+		stats = cache.GetStats();
+		Check(stats.PoseCount == 5 && stats.Hits == 0 && stats.Misses == 0, "counters reset, poses kept");
+
+		// Reserve leaves the evaluating to the caller
+		float sampleTime;
+		bool missed;
+		CredibleModelPose& reserved = cache.Reserve(ModelA, 2, 0.57f, sampleTime, missed);
+		Check(missed && sampleTime == 0.5f && reserved.GlobalTransforms.empty(), "reserved miss left empty for the caller");
+		Check(&cache.Reserve(ModelA, 2, 0.55f, sampleTime, missed) == &reserved && !missed && sampleTime == 0.5f, "reserved pose shared");
+		Check(&cache.Acquire(ModelA, 2, 0.51f, evaluate) == &reserved && counter.Evaluations == 5, "reserved pose not evaluated by Acquire");
+	}
+
+	void checkEndFrame()
+	{
+		PoseCache cache(10.0f);
+		CountingEvaluator counter;
+		PoseCache::Evaluator evaluate = counter.Get();
+
+		const CredibleModelPose* kept = &cache.Acquire(ModelA, 0, 1.0f, evaluate);
+		cache.Acquire(ModelA, 1, 1.0f, evaluate);
+		cache.Acquire(ModelB, 0, 1.0f, evaluate);
+		cache.EndFrame();
+		Check(cache.GetStats().PoseCount == 3, "poses asked for during the frame survive its end");
+
+		// Only one of them is asked for during the next frame
+		Check(&cache.Acquire(ModelA, 0, 1.0f, evaluate) == kept && counter.Evaluations == 3, "pose kept across frames");
+		cache.EndFrame();
+		Check(cache.GetStats().PoseCount == 1, "poses nobody asked for dropped");
+		Check(&cache.Acquire(ModelA, 0, 1.0f, evaluate) == kept, "requested pose still the same");
+
+		cache.Acquire(ModelA, 1, 1.0f, evaluate);
+		Check(counter.Evaluations == 4, "dropped pose evaluated again");
+
+		cache.Clear();
+		Check(cache.GetStats().PoseCount == 0, "clear drops every pose");
+		cache.Acquire(ModelA, 0, 1.0f, evaluate);
+		Check(counter.Evaluations == 5, "pose evaluated again after clear");
+	}
+}
+
+int main()
+{
+	checkHitsAndMisses();
+	checkEndFrame();
+
+	return TestCheck::Report("PoseCacheTest");
+}
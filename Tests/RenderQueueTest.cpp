@@ -0,0 +1,324 @@
+//////////////////////////////////////////////////////////////////////////
+// RenderQueueTest.cpp
+// Records scenes into a RenderQueue and submits them to the null backend.
+// Checks that every recorded draw is issued once with its own state, that
+// only changes of state reach the backend and that runs of the same
+// geometry are drawn instanced. Also checks that the backend's texture
+// and geometry ids survive models being evicted and loaded again without
+// growing, then times recording and submitting a frame
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestCheck.h"
+#include "../Engine/NullRenderBackend.h"
+#include "../KsmCreatorLib/LightHelper.h"
+#include <chrono>
+#include <tuple>
+
+using namespace DirectX;
+using namespace Engine;
+using TestCheck::Check;
+
+namespace
+{
+	// Shader, texture, geometry, index count and the x translation of the world transform
+	typedef std::tuple<UINT, UINT, UINT, UINT, float> Draw;
+
+	//
+	// The null backend, also keeping every draw with the state it was issued with
+	//
+	class LoggingBackend : public NullRenderBackend
+	{
+	public:
+
+		LoggingBackend()
+			: _shader(0), _texture(0), _geometry(0), _x(0.0f), _instancedShaderOffset(0)
+		{}
+
+		// Instanced draws are logged under the shader they were recorded with, this far below the bound one
+		void SetInstancedShaderOffset(_In_ UINT offset)
+		{
+			_instancedShaderOffset = offset;
+		}
+
+		void BindShader(_In_ UINT shader) override
+		{
+			NullRenderBackend::BindShader(shader);
+			_shader = shader;
+		}
+
+		void BindTexture(_In_ UINT texture) override
+		{
+			NullRenderBackend::BindTexture(texture);
+			_texture = texture;
+		}
+
+		void BindGeometry(_In_ UINT geometry) override
+		{
+			NullRenderBackend::BindGeometry(geometry);
+			_geometry = geometry;
+		}
+
+		void SetTransform(_In_ const RenderTransform& transform) override
+		{
+			NullRenderBackend::SetTransform(transform);
+			// Transposed for the shaders, so the translation is in the last column
+			_x = transform.World.m[0][3];
+		}
+
+		void DrawIndexed(_In_ UINT indexCount) override
+		{
+			NullRenderBackend::DrawIndexed(indexCount);
+			Draws.push_back(Draw(_shader, _texture, _geometry, indexCount, _x));
+		}
+
+		void DrawIndexedInstanced(
+			_In_ UINT indexCount,
+			_In_ const RenderTransform* transforms,
+			_In_ UINT instanceCount) override
+		{
+			NullRenderBackend::DrawIndexedInstanced(indexCount, transforms, instanceCount);
+			for (UINT i = 0; i < instanceCount; ++i)
+			{
+				Draws.push_back(Draw(_shader - _instancedShaderOffset, _texture, _geometry, indexCount, transforms[i].World.m[0][3]));
+			}
+		}
+
+		std::vector<Draw> Draws;
+
+	private:
+
+		UINT _shader;
+		UINT _texture;
+		UINT _geometry;
+		float _x;
+		UINT _instancedShaderOffset;
+	};
+
+	ID3D11ShaderResourceView* fakeTexture(_In_ UINT n)
+	{
+		return reinterpret_cast<ID3D11ShaderResourceView*>(static_cast<uintptr_t>(0x1000 + n * 16));
+	}
+
+	ID3D11Buffer* fakeBuffer(_In_ UINT n)
+	{
+		return reinterpret_cast<ID3D11Buffer*>(static_cast<uintptr_t>(0x100000 + n * 16));
+	}
+
+	//
+	// What a model keeps of what it added to a backend: the geometry of each mesh and its levels of detail
+	// and the mesh's texture. Removes them again when it goes away, as CredibleModelData does
+	//
+	struct Model
+	{
+		Model(
+			_Inout_ RenderBackend& backend,
+			_In_ UINT meshCount,
+			_In_ UINT lodCount,
+			_In_ UINT firstTexture)
+			: Backend(backend)
+		{
+			Material material = {};
+			for (UINT m = 0; m < meshCount; ++m)
+			{
+				Geometry.push_back(backend.AddGeometry(fakeBuffer(m), 32, fakeBuffer(m + 1000), 2, material));
+				for (UINT l = 1; l < lodCount; ++l)
+				{
+					Geometry.push_back(backend.AddGeometry(fakeBuffer(m), 32, fakeBuffer(m + 1000 * (l + 1)), 2, material));
+				}
+				Textures.push_back(backend.AddTexture((m % 3 == 2) ? nullptr : fakeTexture(firstTexture + m % 4)));
+			}
+		}
+
+		~Model()
+		{
+			for (UINT geometry : Geometry)
+			{
+				Backend.RemoveGeometry(geometry);
+			}
+			for (UINT texture : Textures)
+			{
+				Backend.RemoveTexture(texture);
+			}
+		}
+
+		RenderBackend& Backend;
+		std::vector<UINT> Geometry;
+		std::vector<UINT> Textures;
+	};
+
+	//
+	// Records instanceCount instances, spread over the models, each with a transform of its own. Some of them
+	// skinned. Returns the draws the queue was asked for
+	//
+	std::vector<Draw> recordScene(
+		_Inout_ RenderQueue& queue,
+		_In_ const std::vector<std::unique_ptr<Model>>& models,
+		_In_ UINT instanceCount,
+		_In_ const std::vector<XMFLOAT4X4>& palette)
+	{
+		std::vector<Draw> recorded;
+		for (UINT i = 0; i < instanceCount; ++i)
+		{
+			const Model& model = *models[i % models.size()];
+
+			XMFLOAT4X4 world = {};
+			world.m[0][0] = world.m[1][1] = world.m[2][2] = world.m[3][3] = 1.0f;
+			world.m[3][0] = static_cast<float>(i);
+			UINT transform = queue.AddTransform(world);
+
+			UINT shader = (i % 5 == 0) ? 1 : 0;
+			for (size_t m = 0; m < model.Textures.size(); ++m)
+			{
+				UINT geometry = model.Geometry[m * (model.Geometry.size() / model.Textures.size())];
+				UINT indexCount = 36 + static_cast<UINT>(m);
+				bool skinned = shader == 1 && m == 0;
+				queue.Add(shader, model.Textures[m], geometry, indexCount, transform, skinned ? palette.data() : nullptr, skinned ? 20 : 0);
+				recorded.push_back(Draw(shader, model.Textures[m], geometry, indexCount, static_cast<float>(i)));
+			}
+		}
+		return recorded;
+	}
+
+	std::vector<std::unique_ptr<Model>> makeModels(
+		_Inout_ RenderBackend& backend,
+		_In_ UINT count)
+	{
+		std::vector<std::unique_ptr<Model>> models;
+		for (UINT m = 0; m < count; ++m)
+		{
+			models.emplace_back(new Model(backend, 1 + m % 3, 3, m % 7));
+		}
+		return models;
+	}
+
+	void checkSubmit(_In_ bool instanced)
+	{
+		LoggingBackend backend;
+		std::vector<std::unique_ptr<Model>> models = makeModels(backend, 50);
+		std::vector<XMFLOAT4X4> palette(20);
+
+		RenderQueue queue;
+		if (instanced)
+		{
+			queue.SetInstancedShader(0, 10);
+			queue.SetInstancedShader(1, 11);
+			backend.SetInstancedShaderOffset(10);
+		}
+
+		std::vector<Draw> recorded = recordScene(queue, models, 3000, palette);
+		queue.Submit(backend);
+		const RenderQueueStats& stats = queue.GetStats();
+
+		std::vector<Draw> issued = backend.Draws;
+		std::sort(recorded.begin(), recorded.end());
+		std::sort(issued.begin(), issued.end());
+		Check(recorded == issued, "every recorded draw issued once with its own state");
+		Check(stats.Packets == recorded.size() && queue.GetPacketCount() == 0, "submit takes every packet and clears the queue");
+
+		// Sorting by state leaves one change of texture or geometry per distinct combination at most
+		std::vector<std::tuple<UINT, UINT, UINT>> states;
+		for (const auto& draw : recorded)
+		{
+			states.push_back(std::make_tuple(std::get<0>(draw), std::get<1>(draw), std::get<2>(draw)));
+		}
+		std::sort(states.begin(), states.end());
+		size_t distinctStates = std::unique(states.begin(), states.end()) - states.begin();
+		Check(stats.GeometryChanges <= distinctStates && stats.TextureChanges <= distinctStates, "state only changes between distinct combinations");
+		Check(backend.GetStats().GeometryBinds == stats.GeometryChanges, "backend only told about changes");
+
+		if (instanced)
+		{
+			Check(stats.InstancedDraws > 0 && stats.InstancedPackets > stats.Packets / 2, "runs of unskinned geometry drawn instanced");
+			Check(backend.GetStats().Draws < stats.Packets / 4, "instancing cuts the draws");
+		}
+		else
+		{
+			Check(stats.InstancedDraws == 0 && backend.GetStats().Draws == stats.Packets, "no instancing without instanced shaders");
+		}
+	}
+
+	void checkRegistry()
+	{
+		NullRenderBackend backend;
+		Material material = {};
+
+		UINT first = backend.AddTexture(fakeTexture(1));
+		Check(backend.AddTexture(fakeTexture(1)) == first, "texture added again gets the same id");
+		Check(backend.AddTexture(nullptr) == 0, "null texture is id 0");
+		backend.RemoveTexture(first);
+		Check(backend.GetTextureCount() == 1, "texture kept while referenced");
+		backend.BindTexture(first);
+		backend.RemoveTexture(first);
+		Check(backend.GetTextureCount() == 0, "texture dropped with its last reference");
+		Check(backend.AddTexture(fakeTexture(2)) == first, "removed texture id reused");
+
+		UINT geometry = backend.AddGeometry(fakeBuffer(0), 32, fakeBuffer(1), 4, material);
+		backend.RemoveGeometry(geometry);
+		Check(backend.AddGeometry(fakeBuffer(2), 32, fakeBuffer(3), 2, material) == geometry, "removed geometry id reused");
+
+		// Models evicted and loaded again, as the model cache does, never need more ids than are loaded at once
+		NullRenderBackend cycled;
+		std::vector<std::unique_ptr<Model>> models = makeModels(cycled, 50);
+		UINT geometryCount = cycled.GetGeometryCount();
+		UINT textureCount = cycled.GetTextureCount();
+		UINT largestId = 0;
+		for (int cycle = 0; cycle < 100; ++cycle)
+		{
+			size_t evicted = cycle % models.size();
+			UINT meshCount = static_cast<UINT>(models[evicted]->Textures.size());
+			models[evicted].reset();
+			models[evicted].reset(new Model(cycled, meshCount, 3, static_cast<UINT>(evicted % 7)));
+			for (UINT id : models[evicted]->Geometry)
+			{
+				largestId = std::max(largestId, id);
+			}
+		}
+		Check(cycled.GetGeometryCount() == geometryCount && cycled.GetTextureCount() == textureCount, "reloading models leaves as many resources added");
+		Check(largestId < geometryCount, "reloaded models reuse the ids of evicted ones");
+
+		models.clear();
+		Check(cycled.GetGeometryCount() == 0 && cycled.GetTextureCount() == 0, "every resource removed with its models");
+	}
+
+	void timeFrames()
+	{
+		NullRenderBackend backend;
+		std::vector<std::unique_ptr<Model>> models = makeModels(backend, 50);
+		std::vector<XMFLOAT4X4> palette(20);
+
+		for (int instanced = 0; instanced < 2; ++instanced)
+		{
+			RenderQueue queue;
+			if (instanced)
+			{
+				queue.SetInstancedShader(0, 10);
+			}
+
+			const int Frames = 200;
+			backend.ResetCounters();
+			auto start = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < Frames; ++frame)
+			{
+				recordScene(queue, models, 3000, palette);
+				queue.Submit(backend);
+			}
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / Frames;
+
+			printf("%u packets, %s: %.3f ms per frame recorded and submitted, %u draws, %u texture and %u geometry changes\n",
+				queue.GetStats().Packets, instanced ? "instanced" : "not instanced", ms, backend.GetStats().Draws / Frames,
+				queue.GetStats().TextureChanges, queue.GetStats().GeometryChanges);
+		}
+	}
+}
+
+int main()
+{
+	checkSubmit(false);
+	checkSubmit(true);
+	checkRegistry();
+	timeFrames();
+
+	return TestCheck::Report("RenderQueueTest");
+}
@@ -0,0 +1,195 @@
+//////////////////////////////////////////////////////////////////////////
+// ResidencyCacheTest.cpp
+// Checks ResidencyCache with small values: that the least recently
+// released entries are evicted first, that pinned and referenced entries
+// stay, that finding an unreferenced entry takes it off the eviction
+// list, that a smaller budget and Clear evict what they should, and that
+// evicting a model releases the textures it held so they go too
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestCheck.h"
+#include "../Engine/ResidencyCache.h"
+#include <string>
+
+using namespace Engine;
+using TestCheck::Check;
+
+namespace
+{
+	// Keys of the values destroyed so far, in order
+	std::vector<int> destroyed;
+
+	//
+	// A cached value that records its key when it is destroyed, so evictions can be followed without
+	// looking entries up, which would change their place on the eviction list
+	//
+	struct LoggedValue
+	{
+		explicit LoggedValue(_In_ int key)
+			: Key(key)
+		{}
+
+		~LoggedValue()
+		{
+			destroyed.push_back(Key);
+		}
+
+		int Key;
+	};
+
+	typedef ResidencyCache<int, std::unique_ptr<LoggedValue>> LoggedCache;
+
+	LoggedCache::Handle insert(
+		_Inout_ LoggedCache& cache,
+		_In_ int key,
+		_In_ size_t bytes)
+	{
+		return cache.Insert(key, std::unique_ptr<LoggedValue>(new LoggedValue(key)), bytes);
+	}
+
+	void checkLeastRecentlyReleasedFirst()
+	{
+		destroyed.clear();
+		LoggedCache cache(30);
+		LoggedCache::Handle first = insert(cache, 1, 10);
+		LoggedCache::Handle second = insert(cache, 2, 10);
+		LoggedCache::Handle third = insert(cache, 3, 10);
+		Check(cache.GetStats().ResidentBytes == 30 && cache.GetStats().ReferencedCount == 3, "referenced entries resident");
+
+		second.Reset();
+		first.Reset();
+		third.Reset();
+		Check(destroyed.empty() && cache.GetStats().ReferencedCount == 0, "released entries stay within the budget");
+
+		insert(cache, 4, 10);
+		Check(destroyed == std::vector<int>({ 2 }), "least recently released evicted first");
+		insert(cache, 5, 10);
+		Check(destroyed == std::vector<int>({ 2, 1 }), "then the next least recently released");
+		Check(cache.GetStats().Evictions == 2 && cache.GetStats().EvictedBytes == 20, "evictions counted");
+	}
+
+	void checkReferencedAndPinnedStay()
+	{
+		destroyed.clear();
+		LoggedCache cache(10);
+		LoggedCache::Handle held = insert(cache, 1, 10);
+		LoggedCache::Handle pinned = insert(cache, 2, 10);
+		cache.Pin(pinned);
+		pinned.Reset();
+
+		// Over budget, but nothing can go
+		Check(destroyed.empty() && cache.GetStats().ResidentBytes == 20, "referenced and pinned entries never evicted");
+		Check(cache.GetStats().ReferencedBytes == 20, "pinned entry counts as referenced");
+
+		LoggedCache::Handle copy = held;
+		held.Reset();
+		Check(destroyed.empty(), "copy of a handle keeps the entry");
+		copy.Reset();
+		Check(destroyed == std::vector<int>({ 1 }), "entry evicted once its last handle goes");
+
+		cache.Clear(false);
+		Check(destroyed == std::vector<int>({ 1 }), "clear keeps pinned entries");
+		cache.Clear(true);
+		Check(destroyed == std::vector<int>({ 1, 2 }) && cache.GetStats().ResidentCount == 0, "clear with unpin evicts them");
+	}
+
+	void checkReacquire()
+	{
+		destroyed.clear();
+		LoggedCache cache(30);
+		insert(cache, 1, 10);
+		insert(cache, 2, 10);
+		insert(cache, 3, 10);
+
+		// Finding 1 takes it off the eviction list
+		LoggedCache::Handle found = cache.Find(1);
+		Check(found.IsValid() && found.Get()->Key == 1 && found.GetKey() == 1, "unreferenced entry found");
+		insert(cache, 4, 10);
+		Check(destroyed == std::vector<int>({ 2 }), "found entry not evicted while referenced");
+
+		// Releasing it again puts it behind the entries released before
+		found.Reset();
+		insert(cache, 5, 10);
+		Check(destroyed == std::vector<int>({ 2, 3 }), "re-released entry moves behind older ones");
+
+		// Inserting a resident key drops the new value and returns the resident one
+		LoggedCache::Handle again = cache.Insert(1, std::unique_ptr<LoggedValue>(new LoggedValue(-1)), 10);
+		Check(again.Get()->Key == 1 && destroyed.back() == -1 && cache.GetStats().ResidentCount == 3, "insert of a resident key keeps the resident value");
+
+		Check(cache.GetStats().Hits == 1 && cache.GetStats().Misses == 0, "lookups counted");
+		Check(!cache.Find(7).IsValid() && cache.GetStats().Misses == 1, "lookup of a missing key is a miss");
+	}
+
+	void checkSetBudget()
+	{
+		destroyed.clear();
+		LoggedCache cache(100);
+		for (int key = 1; key <= 10; ++key)
+		{
+			insert(cache, key, 10);
+		}
+		LoggedCache::Handle held = cache.Find(1);
+		Check(destroyed.empty() && cache.GetStats().PeakResidentBytes == 100, "budget filled");
+
+		cache.SetBudget(35);
+		Check(destroyed == std::vector<int>({ 2, 3, 4, 5, 6, 7, 8 }), "smaller budget evicts the least recently released");
+		Check(cache.GetStats().ResidentBytes == 30 && cache.GetStats().BudgetBytes == 35, "cache trimmed to fit the budget");
+
+		cache.ResetCounters();
+		ResidencyStats stats = cache.GetStats();
+		Check(stats.Evictions == 0 && stats.Hits == 0 && stats.PeakResidentBytes == 30, "counters reset to the current residency");
+	}
+
+	//
+	// A model holding handles to its textures, as meshes do
+	//
+	typedef ResidencyCache<std::wstring, byte> TextureCache;
+
+	struct Model
+	{
+		std::vector<TextureCache::Handle> Textures;
+	};
+
+	typedef ResidencyCache<int, std::unique_ptr<Model>> ModelCache;
+
+	void checkCascade()
+	{
+		TextureCache textures(0);
+		ModelCache models(25);
+
+		{
+			std::unique_ptr<Model> tree(new Model());
+			tree->Textures.push_back(textures.Insert(L"bark", 1, 4));
+			tree->Textures.push_back(textures.Insert(L"leaves", 1, 4));
+			std::unique_ptr<Model> rock(new Model());
+			rock->Textures.push_back(textures.Insert(L"stone", 1, 4));
+			rock->Textures.push_back(textures.Find(L"bark"));
+
+			models.Insert(1, std::move(tree), 10);
+			models.Insert(2, std::move(rock), 10);
+		}
+		Check(textures.GetStats().ResidentCount == 3, "textures kept by the models holding them");
+
+		// A third model puts the models over budget and evicts the tree, the least recently released
+		models.Insert(3, std::unique_ptr<Model>(new Model()), 10);
+		Check(!models.Find(1, false).IsValid() && models.Find(2, false).IsValid(), "model evicted");
+		Check(!textures.Find(L"leaves", false).IsValid(), "texture only the evicted model held evicted with it");
+		Check(textures.Find(L"bark", false).IsValid() && textures.Find(L"stone", false).IsValid(), "textures another model holds stay");
+
+		models.Clear();
+		Check(models.GetStats().ResidentCount == 0 && textures.GetStats().ResidentCount == 0, "clearing the models frees every texture");
+	}
+}
+
+int main()
+{
+	checkLeastRecentlyReleasedFirst();
+	checkReferencedAndPinnedStay();
+	checkReacquire();
+	checkSetBudget();
+	checkCascade();
+
+	return TestCheck::Report("ResidencyCacheTest");
+}
@@ -0,0 +1,202 @@
+//////////////////////////////////////////////////////////////////////////
+// SceneCullerTest.cpp
+// Fills a SceneCuller with 20000 instance boxes spread over a zone, then
+// removes, adds back and moves some so about 17000 are left, and checks
+// that culling against random camera frustums finds the same instances
+// as testing every box. Times both. Also built without the SSE box tests
+// (SCENECULLER_NO_SIMD)
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include "pch.h"
+#include "TestCheck.h"
+#include "../Engine/SceneCuller.h"
+#include <chrono>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+using namespace Engine;
+using TestCheck::Check;
+
+namespace
+{
+	void multiply(
+		_In_ const float a[4][4],
+		_In_ const float b[4][4],
+		_Out_ float result[4][4])
+	{
+		for (int row = 0; row < 4; ++row)
+		{
+			for (int column = 0; column < 4; ++column)
+			{
+				result[row][column] = 0.0f;
+				for (int k = 0; k < 4; ++k)
+				{
+					result[row][column] += a[row][k] * b[k][column];
+				}
+			}
+		}
+	}
+
+	// The (row vector, left handed) view projection of a camera at eye looking level along yaw
+	XMFLOAT4X4 viewProjection(
+		_In_ const XMFLOAT3& eye,
+		_In_ float yaw,
+		_In_ float fieldOfView,
+		_In_ float nearZ,
+		_In_ float farZ)
+	{
+		float forwardX = std::cos(yaw);
+		float forwardZ = std::sin(yaw);
+		float rightX = forwardZ;
+		float rightZ = -forwardX;
+
+		float view[4][4] =
+		{
+			{ rightX, 0.0f, forwardX, 0.0f },
+			{ 0.0f, 1.0f, 0.0f, 0.0f },
+			{ rightZ, 0.0f, forwardZ, 0.0f },
+			{ -(eye.x * rightX + eye.z * rightZ), -eye.y, -(eye.x * forwardX + eye.z * forwardZ), 1.0f },
+		};
+
+		float h = 1.0f / std::tan(fieldOfView * 0.5f);
+		float projection[4][4] =
+		{
+			{ h, 0.0f, 0.0f, 0.0f },
+			{ 0.0f, h, 0.0f, 0.0f },
+			{ 0.0f, 0.0f, farZ / (farZ - nearZ), 1.0f },
+			{ 0.0f, 0.0f, -nearZ * farZ / (farZ - nearZ), 0.0f },
+		};
+
+		XMFLOAT4X4 result;
+		multiply(view, projection, result.m);
+		return result;
+	}
+
+	struct Box
+	{
+		XMFLOAT3 Center;
+		XMFLOAT3 Extents;
+		bool Alive;
+	};
+
+	void checkAgainstEveryBox()
+	{
+		std::mt19937 random(47);
+		std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> size(0.5f, 10.0f);
+
+		SceneCuller culler;
+		std::vector<Box> boxes;
+		for (int i = 0; i < 20000; ++i)
+		{
+			Box box = { XMFLOAT3(position(random), position(random) * 0.05f, position(random)), XMFLOAT3(size(random), size(random), size(random)), true };
+			Check(culler.Add(box.Center, box.Extents) == boxes.size(), "ids handed out in order");
+			boxes.push_back(box);
+		}
+
+		// Remove some, add a few back into the freed ids and move others, so the tree is rebuilt
+		for (int i = 0; i < 3500; ++i)
+		{
+			UINT item = random() % boxes.size();
+			if (boxes[item].Alive)
+			{
+				culler.Remove(item);
+				boxes[item].Alive = false;
+			}
+		}
+		for (int i = 0; i < 500; ++i)
+		{
+			Box box = { XMFLOAT3(position(random), 0.0f, position(random)), XMFLOAT3(size(random), size(random), size(random)), true };
+			UINT item = culler.Add(box.Center, box.Extents);
+			Check(item < boxes.size() && !boxes[item].Alive, "removed ids reused");
+			boxes[item] = box;
+		}
+		for (int i = 0; i < 500; ++i)
+		{
+			UINT item = random() % boxes.size();
+			if (boxes[item].Alive)
+			{
+				boxes[item].Center.x += 3.0f;
+				culler.Move(item, boxes[item].Center, boxes[item].Extents);
+			}
+		}
+
+		std::vector<UINT> visible;
+		std::vector<UINT> expected;
+		int mismatches = 0;
+		size_t totalVisible = 0;
+		double culling = 0.0;
+		double testingEvery = 0.0;
+		const int Frames = 200;
+		for (int frame = 0; frame < Frames; ++frame)
+		{
+			CullingFrustum frustum = CullingFrustum::FromViewProjection(
+				viewProjection(XMFLOAT3(position(random), 5.0f, position(random)), position(random), 1.0f, 0.5f, 300.0f));
+
+			auto start = std::chrono::steady_clock::now();
+			culler.Cull(frustum, visible);
+			auto culled = std::chrono::steady_clock::now();
+
+			expected.clear();
+			for (UINT i = 0; i < boxes.size(); ++i)
+			{
+				if (boxes[i].Alive && frustum.Intersects(boxes[i].Center, boxes[i].Extents))
+				{
+					expected.push_back(i);
+				}
+			}
+			auto tested = std::chrono::steady_clock::now();
+
+			// The first Cull rebuilds the tree, which isn't what's being timed
+			if (frame > 0)
+			{
+				culling += std::chrono::duration<double, std::micro>(culled - start).count();
+				testingEvery += std::chrono::duration<double, std::micro>(tested - culled).count();
+			}
+
+			std::sort(visible.begin(), visible.end());
+			mismatches += (visible != expected) ? 1 : 0;
+			totalVisible += visible.size();
+		}
+
+		Check(mismatches == 0, "tree finds the same instances as testing every box");
+		Check(totalVisible > Frames * 100, "frustums see enough instances to make the comparison meaningful");
+		printf("%u instances, %zu visible on average: %.1f us culled with the tree, %.1f us testing every box (%.1fx)\n",
+			culler.GetItemCount(), totalVisible / Frames, culling / (Frames - 1), testingEvery / (Frames - 1), testingEvery / culling);
+	}
+
+	void checkFewInstances()
+	{
+		CullingFrustum frustum = CullingFrustum::FromViewProjection(viewProjection(XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f, 1.0f, 0.5f, 300.0f));
+		Check(frustum.Intersects(XMFLOAT3(50.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)), "box in front of the camera inside");
+		Check(!frustum.Intersects(XMFLOAT3(-50.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)), "box behind the camera outside");
+		Check(!frustum.Intersects(XMFLOAT3(400.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)), "box past the far plane outside");
+
+		SceneCuller culler;
+		std::vector<UINT> visible;
+		culler.Cull(frustum, visible);
+		Check(visible.empty(), "empty culler sees nothing");
+
+		UINT item = culler.Add(XMFLOAT3(50.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+		culler.Cull(frustum, visible);
+		Check(visible.size() == 1 && visible[0] == item, "single instance seen");
+
+		culler.Move(item, XMFLOAT3(-50.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f));
+		culler.Cull(frustum, visible);
+		Check(visible.empty(), "instance moved behind the camera no longer seen");
+
+		culler.Remove(item);
+		culler.Cull(frustum, visible);
+		Check(visible.empty() && culler.GetItemCount() == 0, "removed instance gone");
+	}
+}
+
+int main()
+{
+	checkFewInstances();
+	checkAgainstEveryBox();
+
+	return TestCheck::Report("SceneCullerTest");
+}
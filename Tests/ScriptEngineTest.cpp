@@ -0,0 +1,417 @@
+//////////////////////////////////////////////////////////////////////////
+// ScriptEngineTest.cpp
+// Builds and runs scripts through the script engine to check symbol
+// lookups across namespaces, registered types and functions, module
+// rebuilds, saved bytecode, configuration snapshots and module instances
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include <angelscript.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../Engine/AngelScript Addons/scriptmoduleinstance.h"
+#include "../Engine/AngelScript Addons/scriptstdstring.h"
+#include "TestCheck.h"
+
+using TestCheck::Check;
+
+namespace
+{
+	void messageCallback(const asSMessageInfo* msg, void*)
+	{
+		if (msg->type == asMSGTYPE_ERROR)
+		{
+			printf("%s (%d, %d): %s\n", msg->section, msg->row, msg->col, msg->message);
+		}
+	}
+
+	struct Vec2
+	{
+		float x;
+		float y;
+	};
+
+	void vec2Length2(asIScriptGeneric* gen)
+	{
+		Vec2* v = (Vec2*)gen->GetObject();
+		gen->SetReturnFloat(v->x * v->x + v->y * v->y);
+	}
+
+	void twice(asIScriptGeneric* gen)
+	{
+		gen->SetReturnDWord(gen->GetArgDWord(0) * 2);
+	}
+
+	void mathTwice(asIScriptGeneric* gen)
+	{
+		gen->SetReturnDWord(gen->GetArgDWord(0) * 20);
+	}
+
+	void returnNull(asIScriptGeneric* gen)
+	{
+		gen->SetReturnAddress(nullptr);
+	}
+
+	int counterProperty = 5;
+
+	class MemoryStream : public asIBinaryStream
+	{
+	public:
+		MemoryStream() : _read(0) {}
+
+		void Rewind() { _read = 0; }
+		const std::vector<char>& Data() const { return _data; }
+
+		void Write(const void* ptr, asUINT size) override
+		{
+			_data.insert(_data.end(), (const char*)ptr, (const char*)ptr + size);
+		}
+
+		void Read(void* ptr, asUINT size) override
+		{
+			memcpy(ptr, &_data[_read], size);
+			_read += size;
+		}
+
+	private:
+		std::vector<char> _data;
+		size_t _read;
+	};
+
+	const char* const Script =
+		"namespace Game { int counter = 3; int next() { return ++counter; } }\n"
+		"namespace Other { int counter = 100; }\n"
+		"int counter = 40;\n"
+		"class Actor { int hp; Actor() { hp = 7; } int damage(int d) { hp -= d; return hp; } }\n"
+		"int run()\n"
+		"{\n"
+		"  Actor a;\n"
+		"  Vec2 v; v.x = 3; v.y = 4;\n"
+		"  return Game::next() + Other::counter + counter + a.damage(2) + int(v.length2()) + twice(4) + Math::twice(1);\n"
+		"}\n";
+
+	int buildModule(asIScriptEngine* engine, const char* name, const char* code)
+	{
+		asIScriptModule* module = engine->GetModule(name, asGM_ALWAYS_CREATE);
+		module->AddScriptSection("script", code, strlen(code));
+		return module->Build();
+	}
+
+	int runStep(asIScriptEngine* engine, asIScriptFunction* func, int arg)
+	{
+		asIScriptContext* ctx = engine->CreateContext();
+		ctx->Prepare(func);
+		ctx->SetArgDWord(0, arg);
+		int r = ctx->Execute();
+		int value = (r == asEXECUTION_FINISHED) ? (int)ctx->GetReturnDWord() : -1;
+		ctx->Release();
+		return value;
+	}
+
+	int runInt(asIScriptEngine* engine, asIScriptFunction* func)
+	{
+		asIScriptContext* ctx = engine->CreateContext();
+		ctx->Prepare(func);
+		int r = ctx->Execute();
+		int value = (r == asEXECUTION_FINISHED) ? (int)ctx->GetReturnDWord() : -1;
+		ctx->Release();
+		return value;
+	}
+
+	// Registers the interface the scripts use. With a snapshot stream the declarations
+	// are restored from it where they still match, and the new snapshot is recorded
+	asIScriptEngine* createEngine(MemoryStream* snapshotIn = nullptr, MemoryStream* snapshotOut = nullptr, asQWORD fingerprint = 0, asUINT* parsed = nullptr, bool extraFunction = false)
+	{
+		asIScriptEngine* engine = asCreateScriptEngine(ANGELSCRIPT_VERSION);
+		engine->SetMessageCallback(asFUNCTION(messageCallback), 0, asCALL_CDECL);
+		if (snapshotOut)
+		{
+			Check(engine->BeginConfigSnapshot(snapshotIn, fingerprint) >= 0, "begin snapshot");
+		}
+
+		int r = engine->RegisterObjectType("Vec2", sizeof(Vec2), asOBJ_VALUE | asOBJ_POD | asOBJ_APP_PRIMITIVE);
+		Check(r >= 0, "register Vec2");
+		engine->RegisterObjectProperty("Vec2", "float x", asOFFSET(Vec2, x));
+		engine->RegisterObjectProperty("Vec2", "float y", asOFFSET(Vec2, y));
+		engine->RegisterObjectMethod("Vec2", "float length2() const", asFUNCTION(vec2Length2), asCALL_GENERIC);
+		engine->RegisterGlobalFunction("int twice(int)", asFUNCTION(twice), asCALL_GENERIC);
+		if (extraFunction)
+		{
+			engine->RegisterGlobalFunction("int thrice(int)", asFUNCTION(twice), asCALL_GENERIC);
+		}
+		engine->SetDefaultNamespace("Math");
+		engine->RegisterGlobalFunction("int twice(int)", asFUNCTION(mathTwice), asCALL_GENERIC);
+		engine->RegisterGlobalProperty("const int counter", &counterProperty);
+		engine->SetDefaultNamespace("");
+
+		// A template, its instances, funcdefs and default arguments all go through the snapshot
+		RegisterStdString(engine);
+		engine->RegisterObjectType("Box<class T>", 0, asOBJ_REF | asOBJ_NOCOUNT | asOBJ_TEMPLATE);
+		engine->RegisterObjectMethod("Box<T>", "const T &get() const", asFUNCTION(returnNull), asCALL_GENERIC);
+		engine->RegisterObjectMethod("Box<T>", "Box<T>@ self()", asFUNCTION(returnNull), asCALL_GENERIC);
+		engine->RegisterFuncdef("void Callback(const string &in, int)");
+		engine->RegisterGlobalFunction("Box<Vec2>@ boxOf(Callback@ cb, const string &in name = \"box\", int count = 3)", asFUNCTION(returnNull), asCALL_GENERIC);
+		engine->RegisterGlobalFunction("Box<Box<int>@>@ nested()", asFUNCTION(returnNull), asCALL_GENERIC);
+
+		if (snapshotOut)
+		{
+			Check(engine->EndConfigSnapshot(snapshotOut, parsed) >= 0, "end snapshot");
+		}
+		return engine;
+	}
+
+	// Everything the registered interface declares, to compare engines configured in different ways
+	std::string describeInterface(asIScriptEngine* engine)
+	{
+		std::string s;
+		for (asUINT n = 0; n < engine->GetGlobalFunctionCount(); ++n)
+		{
+			asIScriptFunction* func = engine->GetGlobalFunctionByIndex(n);
+			s += func->GetDeclaration(true, true);
+			s += "\n";
+		}
+		for (asUINT n = 0; n < engine->GetGlobalPropertyCount(); ++n)
+		{
+			const char* name;
+			const char* nameSpace;
+			int typeId;
+			bool isConst;
+			engine->GetGlobalPropertyByIndex(n, &name, &nameSpace, &typeId, &isConst);
+			s += std::string(nameSpace) + "::" + name + " " + engine->GetTypeDeclaration(typeId, true) + (isConst ? " const\n" : "\n");
+		}
+		for (asUINT n = 0; n < engine->GetObjectTypeCount(); ++n)
+		{
+			asIObjectType* type = engine->GetObjectTypeByIndex(n);
+			for (asUINT m = 0; m < type->GetMethodCount(); ++m)
+			{
+				s += type->GetMethodByIndex(m)->GetDeclaration(true, true);
+				s += "\n";
+			}
+			for (asUINT m = 0; m < type->GetBehaviourCount(); ++m)
+			{
+				asEBehaviours behaviour;
+				s += type->GetBehaviourByIndex(m, &behaviour)->GetDeclaration(true, true);
+				s += "\n";
+			}
+			for (asUINT m = 0; m < type->GetPropertyCount(); ++m)
+			{
+				s += type->GetPropertyDeclaration(m);
+				s += "\n";
+			}
+		}
+		return s;
+	}
+
+	void checkSnapshots()
+	{
+		// The first launch has nothing to restore and parses every declaration
+		MemoryStream first;
+		asUINT total = 0;
+		asIScriptEngine* recorded = createEngine(nullptr, &first, 42, &total);
+		Check(total > 10, "snapshot records the parsed declarations");
+		std::string expected = describeInterface(recorded);
+		recorded->Release();
+
+		// A launch with the same interface parses nothing, and ends up with the same
+		// interface and an identical snapshot
+		MemoryStream second;
+		asUINT parsed = 0;
+		asIScriptEngine* restored = createEngine(&first, &second, 42, &parsed);
+		Check(parsed == 0, "snapshot restores every declaration");
+		Check(describeInterface(restored) == expected, "restored interface matches the parsed one");
+		Check(second.Data() == first.Data(), "restored snapshot is saved unchanged");
+		Check(buildModule(restored, "main", Script) >= 0, "build with restored interface");
+		Check(runInt(restored, restored->GetModule("main")->GetFunctionByDecl("int run()")) == 202, "run with restored interface");
+		Check(buildModule(restored, "boxes", "int f() { Box<Vec2>@ b = boxOf(null); Box<Box<int>@>@ n = nested(); return b is null && n is null ? Math::counter : 0; }") >= 0, "build template use with restored interface");
+		Check(runInt(restored, restored->GetModule("boxes")->GetFunctionByDecl("int f()")) == 5, "run template use with restored interface");
+		restored->Release();
+
+		// Another fingerprint means another build of the application, so nothing is restored
+		first.Rewind();
+		MemoryStream third;
+		asIScriptEngine* stale = createEngine(&first, &third, 43, &parsed);
+		Check(parsed == total, "snapshot with another fingerprint is ignored");
+		Check(describeInterface(stale) == expected, "interface without a usable snapshot");
+		stale->Release();
+
+		// A changed interface restores what comes before the change and parses the rest
+		first.Rewind();
+		MemoryStream fourth;
+		asIScriptEngine* extended = createEngine(&first, &fourth, 42, &parsed, true);
+		Check(parsed > 1 && parsed < total, "changed interface restores up to the change");
+		Check(buildModule(extended, "main", Script) >= 0, "build with partly restored interface");
+		Check(runInt(extended, extended->GetModule("main")->GetFunctionByDecl("int run()")) == 202, "run with partly restored interface");
+		extended->Release();
+
+		// The snapshot saved after the change restores it completely
+		MemoryStream fifth;
+		asIScriptEngine* updated = createEngine(&fourth, &fifth, 42, &parsed, true);
+		Check(parsed == 0, "updated snapshot restores every declaration");
+		updated->Release();
+	}
+
+	// Instances of one module each keep their own globals, objects and handles included,
+	// and swap them in and out of the module without copying them
+	void checkModuleInstances()
+	{
+		const char* const InstanceScript =
+			"class Target { int hp; Target() { hp = 10; } }\n"
+			"int hits = 0;\n"
+			"string name = \"fresh\";\n"
+			"Target@ target;\n"
+			"int step(int n)\n"
+			"{\n"
+			"  hits += n; name += \"!\";\n"
+			"  if (target is null) @target = Target();\n"
+			"  target.hp -= 1;\n"
+			"  return hits * 1000 + name.length() * 10 + target.hp;\n"
+			"}\n";
+
+		asIScriptEngine* engine = createEngine();
+		Check(buildModule(engine, "instanced", InstanceScript) >= 0, "build instanced module");
+		asIScriptModule* module = engine->GetModule("instanced");
+		asIScriptFunction* step = module->GetFunctionByDecl("int step(int)");
+		int name = module->GetGlobalVarIndexByName("name");
+
+		CScriptModuleInstance* first = new CScriptModuleInstance(module);
+		CScriptModuleInstance* second = new CScriptModuleInstance(module);
+
+		Check(first->Activate() == asSUCCESS, "activate first instance");
+		Check(CScriptModuleInstance::GetActiveInstance(module) == first, "first instance is the active one");
+		void* firstName = module->GetAddressOfGlobalVar(name);
+		Check(runStep(engine, step, 1) == 1069, "first instance runs on fresh globals");
+		Check(second->Activate() == asCONTEXT_ACTIVE, "second instance refused while the first is active");
+		first->Deactivate();
+
+		Check(second->Activate() == asSUCCESS, "activate second instance");
+		Check(module->GetAddressOfGlobalVar(name) != firstName, "second instance has its own objects");
+		Check(runStep(engine, step, 2) == 2069, "second instance starts from fresh globals");
+		second->Deactivate();
+
+		Check(first->Activate() == asSUCCESS, "reactivate first instance");
+		Check(module->GetAddressOfGlobalVar(name) == firstName, "reactivation swaps the objects back without copying");
+		Check(runStep(engine, step, 1) == 2078, "first instance keeps its globals");
+
+		// Destroying the active instance hands the module its own fresh values back
+		delete first;
+		Check(CScriptModuleInstance::GetActiveInstance(module) == nullptr, "destroyed instance is no longer active");
+		Check(runStep(engine, step, 5) == 5069, "module keeps fresh globals of its own");
+
+		Check(second->Activate() == asSUCCESS, "activate second instance again");
+		Check(runStep(engine, step, 1) == 3078, "second instance keeps its globals");
+		delete second;
+
+		engine->Release();
+	}
+
+	void* handleGlobal(
+		asIScriptModule* module,
+		int index)
+	{
+		return *static_cast<void**>(module->GetAddressOfGlobalVar(index));
+	}
+
+	// A module whose globals were already changed by using it directly keeps them across instances, and
+	// handles initialized by their declaration get an object per instance rather than sharing the module's
+	void checkModuleStateWithInstances()
+	{
+		const char* const StateScript =
+			"class Target { int hp; Target() { hp = 10; } }\n"
+			"int hits = 0;\n"
+			"Target@ target = Target();\n"
+			"int step(int n)\n"
+			"{\n"
+			"  hits += n; target.hp -= n;\n"
+			"  return hits * 100 + target.hp;\n"
+			"}\n";
+
+		asIScriptEngine* engine = createEngine();
+		Check(buildModule(engine, "stateful", StateScript) >= 0, "build stateful module");
+		asIScriptModule* module = engine->GetModule("stateful");
+		asIScriptFunction* step = module->GetFunctionByDecl("int step(int)");
+		int target = module->GetGlobalVarIndexByName("target");
+
+		Check(runStep(engine, step, 3) == 307, "module used directly");
+		void* moduleTarget = handleGlobal(module, target);
+
+		CScriptModuleInstance* first = new CScriptModuleInstance(module);
+		CScriptModuleInstance* second = new CScriptModuleInstance(module);
+
+		Check(first->Activate() == asSUCCESS, "activate instance of a used module");
+		void* firstTarget = handleGlobal(module, target);
+		Check(firstTarget != nullptr && firstTarget != moduleTarget, "initialized handle gets the instance its own object");
+		Check(runStep(engine, step, 1) == 109, "instance starts from fresh globals, not the module's");
+		first->Deactivate();
+
+		Check(handleGlobal(module, target) == moduleTarget, "module gets its own object back");
+		Check(runStep(engine, step, 1) == 406, "module keeps its state, untouched by the instance");
+
+		Check(second->Activate() == asSUCCESS, "activate second instance of a used module");
+		Check(handleGlobal(module, target) != firstTarget && handleGlobal(module, target) != moduleTarget, "second instance's handle has an object of its own");
+		Check(runStep(engine, step, 2) == 208, "second instance starts from fresh globals");
+		second->Deactivate();
+
+		Check(first->Activate() == asSUCCESS, "reactivate instance of a used module");
+		Check(runStep(engine, step, 1) == 208, "instance keeps its own handle's object");
+		first->Deactivate();
+
+		Check(runStep(engine, step, 1) == 505, "module state survives every instance");
+		delete first;
+		delete second;
+		Check(runStep(engine, step, 1) == 604, "module state survives the instances being destroyed");
+
+		engine->Release();
+	}
+}
+
+int main()
+{
+	// The registered interface is found by name, and duplicates are refused. A refused
+	// registration invalidates the configuration, so this engine is thrown away
+	asIScriptEngine* engine = createEngine();
+	Check(engine->GetObjectTypeByName("Vec2") != nullptr, "registered type lookup");
+	Check(engine->GetObjectTypeByName("NoSuchType") == nullptr, "unknown type lookup");
+	engine->ClearMessageCallback();
+	Check(engine->RegisterObjectType("Vec2", sizeof(Vec2), asOBJ_VALUE | asOBJ_POD) == asALREADY_REGISTERED, "duplicate type refused");
+	Check(engine->RegisterGlobalFunction("int twice(int)", asFUNCTION(twice), asCALL_GENERIC) == asALREADY_REGISTERED, "duplicate function refused");
+	engine->Release();
+
+	engine = createEngine();
+
+	// 4 + 100 + 40 + 5 + 25 + 8 + 20
+	Check(buildModule(engine, "main", Script) >= 0, "build");
+	asIScriptModule* module = engine->GetModule("main");
+	Check(runInt(engine, module->GetFunctionByDecl("int run()")) == 202, "run");
+	Check(module->GetGlobalVarIndexByName("counter") >= 0, "global lookup");
+	Check(module->GetGlobalVarIndexByName("nothing") < 0, "unknown global lookup");
+	Check(module->GetFunctionByName("missing") == nullptr, "unknown function lookup");
+
+	// Names used only by a discarded module can still be looked up and built again
+	engine->ClearMessageCallback();
+	Check(buildModule(engine, "broken", "int f() { return undefinedName; }") < 0, "undeclared name refused");
+	engine->DiscardModule("broken");
+	engine->SetMessageCallback(asFUNCTION(messageCallback), 0, asCALL_CDECL);
+	Check(buildModule(engine, "again", "int undefinedName = 9; int f() { return undefinedName; }") >= 0, "rebuild");
+	Check(runInt(engine, engine->GetModule("again")->GetFunctionByDecl("int f()")) == 9, "rebuilt run");
+
+	// Saved bytecode loads into another engine and runs the same
+	MemoryStream stream;
+	Check(module->SaveByteCode(&stream) >= 0, "save bytecode");
+	asIScriptEngine* other = createEngine();
+	asIScriptModule* loaded = other->GetModule("loaded", asGM_ALWAYS_CREATE);
+	Check(loaded->LoadByteCode(&stream) >= 0, "load bytecode");
+	Check(runInt(other, loaded->GetFunctionByDecl("int run()")) == 202, "run loaded bytecode");
+	other->Release();
+
+	engine->Release();
+
+	checkSnapshots();
+	checkModuleInstances();
+	checkModuleStateWithInstances();
+
+	return TestCheck::Report("ScriptEngineTest");
+}
@@ -0,0 +1,46 @@
+//////////////////////////////////////////////////////////////////////////
+// TestCheck.h
+// The checks the headless tests make: each failed one is printed and
+// counted, and the test's exit code reports whether any failed
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdio>
+
+namespace TestCheck
+{
+	// How many checks have failed so far
+	inline int& Failures()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	inline void Check(
+		bool condition,
+		const char* what)
+	{
+		if (!condition)
+		{
+			printf("FAILED: %s\n", what);
+			++Failures();
+		}
+	}
+
+	//
+	// Prints whether the named test passed and returns its exit code, 1 if any check failed
+	//
+	inline int Report(const char* test)
+	{
+		if (Failures() > 0)
+		{
+			printf("%s: %d failures\n", test, Failures());
+			return 1;
+		}
+
+		printf("%s: passed\n", test);
+		return 0;
+	}
+}
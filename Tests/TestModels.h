@@ -0,0 +1,148 @@
+//////////////////////////////////////////////////////////////////////////
+// TestModels.h
+// Generated meshes for the headless tests and benchmarks, and a KSM model
+// view over them so they can go through the same code as loaded models
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "pch.h"
+#include "../Engine/KsmReader.h"
+#include <cmath>
+
+namespace TestModels
+{
+	// Layout of the engine's VertexPositionNormalTexture, which static KSM meshes store
+	struct StaticVertex
+	{
+		DirectX::XMFLOAT3 Position;
+		DirectX::XMFLOAT3 Normal;
+		DirectX::XMFLOAT2 TexCoord;
+	};
+
+	const Engine::KsmVertexStrides Strides = { sizeof(StaticVertex), 2 * sizeof(StaticVertex) };
+
+	struct Mesh
+	{
+		std::vector<StaticVertex> Vertices;
+		std::vector<UINT> Indices;
+	};
+
+	//
+	// A flat grid of cells x cells quads in the XZ plane, each split into two triangles, written
+	// row by row
+	//
+	inline Mesh MakeGrid(_In_ UINT cells)
+	{
+		Mesh mesh;
+		for (UINT z = 0; z <= cells; ++z)
+		{
+			for (UINT x = 0; x <= cells; ++x)
+			{
+				StaticVertex vertex = { DirectX::XMFLOAT3((float)x, 0.0f, (float)z), DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f), DirectX::XMFLOAT2((float)x / cells, (float)z / cells) };
+				mesh.Vertices.push_back(vertex);
+			}
+		}
+
+		for (UINT z = 0; z < cells; ++z)
+		{
+			for (UINT x = 0; x < cells; ++x)
+			{
+				UINT corner = z * (cells + 1) + x;
+				UINT quad[6] = { corner, corner + cells + 1, corner + 1, corner + 1, corner + cells + 1, corner + cells + 2 };
+				mesh.Indices.insert(mesh.Indices.end(), quad, quad + 6);
+			}
+		}
+		return mesh;
+	}
+
+	//
+	// A unit sphere around the origin made of rings x segments quads, the poles included as rings
+	// of vertices that all sit at the same point
+	//
+	inline Mesh MakeSphere(
+		_In_ UINT rings,
+		_In_ UINT segments)
+	{
+		const float pi = 3.14159265f;
+
+		Mesh mesh;
+		for (UINT r = 0; r <= rings; ++r)
+		{
+			float theta = pi * r / rings;
+			for (UINT s = 0; s <= segments; ++s)
+			{
+				float phi = 2.0f * pi * s / segments;
+				DirectX::XMFLOAT3 p(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+				StaticVertex vertex = { p, p, DirectX::XMFLOAT2((float)s / segments, (float)r / rings) };
+				mesh.Vertices.push_back(vertex);
+			}
+		}
+
+		for (UINT r = 0; r < rings; ++r)
+		{
+			for (UINT s = 0; s < segments; ++s)
+			{
+				UINT corner = r * (segments + 1) + s;
+				UINT quad[6] = { corner, corner + 1, corner + segments + 1, corner + 1, corner + segments + 2, corner + segments + 1 };
+				mesh.Indices.insert(mesh.Indices.end(), quad, quad + 6);
+			}
+		}
+		return mesh;
+	}
+
+	//
+	// A model holding the given meshes under a single root node. The view points into Meshes, so
+	// they must not be changed while it is used
+	//
+	struct Model
+	{
+		std::vector<Mesh> Meshes;
+		Engine::KsmModelView View;
+	};
+
+	inline void BuildView(_Inout_ Model& model)
+	{
+		Engine::KsmModelView& view = model.View;
+		view = Engine::KsmModelView();
+		view.Version = Engine::KsmVersion;
+		view.NumMeshes = static_cast<UINT>(model.Meshes.size());
+		view.NumMaterials = view.NumMeshes;
+		view.NumTextures = 0;
+		view.NumAnimations = 0;
+		view.BoundsCenter = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+		view.BoundsExtents = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+
+		Engine::KsmNodeView root;
+		root.Name = L"root";
+		memset(&root.LocalTransform, 0, sizeof(root.LocalTransform));
+		for (int i = 0; i < 4; ++i)
+		{
+			root.LocalTransform.m[i][i] = 1.0f;
+		}
+		root.Parent = Engine::KsmNone;
+		root.ChannelIndex = Engine::KsmNone;
+		root.FirstMesh = 0;
+		root.MeshCount = view.NumMeshes;
+		view.Nodes.push_back(root);
+
+		for (Mesh& mesh : model.Meshes)
+		{
+			Engine::KsmMeshView meshView = Engine::KsmMeshView();
+			meshView.FaceCount = static_cast<UINT>(mesh.Indices.size() / 3);
+			meshView.VertexCount = static_cast<UINT>(mesh.Vertices.size());
+			meshView.IndexCount = static_cast<UINT>(mesh.Indices.size());
+			meshView.Diffuse = DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+			meshView.Opacity = 1.0f;
+			meshView.IndicesAre16Bit = mesh.Vertices.size() <= 0x10000;
+			meshView.IndexSize = sizeof(UINT);
+			meshView.IndexData = reinterpret_cast<byte*>(mesh.Indices.data());
+			meshView.Vertices = reinterpret_cast<byte*>(mesh.Vertices.data());
+			meshView.VertexStride = sizeof(StaticVertex);
+			meshView.BoundsCenter = view.BoundsCenter;
+			meshView.BoundsExtents = view.BoundsExtents;
+			view.Meshes.push_back(meshView);
+		}
+	}
+}
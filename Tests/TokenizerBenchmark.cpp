@@ -0,0 +1,140 @@
+//////////////////////////////////////////////////////////////////////////
+// TokenizerBenchmark.cpp
+// Measures how fast the script tokenizer gets through a generated script
+// corpus. Prints a checksum of the token classes and lengths so builds
+// with and without the SSE2 scanner (AS_NO_SIMD) can be compared
+// (c) 2012 Overclocked Games LLC
+//////////////////////////////////////////////////////////////////////////
+
+#include <angelscript.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace
+{
+	// A fixed generator so every build tokenizes the same corpus
+	struct Random
+	{
+		unsigned int State;
+
+		unsigned int Next()
+		{
+			State = State * 1664525u + 1013904223u;
+			return State >> 8;
+		}
+	};
+
+	const char* const Keywords[] = { "class", "void", "int", "float", "if", "else", "return", "for", "const", "bool", "!is", "in", "out", "inout", "null" };
+	const char* const Operators[] = { "+", "-", "*", "/", "=", "==", "+=", "<", ">=", "(", ")", "{", "}", "[", "]", ";", ",", ".", "&", "@" };
+
+	void appendIdentifier(std::string& s, Random& random)
+	{
+		// Mostly short names, with the odd long one so the 16 byte scan and the tail both get used
+		unsigned int length = 1 + random.Next() % ((random.Next() % 8 == 0) ? 40 : 10);
+		static const char first[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_";
+		static const char rest[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+		s += first[random.Next() % (sizeof(first) - 1)];
+		for (unsigned int i = 1; i < length; ++i)
+		{
+			s += rest[random.Next() % (sizeof(rest) - 1)];
+		}
+	}
+
+	void appendWhiteSpace(std::string& s, Random& random)
+	{
+		static const char ws[] = " \t\r\n";
+		unsigned int length = 1 + random.Next() % ((random.Next() % 6 == 0) ? 24 : 3);
+		for (unsigned int i = 0; i < length; ++i)
+		{
+			s += ws[random.Next() % 4];
+		}
+	}
+
+	std::string buildCorpus(size_t size)
+	{
+		Random random = { 12345 };
+		std::string s;
+		while (s.size() < size)
+		{
+			switch (random.Next() % 12)
+			{
+			case 0: case 1: case 2: case 3:
+				appendIdentifier(s, random);
+				break;
+			case 4:
+				s += Keywords[random.Next() % (sizeof(Keywords) / sizeof(Keywords[0]))];
+				break;
+			case 5: case 6:
+				s += Operators[random.Next() % (sizeof(Operators) / sizeof(Operators[0]))];
+				break;
+			case 7:
+				s += std::to_string(random.Next() % 100000);
+				if (random.Next() % 2) s += ".5f";
+				break;
+			case 8:
+				s += "// a comment about ";
+				appendIdentifier(s, random);
+				s += "\n";
+				break;
+			case 9:
+				s += "/* a longer * comment\n   over lines */";
+				break;
+			case 10:
+				s += "\"text ";
+				appendIdentifier(s, random);
+				s += "\"";
+				break;
+			default:
+				// Bytes above 127 are never part of an identifier
+				if (random.Next() % 16 == 0) s += "\xC3\xA9";
+				break;
+			}
+			appendWhiteSpace(s, random);
+		}
+		return s;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	size_t size = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 8 << 20;
+	int passes = (argc > 2) ? atoi(argv[2]) : 5;
+
+	asIScriptEngine* engine = asCreateScriptEngine(ANGELSCRIPT_VERSION);
+	std::string corpus = buildCorpus(size);
+
+	unsigned int checksum = 2166136261u;
+	size_t tokens = 0;
+	double best = 1e30;
+	for (int pass = 0; pass < passes; ++pass)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		const char* p = corpus.c_str();
+		size_t remaining = corpus.size();
+		while (remaining > 0)
+		{
+			int length = 0;
+			asETokenClass tokenClass = engine->ParseToken(p, remaining, &length);
+			if (pass == 0)
+			{
+				checksum = (checksum ^ (unsigned int)tokenClass) * 16777619u;
+				checksum = (checksum ^ (unsigned int)length) * 16777619u;
+				++tokens;
+			}
+			p += length;
+			remaining -= length;
+		}
+
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		best = (ms < best) ? ms : best;
+	}
+
+	printf("tokenized %.1f MB into %zu tokens in %.1f ms: %.0f MB/s\n", corpus.size() / 1048576.0, tokens, best, corpus.size() / 1048576.0 / (best / 1000.0));
+	printf("checksum %08x\n", checksum);
+
+	engine->Release();
+	return 0;
+}